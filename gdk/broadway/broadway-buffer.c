@@ -4,6 +4,16 @@
 
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 /* This code is based on some code from weston with this license:
  *
  * Copyright © 2012 Intel Corporation
@@ -36,7 +46,16 @@ struct entry {
 };
 
 struct _BroadwayBuffer {
+  int ref_count;
   guint8 *data;
+  /* One byte per block, non-zero if the block differs from the previous
+   * buffer passed to broadway_buffer_create(). NULL if all blocks do. */
+  guint8 *damage;
+  /* The previous buffer passed to broadway_buffer_create(), kept so that
+   * the next buffer can reuse its memory, see recycle_buffer() */
+  BroadwayBuffer *prev;
+  /* The hash of every block on the grid, valid once encoded */
+  guint32 *grid_hashes;
   struct entry *table;
   int width, height, stride;
   int encoded;
@@ -57,6 +76,149 @@ static const guint32 end_vprime = 0xcdb99001;	/* vprime^block_size */
 static const guint32 step = 0x0ac93019;
 static const int block_size = 32, block_mask = 31;
 
+/* Damage detection
+ *
+ * Instead of hashing and encoding every pixel of every frame, we compare
+ * the new pixels with the previous buffer, one block_size x block_size
+ * tile at a time. Tiles that didn't change are encoded as a single delta
+ * 0 run, only the changed tiles are hashed and searched for block matches.
+ *
+ * If the app tells us which areas it painted, the other tiles are not
+ * even looked at. Their pixels are taken from the previous buffer, and
+ * if we can reuse the memory of the buffer before that one, only the
+ * tiles that changed in the previous frame need to be copied.
+ */
+
+#if defined(__SSE2__)
+
+static gboolean
+tile_differs (const guint8 *a,
+              const guint8 *b,
+              int           stride,
+              int           bytes,
+              int           rows)
+{
+  __m128i diff = _mm_setzero_si128 ();
+  int i, k;
+
+  for (i = 0; i < rows; i++)
+    {
+      const guint8 *row_a = a + i * stride;
+      const guint8 *row_b = b + i * stride;
+
+      for (k = 0; k + 16 <= bytes; k += 16)
+        diff = _mm_or_si128 (diff,
+                             _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (row_a + k)),
+                                            _mm_loadu_si128 ((const __m128i *) (row_b + k))));
+
+      if (k < bytes && memcmp (row_a + k, row_b + k, bytes - k) != 0)
+        return TRUE;
+    }
+
+  return _mm_movemask_epi8 (_mm_cmpeq_epi8 (diff, _mm_setzero_si128 ())) != 0xffff;
+}
+
+#else
+
+static gboolean
+tile_differs (const guint8 *a,
+              const guint8 *b,
+              int           stride,
+              int           bytes,
+              int           rows)
+{
+  int i;
+
+  for (i = 0; i < rows; i++)
+    {
+      if (memcmp (a + i * stride, b + i * stride, bytes) != 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+#endif
+
+/* Computes the hash of the block_size pixels starting at each x in
+ * [x0, x1) of @line, treating pixels beyond @width as 0.
+ */
+static void
+compute_row_hashes (const guint32 *line,
+                    int            width,
+                    int            x0,
+                    int            x1,
+                    guint32       *hashes)
+{
+  guint32 hash = 0;
+  int j;
+
+  for (j = x0; j < x0 + block_size; j++)
+    {
+      hash = hash * prime;
+      if (j < width)
+        hash += line[j];
+    }
+
+  for (j = x0; j < x1; j++)
+    {
+      hashes[j] = hash;
+
+      hash = hash * prime - line[j] * end_prime;
+      if (j + block_size < width)
+        hash += line[j + block_size];
+    }
+}
+
+/* Moves the block hashes of @n columns down by one row, by removing
+ * the row hashes of the top row and adding those of the new bottom row.
+ */
+static void
+roll_block_hashes (guint32       *block_hashes,
+                   const guint32 *top,
+                   const guint32 *bottom,
+                   int            n)
+{
+  int j = 0;
+
+#if defined(__AVX2__)
+  {
+    const __m256i v = _mm256_set1_epi32 (vprime);
+    const __m256i end_v = _mm256_set1_epi32 (end_vprime);
+
+    for (; j + 8 <= n; j += 8)
+      {
+        __m256i h = _mm256_loadu_si256 ((const __m256i *) (block_hashes + j));
+        __m256i t = _mm256_loadu_si256 ((const __m256i *) (top + j));
+        __m256i b = _mm256_loadu_si256 ((const __m256i *) (bottom + j));
+
+        h = _mm256_sub_epi32 (_mm256_add_epi32 (_mm256_mullo_epi32 (h, v), b),
+                              _mm256_mullo_epi32 (t, end_v));
+        _mm256_storeu_si256 ((__m256i *) (block_hashes + j), h);
+      }
+  }
+#elif defined(__SSE4_1__)
+  {
+    const __m128i v = _mm_set1_epi32 (vprime);
+    const __m128i end_v = _mm_set1_epi32 (end_vprime);
+
+    for (; j + 4 <= n; j += 4)
+      {
+        __m128i h = _mm_loadu_si128 ((const __m128i *) (block_hashes + j));
+        __m128i t = _mm_loadu_si128 ((const __m128i *) (top + j));
+        __m128i b = _mm_loadu_si128 ((const __m128i *) (bottom + j));
+
+        h = _mm_sub_epi32 (_mm_add_epi32 (_mm_mullo_epi32 (h, v), b),
+                           _mm_mullo_epi32 (t, end_v));
+        _mm_storeu_si128 ((__m128i *) (block_hashes + j), h);
+      }
+  }
+#endif
+
+  for (; j < n; j++)
+    block_hashes[j] = block_hashes[j] * vprime + bottom[j] - top[j] * end_vprime;
+}
+
 static gboolean
 verify_block_match (BroadwayBuffer *buffer, int x, int y,
                     BroadwayBuffer *prev, struct entry *entry)
@@ -258,6 +420,46 @@ encode_pixel (struct encoder *encoder, guint32 color, guint32 prev_color)
     }
 }
 
+/* Encodes the @n pixels of @line that are the same as in the previous
+ * frame. Other than continuing a pending color run, this doesn't look at
+ * the pixels and just turns them into a delta 0 run.
+ */
+static void
+encode_unchanged (struct encoder *encoder, const guint32 *line, guint32 n)
+{
+  while (n > 0 && encoder->color_run > encoder->delta_run &&
+         *line == encoder->color)
+    {
+      encode_pixel (encoder, *line, *line);
+      line++;
+      n--;
+    }
+
+  if (n == 0)
+    return;
+
+  if (encoder->delta_run == 0 ||
+      encoder->delta != 0 ||
+      encoder->delta_run < encoder->color_run)
+    {
+      encode_run (encoder);
+      encoder->delta = 0;
+      encoder->delta_run = 0;
+    }
+
+  encoder->color_run = 0;
+
+  while (encoder->delta_run + n > 0xFFFFF)
+    {
+      n -= 0xFFFFF - encoder->delta_run;
+      encoder->delta_run = 0xFFFFF;
+      encode_run (encoder);
+      encoder->delta_run = 0;
+    }
+
+  encoder->delta_run += n;
+}
+
 static void
 encoder_flush (struct encoder *encoder)
 {
@@ -278,10 +480,27 @@ encode_block (struct encoder *encoder, struct entry *entry, int x, int y)
   emit (encoder, (x << 16) | y);
 }
 
+/* Buffers are encoded in worker threads, so they are refcounted */
+BroadwayBuffer *
+broadway_buffer_ref (BroadwayBuffer *buffer)
+{
+  g_atomic_int_inc (&buffer->ref_count);
+
+  return buffer;
+}
+
 void
-broadway_buffer_destroy (BroadwayBuffer *buffer)
+broadway_buffer_unref (BroadwayBuffer *buffer)
 {
+  if (!g_atomic_int_dec_and_test (&buffer->ref_count))
+    return;
+
+  if (buffer->prev)
+    broadway_buffer_unref (buffer->prev);
+
   g_free (buffer->data);
+  g_free (buffer->damage);
+  g_free (buffer->grid_hashes);
   g_free (buffer->table);
   g_free (buffer);
 }
@@ -327,13 +546,264 @@ unpremultiply_line (void *destp, void *srcp, int width)
     }
 }
 
+#if defined(__SSE2__)
+
+/* Computes (v * 255 + alpha / 2) / alpha for one channel of 4 pixels.
+ * All values involved are exactly representable as floats, and the
+ * quotient we get from multiplying with the reciprocal is off by at
+ * most one, so we correct it to get the same result as the integer
+ * division in unpremultiply_line().
+ */
+static inline __m128i
+unpremultiply_channel (__m128i pixels,
+                       int     shift,
+                       __m128  alpha,
+                       __m128  half_alpha,
+                       __m128  inv_alpha)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128 v, q, n;
+
+  v = _mm_cvtepi32_ps (_mm_and_si128 (_mm_srli_epi32 (pixels, shift), _mm_set1_epi32 (0xff)));
+  n = _mm_add_ps (_mm_mul_ps (v, _mm_set1_ps (255.0f)), half_alpha);
+  q = _mm_cvtepi32_ps (_mm_cvttps_epi32 (_mm_mul_ps (n, inv_alpha)));
+
+  q = _mm_sub_ps (q, _mm_and_ps (_mm_cmpgt_ps (_mm_mul_ps (q, alpha), n), one));
+  q = _mm_add_ps (q, _mm_and_ps (_mm_cmple_ps (_mm_mul_ps (_mm_add_ps (q, one), alpha), n), one));
+
+  return _mm_slli_epi32 (_mm_and_si128 (_mm_cvttps_epi32 (q), _mm_set1_epi32 (0xff)), shift);
+}
+
+static void
+unpremultiply_line_sse2 (void *destp, void *srcp, int width)
+{
+  const __m128i alpha_mask = _mm_set1_epi32 (0xff000000);
+  guint32 *src = srcp;
+  guint32 *dest = destp;
+  int i;
+
+  for (i = 0; i + 4 <= width; i += 4)
+    {
+      __m128i pixels = _mm_loadu_si128 ((const __m128i *) (src + i));
+      __m128i alpha_bits = _mm_and_si128 (pixels, alpha_mask);
+      __m128i transparent = _mm_cmpeq_epi32 (alpha_bits, _mm_setzero_si128 ());
+      __m128 alpha, half_alpha, inv_alpha;
+      __m128i result;
+
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (alpha_bits, alpha_mask)) == 0xffff)
+        {
+          _mm_storeu_si128 ((__m128i *) (dest + i), pixels);
+          continue;
+        }
+
+      if (_mm_movemask_epi8 (transparent) == 0xffff)
+        {
+          _mm_storeu_si128 ((__m128i *) (dest + i), _mm_setzero_si128 ());
+          continue;
+        }
+
+      alpha = _mm_cvtepi32_ps (_mm_srli_epi32 (pixels, 24));
+      half_alpha = _mm_cvtepi32_ps (_mm_srli_epi32 (pixels, 25));
+      /* transparent pixels get a bogus result here, they are masked out below */
+      inv_alpha = _mm_div_ps (_mm_set1_ps (1.0f), _mm_max_ps (alpha, _mm_set1_ps (1.0f)));
+
+      result = _mm_or_si128 (alpha_bits,
+                             _mm_or_si128 (unpremultiply_channel (pixels, 16, alpha, half_alpha, inv_alpha),
+                                           _mm_or_si128 (unpremultiply_channel (pixels, 8, alpha, half_alpha, inv_alpha),
+                                                         unpremultiply_channel (pixels, 0, alpha, half_alpha, inv_alpha))));
+      result = _mm_andnot_si128 (transparent, result);
+
+      _mm_storeu_si128 ((__m128i *) (dest + i), result);
+    }
+
+  unpremultiply_line (dest + i, src + i, width - i);
+}
+
+#define unpremultiply_line unpremultiply_line_sse2
+
+#endif
+
+/* Marks the tiles touched by @rects */
+static guint8 *
+get_painted_tiles (BroadwayBuffer     *buffer,
+                   const BroadwayRect *rects,
+                   int                 n_rects)
+{
+  guint8 *painted;
+  int i, tx, ty;
+
+  painted = g_malloc0 (buffer->block_count);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      int x0 = MAX (rects[i].x, 0);
+      int y0 = MAX (rects[i].y, 0);
+      int x1 = MIN (rects[i].x + rects[i].width, buffer->width);
+      int y1 = MIN (rects[i].y + rects[i].height, buffer->height);
+
+      if (x0 >= x1 || y0 >= y1)
+        continue;
+
+      for (ty = y0 / block_size; ty <= (y1 - 1) / block_size; ty++)
+        for (tx = x0 / block_size; tx <= (x1 - 1) / block_size; tx++)
+          painted[ty * buffer->block_stride + tx] = 1;
+    }
+
+  return painted;
+}
+
+static void
+copy_tile (guint8       *dest,
+           const guint8 *src,
+           int           stride,
+           int           bytes,
+           int           rows)
+{
+  int i;
+
+  for (i = 0; i < rows; i++)
+    memcpy (dest + i * stride, src + i * stride, bytes);
+}
+
+/* Fills in @buffer from @src and @prev, and finds the tiles that differ
+ * from @prev. If @painted is given, only those tiles are read from @src.
+ * If @recycled is set, @buffer already contains the buffer @prev was
+ * created against, so only the tiles @prev changed need to be copied.
+ */
+static void
+update_tiles (BroadwayBuffer *buffer,
+              BroadwayBuffer *prev,
+              guint8         *src,
+              int             src_stride,
+              const guint8   *painted,
+              gboolean        recycled)
+{
+  int tiles_x, tiles_y, tx, ty, x0, x1, y;
+  const guint8 *p;
+  guint8 *damage;
+
+  tiles_x = buffer->block_stride;
+  tiles_y = buffer->block_count / tiles_x;
+
+  for (ty = 0; ty < tiles_y; ty++)
+    {
+      int y0 = ty * block_size;
+      int rows = MIN (block_size, buffer->height - y0);
+
+      damage = buffer->damage + ty * tiles_x;
+      p = painted ? painted + ty * tiles_x : NULL;
+
+      /* Unpremultiply runs of painted tiles in one go */
+      for (tx = 0; tx < tiles_x; tx = x1)
+        {
+          if (p && !p[tx])
+            {
+              x1 = tx + 1;
+              continue;
+            }
+
+          for (x1 = tx + 1; x1 < tiles_x && (p == NULL || p[x1]); x1++)
+            ;
+
+          x0 = tx * block_size;
+          for (y = y0; y < y0 + rows; y++)
+            unpremultiply_line (buffer->data + y * buffer->stride + x0 * 4,
+                                src + y * src_stride + x0 * 4,
+                                MIN (x1 * block_size, buffer->width) - x0);
+        }
+
+      for (tx = 0; tx < tiles_x; tx++)
+        {
+          int offset = y0 * buffer->stride + tx * block_size * 4;
+          int bytes = MIN (block_size, buffer->width - tx * block_size) * 4;
+
+          if (p == NULL || p[tx])
+            {
+              damage[tx] = tile_differs (buffer->data + offset,
+                                         prev->data + offset,
+                                         buffer->stride,
+                                         bytes,
+                                         rows);
+            }
+          else
+            {
+              damage[tx] = 0;
+              if (!recycled || prev->damage[ty * tiles_x + tx])
+                copy_tile (buffer->data + offset, prev->data + offset,
+                           buffer->stride, bytes, rows);
+            }
+        }
+    }
+}
+
+/* Takes over the buffer @prev was created against, if nobody else
+ * (like an encoder thread) uses it anymore. Either way, @prev doesn't
+ * keep it alive any longer.
+ */
+static BroadwayBuffer *
+recycle_buffer (BroadwayBuffer *prev)
+{
+  BroadwayBuffer *old = prev->prev;
+
+  prev->prev = NULL;
+
+  if (old == NULL)
+    return NULL;
+
+  if (g_atomic_int_get (&old->ref_count) != 1 ||
+      old->width != prev->width || old->height != prev->height)
+    {
+      broadway_buffer_unref (old);
+      return NULL;
+    }
+
+  memset (old->table, 0, old->length * sizeof old->table[0]);
+  memset (old->stats, 0, sizeof old->stats);
+  old->clashes = 0;
+  old->encoded = 0;
+
+  return old;
+}
+
+/* If @prev is given, only the parts that differ from it are processed,
+ * and when encoding, @prev must be passed as the previous buffer again
+ * (or %NULL to encode the whole buffer).
+ *
+ * @rects are the areas of @data that changed since @prev was created.
+ * If @n_rects is 0, any part of @data may have changed.
+ */
 BroadwayBuffer *
-broadway_buffer_create (int width, int height, guint8 *data, int stride)
+broadway_buffer_create (int                 width,
+                        int                 height,
+                        guint8             *data,
+                        int                 stride,
+                        BroadwayBuffer     *prev,
+                        const BroadwayRect *rects,
+                        int                 n_rects)
 {
   BroadwayBuffer *buffer;
+  guint8 *painted;
   int y, bits_required;
 
+  if (prev && (prev->width != width || prev->height != height))
+    prev = NULL;
+
+  buffer = prev ? recycle_buffer (prev) : NULL;
+  if (buffer)
+    {
+      if (buffer->damage == NULL)
+        buffer->damage = g_malloc (buffer->block_count);
+      painted = n_rects > 0 ? get_painted_tiles (buffer, rects, n_rects) : NULL;
+      update_tiles (buffer, prev, data, stride, painted, TRUE);
+      g_free (painted);
+
+      buffer->prev = broadway_buffer_ref (prev);
+
+      return buffer;
+    }
+
   buffer = g_new0 (BroadwayBuffer, 1);
+  buffer->ref_count = 1;
   buffer->width = width;
   buffer->stride = width * 4;
   buffer->height = height;
@@ -346,161 +816,252 @@ broadway_buffer_create (int width, int height, guint8 *data, int stride)
   buffer->length = 1 << bits_required;
 
   buffer->table = g_malloc0 (buffer->length * sizeof buffer->table[0]);
+  buffer->grid_hashes = g_new (guint32, buffer->block_count);
 
   memset (buffer->stats, 0, sizeof buffer->stats);
   buffer->clashes = 0;
 
   buffer->data = g_malloc (buffer->stride * height);
 
-  for (y = 0; y < height; y++)
-    unpremultiply_line (buffer->data + y * buffer->stride, data + y * stride, width);
+  if (prev)
+    {
+      buffer->damage = g_malloc (buffer->block_count);
+      painted = n_rects > 0 ? get_painted_tiles (buffer, rects, n_rects) : NULL;
+      update_tiles (buffer, prev, data, stride, painted, FALSE);
+      g_free (painted);
+
+      buffer->prev = broadway_buffer_ref (prev);
+    }
+  else
+    {
+      for (y = 0; y < height; y++)
+        unpremultiply_line (buffer->data + y * buffer->stride, data + y * stride, width);
+    }
 
   return buffer;
 }
 
+/* Hashes the block at @x, @y directly, for blocks that are not
+ * covered by the sliding hashes in broadway_buffer_encode().
+ */
+static guint32
+hash_block (BroadwayBuffer *buffer, int x, int y)
+{
+  guint32 hash = 0, row_hash;
+  guint32 *line;
+  int i, j;
+
+  for (i = y; i < y + block_size; i++)
+    {
+      row_hash = 0;
+      if (i < buffer->height)
+        {
+          line = (guint32 *) (buffer->data + i * buffer->stride);
+          for (j = x; j < x + block_size; j++)
+            {
+              row_hash = row_hash * prime;
+              if (j < buffer->width)
+                row_hash += line[j];
+            }
+        }
+
+      hash = hash * vprime + row_hash;
+    }
+
+  return hash;
+}
+
+/* Sets up the sliding block hashes for the columns [x0, x1) at row @y */
+static void
+init_block_hashes (BroadwayBuffer *buffer,
+                   guint32        *block_hashes,
+                   guint32        *row_hashes,
+                   const guint32  *zeros,
+                   int             x0,
+                   int             x1,
+                   int             y)
+{
+  int i;
+
+  memset (block_hashes + x0, 0, (x1 - x0) * sizeof (guint32));
+
+  for (i = y; i < y + block_size; i++)
+    {
+      if (i < buffer->height)
+        compute_row_hashes ((guint32 *) (buffer->data + i * buffer->stride),
+                            buffer->width, x0, x1, row_hashes);
+      else
+        memset (row_hashes + x0, 0, (x1 - x0) * sizeof (guint32));
+
+      roll_block_hashes (block_hashes + x0, zeros + x0, row_hashes + x0, x1 - x0);
+    }
+}
+
 void
 broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *dest)
 {
   struct entry *entry;
   int i, j, k;
-  int x0, x1, y0, y1;
-  guint32 *block_hashes;
-  guint32 hash, bottom_hash, h, *line, *bottom, *prev_line;
+  int x0, x1, tx, ty, tiles_x, tiles_y, y_end;
+  guint32 *block_hashes, *hashes, *bottom_hashes, *zeros;
+  guint32 h, *line, *bottom, *prev_line;
   int width, height;
   struct encoder encoder = { 0 };
   int *skyline, skyline_pixels;
+  guint8 *encode_tile, *hashed;
   int matches;
 
   width = buffer->width;
   height = buffer->height;
-  x0 = 0;
-  x1 = width;
-  y0 = 0;
-  y1 = height;
+  tiles_x = buffer->block_stride;
+  tiles_y = buffer->block_count / tiles_x;
 
   skyline = g_malloc0 ((width + block_size) * sizeof skyline[0]);
 
   block_hashes = g_malloc0 (width * sizeof block_hashes[0]);
+  hashes = g_malloc (width * sizeof hashes[0]);
+  bottom_hashes = g_malloc (width * sizeof bottom_hashes[0]);
+  zeros = g_malloc0 (width * sizeof zeros[0]);
+
+  /* Tiles that are unchanged from prev don't need to be looked at */
+  encode_tile = g_malloc (buffer->block_count);
+  if (prev && buffer->damage)
+    memcpy (encode_tile, buffer->damage, buffer->block_count);
+  else
+    memset (encode_tile, 1, buffer->block_count);
+
+  /* Whether the block hashes of a tile column are valid for the current row */
+  hashed = g_malloc0 (tiles_x);
 
   matches = 0;
   encoder.dest = dest;
 
-  // Calculate the block hashes for the first row
-  for (i = y0; i < MIN(y1, y0 + block_size); i++)
+  for (ty = 0; ty < tiles_y; ty++)
     {
-      line = (guint32 *)(buffer->data + i * buffer->stride);
-      hash = 0;
-      for (j = x0; j < MIN(x1, x0 + block_size); j++)
-        hash = hash * prime + line[j];
-      for (; j < x0 + block_size; j++)
-        hash = hash * prime;
-
-      for (j = x0; j < x1; j++)
+      guint8 *row_encode = encode_tile + ty * tiles_x;
+      int y0 = ty * block_size;
+
+      for (tx = 0; tx < tiles_x; tx++)
         {
-          block_hashes[j] = block_hashes[j] * vprime + hash;
+          gboolean sliding = prev && row_encode[tx];
 
-          hash = hash * prime - line[j] * end_prime;
-          if (j + block_size < width)
-            hash += line[j + block_size];
-        }
-    }
-  // Do the last rows if height < block_size
-  for (; i < y0 + block_size; i++)
-    {
-      for (j = x0; j < x1; j++)
-        block_hashes[j] = block_hashes[j] * vprime;
-    }
+          x0 = tx * block_size;
+          x1 = MIN (x0 + block_size, width);
 
-  for (i = y0; i < y1; i++)
-    {
-      line = (guint32 *) (buffer->data + i * buffer->stride);
-      bottom = (guint32 *) (buffer->data + (i + block_size) * buffer->stride);
-      bottom_hash = 0;
-      hash = 0;
-      skyline_pixels = 0;
-
-      if (prev && i < prev->height)
-        prev_line = (guint32 *) (prev->data + i * prev->stride);
-      else
-        prev_line = NULL;
+          /* We only need the sliding hashes where we look for matches */
+          if (sliding && !hashed[tx])
+            init_block_hashes (buffer, block_hashes, hashes, zeros, x0, x1, y0);
+          hashed[tx] = sliding;
 
-      for (j = x0; j < x0 + block_size; j++)
-        {
-          hash = hash * prime;
-          if (j < width)
-            hash += line[j];
-          if (i + block_size < height)
+          if (!buffer->encoded)
             {
-              bottom_hash = bottom_hash * prime;
-              if (j < width)
-                bottom_hash += bottom[j];
+              if (sliding)
+                h = block_hashes[x0];
+              else if (!row_encode[tx] && prev->encoded)
+                h = prev->grid_hashes[ty * tiles_x + tx];
+              else
+                h = hash_block (buffer, x0, y0);
+
+              buffer->grid_hashes[ty * tiles_x + tx] = h;
+              insert_block (buffer, h, x0, y0);
             }
-          if (i < skyline[j])
-            skyline_pixels = 0;
-          else
-            skyline_pixels++;
         }
 
-      for (j = x0; j < x1; j++)
+      y_end = MIN (y0 + block_size, height);
+      for (i = y0; i < y_end; i++)
         {
-          if (i < skyline[j])
-            encode_pixel (&encoder, line[j], line[j]);
-          else if (prev)
+          line = (guint32 *) (buffer->data + i * buffer->stride);
+          if (i + block_size < height)
+            bottom = (guint32 *) (buffer->data + (i + block_size) * buffer->stride);
+          else
+            bottom = NULL;
+
+          if (prev && i < prev->height)
+            prev_line = (guint32 *) (prev->data + i * prev->stride);
+          else
+            prev_line = NULL;
+
+          for (tx = 0; tx < tiles_x; )
             {
-              /* FIXME: Add back overlap exception
-               * for consecutive blocks */
-
-              h = block_hashes[j];
-              entry = lookup_block (prev, h);
-              if (entry && entry->count < 2 &&
-                  skyline_pixels >= block_size &&
-                  verify_block_match (buffer, j, i, prev, entry) &&
-                  (entry->x != j || entry->y != i))
-                {
-                  matches++;
-                  encode_block (&encoder, entry, j, i);
+              x0 = tx * block_size;
 
-                  for (k = 0; k < block_size; k++)
-                    skyline[j + k] = i + block_size;
+              if (!row_encode[tx])
+                {
+                  for (tx++; tx < tiles_x && !row_encode[tx]; tx++)
+                    ;
 
-                  encode_pixel (&encoder, line[j], line[j]);
+                  encode_unchanged (&encoder, line + x0, MIN (tx * block_size, width) - x0);
+                  continue;
                 }
-              else
+
+              for (tx++; tx < tiles_x && row_encode[tx]; tx++)
+                ;
+              x1 = MIN (tx * block_size, width);
+
+              if (prev)
                 {
-                  if (prev_line && j < prev->width)
-                    encode_pixel (&encoder, line[j],
-                                  prev_line[j]);
+                  compute_row_hashes (line, width, x0, x1, hashes);
+                  if (bottom)
+                    compute_row_hashes (bottom, width, x0, x1, bottom_hashes);
                   else
-                    encode_pixel (&encoder, line[j], 0);
+                    memset (bottom_hashes + x0, 0, (x1 - x0) * sizeof (guint32));
                 }
-            }
-          else
-            encode_pixel (&encoder, line[j], 0);
 
-          if (i < skyline[j + block_size])
-            skyline_pixels = 0;
-          else
-            skyline_pixels++;
+              skyline_pixels = 0;
+              for (j = x0; j < x0 + block_size; j++)
+                {
+                  if (i < skyline[j])
+                    skyline_pixels = 0;
+                  else
+                    skyline_pixels++;
+                }
 
-          /* Insert block in hash table if we're on a
-           * grid point. */
-          if (((i | j) & block_mask) == 0 && !buffer->encoded)
-            insert_block (buffer, block_hashes[j], j, i);
+              for (j = x0; j < x1; j++)
+                {
+                  if (i < skyline[j])
+                    encode_pixel (&encoder, line[j], line[j]);
+                  else if (prev)
+                    {
+                      /* FIXME: Add back overlap exception
+                       * for consecutive blocks */
+
+                      h = block_hashes[j];
+                      entry = lookup_block (prev, h);
+                      if (entry && entry->count < 2 &&
+                          skyline_pixels >= block_size &&
+                          verify_block_match (buffer, j, i, prev, entry) &&
+                          (entry->x != j || entry->y != i))
+                        {
+                          matches++;
+                          encode_block (&encoder, entry, j, i);
+
+                          for (k = 0; k < block_size; k++)
+                            skyline[j + k] = i + block_size;
+
+                          encode_pixel (&encoder, line[j], line[j]);
+                        }
+                      else
+                        {
+                          if (prev_line && j < prev->width)
+                            encode_pixel (&encoder, line[j],
+                                          prev_line[j]);
+                          else
+                            encode_pixel (&encoder, line[j], 0);
+                        }
+                    }
+                  else
+                    encode_pixel (&encoder, line[j], 0);
 
-          /* Update sliding block hash */
-          block_hashes[j] =
-            block_hashes[j] * vprime + bottom_hash -
-            hash * end_vprime;
+                  if (i < skyline[j + block_size])
+                    skyline_pixels = 0;
+                  else
+                    skyline_pixels++;
+                }
 
-          if (i + block_size < height)
-            {
-              bottom_hash = bottom_hash * prime - bottom[j] * end_prime;
-              if (j + block_size < width)
-                bottom_hash += bottom[j + block_size];
+              /* Update sliding block hashes */
+              if (prev)
+                roll_block_hashes (block_hashes + x0, hashes + x0, bottom_hashes + x0, x1 - x0);
             }
-          hash = hash * prime - line[j] * end_prime;
-          if  (j + block_size < width)
-            hash += line[j + block_size] ;
         }
     }
 
@@ -523,6 +1084,11 @@ broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *d
 
   g_free (skyline);
   g_free (block_hashes);
+  g_free (hashes);
+  g_free (bottom_hashes);
+  g_free (zeros);
+  g_free (encode_tile);
+  g_free (hashed);
 
   buffer->encoded = TRUE;
 }
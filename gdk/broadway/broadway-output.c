@@ -11,13 +11,56 @@
  *                Basic I/O primitives                                  *
  ************************************************************************/
 
+typedef struct EncodeJob EncodeJob;
+
 struct BroadwayOutput {
   GOutputStream *out;
   GString *buf;
   int error;
   guint32 serial;
+
+  /* The parts of the current message before buf, if it contains buffers */
+  GPtrArray *parts;
+  /* Messages waiting for their buffers to be encoded, oldest first */
+  GQueue pending;
+  int n_encoding;
+  gboolean closed;
+
+  /* Messages with buffers that the client has not acknowledged yet */
+  GQueue unacked;
+  gsize unacked_bytes;
+  gint64 last_ack_time;
+  /* Estimates for the connection, 0 if unknown */
+  gint64 rtt;          /* in usec */
+  double bandwidth;    /* in bytes per usec */
 };
 
+typedef struct {
+  GPtrArray *parts;
+  /* The serial of the last command in the message */
+  guint32 serial;
+} PendingMessage;
+
+typedef struct {
+  guint32 serial;
+  gsize size;
+  gint64 send_time;
+} SentMessage;
+
+/* A part of a message. Either a buffer being encoded in a worker thread,
+ * which fills in data, or data that is ready to be sent.
+ */
+struct EncodeJob {
+  BroadwayOutput *output;
+  int id;
+  BroadwayBuffer *prev_buffer;
+  BroadwayBuffer *buffer;
+  GString *data;
+  gboolean done; /* protected by encode_lock */
+};
+
+static void send_pending_messages (BroadwayOutput *output);
+
 static void
 broadway_output_send_cmd (BroadwayOutput *output,
 			  gboolean fin, BroadwayWSOpCode code,
@@ -56,19 +99,73 @@ void broadway_output_pong (BroadwayOutput *output)
   broadway_output_send_cmd (output, TRUE, BROADWAY_WS_CNX_PONG, NULL, 0);
 }
 
+static EncodeJob *
+encode_job_new_for_data (GString *data)
+{
+  EncodeJob *job;
+
+  job = g_new0 (EncodeJob, 1);
+  job->data = data;
+  job->done = TRUE;
+
+  return job;
+}
+
+static void
+encode_job_free (EncodeJob *job)
+{
+  g_clear_pointer (&job->prev_buffer, broadway_buffer_unref);
+  g_clear_pointer (&job->buffer, broadway_buffer_unref);
+  if (job->data)
+    g_string_free (job->data, TRUE);
+  g_free (job);
+}
+
+/* Ends the current message at buf, and adds it to the parts */
+static void
+push_buf_part (BroadwayOutput *output)
+{
+  if (output->buf->len == 0)
+    return;
+
+  g_ptr_array_add (output->parts, encode_job_new_for_data (output->buf));
+  output->buf = g_string_new ("");
+}
+
 int
 broadway_output_flush (BroadwayOutput *output)
 {
-  if (output->buf->len == 0)
-    return TRUE;
+  if (output->parts->len == 0 && g_queue_is_empty (&output->pending))
+    {
+      if (output->buf->len == 0)
+        return TRUE;
 
-  broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY,
-                            output->buf->str, output->buf->len);
+      broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY,
+                                output->buf->str, output->buf->len);
 
-  g_string_set_size (output->buf, 0);
+      g_string_set_size (output->buf, 0);
 
-  return !output->error;
+      return !output->error;
+    }
+
+  /* Some buffers are still being encoded, so messages have to wait
+   * for them to keep everything in order. */
+  push_buf_part (output);
+  if (output->parts->len > 0)
+    {
+      PendingMessage *message;
 
+      message = g_new (PendingMessage, 1);
+      message->parts = output->parts;
+      message->serial = output->serial - 1;
+      g_queue_push_tail (&output->pending, message);
+
+      output->parts = g_ptr_array_new_with_free_func ((GDestroyNotify) encode_job_free);
+    }
+
+  send_pending_messages (output);
+
+  return !output->error;
 }
 
 BroadwayOutput *
@@ -81,17 +178,43 @@ broadway_output_new (GOutputStream *out, guint32 serial)
   output->out = g_object_ref (out);
   output->buf = g_string_new ("");
   output->serial = serial;
+  output->parts = g_ptr_array_new_with_free_func ((GDestroyNotify) encode_job_free);
+  g_queue_init (&output->pending);
+  g_queue_init (&output->unacked);
 
   return output;
 }
 
-void
-broadway_output_free (BroadwayOutput *output)
+static void
+pending_message_free (PendingMessage *message)
 {
+  g_ptr_array_unref (message->parts);
+  g_free (message);
+}
+
+static void
+broadway_output_destroy (BroadwayOutput *output)
+{
+  g_queue_foreach (&output->pending, (GFunc) pending_message_free, NULL);
+  g_queue_clear (&output->pending);
+  g_queue_foreach (&output->unacked, (GFunc) g_free, NULL);
+  g_queue_clear (&output->unacked);
+  g_ptr_array_unref (output->parts);
+  g_string_free (output->buf, TRUE);
   g_object_unref (output->out);
   free (output);
 }
 
+void
+broadway_output_free (BroadwayOutput *output)
+{
+  /* Worker threads may still be encoding buffers for us, in that
+   * case we are destroyed once they are done. */
+  output->closed = TRUE;
+  if (output->n_encoding == 0)
+    broadway_output_destroy (output);
+}
+
 guint32
 broadway_output_get_next_serial (BroadwayOutput *output)
 {
@@ -286,29 +409,35 @@ broadway_output_set_transient_for (BroadwayOutput *output,
   append_uint16 (output, parent_id);
 }
 
-void
-broadway_output_put_buffer (BroadwayOutput *output,
-                            int             id,
-                            BroadwayBuffer *prev_buffer,
-                            BroadwayBuffer *buffer)
+/************************************************************************
+ *                Encoding buffers in worker threads                    *
+ ************************************************************************/
+
+/* Encoding and compressing buffers is by far the most expensive thing we
+ * do, so it happens in a thread pool to keep the main loop responsive.
+ * Every buffer is encoded against the previous buffer of its surface, so
+ * the buffers of one surface are encoded one after the other, in order,
+ * while different surfaces are encoded in parallel. The messages that
+ * contain buffers are held back until all their buffers are done, and
+ * are sent in the order they were flushed.
+ */
+
+static GMutex encode_lock;
+static GThreadPool *encode_pool;
+/* surface id => GQueue of jobs, the head is being encoded */
+static GHashTable *surface_queues;
+
+static void
+encode_buffer (EncodeJob *job)
 {
-  gsize len;
-  int w, h;
   GZlibCompressor *compressor;
   GOutputStream *out, *out_mem;
   GString *encoded;
-
-  write_header (output, BROADWAY_OP_PUT_BUFFER);
-
-  w = broadway_buffer_get_width (buffer);
-  h = broadway_buffer_get_height (buffer);
-
-  append_uint16 (output, id);
-  append_uint16 (output, w);
-  append_uint16 (output, h);
+  gsize len;
+  guint8 *buf;
 
   encoded = g_string_new ("");
-  broadway_buffer_encode (buffer, prev_buffer, encoded);
+  broadway_buffer_encode (job->buffer, job->prev_buffer, encoded);
 
   compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1);
   out_mem = g_memory_output_stream_new_resizable ();
@@ -320,13 +449,273 @@ broadway_output_put_buffer (BroadwayOutput *output,
       !g_output_stream_close (out, NULL, NULL))
     g_warning ("compression failed");
 
-
   len = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (out_mem));
-  append_uint32 (output, len);
 
-  g_string_append_len (output->buf, g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (out_mem)), len);
+  job->data = g_string_sized_new (len + 4);
+  g_string_set_size (job->data, 4);
+  buf = (guint8 *) job->data->str;
+  buf[0] = (len >> 0) & 0xff;
+  buf[1] = (len >> 8) & 0xff;
+  buf[2] = (len >> 16) & 0xff;
+  buf[3] = (len >> 24) & 0xff;
+  g_string_append_len (job->data, g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (out_mem)), len);
 
   g_string_free (encoded, TRUE);
   g_object_unref (out);
   g_object_unref (out_mem);
 }
+
+static gboolean
+encode_done_cb (gpointer data)
+{
+  BroadwayOutput *output = data;
+
+  output->n_encoding--;
+
+  if (output->closed)
+    {
+      if (output->n_encoding == 0)
+        broadway_output_destroy (output);
+    }
+  else
+    send_pending_messages (output);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+encode_thread (gpointer data,
+               gpointer user_data)
+{
+  EncodeJob *job = data;
+  BroadwayOutput *output = job->output;
+  EncodeJob *next;
+  GQueue *queue;
+
+  encode_buffer (job);
+
+  /* The next buffer needs this one, but nobody else does */
+  g_clear_pointer (&job->prev_buffer, broadway_buffer_unref);
+
+  g_mutex_lock (&encode_lock);
+
+  queue = g_hash_table_lookup (surface_queues, GINT_TO_POINTER (job->id));
+  g_queue_pop_head (queue);
+  next = g_queue_peek_head (queue);
+  if (next)
+    g_thread_pool_push (encode_pool, next, NULL);
+  else
+    g_hash_table_remove (surface_queues, GINT_TO_POINTER (job->id));
+
+  job->done = TRUE;
+
+  g_mutex_unlock (&encode_lock);
+
+  /* The job may have been sent and freed by now, but the output
+   * stays around until it got this notification. */
+  g_idle_add (encode_done_cb, output);
+}
+
+static void
+queue_encode_job (EncodeJob *job)
+{
+  GQueue *queue;
+
+  g_mutex_lock (&encode_lock);
+
+  if (encode_pool == NULL)
+    {
+      encode_pool = g_thread_pool_new (encode_thread, NULL,
+                                       g_get_num_processors (), FALSE,
+                                       NULL);
+      surface_queues = g_hash_table_new_full (NULL, NULL, NULL,
+                                              (GDestroyNotify) g_queue_free);
+    }
+
+  queue = g_hash_table_lookup (surface_queues, GINT_TO_POINTER (job->id));
+  if (queue == NULL)
+    {
+      queue = g_queue_new ();
+      g_hash_table_insert (surface_queues, GINT_TO_POINTER (job->id), queue);
+    }
+
+  g_queue_push_tail (queue, job);
+  if (queue->length == 1)
+    g_thread_pool_push (encode_pool, job, NULL);
+
+  g_mutex_unlock (&encode_lock);
+}
+
+static GString *
+take_message_if_done (GPtrArray *parts)
+{
+  GString *message;
+  guint i;
+
+  g_mutex_lock (&encode_lock);
+  for (i = 0; i < parts->len; i++)
+    {
+      EncodeJob *job = g_ptr_array_index (parts, i);
+
+      if (!job->done)
+        {
+          g_mutex_unlock (&encode_lock);
+          return NULL;
+        }
+    }
+  g_mutex_unlock (&encode_lock);
+
+  message = g_string_new ("");
+  for (i = 0; i < parts->len; i++)
+    {
+      EncodeJob *job = g_ptr_array_index (parts, i);
+
+      g_string_append_len (message, job->data->str, job->data->len);
+    }
+
+  return message;
+}
+
+static void
+send_pending_messages (BroadwayOutput *output)
+{
+  PendingMessage *pending;
+  SentMessage *sent;
+  GString *message;
+
+  while ((pending = g_queue_peek_head (&output->pending)) != NULL &&
+         (message = take_message_if_done (pending->parts)) != NULL)
+    {
+      broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY,
+                                message->str, message->len);
+
+      sent = g_new (SentMessage, 1);
+      sent->serial = pending->serial;
+      sent->size = message->len;
+      sent->send_time = g_get_monotonic_time ();
+      g_queue_push_tail (&output->unacked, sent);
+      output->unacked_bytes += sent->size;
+
+      g_string_free (message, TRUE);
+      pending_message_free (g_queue_pop_head (&output->pending));
+    }
+}
+
+void
+broadway_output_put_buffer (BroadwayOutput *output,
+                            int             id,
+                            BroadwayBuffer *prev_buffer,
+                            BroadwayBuffer *buffer)
+{
+  EncodeJob *job;
+
+  write_header (output, BROADWAY_OP_PUT_BUFFER);
+
+  append_uint16 (output, id);
+  append_uint16 (output, broadway_buffer_get_width (buffer));
+  append_uint16 (output, broadway_buffer_get_height (buffer));
+
+  push_buf_part (output);
+
+  job = g_new0 (EncodeJob, 1);
+  job->output = output;
+  job->id = id;
+  job->prev_buffer = prev_buffer ? broadway_buffer_ref (prev_buffer) : NULL;
+  job->buffer = broadway_buffer_ref (buffer);
+
+  g_ptr_array_add (output->parts, job);
+  output->n_encoding++;
+
+  queue_encode_job (job);
+}
+
+/************************************************************************
+ *                          Frame pacing                                *
+ ************************************************************************/
+
+/* The web client acknowledges every message with buffers once it has
+ * decoded them. From that we estimate the round trip time and the
+ * bandwidth of the connection, and consider the client congested when
+ * the buffers it has not acknowledged yet would take longer than
+ * MAX_LATENCY to arrive, or when there are too many of them. The server
+ * stops sending buffers to a congested client, see
+ * broadway_server_window_update().
+ */
+
+#define MAX_LATENCY (250 * G_TIME_SPAN_MILLISECOND)
+#define MAX_UNACKED_MESSAGES 4
+
+void
+broadway_output_ack (BroadwayOutput *output,
+                     guint32         serial)
+{
+  SentMessage *sent;
+  gint64 now, start, rtt;
+  gsize acked_bytes;
+  double bandwidth;
+
+  now = g_get_monotonic_time ();
+  start = 0;
+  rtt = 0;
+  acked_bytes = 0;
+
+  while ((sent = g_queue_peek_head (&output->unacked)) != NULL &&
+         sent->serial <= serial)
+    {
+      if (start == 0)
+        start = MAX (sent->send_time, output->last_ack_time);
+      rtt = now - sent->send_time;
+      acked_bytes += sent->size;
+
+      g_free (g_queue_pop_head (&output->unacked));
+    }
+
+  if (acked_bytes == 0)
+    return;
+
+  output->unacked_bytes -= acked_bytes;
+  output->last_ack_time = now;
+
+  /* Exponentially weighted moving averages, like TCP does */
+  if (output->rtt == 0)
+    output->rtt = rtt;
+  else
+    output->rtt = (7 * output->rtt + rtt) / 8;
+
+  bandwidth = (double) acked_bytes / MAX (now - start, 1);
+  if (output->bandwidth == 0)
+    output->bandwidth = bandwidth;
+  else
+    output->bandwidth = (7 * output->bandwidth + bandwidth) / 8;
+}
+
+static int
+count_messages_with_buffers (BroadwayOutput *output)
+{
+  int n;
+
+  n = g_queue_get_length (&output->unacked) + g_queue_get_length (&output->pending);
+  if (output->parts->len > 0)
+    n++;
+
+  return n;
+}
+
+gboolean
+broadway_output_is_congested (BroadwayOutput *output)
+{
+  int n_messages;
+
+  n_messages = count_messages_with_buffers (output);
+  if (n_messages == 0)
+    return FALSE;
+
+  if (n_messages >= MAX_UNACKED_MESSAGES)
+    return TRUE;
+
+  /* Until we know better, allow one message in flight */
+  if (output->bandwidth == 0)
+    return n_messages > 1;
+
+  return output->rtt + output->unacked_bytes / output->bandwidth > MAX_LATENCY;
+}
@@ -58,6 +58,9 @@ void            broadway_output_put_buffer      (BroadwayOutput *output,
 						 int             id,
                                                  BroadwayBuffer *prev_buffer,
                                                  BroadwayBuffer *buffer);
+void            broadway_output_ack             (BroadwayOutput *output,
+                                                 guint32         serial);
+gboolean        broadway_output_is_congested    (BroadwayOutput *output);
 void            broadway_output_grab_pointer    (BroadwayOutput *output,
 						 int id,
 						 gboolean owner_event);
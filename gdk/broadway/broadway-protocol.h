@@ -23,7 +23,9 @@ typedef enum {
   BROADWAY_EVENT_CONFIGURE_NOTIFY = 'w',
   BROADWAY_EVENT_DELETE_NOTIFY = 'W',
   BROADWAY_EVENT_SCREEN_SIZE_CHANGED = 'd',
-  BROADWAY_EVENT_FOCUS = 'f'
+  BROADWAY_EVENT_FOCUS = 'f',
+  BROADWAY_EVENT_BUFFER_ACK = 'A',
+  BROADWAY_EVENT_FRAME_DONE = 'F'
 } BroadwayEventType;
 
 typedef enum {
@@ -128,6 +130,11 @@ typedef struct {
   gint32 old_id;
 } BroadwayInputFocusMsg;
 
+typedef struct {
+  BroadwayInputBaseMsg base;
+  gint32 id;
+} BroadwayInputFrameDoneMsg;
+
 typedef union {
   BroadwayInputBaseMsg base;
   BroadwayInputPointerMsg pointer;
@@ -141,6 +148,7 @@ typedef union {
   BroadwayInputDeleteNotify delete_notify;
   BroadwayInputScreenResizeNotify screen_resize_notify;
   BroadwayInputFocusMsg focus;
+  BroadwayInputFrameDoneMsg frame_done;
 } BroadwayInputMsg;
 
 typedef enum {
@@ -192,6 +200,9 @@ typedef struct {
   char name[36];
   guint32 width;
   guint32 height;
+  /* The areas painted since the last update, 0 if unknown */
+  guint32 n_rects;
+  BroadwayRect rects[1];
 } BroadwayRequestUpdate;
 
 typedef struct {
@@ -116,12 +116,16 @@ struct BroadwayWindow {
 
   BroadwayBuffer *buffer;
   gboolean buffer_synced;
+  /* A newer buffer, held back while the web client is congested */
+  BroadwayBuffer *pending_buffer;
 
   char *cached_surface_name;
   cairo_surface_t *cached_surface;
 };
 
 static void broadway_server_resync_windows (BroadwayServer *server);
+static void send_pending_buffers (BroadwayServer *server);
+static void take_pending_buffers (BroadwayServer *server);
 
 static GType broadway_server_get_type (void);
 
@@ -380,6 +384,80 @@ fake_configure_notify (BroadwayServer *server,
   process_input_message (server, &ev);
 }
 
+/* Lets the app draw the next frame of the window */
+static void
+send_frame_done (BroadwayServer *server,
+                 BroadwayWindow *window)
+{
+  BroadwayInputMsg ev = { {0} };
+
+  ev.base.type = BROADWAY_EVENT_FRAME_DONE;
+  ev.base.serial = server->saved_serial - 1;
+  ev.base.time = server->last_seen_time;
+  ev.frame_done.id = window->id;
+
+  process_input_message (server, &ev);
+}
+
+static void
+take_pending_buffer (BroadwayServer *server,
+                     BroadwayWindow *window)
+{
+  if (window->buffer)
+    broadway_buffer_unref (window->buffer);
+
+  window->buffer = window->pending_buffer;
+  window->pending_buffer = NULL;
+
+  send_frame_done (server, window);
+}
+
+/* Sends the buffers that were held back while the client was congested,
+ * for as long as it isn't congested again.
+ */
+static void
+send_pending_buffers (BroadwayServer *server)
+{
+  GList *l;
+
+  if (server->output == NULL)
+    return;
+
+  for (l = server->toplevels; l != NULL; l = l->next)
+    {
+      BroadwayWindow *window = l->data;
+
+      if (window->pending_buffer == NULL)
+        continue;
+
+      if (broadway_output_is_congested (server->output))
+        break;
+
+      window->buffer_synced = TRUE;
+      broadway_output_put_buffer (server->output, window->id,
+                                  window->buffer, window->pending_buffer);
+
+      take_pending_buffer (server, window);
+    }
+}
+
+/* Makes the pending buffers current without sending them, for when
+ * the client is gone or gets everything anew.
+ */
+static void
+take_pending_buffers (BroadwayServer *server)
+{
+  GList *l;
+
+  for (l = server->toplevels; l != NULL; l = l->next)
+    {
+      BroadwayWindow *window = l->data;
+
+      if (window->pending_buffer != NULL)
+        take_pending_buffer (server, window);
+    }
+}
+
 static guint32 *
 parse_pointer_data (guint32 *p, BroadwayInputPointerMsg *data)
 {
@@ -511,6 +589,16 @@ parse_input_message (BroadwayInput *input, const unsigned char *message)
     msg.screen_resize_notify.height = ntohl (*p++);
     break;
 
+  case BROADWAY_EVENT_BUFFER_ACK:
+    /* This is for us, not for the clients */
+    broadway_output_ack (input->output, msg.base.serial);
+    if (input->output == server->output)
+      {
+        send_pending_buffers (server);
+        broadway_server_flush (server);
+      }
+    return;
+
   default:
     g_printerr ("parse_input_message - Unknown input command %c (%s)\n", msg.base.type, message);
     break;
@@ -758,6 +846,7 @@ broadway_server_flush (BroadwayServer *server)
       server->saved_serial = broadway_output_get_next_serial (server->output);
       broadway_output_free (server->output);
       server->output = NULL;
+      take_pending_buffers (server);
     }
 }
 
@@ -1460,6 +1549,8 @@ broadway_server_destroy_window (BroadwayServer *server,
       g_free (window->cached_surface_name);
       if (window->cached_surface != NULL)
 	cairo_surface_destroy (window->cached_surface);
+      g_clear_pointer (&window->buffer, broadway_buffer_unref);
+      g_clear_pointer (&window->pending_buffer, broadway_buffer_unref);
 
       g_free (window);
     }
@@ -1597,25 +1688,52 @@ broadway_server_has_client (BroadwayServer *server)
 void
 broadway_server_window_update (BroadwayServer *server,
 			       gint id,
-			       cairo_surface_t *surface)
+			       cairo_surface_t *surface,
+			       const BroadwayRect *rects,
+			       int n_rects)
 {
   BroadwayWindow *window;
   BroadwayBuffer *buffer;
 
-  if (surface == NULL)
-    return;
-
   window = g_hash_table_lookup (server->id_ht,
 				GINT_TO_POINTER (id));
   if (window == NULL)
     return;
 
+  if (surface == NULL)
+    {
+      /* Don't leave the app waiting */
+      send_frame_done (server, window);
+      return;
+    }
+
   g_assert (window->width == cairo_image_surface_get_width (surface));
   g_assert (window->height == cairo_image_surface_get_height (surface));
 
+  /* This is a diff against window->buffer, which is what the web
+   * client has, even if there is a pending buffer already. The rects
+   * are relative to the pending buffer then, so we can't use them. */
+  if (window->pending_buffer)
+    n_rects = 0;
+
   buffer = broadway_buffer_create (window->width, window->height,
                                    cairo_image_surface_get_data (surface),
-                                   cairo_image_surface_get_stride (surface));
+                                   cairo_image_surface_get_stride (surface),
+                                   window->buffer,
+                                   rects, n_rects);
+
+  if (server->output != NULL &&
+      broadway_output_is_congested (server->output))
+    {
+      /* Hold the buffer back until the client caught up, and don't
+       * let the app draw another frame until then */
+      if (window->pending_buffer)
+        broadway_buffer_unref (window->pending_buffer);
+      window->pending_buffer = buffer;
+      return;
+    }
+
+  g_clear_pointer (&window->pending_buffer, broadway_buffer_unref);
 
   if (server->output != NULL)
     {
@@ -1625,9 +1743,11 @@ broadway_server_window_update (BroadwayServer *server,
     }
 
   if (window->buffer)
-    broadway_buffer_destroy (window->buffer);
+    broadway_buffer_unref (window->buffer);
 
   window->buffer = buffer;
+
+  send_frame_done (server, window);
 }
 
 gboolean
@@ -1879,6 +1999,8 @@ broadway_server_resync_windows (BroadwayServer *server)
   if (server->output == NULL)
     return;
 
+  take_pending_buffers (server);
+
   /* First create all windows */
   for (l = server->toplevels; l != NULL; l = l->next)
     {
@@ -549,6 +549,8 @@ function handleCommands(cmd)
         active = true;
     }
 
+    var putBuffer = false;
+
     while (cmd.pos < cmd.length) {
 	var id, x, y, w, h, q;
 	var command = cmd.get_char();
@@ -622,6 +624,7 @@ function handleCommands(cmd)
 	    h = cmd.get_16();
             var data = cmd.get_data();
             cmdPutBuffer(id, w, h, data);
+            putBuffer = true;
             break;
 
 	case 'g': // Grab
@@ -644,6 +647,11 @@ function handleCommands(cmd)
 	    alert("Unknown op " + command);
 	}
     }
+
+    // Let the server know how far we got, so it can pace its frames
+    if (putBuffer)
+        sendInput ("A", []);
+
     return true;
 }
 
@@ -200,6 +200,7 @@ client_handle_request (BroadwayClient *client,
   BroadwayReplyUngrabPointer reply_ungrab_pointer;
   cairo_surface_t *surface;
   guint32 before_serial, now_serial;
+  guint32 n_rects;
 
   before_serial = broadway_server_get_next_serial (server);
 
@@ -260,13 +261,19 @@ client_handle_request (BroadwayClient *client,
 					      request->update.name,
 					      request->update.width,
 					      request->update.height);
+      /* Don't read rects beyond the end of the request */
+      if (request->base.size < sizeof (BroadwayRequestUpdate))
+	n_rects = 0;
+      else
+	n_rects = MIN (request->update.n_rects,
+		       1 + (request->base.size - sizeof (BroadwayRequestUpdate)) / sizeof (BroadwayRect));
+      broadway_server_window_update (server,
+				     request->update.id,
+				     surface,
+				     request->update.rects,
+				     n_rects);
       if (surface != NULL)
-	{
-	  broadway_server_window_update (server,
-					 request->update.id,
-					 surface);
-	  cairo_surface_destroy (surface);
-	}
+	cairo_surface_destroy (surface);
       break;
     case BROADWAY_REQUEST_MOVE_RESIZE:
       broadway_server_window_move_resize (server,
@@ -568,6 +575,8 @@ get_event_size (int type)
       return sizeof (BroadwayInputScreenResizeNotify);
     case BROADWAY_EVENT_FOCUS:
       return sizeof (BroadwayInputFocusMsg);
+    case BROADWAY_EVENT_FRAME_DONE:
+      return sizeof (BroadwayInputFrameDoneMsg);
     default:
       g_assert_not_reached ();
     }
@@ -728,13 +728,22 @@ _gdk_broadway_server_create_surface (int                 width,
   return surface;
 }
 
+/* Damage with more rectangles than this is sent as its extents */
+#define MAX_DAMAGE_RECTS 16
+
+/* @damage is the area painted since the last update, or %NULL
+ * if all of @surface may have changed */
 void
 _gdk_broadway_server_window_update (GdkBroadwayServer *server,
 				    gint id,
-				    cairo_surface_t *surface)
+				    cairo_surface_t *surface,
+				    cairo_region_t *damage)
 {
-  BroadwayRequestUpdate msg;
+  BroadwayRequestUpdate *msg;
   BroadwayShmSurfaceData *data;
+  cairo_rectangle_int_t rect;
+  gsize size;
+  int i, n_rects;
 
   if (surface == NULL)
     return;
@@ -742,13 +751,41 @@ _gdk_broadway_server_window_update (GdkBroadwayServer *server,
   data = cairo_surface_get_user_data (surface, &gdk_broadway_shm_cairo_key);
   g_assert (data != NULL);
 
-  msg.id = id;
-  memcpy (msg.name, data->name, 36);
-  msg.width = cairo_image_surface_get_width (surface);
-  msg.height = cairo_image_surface_get_height (surface);
+  n_rects = damage ? cairo_region_num_rectangles (damage) : 0;
 
-  gdk_broadway_server_send_message (server, msg,
-				    BROADWAY_REQUEST_UPDATE);
+  size = sizeof (BroadwayRequestUpdate) + sizeof (BroadwayRect) * MAX (MIN (n_rects, MAX_DAMAGE_RECTS) - 1, 0);
+  msg = g_malloc0 (size);
+
+  msg->id = id;
+  memcpy (msg->name, data->name, 36);
+  msg->width = cairo_image_surface_get_width (surface);
+  msg->height = cairo_image_surface_get_height (surface);
+
+  if (n_rects > MAX_DAMAGE_RECTS)
+    {
+      cairo_region_get_extents (damage, &rect);
+      msg->n_rects = 1;
+      msg->rects[0].x = rect.x;
+      msg->rects[0].y = rect.y;
+      msg->rects[0].width = rect.width;
+      msg->rects[0].height = rect.height;
+    }
+  else
+    {
+      msg->n_rects = n_rects;
+      for (i = 0; i < n_rects; i++)
+	{
+	  cairo_region_get_rectangle (damage, i, &rect);
+	  msg->rects[i].x = rect.x;
+	  msg->rects[i].y = rect.y;
+	  msg->rects[i].width = rect.width;
+	  msg->rects[i].height = rect.height;
+	}
+    }
+
+  gdk_broadway_server_send_message_with_size (server, (BroadwayRequestBase *) msg, size,
+					      BROADWAY_REQUEST_UPDATE);
+  g_free (msg);
 }
 
 gboolean
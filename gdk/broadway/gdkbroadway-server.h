@@ -63,7 +63,8 @@ cairo_surface_t   *_gdk_broadway_server_create_surface           (int
 								  int                 height);
 void               _gdk_broadway_server_window_update            (GdkBroadwayServer  *server,
 								  gint                id,
-								  cairo_surface_t    *surface);
+								  cairo_surface_t    *surface,
+								  cairo_region_t     *damage);
 gboolean           _gdk_broadway_server_window_move_resize       (GdkBroadwayServer  *server,
 								  gint                id,
 								  gboolean            with_move,
@@ -352,6 +352,12 @@ _gdk_broadway_events_got_input (BroadwayInputMsg *message)
     _gdk_broadway_display_size_changed (display, &message->screen_resize_notify);
     break;
 
+  case BROADWAY_EVENT_FRAME_DONE:
+    window = g_hash_table_lookup (display_broadway->id_ht, GINT_TO_POINTER (message->frame_done.id));
+    if (window)
+      _gdk_broadway_window_frame_done (window);
+    break;
+
   case BROADWAY_EVENT_FOCUS:
     window = g_hash_table_lookup (display_broadway->id_ht, GINT_TO_POINTER (message->focus.old_id));
     if (window)
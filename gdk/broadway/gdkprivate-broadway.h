@@ -91,6 +91,7 @@ void _gdk_broadway_display_size_changed (GdkDisplay *display,
 	                                 BroadwayInputScreenResizeNotify *msg);
 
 void _gdk_broadway_events_got_input      (BroadwayInputMsg *message);
+void _gdk_broadway_window_frame_done     (GdkWindow        *window);
 
 void _gdk_broadway_display_init_root_window (GdkDisplay *display);
 void _gdk_broadway_display_init_dnd (GdkDisplay *display);
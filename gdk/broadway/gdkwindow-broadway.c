@@ -29,6 +29,7 @@
 
 #include "gdkbroadwaydisplay.h"
 #include "gdkdisplay.h"
+#include "gdkframeclockprivate.h"
 #include "gdkwindow.h"
 #include "gdkwindowimpl.h"
 #include "gdkdisplay-broadway.h"
@@ -116,7 +117,17 @@ update_dirty_windows_and_sync (void)
 	  updated_surface = TRUE;
 	  _gdk_broadway_server_window_update (display->server,
 					      impl->id,
-					      impl->surface);
+					      impl->surface,
+					      impl->damage);
+	  g_clear_pointer (&impl->damage, cairo_region_destroy);
+
+	  /* broadwayd tells us when the web client can take another
+	     frame, don't draw any until then */
+	  if (!impl->frame_pending)
+	    {
+	      impl->frame_pending = TRUE;
+	      _gdk_frame_clock_freeze (gdk_window_get_frame_clock (impl->wrapper));
+	    }
 	}
     }
 
@@ -181,6 +192,8 @@ gdk_window_impl_broadway_finalize (GObject *object)
   if (impl->cursor)
     g_object_unref (impl->cursor);
 
+  g_clear_pointer (&impl->damage, cairo_region_destroy);
+
   broadway_display->toplevels = g_list_remove (broadway_display->toplevels, impl);
 
   G_OBJECT_CLASS (gdk_window_impl_broadway_parent_class)->finalize (object);
@@ -193,6 +206,18 @@ on_frame_clock_after_paint (GdkFrameClock *clock,
   update_dirty_windows_and_sync ();
 }
 
+void
+_gdk_broadway_window_frame_done (GdkWindow *window)
+{
+  GdkWindowImplBroadway *impl = GDK_WINDOW_IMPL_BROADWAY (window->impl);
+
+  if (!impl->frame_pending)
+    return;
+
+  impl->frame_pending = FALSE;
+  _gdk_frame_clock_thaw (gdk_window_get_frame_clock (window));
+}
+
 static void
 connect_frame_clock (GdkWindow *window)
 {
@@ -410,6 +435,7 @@ gdk_window_broadway_move_resize (GdkWindow *window,
 {
   GdkWindowImplBroadway *impl = GDK_WINDOW_IMPL_BROADWAY (window->impl);
   GdkBroadwayDisplay *broadway_display;
+  cairo_rectangle_int_t rect;
   gboolean size_changed;
 
   size_changed = FALSE;
@@ -435,6 +461,13 @@ gdk_window_broadway_move_resize (GdkWindow *window,
 
 	  window->width = width;
 	  window->height = height;
+
+	  rect.x = 0;
+	  rect.y = 0;
+	  rect.width = width;
+	  rect.height = height;
+	  g_clear_pointer (&impl->damage, cairo_region_destroy);
+	  impl->damage = cairo_region_create_rectangle (&rect);
 	  _gdk_broadway_window_resize_surface (window);
 	}
     }
@@ -919,6 +952,12 @@ gdk_broadway_window_end_paint (GdkWindow *window)
   GdkWindowImplBroadway *impl;
   impl = GDK_WINDOW_IMPL_BROADWAY (window->impl);
   impl->dirty = TRUE;
+
+  /* Tell broadwayd where to look for changes */
+  if (impl->damage == NULL)
+    impl->damage = cairo_region_copy (window->current_paint.region);
+  else
+    cairo_region_union (impl->damage, window->current_paint.region);
 }
 
 typedef struct _MoveResizeData MoveResizeData;
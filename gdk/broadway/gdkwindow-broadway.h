@@ -67,7 +67,11 @@ struct _GdkWindowImplBroadway
 
   gint8 toplevel_window_type;
   gboolean dirty;
+  /* The area painted since the last update, NULL if unknown */
+  cairo_region_t *damage;
   gboolean last_synced;
+  /* The frame clock is frozen until broadwayd is ready for the next frame */
+  gboolean frame_pending;
 
   GdkGeometry geometry_hints;
   GdkWindowHints geometry_hints_mask;
@@ -25,6 +25,9 @@ void            gdk_window_thaw_toplevel_updates        (GdkWindow *window);
 
 gboolean        gdk_window_supports_edge_constraints    (GdkWindow *window);
 
+void            gdk_window_set_damage                   (GdkWindow      *window,
+                                                         cairo_region_t *damage);
+
 GdkRenderingMode gdk_display_get_rendering_mode (GdkDisplay       *display);
 void             gdk_display_set_rendering_mode (GdkDisplay       *display,
                                                  GdkRenderingMode  mode);
@@ -211,6 +211,9 @@ struct _GdkWindow
     cairo_region_t *region;
 
     gboolean surface_needs_composite;
+    /* The region gets cleared when the surface is first used, so that
+     * gdk_window_set_damage() can still shrink it. */
+    gboolean surface_needs_clear;
   } current_paint;
   GdkGLContext *gl_paint_context;
 
@@ -220,6 +223,11 @@ struct _GdkWindow
      started. It may be smaller than the expose area if we'e painting
      more than we have to, but it represents the "true" damage. */
   cairo_region_t *active_update_area;
+  /* The part of the update_area whose contents got lost, like areas
+     exposed by the windowing system. These need to be repainted even
+     if nothing changed in them, see gdk_window_set_damage(). */
+  cairo_region_t *exposed_area;
+  cairo_region_t *active_exposed_area;
   /* We store the old expose areas to support buffer-age optimizations */
   cairo_region_t *old_updated_area[2];
 
@@ -819,6 +819,15 @@ _gdk_window_update_size (GdkWindow *window)
 {
   gdk_window_clear_old_updated_area (window);
   recompute_visible_regions (window, FALSE);
+
+  /* Depending on the backend, the contents may be gone */
+  if (gdk_window_has_impl (window))
+    {
+      cairo_rectangle_int_t r = { 0, 0, window->width, window->height };
+
+      g_clear_pointer (&window->exposed_area, cairo_region_destroy);
+      window->exposed_area = cairo_region_create_rectangle (&r);
+    }
 }
 
 static GdkEventMask
@@ -2032,8 +2041,7 @@ gdk_window_begin_paint_internal (GdkWindow            *window,
       window->current_paint.surface_needs_composite = FALSE;
     }
 
-  if (!cairo_region_is_empty (window->current_paint.region))
-    gdk_window_clear_backing_region (window);
+  window->current_paint.surface_needs_clear = !cairo_region_is_empty (window->current_paint.region);
 }
 
 static void
@@ -2050,6 +2058,9 @@ gdk_window_end_paint_internal (GdkWindow *window)
 
   impl_class = GDK_WINDOW_IMPL_GET_CLASS (window->impl);
 
+  if (window->current_paint.surface_needs_clear)
+    gdk_window_clear_backing_region (window);
+
   if (impl_class->end_paint)
     impl_class->end_paint (window);
 
@@ -2223,6 +2234,54 @@ gdk_window_end_draw_frame (GdkWindow         *window,
   g_object_unref (context);
 }
 
+/*< private >
+ * gdk_window_set_damage:
+ * @window: a #GdkWindow
+ * @damage: the area that changed since the last frame, in window
+ *     coordinates
+ *
+ * Tells GDK that only @damage needs to be drawn in the frame started
+ * with gdk_window_begin_draw_frame(), because the rest of the area that
+ * was queued for redrawing still has the same contents.
+ *
+ * Areas whose contents were lost, like areas exposed by the windowing
+ * system, are added to @damage, and @damage is limited to the area being
+ * drawn. After this call, @damage is the area the caller must draw; only
+ * that area will be copied to the window and reported as updated.
+ *
+ * This must be called before drawing anything.
+ */
+void
+gdk_window_set_damage (GdkWindow      *window,
+                       cairo_region_t *damage)
+{
+  cairo_region_t *clip;
+
+  g_return_if_fail (GDK_IS_WINDOW (window));
+  g_return_if_fail (gdk_window_has_impl (window));
+  g_return_if_fail (window->drawing_context != NULL);
+
+  if (window->active_exposed_area)
+    cairo_region_union (damage, window->active_exposed_area);
+
+  clip = gdk_drawing_context_get_clip (window->drawing_context);
+  if (clip)
+    {
+      cairo_region_intersect (damage, clip);
+      cairo_region_destroy (clip);
+    }
+
+  if (window->current_paint.region)
+    {
+      cairo_region_intersect (damage, window->current_paint.region);
+      cairo_region_destroy (window->current_paint.region);
+      window->current_paint.region = cairo_region_copy (damage);
+    }
+
+  if (window->active_update_area)
+    cairo_region_intersect (window->active_update_area, damage);
+}
+
 /*< private >
  * gdk_window_get_current_paint_region:
  * @window: a #GdkWindow
@@ -2322,6 +2381,8 @@ gdk_window_clear_backing_region (GdkWindow *window)
 {
   cairo_t *cr;
 
+  window->current_paint.surface_needs_clear = FALSE;
+
   if (GDK_WINDOW_DESTROYED (window))
     return;
 
@@ -2341,7 +2402,12 @@ static cairo_surface_t *
 ref_window_surface (GdkWindow *window)
 {
   if (window->impl_window->current_paint.surface)
-    return cairo_surface_reference (window->impl_window->current_paint.surface);
+    {
+      if (window->impl_window->current_paint.surface_needs_clear)
+        gdk_window_clear_backing_region (window->impl_window);
+
+      return cairo_surface_reference (window->impl_window->current_paint.surface);
+    }
   else
     return gdk_window_ref_impl_surface (window);
 }
@@ -2594,6 +2660,8 @@ gdk_window_process_updates_internal (GdkWindow *window)
 
       window->active_update_area = window->update_area;
       window->update_area = NULL;
+      window->active_exposed_area = window->exposed_area;
+      window->exposed_area = NULL;
 
       if (gdk_window_is_viewable (window))
 	{
@@ -2618,6 +2686,7 @@ gdk_window_process_updates_internal (GdkWindow *window)
 
       cairo_region_destroy (window->active_update_area);
       window->active_update_area = NULL;
+      g_clear_pointer (&window->active_exposed_area, cairo_region_destroy);
     }
 
   window->in_update = FALSE;
@@ -2864,6 +2933,14 @@ void
 _gdk_window_invalidate_for_expose (GdkWindow       *window,
 				   cairo_region_t       *region)
 {
+  if (gdk_window_has_impl (window))
+    {
+      if (window->exposed_area)
+        cairo_region_union (window->exposed_area, region);
+      else
+        window->exposed_area = cairo_region_copy (region);
+    }
+
   gdk_window_invalidate_maybe_recurse_full (window, region,
 					    (gboolean (*) (GdkWindow *, gpointer))gdk_window_has_no_impl,
 					    NULL);
@@ -2957,6 +3034,8 @@ _gdk_window_clear_update_area (GdkWindow *window)
       cairo_region_destroy (window->update_area);
       window->update_area = NULL;
     }
+
+  g_clear_pointer (&window->exposed_area, cairo_region_destroy);
 }
 
 /**
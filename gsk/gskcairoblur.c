@@ -123,99 +123,581 @@ blur_xspan (guchar *row,
 }
 
 static void
-blur_rows (guchar *dst_buffer,
-           guchar *tmp_buffer,
-           int     buffer_width,
-           int     buffer_height,
-           int     d)
+blur_row (guchar *row,
+          guchar *tmp_buffer,
+          int     row_width,
+          int     d)
 {
-  int i;
+  /* We want to produce a symmetric blur that spreads a pixel
+   * equally far to the left and right. If d is odd that happens
+   * naturally, but for d even, we approximate by using a blur
+   * on either side and then a centered blur of size d + 1.
+   * (technique also from the SVG specification)
+   */
+  if (d % 2 == 1)
+    {
+      blur_xspan (row, tmp_buffer, row_width, d, 0);
+      blur_xspan (row, tmp_buffer, row_width, d, 0);
+      blur_xspan (row, tmp_buffer, row_width, d, 0);
+    }
+  else
+    {
+      blur_xspan (row, tmp_buffer, row_width, d, 1);
+      blur_xspan (row, tmp_buffer, row_width, d, -1);
+      blur_xspan (row, tmp_buffer, row_width, d + 1, 0);
+    }
+}
+
+/* The vertical pass works on strips of STRIP_WIDTH adjacent columns.
+ * Instead of transposing the buffer, we keep one running sum per column
+ * and slide the window down the strip one row at a time, so every
+ * memory access is a contiguous run of STRIP_WIDTH bytes and all columns
+ * of the strip can be updated in parallel with SIMD instructions.
+ */
+#define STRIP_WIDTH 64
+
+/* Updates the per-column running sums for one row of the strip: adds
+ * @add, subtracts @sub and writes the rounded averages to @out. Any of
+ * the three rows may be %NULL. The SIMD variants below compute exactly
+ * the same result, they are only used for the bulk of the strip.
+ */
+static inline void
+blur_ystep_scalar (guint32      *sums,
+                   const guchar *add,
+                   const guchar *sub,
+                   guchar       *out,
+                   int           start,
+                   int           width,
+                   int           d)
+{
+  int x;
 
-  for (i = 0; i < buffer_height; i++)
+  for (x = start; x < width; x++)
     {
-      guchar *row = dst_buffer + i * buffer_width;
-
-      /* We want to produce a symmetric blur that spreads a pixel
-       * equally far to the left and right. If d is odd that happens
-       * naturally, but for d even, we approximate by using a blur
-       * on either side and then a centered blur of size d + 1.
-       * (technique also from the SVG specification)
-       */
-      if (d % 2 == 1)
+      if (add)
+        sums[x] += add[x];
+      if (sub)
+        sums[x] -= sub[x];
+      if (out)
+        out[x] = (sums[x] + d / 2) / d;
+    }
+}
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define BLUR_YSTEP_SIMD blur_ystep_avx2
+
+/* Computes (n / d) exactly for the small integers we deal with: the
+ * float quotient is off by at most one, so a single correction step
+ * on the remainder yields the same result as an integer division.
+ */
+static inline __m256i
+div_avx2 (__m256i n,
+          __m256  inv,
+          __m256i dv)
+{
+  __m256i q, r;
+
+  q = _mm256_cvttps_epi32 (_mm256_mul_ps (_mm256_cvtepi32_ps (n), inv));
+  r = _mm256_sub_epi32 (n, _mm256_mullo_epi32 (q, dv));
+  q = _mm256_sub_epi32 (q, _mm256_cmpgt_epi32 (r, _mm256_sub_epi32 (dv, _mm256_set1_epi32 (1))));
+  q = _mm256_add_epi32 (q, _mm256_cmpgt_epi32 (_mm256_setzero_si256 (), r));
+
+  return q;
+}
+
+static void
+blur_ystep_avx2 (guint32      *sums,
+                 const guchar *add,
+                 const guchar *sub,
+                 guchar       *out,
+                 int           width,
+                 int           d)
+{
+  const __m256 inv = _mm256_set1_ps (1.0f / d);
+  const __m256i dv = _mm256_set1_epi32 (d);
+  const __m256i half = _mm256_set1_epi32 (d / 2);
+  int x;
+
+  for (x = 0; x + 8 <= width; x += 8)
+    {
+      __m256i s = _mm256_loadu_si256 ((const __m256i *) (sums + x));
+
+      if (add)
+        s = _mm256_add_epi32 (s, _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (add + x))));
+      if (sub)
+        s = _mm256_sub_epi32 (s, _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (sub + x))));
+
+      _mm256_storeu_si256 ((__m256i *) (sums + x), s);
+
+      if (out)
         {
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
+          __m256i q = div_avx2 (_mm256_add_epi32 (s, half), inv, dv);
+          __m128i q16 = _mm_packs_epi32 (_mm256_castsi256_si128 (q),
+                                         _mm256_extracti128_si256 (q, 1));
+
+          _mm_storel_epi64 ((__m128i *) (out + x), _mm_packus_epi16 (q16, q16));
         }
-      else
+    }
+
+  blur_ystep_scalar (sums, add, sub, out, x, width, d);
+}
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define BLUR_YSTEP_SIMD blur_ystep_sse2
+
+/* See div_avx2(). SSE2 has no 32bit multiply, so the correction is
+ * done on floats, which is exact since all values are below 2^24.
+ */
+static inline __m128i
+div_sse2 (__m128i n,
+          __m128  inv,
+          __m128  df)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128 nf, qf, r;
+
+  nf = _mm_cvtepi32_ps (n);
+  qf = _mm_cvtepi32_ps (_mm_cvttps_epi32 (_mm_mul_ps (nf, inv)));
+  r = _mm_sub_ps (nf, _mm_mul_ps (qf, df));
+  qf = _mm_add_ps (qf, _mm_and_ps (_mm_cmpge_ps (r, df), one));
+  qf = _mm_sub_ps (qf, _mm_and_ps (_mm_cmplt_ps (r, _mm_setzero_ps ()), one));
+
+  return _mm_cvttps_epi32 (qf);
+}
+
+static void
+blur_ystep_sse2 (guint32      *sums,
+                 const guchar *add,
+                 const guchar *sub,
+                 guchar       *out,
+                 int           width,
+                 int           d)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128 inv = _mm_set1_ps (1.0f / d);
+  const __m128 df = _mm_set1_ps (d);
+  const __m128i half = _mm_set1_epi32 (d / 2);
+  int x, k;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    {
+      __m128i s[4];
+
+      for (k = 0; k < 4; k++)
+        s[k] = _mm_loadu_si128 ((const __m128i *) (sums + x + 4 * k));
+
+      if (add)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *) (add + x));
+          __m128i lo = _mm_unpacklo_epi8 (v, zero);
+          __m128i hi = _mm_unpackhi_epi8 (v, zero);
+
+          s[0] = _mm_add_epi32 (s[0], _mm_unpacklo_epi16 (lo, zero));
+          s[1] = _mm_add_epi32 (s[1], _mm_unpackhi_epi16 (lo, zero));
+          s[2] = _mm_add_epi32 (s[2], _mm_unpacklo_epi16 (hi, zero));
+          s[3] = _mm_add_epi32 (s[3], _mm_unpackhi_epi16 (hi, zero));
+        }
+
+      if (sub)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *) (sub + x));
+          __m128i lo = _mm_unpacklo_epi8 (v, zero);
+          __m128i hi = _mm_unpackhi_epi8 (v, zero);
+
+          s[0] = _mm_sub_epi32 (s[0], _mm_unpacklo_epi16 (lo, zero));
+          s[1] = _mm_sub_epi32 (s[1], _mm_unpackhi_epi16 (lo, zero));
+          s[2] = _mm_sub_epi32 (s[2], _mm_unpacklo_epi16 (hi, zero));
+          s[3] = _mm_sub_epi32 (s[3], _mm_unpackhi_epi16 (hi, zero));
+        }
+
+      for (k = 0; k < 4; k++)
+        _mm_storeu_si128 ((__m128i *) (sums + x + 4 * k), s[k]);
+
+      if (out)
+        {
+          __m128i q[4];
+
+          for (k = 0; k < 4; k++)
+            q[k] = div_sse2 (_mm_add_epi32 (s[k], half), inv, df);
+
+          _mm_storeu_si128 ((__m128i *) (out + x),
+                            _mm_packus_epi16 (_mm_packs_epi32 (q[0], q[1]),
+                                              _mm_packs_epi32 (q[2], q[3])));
+        }
+    }
+
+  blur_ystep_scalar (sums, add, sub, out, x, width, d);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+#define BLUR_YSTEP_SIMD blur_ystep_neon
+
+/* See div_avx2() */
+static inline int32x4_t
+div_neon (int32x4_t   n,
+          float32x4_t inv,
+          int32x4_t   dv)
+{
+  int32x4_t q, r;
+
+  q = vcvtq_s32_f32 (vmulq_f32 (vcvtq_f32_s32 (n), inv));
+  r = vsubq_s32 (n, vmulq_s32 (q, dv));
+  q = vsubq_s32 (q, vreinterpretq_s32_u32 (vcgeq_s32 (r, dv)));
+  q = vaddq_s32 (q, vreinterpretq_s32_u32 (vcltq_s32 (r, vdupq_n_s32 (0))));
+
+  return q;
+}
+
+static void
+blur_ystep_neon (guint32      *sums,
+                 const guchar *add,
+                 const guchar *sub,
+                 guchar       *out,
+                 int           width,
+                 int           d)
+{
+  const float32x4_t inv = vdupq_n_f32 (1.0f / d);
+  const int32x4_t dv = vdupq_n_s32 (d);
+  const int32x4_t half = vdupq_n_s32 (d / 2);
+  int x, k;
+
+  for (x = 0; x + 8 <= width; x += 8)
+    {
+      int32x4_t s[2];
+
+      for (k = 0; k < 2; k++)
+        s[k] = vreinterpretq_s32_u32 (vld1q_u32 (sums + x + 4 * k));
+
+      if (add)
         {
-          blur_xspan (row, tmp_buffer, buffer_width, d, 1);
-          blur_xspan (row, tmp_buffer, buffer_width, d, -1);
-          blur_xspan (row, tmp_buffer, buffer_width, d + 1, 0);
+          uint16x8_t v = vmovl_u8 (vld1_u8 (add + x));
+
+          s[0] = vaddq_s32 (s[0], vreinterpretq_s32_u32 (vmovl_u16 (vget_low_u16 (v))));
+          s[1] = vaddq_s32 (s[1], vreinterpretq_s32_u32 (vmovl_u16 (vget_high_u16 (v))));
+        }
+
+      if (sub)
+        {
+          uint16x8_t v = vmovl_u8 (vld1_u8 (sub + x));
+
+          s[0] = vsubq_s32 (s[0], vreinterpretq_s32_u32 (vmovl_u16 (vget_low_u16 (v))));
+          s[1] = vsubq_s32 (s[1], vreinterpretq_s32_u32 (vmovl_u16 (vget_high_u16 (v))));
+        }
+
+      for (k = 0; k < 2; k++)
+        vst1q_u32 (sums + x + 4 * k, vreinterpretq_u32_s32 (s[k]));
+
+      if (out)
+        {
+          int32x4_t q0 = div_neon (vaddq_s32 (s[0], half), inv, dv);
+          int32x4_t q1 = div_neon (vaddq_s32 (s[1], half), inv, dv);
+
+          vst1_u8 (out + x, vqmovn_u16 (vcombine_u16 (vqmovun_s32 (q0), vqmovun_s32 (q1))));
         }
     }
+
+  blur_ystep_scalar (sums, add, sub, out, x, width, d);
+}
+
+#endif
+
+static inline void
+blur_ystep (guint32      *sums,
+            const guchar *add,
+            const guchar *sub,
+            guchar       *out,
+            int           width,
+            int           d)
+{
+#ifdef BLUR_YSTEP_SIMD
+  BLUR_YSTEP_SIMD (sums, add, sub, out, width, d);
+#else
+  blur_ystep_scalar (sums, add, sub, out, 0, width, d);
+#endif
 }
 
-/* Swaps width and height.
+/* The vertical equivalent of blur_xspan(), applied to @width columns
+ * at once. Unlike blur_xspan() this works out of place, reading from
+ * @src and writing to @dst, which may have different strides.
  */
 static void
-flip_buffer (guchar *dst_buffer,
-             guchar *src_buffer,
-             int     width,
-             int     height)
+blur_yspan (const guchar *src,
+            int           src_stride,
+            guchar       *dst,
+            int           dst_stride,
+            guint32      *sums,
+            int           width,
+            int           height,
+            int           d,
+            int           shift)
 {
-  /* Working in blocks increases cache efficiency, compared to reading
-   * or writing an entire column at once
-   */
-#define BLOCK_SIZE 16
-
-  int i0, j0;
-
-  for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
-    for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
-      {
-        int max_j = MIN(j0 + BLOCK_SIZE, height);
-        int max_i = MIN(i0 + BLOCK_SIZE, width);
-        int i, j;
-
-        for (i = i0; i < max_i; i++)
-          for (j = j0; j < max_j; j++)
-            dst_buffer[i * height + j] = src_buffer[j * width + i];
-      }
-#undef BLOCK_SIZE
+  int offset;
+  int i;
+
+  if (d % 2 == 1)
+    offset = d / 2;
+  else
+    offset = (d - shift) / 2;
+
+  memset (sums, 0, width * sizeof (guint32));
+
+  for (i = -d + offset; i < height + offset; i++)
+    {
+      const guchar *add = NULL;
+      const guchar *sub = NULL;
+      guchar *out = NULL;
+
+      if (i >= 0 && i < height)
+        add = src + i * src_stride;
+
+      if (i >= offset)
+        {
+          if (i >= d)
+            sub = src + (i - d) * src_stride;
+
+          out = dst + (i - offset) * dst_stride;
+        }
+
+      blur_ystep (sums, add, sub, out, width, d);
+    }
 }
 
+/* Blurs the columns of a single strip, see blur_row() for the
+ * three passes. @scratch must hold 2 * width * height bytes for the
+ * intermediate results plus the running sums.
+ */
 static void
-_boxblur (guchar      *buffer,
-          int          width,
-          int          height,
-          int          radius,
-          GskBlurFlags flags)
+blur_columns (guchar *buffer,
+              int     stride,
+              int     width,
+              int     height,
+              int     d,
+              guchar *scratch)
 {
-  guchar *flipped_buffer;
-  int d = get_box_filter_size (radius);
+  guint32 *sums = (guint32 *) scratch;
+  guchar *tmp1 = scratch + STRIP_WIDTH * sizeof (guint32);
+  guchar *tmp2 = tmp1 + width * height;
+
+  if (d % 2 == 1)
+    {
+      blur_yspan (buffer, stride, tmp1, width, sums, width, height, d, 0);
+      blur_yspan (tmp1, width, tmp2, width, sums, width, height, d, 0);
+      blur_yspan (tmp2, width, buffer, stride, sums, width, height, d, 0);
+    }
+  else
+    {
+      blur_yspan (buffer, stride, tmp1, width, sums, width, height, d, 1);
+      blur_yspan (tmp1, width, tmp2, width, sums, width, height, d, -1);
+      blur_yspan (tmp2, width, buffer, stride, sums, width, height, d + 1, 0);
+    }
+}
 
-  flipped_buffer = g_malloc (width * height);
+/* Scratch memory is kept per thread and reused between blurs, since
+ * we usually blur lots of similarly sized shadows per frame.
+ */
+typedef struct {
+  gsize   size;
+  guchar *data;
+} BlurScratch;
 
-  if (flags & GSK_BLUR_Y)
+static void
+blur_scratch_free (gpointer data)
+{
+  BlurScratch *scratch = data;
+
+  g_free (scratch->data);
+  g_slice_free (BlurScratch, scratch);
+}
+
+static GPrivate blur_scratch_key = G_PRIVATE_INIT (blur_scratch_free);
+
+static guchar *
+get_blur_scratch (gsize size)
+{
+  BlurScratch *scratch = g_private_get (&blur_scratch_key);
+
+  if (scratch == NULL)
+    {
+      scratch = g_slice_new0 (BlurScratch);
+      g_private_set (&blur_scratch_key, scratch);
+    }
+
+  if (scratch->size < size)
+    {
+      g_free (scratch->data);
+      scratch->data = g_malloc (size);
+      scratch->size = size;
+    }
+
+  return scratch->data;
+}
+
+typedef struct {
+  GMutex lock;
+  GCond  cond;
+  int    pending;
+} BlurBatch;
+
+typedef struct {
+  BlurBatch *batch;
+  guchar    *buffer;
+  int        width;
+  int        height;
+  int        d;
+  gboolean   columns;
+  /* the range of rows or columns to blur */
+  int        start;
+  int        end;
+} BlurJob;
+
+static void
+blur_job_run (BlurJob *job)
+{
+  int i;
+
+  if (job->columns)
     {
-      /* Step 1: swap rows and columns */
-      flip_buffer (flipped_buffer, buffer, width, height);
+      int strip_height = job->height;
+      guchar *scratch = get_blur_scratch (STRIP_WIDTH * sizeof (guint32) + 2 * STRIP_WIDTH * strip_height);
 
-      /* Step 2: blur rows (really columns) */
-      blur_rows (flipped_buffer, buffer, height, width, d);
+      for (i = job->start; i < job->end; i += STRIP_WIDTH)
+        blur_columns (job->buffer + i, job->width,
+                      MIN (STRIP_WIDTH, job->end - i), job->height,
+                      job->d, scratch);
+    }
+  else
+    {
+      guchar *scratch = get_blur_scratch (job->width);
 
-      /* Step 3: swap rows and columns */
-      flip_buffer (buffer, flipped_buffer, height, width);
+      for (i = job->start; i < job->end; i++)
+        blur_row (job->buffer + i * job->width, scratch, job->width, job->d);
     }
+}
 
-  if (flags & GSK_BLUR_X)
+static void
+blur_job_thread_func (gpointer data,
+                      gpointer user_data)
+{
+  BlurJob *job = data;
+  BlurBatch *batch = job->batch;
+
+  blur_job_run (job);
+
+  g_mutex_lock (&batch->lock);
+  batch->pending--;
+  if (batch->pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+/* Surfaces smaller than this many pixels are blurred on the calling
+ * thread, the overhead of handing them off isn't worth it.
+ */
+#define MIN_PARALLEL_PIXELS (512 * 512)
+#define MAX_BLUR_THREADS 4
+
+static GThreadPool *
+get_blur_pool (void)
+{
+  static gsize initialized = 0;
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&initialized))
+    {
+      int n_threads = MIN (g_get_num_processors (), MAX_BLUR_THREADS);
+
+      /* The calling thread does its share of the work, too */
+      if (n_threads > 1)
+        pool = g_thread_pool_new (blur_job_thread_func, NULL,
+                                  n_threads - 1, FALSE, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+static void
+blur_parallel (guchar   *buffer,
+               int       width,
+               int       height,
+               int       d,
+               gboolean  columns)
+{
+  GThreadPool *pool = NULL;
+  BlurBatch batch;
+  BlurJob jobs[MAX_BLUR_THREADS];
+  int n_jobs, total, chunk, i;
+
+  if (width * height >= MIN_PARALLEL_PIXELS)
+    pool = get_blur_pool ();
+
+  if (pool)
+    n_jobs = g_thread_pool_get_max_threads (pool) + 1;
+  else
+    n_jobs = 1;
+
+  total = columns ? width : height;
+  chunk = (total + n_jobs - 1) / n_jobs;
+  /* Keep column ranges aligned to whole strips */
+  if (columns)
+    chunk = (chunk + STRIP_WIDTH - 1) / STRIP_WIDTH * STRIP_WIDTH;
+
+  n_jobs = MAX (1, (total + chunk - 1) / chunk);
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+  batch.pending = n_jobs - 1;
+
+  for (i = 0; i < n_jobs; i++)
     {
-      /* Step 4: blur rows */
-      blur_rows (buffer, flipped_buffer, width, height, d);
+      jobs[i].batch = &batch;
+      jobs[i].buffer = buffer;
+      jobs[i].width = width;
+      jobs[i].height = height;
+      jobs[i].d = d;
+      jobs[i].columns = columns;
+      jobs[i].start = i * chunk;
+      jobs[i].end = MIN (total, (i + 1) * chunk);
     }
 
-  g_free (flipped_buffer);
+  for (i = 1; i < n_jobs; i++)
+    g_thread_pool_push (pool, &jobs[i], NULL);
+
+  blur_job_run (&jobs[0]);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_cond_clear (&batch.cond);
+  g_mutex_clear (&batch.lock);
+}
+
+static void
+_boxblur (guchar      *buffer,
+          int          width,
+          int          height,
+          int          radius,
+          GskBlurFlags flags)
+{
+  int d = get_box_filter_size (radius);
+
+  if (flags & GSK_BLUR_Y)
+    blur_parallel (buffer, width, height, d, TRUE);
+
+  if (flags & GSK_BLUR_X)
+    blur_parallel (buffer, width, height, d, FALSE);
 }
 
 /*
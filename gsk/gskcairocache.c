@@ -0,0 +1,430 @@
+#include "config.h"
+
+#include "gskcairocacheprivate.h"
+
+#include "gskdebugprivate.h"
+#include "gskrendernodeprivate.h"
+
+#include <math.h>
+
+/* Parameters for our caching strategy.
+ *
+ * Only subtrees that are expensive to rasterize and cover at least
+ * MIN_PIXELS device pixels are considered. The first time such a subtree
+ * is seen, we only remember it; it gets rasterized into an image surface
+ * when it is drawn again in a later frame. Candidates that are not drawn
+ * again in the next frame are forgotten.
+ *
+ * Rasterized entries are kept in LRU order and the least recently used
+ * ones are dropped whenever the surfaces exceed the memory budget. A single
+ * entry may use at most a quarter of the budget. Entries that have not been
+ * used for MAX_AGE frames are dropped, too, so we don't keep old node trees
+ * alive forever.
+ */
+
+#define MIN_PIXELS (64 * 64)
+#define MAX_AGE 60
+#define MAX_ENTRIES 1024
+
+typedef struct {
+  GskRenderNode *node;
+  guint hash;
+  /* device pixels per user space unit */
+  double scale_x;
+  double scale_y;
+
+  cairo_surface_t *surface;
+  gsize size;
+
+  guint64 timestamp;
+  GList link;
+} CacheEntry;
+
+struct _GskCairoCache {
+  GObject parent_instance;
+
+  GHashTable *entries;
+  GQueue lru;
+
+  gsize size;
+  gsize max_size;
+
+  guint64 timestamp;
+
+  guint hits;
+  guint misses;
+};
+
+struct _GskCairoCacheClass {
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (GskCairoCache, gsk_cairo_cache, G_TYPE_OBJECT)
+
+static const cairo_user_data_key_t cache_key;
+
+static guint
+cache_entry_hash (gconstpointer v)
+{
+  const CacheEntry *entry = v;
+
+  return entry->hash ^ (guint) (entry->scale_x * 1000) ^ ((guint) (entry->scale_y * 1000) << 16);
+}
+
+static gboolean
+cache_entry_equal (gconstpointer v1,
+                   gconstpointer v2)
+{
+  const CacheEntry *entry1 = v1;
+  const CacheEntry *entry2 = v2;
+
+  return entry1->scale_x == entry2->scale_x &&
+         entry1->scale_y == entry2->scale_y &&
+         entry1->hash == entry2->hash &&
+         gsk_render_node_equal (entry1->node, entry2->node);
+}
+
+static void
+cache_entry_free (gpointer v)
+{
+  CacheEntry *entry = v;
+
+  gsk_render_node_unref (entry->node);
+  g_clear_pointer (&entry->surface, cairo_surface_destroy);
+
+  g_slice_free (CacheEntry, entry);
+}
+
+static void
+gsk_cairo_cache_remove_entry (GskCairoCache *self,
+                              CacheEntry    *entry)
+{
+  g_queue_unlink (&self->lru, &entry->link);
+  self->size -= entry->size;
+
+  g_hash_table_remove (self->entries, entry);
+}
+
+static void
+gsk_cairo_cache_finalize (GObject *object)
+{
+  GskCairoCache *self = GSK_CAIRO_CACHE (object);
+
+  g_hash_table_unref (self->entries);
+
+  G_OBJECT_CLASS (gsk_cairo_cache_parent_class)->finalize (object);
+}
+
+static void
+gsk_cairo_cache_class_init (GskCairoCacheClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gsk_cairo_cache_finalize;
+}
+
+static void
+gsk_cairo_cache_init (GskCairoCache *self)
+{
+  self->entries = g_hash_table_new_full (cache_entry_hash, cache_entry_equal, cache_entry_free, NULL);
+  g_queue_init (&self->lru);
+}
+
+/*< private >
+ * gsk_cairo_cache_new:
+ * @max_size: the maximum amount of memory, in bytes, to use for
+ *     rasterized nodes
+ *
+ * Creates a cache for the rasterized contents of expensive render node
+ * subtrees, see gsk_cairo_cache_draw().
+ *
+ * Returns: (transfer full): a new #GskCairoCache
+ */
+GskCairoCache *
+gsk_cairo_cache_new (gsize max_size)
+{
+  GskCairoCache *self;
+
+  self = g_object_new (GSK_TYPE_CAIRO_CACHE, NULL);
+  self->max_size = max_size;
+
+  return self;
+}
+
+/*< private >
+ * gsk_cairo_cache_attach:
+ * @cache: (nullable): a #GskCairoCache, or %NULL to detach
+ * @cr: the context to use the cache for
+ *
+ * Makes gsk_render_node_draw() use @cache when drawing to @cr.
+ * The cache must stay alive as long as it is attached to @cr.
+ */
+void
+gsk_cairo_cache_attach (GskCairoCache *cache,
+                        cairo_t       *cr)
+{
+  cairo_set_user_data (cr, &cache_key, cache, NULL);
+}
+
+GskCairoCache *
+gsk_cairo_cache_get_for_context (cairo_t *cr)
+{
+  return cairo_get_user_data (cr, &cache_key);
+}
+
+static gboolean
+node_is_expensive (GskRenderNode *node)
+{
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_BLUR_NODE:
+    case GSK_SHADOW_NODE:
+    case GSK_TEXT_NODE:
+      return TRUE;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      return gsk_outset_shadow_node_get_blur_radius (node) > 0;
+
+    case GSK_INSET_SHADOW_NODE:
+      return gsk_inset_shadow_node_get_blur_radius (node) > 0;
+
+    /* Cairo nodes are already rasterized, drawing them is a single blit */
+    case GSK_CAIRO_NODE:
+    default:
+      return FALSE;
+    }
+}
+
+static gboolean
+is_integer (double value)
+{
+  return fabs (value - round (value)) < 0.001;
+}
+
+/* Figures out the scale of @cr in device pixels and checks that the
+ * node's origin is pixel-aligned, so that the cached surface can be
+ * composited without any resampling.
+ */
+static gboolean
+get_device_scale (GskRenderNode *node,
+                  cairo_t       *cr,
+                  double        *scale_x,
+                  double        *scale_y)
+{
+  cairo_matrix_t matrix;
+  double device_x_scale, device_y_scale;
+  double x, y;
+
+  cairo_get_matrix (cr, &matrix);
+  if (matrix.xy != 0 || matrix.yx != 0 ||
+      matrix.xx <= 0 || matrix.yy <= 0)
+    return FALSE;
+
+  cairo_surface_get_device_scale (cairo_get_group_target (cr), &device_x_scale, &device_y_scale);
+
+  x = node->bounds.origin.x;
+  y = node->bounds.origin.y;
+  cairo_user_to_device (cr, &x, &y);
+
+  if (!is_integer (x * device_x_scale) || !is_integer (y * device_y_scale))
+    return FALSE;
+
+  *scale_x = matrix.xx * device_x_scale;
+  *scale_y = matrix.yy * device_y_scale;
+
+  return TRUE;
+}
+
+static void
+gsk_cairo_cache_rasterize (GskCairoCache *self,
+                           CacheEntry    *entry,
+                           cairo_t       *cr)
+{
+  GskRenderNode *node = entry->node;
+  cairo_t *surface_cr;
+  int width, height;
+
+  width = ceil (node->bounds.size.width * entry->scale_x);
+  height = ceil (node->bounds.size.height * entry->scale_y);
+
+  entry->surface = cairo_surface_create_similar_image (cairo_get_group_target (cr),
+                                                       CAIRO_FORMAT_ARGB32,
+                                                       width, height);
+  cairo_surface_set_device_scale (entry->surface, entry->scale_x, entry->scale_y);
+
+  surface_cr = cairo_create (entry->surface);
+  cairo_translate (surface_cr, - node->bounds.origin.x, - node->bounds.origin.y);
+  /* The cache is not attached to surface_cr, so nothing below this node
+   * gets cached separately.
+   */
+  node->node_class->draw (node, surface_cr);
+  cairo_destroy (surface_cr);
+
+  entry->size = cairo_image_surface_get_stride (entry->surface) * height;
+  self->size += entry->size;
+
+  GSK_NOTE (CAIRO, g_print ("Caching %s[%p], %dx%d pixels, cache size %" G_GSIZE_FORMAT "kB\n",
+                            node->node_class->type_name, node, width, height,
+                            self->size / 1024));
+}
+
+static void
+gsk_cairo_cache_shrink (GskCairoCache *self)
+{
+  GList *l, *prev;
+
+  for (l = self->lru.tail; l != NULL && self->size > self->max_size; l = prev)
+    {
+      CacheEntry *entry = l->data;
+
+      prev = l->prev;
+
+      if (entry->surface != NULL)
+        gsk_cairo_cache_remove_entry (self, entry);
+    }
+}
+
+/*< private >
+ * gsk_cairo_cache_draw:
+ * @cache: a #GskCairoCache
+ * @node: the node to draw
+ * @cr: the context to draw to, clipped to the bounds of @node
+ *
+ * Draws @node from a previously rasterized surface, if @node is
+ * equal to a node that was drawn in a previous frame.
+ *
+ * Returns: %TRUE if @node was drawn, %FALSE if the caller needs to
+ *     draw it normally
+ */
+gboolean
+gsk_cairo_cache_draw (GskCairoCache *self,
+                      GskRenderNode *node,
+                      cairo_t       *cr)
+{
+  CacheEntry lookup, *entry;
+
+  if (!node_is_expensive (node))
+    return FALSE;
+
+  if (!get_device_scale (node, cr, &lookup.scale_x, &lookup.scale_y))
+    return FALSE;
+
+  if (node->bounds.size.width * lookup.scale_x * node->bounds.size.height * lookup.scale_y < MIN_PIXELS)
+    return FALSE;
+
+  lookup.node = node;
+  lookup.hash = gsk_render_node_hash (node);
+
+  entry = g_hash_table_lookup (self->entries, &lookup);
+  if (entry == NULL)
+    {
+      if (g_hash_table_size (self->entries) >= MAX_ENTRIES)
+        return FALSE;
+
+      entry = g_slice_new0 (CacheEntry);
+      entry->node = gsk_render_node_ref (node);
+      entry->hash = lookup.hash;
+      entry->scale_x = lookup.scale_x;
+      entry->scale_y = lookup.scale_y;
+      entry->timestamp = self->timestamp;
+      entry->link.data = entry;
+
+      g_hash_table_add (self->entries, entry);
+      g_queue_push_head_link (&self->lru, &entry->link);
+
+      self->misses++;
+
+      return FALSE;
+    }
+
+  /* Seen twice in the same frame, that doesn't make it static */
+  if (entry->surface == NULL && entry->timestamp == self->timestamp)
+    {
+      self->misses++;
+      return FALSE;
+    }
+
+  entry->timestamp = self->timestamp;
+  g_queue_unlink (&self->lru, &entry->link);
+  g_queue_push_head_link (&self->lru, &entry->link);
+
+  if (entry->surface == NULL)
+    {
+      gsize size;
+
+      size = ceil (node->bounds.size.width * lookup.scale_x) * 4 *
+             ceil (node->bounds.size.height * lookup.scale_y);
+      if (size > self->max_size / 4)
+        {
+          self->misses++;
+          return FALSE;
+        }
+
+      gsk_cairo_cache_rasterize (self, entry, cr);
+      gsk_cairo_cache_shrink (self);
+      self->misses++;
+    }
+  else
+    {
+      self->hits++;
+    }
+
+  cairo_set_source_surface (cr, entry->surface, node->bounds.origin.x, node->bounds.origin.y);
+  cairo_paint (cr);
+
+  return TRUE;
+}
+
+/*< private >
+ * gsk_cairo_cache_end_frame:
+ * @cache: a #GskCairoCache
+ *
+ * Forgets all candidates that were not drawn in the last frame and
+ * all entries that have become too old, and starts a new frame.
+ */
+void
+gsk_cairo_cache_end_frame (GskCairoCache *self)
+{
+  GList *l, *next;
+
+  for (l = self->lru.head; l != NULL; l = next)
+    {
+      CacheEntry *entry = l->data;
+
+      next = l->next;
+
+      if ((entry->surface == NULL && entry->timestamp < self->timestamp) ||
+          entry->timestamp + MAX_AGE < self->timestamp)
+        gsk_cairo_cache_remove_entry (self, entry);
+    }
+
+  self->timestamp++;
+}
+
+/*< private >
+ * gsk_cairo_cache_get_stats:
+ * @cache: a #GskCairoCache
+ * @hits: (out) (optional): the number of nodes drawn from the cache
+ * @misses: (out) (optional): the number of cacheable nodes that had
+ *     to be drawn
+ * @size: (out) (optional): the memory used by cached surfaces
+ *
+ * Retrieves statistics about the cache. The hit and miss counters
+ * are reset afterwards.
+ */
+void
+gsk_cairo_cache_get_stats (GskCairoCache *self,
+                           guint         *hits,
+                           guint         *misses,
+                           gsize         *size)
+{
+  if (hits)
+    *hits = self->hits;
+  if (misses)
+    *misses = self->misses;
+  if (size)
+    *size = self->size;
+
+  self->hits = 0;
+  self->misses = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef __GSK_CAIRO_CACHE_PRIVATE_H__
+#define __GSK_CAIRO_CACHE_PRIVATE_H__
+
+#include <cairo.h>
+#include "gskrendernode.h"
+
+G_BEGIN_DECLS
+
+#define GSK_TYPE_CAIRO_CACHE (gsk_cairo_cache_get_type ())
+
+G_DECLARE_FINAL_TYPE(GskCairoCache, gsk_cairo_cache, GSK, CAIRO_CACHE, GObject)
+
+GDK_AVAILABLE_IN_ALL
+GskCairoCache *         gsk_cairo_cache_new                     (gsize          max_size);
+
+GDK_AVAILABLE_IN_ALL
+void                    gsk_cairo_cache_attach                  (GskCairoCache *cache,
+                                                                 cairo_t       *cr);
+GskCairoCache *         gsk_cairo_cache_get_for_context         (cairo_t       *cr);
+
+gboolean                gsk_cairo_cache_draw                    (GskCairoCache *cache,
+                                                                 GskRenderNode *node,
+                                                                 cairo_t       *cr);
+
+GDK_AVAILABLE_IN_ALL
+void                    gsk_cairo_cache_end_frame               (GskCairoCache *cache);
+
+GDK_AVAILABLE_IN_ALL
+void                    gsk_cairo_cache_get_stats               (GskCairoCache *cache,
+                                                                 guint         *hits,
+                                                                 guint         *misses,
+                                                                 gsize         *size);
+
+G_END_DECLS
+
+#endif /* __GSK_CAIRO_CACHE_PRIVATE_H__ */
@@ -2,12 +2,23 @@
 
 #include "gskcairorendererprivate.h"
 
+#include "gskcairocacheprivate.h"
 #include "gskdebugprivate.h"
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
+#include "gskenumtypes.h"
+#include "gdk/gdk-private.h"
 #include "gdk/gdktextureprivate.h"
 
+#include <string.h>
+
 #ifdef G_ENABLE_DEBUG
+typedef struct {
+  GQuark cache_hits;
+  GQuark cache_misses;
+  GQuark cache_size;
+} ProfileCounters;
+
 typedef struct {
   GQuark cpu_time;
   GQuark gpu_time;
@@ -18,7 +29,20 @@ struct _GskCairoRenderer
 {
   GskRenderer parent_instance;
 
+  /* The last frame drawn to the window, to find out what changed */
+  GskRenderNode *prev_root;
+  graphene_rect_t prev_viewport;
+
+  /* Only used if GSK_CAIRO_CACHE_SIZE is set */
+  GskCairoCache *cache;
+
+  /* Only used if gsk_cairo_renderer_enable_node_profiling() was called */
+  GskRenderNodeDrawStats *node_stats;
+  GQuark node_timers[GSK_N_RENDER_NODE_TYPES];
+  GQuark node_counters[GSK_N_RENDER_NODE_TYPES];
+
 #ifdef G_ENABLE_DEBUG
+  ProfileCounters profile_counters;
   ProfileTimers profile_timers;
 #endif
 };
@@ -41,7 +65,21 @@ gsk_cairo_renderer_realize (GskRenderer  *renderer,
 static void
 gsk_cairo_renderer_unrealize (GskRenderer *renderer)
 {
+  GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
 
+  g_clear_pointer (&self->prev_root, gsk_render_node_unref);
+}
+
+static void
+gsk_cairo_renderer_finalize (GObject *object)
+{
+  GskCairoRenderer *self = GSK_CAIRO_RENDERER (object);
+
+  g_clear_pointer (&self->prev_root, gsk_render_node_unref);
+  g_clear_object (&self->cache);
+  g_free (self->node_stats);
+
+  G_OBJECT_CLASS (gsk_cairo_renderer_parent_class)->finalize (object);
 }
 
 static void
@@ -49,8 +87,8 @@ gsk_cairo_renderer_do_render (GskRenderer   *renderer,
                               cairo_t       *cr,
                               GskRenderNode *root)
 {
-#ifdef G_ENABLE_DEBUG
   GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
+#ifdef G_ENABLE_DEBUG
   GskProfiler *profiler;
   gint64 cpu_time;
 #endif
@@ -60,12 +98,50 @@ gsk_cairo_renderer_do_render (GskRenderer   *renderer,
   gsk_profiler_timer_begin (profiler, self->profile_timers.cpu_time);
 #endif
 
+  if (self->cache)
+    gsk_cairo_cache_attach (self->cache, cr);
+  if (self->node_stats)
+    {
+      memset (self->node_stats, 0, sizeof (GskRenderNodeDrawStats));
+      gsk_render_node_draw_stats_attach (self->node_stats, cr);
+    }
+
   gsk_render_node_draw (root, cr);
 
+  if (self->cache)
+    {
+      gsk_cairo_cache_attach (NULL, cr);
+      gsk_cairo_cache_end_frame (self->cache);
+    }
+  if (self->node_stats)
+    {
+      GskProfiler *node_profiler = gsk_renderer_get_profiler (renderer);
+      guint i;
+
+      gsk_render_node_draw_stats_attach (NULL, cr);
+
+      for (i = 1; i < GSK_N_RENDER_NODE_TYPES; i++)
+        {
+          gsk_profiler_timer_set (node_profiler, self->node_timers[i], self->node_stats->self_time[i] * 1000);
+          gsk_profiler_counter_set (node_profiler, self->node_counters[i], self->node_stats->n_nodes[i]);
+        }
+    }
+
 #ifdef G_ENABLE_DEBUG
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
+  if (self->cache)
+    {
+      guint hits, misses;
+      gsize size;
+
+      gsk_cairo_cache_get_stats (self->cache, &hits, &misses, &size);
+      gsk_profiler_counter_add (profiler, self->profile_counters.cache_hits, hits);
+      gsk_profiler_counter_add (profiler, self->profile_counters.cache_misses, misses);
+      gsk_profiler_counter_set (profiler, self->profile_counters.cache_size, size / 1024);
+    }
+
   gsk_profiler_push_samples (profiler);
 #endif
 }
@@ -94,20 +170,71 @@ gsk_cairo_renderer_render_texture (GskRenderer           *renderer,
   return texture;
 }
 
+/* Compares @root to the previous frame and limits the frame being drawn
+ * to the area where they differ, plus whatever GDK needs redrawn anyway.
+ * Returns the area to draw, or %NULL to draw everything.
+ */
+static cairo_region_t *
+gsk_cairo_renderer_compute_damage (GskCairoRenderer      *self,
+                                   GskRenderNode         *root,
+                                   const graphene_rect_t *viewport)
+{
+  GskRenderer *renderer = GSK_RENDERER (self);
+  cairo_region_t *damage;
+
+  if (self->prev_root == NULL ||
+      !graphene_rect_equal (viewport, &self->prev_viewport) ||
+      GSK_RENDER_MODE_CHECK (FULL_REDRAW))
+    return NULL;
+
+  damage = cairo_region_create ();
+  gsk_render_node_diff (self->prev_root, root, damage);
+  gdk_window_set_damage (gsk_renderer_get_window (renderer), damage);
+
+  GSK_NOTE (CAIRO, {
+                      cairo_rectangle_int_t extents;
+
+                      cairo_region_get_extents (damage, &extents);
+                      g_print ("Damage: %d rectangles, extents %d %d %d %d\n",
+                               cairo_region_num_rectangles (damage),
+                               extents.x, extents.y, extents.width, extents.height);
+                    });
+
+  return damage;
+}
+
 static void
 gsk_cairo_renderer_render (GskRenderer   *renderer,
                            GskRenderNode *root)
 {
+  GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
   GdkDrawingContext *context = gsk_renderer_get_drawing_context (renderer);
   graphene_rect_t viewport;
-
+  cairo_region_t *damage;
   cairo_t *cr;
 
+  g_return_if_fail (gdk_drawing_context_get_paint_context (context) == NULL);
+
+  gsk_renderer_get_viewport (renderer, &viewport);
+
+  /* This needs to happen before we get the cairo context, so GDK
+   * has not cleared anything yet */
+  damage = gsk_cairo_renderer_compute_damage (self, root, &viewport);
+
   cr = gdk_drawing_context_get_cairo_context (context);
 
-  g_return_if_fail (cr != NULL);
+  g_clear_pointer (&self->prev_root, gsk_render_node_unref);
+  self->prev_root = gsk_render_node_ref (root);
+  self->prev_viewport = viewport;
 
-  gsk_renderer_get_viewport (renderer, &viewport);
+  cairo_save (cr);
+
+  if (damage)
+    {
+      gdk_cairo_region (cr, damage);
+      cairo_clip (cr);
+      cairo_region_destroy (damage);
+    }
 
   if (GSK_RENDER_MODE_CHECK (GEOMETRY))
     {
@@ -124,25 +251,97 @@ gsk_cairo_renderer_render (GskRenderer   *renderer,
     }
 
   gsk_cairo_renderer_do_render (renderer, cr, root);
+
+  cairo_restore (cr);
 }
 
 static void
 gsk_cairo_renderer_class_init (GskCairoRendererClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GskRendererClass *renderer_class = GSK_RENDERER_CLASS (klass);
 
+  gobject_class->finalize = gsk_cairo_renderer_finalize;
+
   renderer_class->realize = gsk_cairo_renderer_realize;
   renderer_class->unrealize = gsk_cairo_renderer_unrealize;
   renderer_class->render = gsk_cairo_renderer_render;
   renderer_class->render_texture = gsk_cairo_renderer_render_texture;
 }
 
+/*< private >
+ * gsk_cairo_renderer_enable_node_profiling:
+ * @self: a #GskCairoRenderer
+ *
+ * Makes @self measure the time spent drawing each type of node and
+ * report it to the profiler, in a timer and a counter named after the
+ * nick of the #GskRenderNodeType, for example "text-node-time" and
+ * "text-node-count".
+ *
+ * This has a noticeable overhead for large node trees, so it is only
+ * done on request.
+ */
+void
+gsk_cairo_renderer_enable_node_profiling (GskCairoRenderer *self)
+{
+  GskProfiler *profiler;
+  GEnumClass *enum_class;
+  guint i;
+
+  g_return_if_fail (GSK_IS_CAIRO_RENDERER (self));
+
+  if (self->node_stats)
+    return;
+
+  self->node_stats = g_new0 (GskRenderNodeDrawStats, 1);
+
+  profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
+  enum_class = g_type_class_ref (GSK_TYPE_RENDER_NODE_TYPE);
+
+  for (i = 1; i < GSK_N_RENDER_NODE_TYPES; i++)
+    {
+      GEnumValue *value = g_enum_get_value (enum_class, i);
+      char *name, *description;
+
+      name = g_strconcat (value->value_nick, "-time", NULL);
+      description = g_strdup_printf ("%s time", value->value_nick);
+      self->node_timers[i] = gsk_profiler_add_timer (profiler, name, description, FALSE, TRUE);
+      g_free (description);
+      g_free (name);
+
+      name = g_strconcat (value->value_nick, "-count", NULL);
+      description = g_strdup_printf ("%s count", value->value_nick);
+      self->node_counters[i] = gsk_profiler_add_counter (profiler, name, description, TRUE);
+      g_free (description);
+      g_free (name);
+    }
+
+  g_type_class_unref (enum_class);
+}
+
 static void
 gsk_cairo_renderer_init (GskCairoRenderer *self)
 {
+  const char *cache_size;
 #ifdef G_ENABLE_DEBUG
   GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
 
+  self->profile_counters.cache_hits = gsk_profiler_add_counter (profiler, "cache-hits", "Cached nodes", TRUE);
+  self->profile_counters.cache_misses = gsk_profiler_add_counter (profiler, "cache-misses", "Uncached nodes", TRUE);
+  self->profile_counters.cache_size = gsk_profiler_add_counter (profiler, "cache-size", "Cache size (kB)", FALSE);
+
   self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
 #endif
+
+  /* Caching rasterized subtrees trades memory for CPU time, so it is
+   * opt-in. The value is the memory budget in megabytes.
+   */
+  cache_size = g_getenv ("GSK_CAIRO_CACHE_SIZE");
+  if (cache_size != NULL)
+    {
+      guint64 size = g_ascii_strtoull (cache_size, NULL, 10);
+
+      if (size > 0)
+        self->cache = gsk_cairo_cache_new (size * 1024 * 1024);
+    }
 }
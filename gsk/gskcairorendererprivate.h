@@ -19,6 +19,8 @@ typedef struct _GskCairoRendererClass           GskCairoRendererClass;
 
 GType gsk_cairo_renderer_get_type (void) G_GNUC_CONST;
 
+void  gsk_cairo_renderer_enable_node_profiling (GskCairoRenderer *self);
+
 G_END_DECLS
 
 #endif /* __GSK_CAIRO_RENDERER_PRIVATE_H__ */
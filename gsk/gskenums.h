@@ -175,4 +175,18 @@ typedef enum {
   GSK_SERIALIZATION_INVALID_DATA
 } GskSerializationError;
 
+/**
+ * GskSerializationFormat:
+ * @GSK_SERIALIZATION_FORMAT_VARIANT: A #GVariant based format
+ * @GSK_SERIALIZATION_FORMAT_BINARY: A compact binary format that
+ *     can be loaded without copying pixel data, see
+ *     gsk_render_node_load_from_file()
+ *
+ * The formats that render nodes can be serialized to.
+ */
+typedef enum {
+  GSK_SERIALIZATION_FORMAT_VARIANT,
+  GSK_SERIALIZATION_FORMAT_BINARY
+} GskSerializationFormat;
+
 #endif /* __GSK_TYPES_H__ */
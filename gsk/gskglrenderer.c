@@ -377,6 +377,13 @@ gsk_gl_renderer_realize (GskRenderer  *renderer,
    */
   if (self->gl_context == NULL)
     {
+      if (window == NULL)
+        {
+          g_set_error_literal (error, GDK_GL_ERROR, GDK_GL_ERROR_NOT_AVAILABLE,
+                               "The OpenGL renderer needs a window");
+          return FALSE;
+        }
+
       self->gl_context = gdk_window_create_gl_context (window, error);
       if (self->gl_context == NULL)
         return FALSE;
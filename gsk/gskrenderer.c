@@ -491,6 +491,26 @@ gsk_renderer_is_realized (GskRenderer *renderer)
   return priv->is_realized;
 }
 
+static gboolean
+gsk_renderer_realize_internal (GskRenderer  *renderer,
+                               GdkWindow    *window,
+                               GError      **error)
+{
+  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+
+  if (window)
+    priv->window = g_object_ref (window);
+
+  if (!GSK_RENDERER_GET_CLASS (renderer)->realize (renderer, window, error))
+    {
+      g_clear_object (&priv->window);
+      return FALSE;
+    }
+
+  priv->is_realized = TRUE;
+  return TRUE;
+}
+
 /**
  * gsk_renderer_realize:
  * @renderer: a #GskRenderer
@@ -507,23 +527,35 @@ gsk_renderer_realize (GskRenderer  *renderer,
                       GdkWindow    *window,
                       GError      **error)
 {
-  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
-
   g_return_val_if_fail (GSK_IS_RENDERER (renderer), FALSE);
   g_return_val_if_fail (!gsk_renderer_is_realized (renderer), FALSE);
   g_return_val_if_fail (GDK_IS_WINDOW (window), FALSE);
   g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-  priv->window = g_object_ref (window);
+  return gsk_renderer_realize_internal (renderer, window, error);
+}
 
-  if (!GSK_RENDERER_GET_CLASS (renderer)->realize (renderer, window, error))
-    {
-      g_clear_object (&priv->window);
-      return FALSE;
-    }
+/*< private >
+ * gsk_renderer_realize_headless:
+ * @renderer: a #GskRenderer
+ * @error: return location for an error
+ *
+ * Like gsk_renderer_realize(), but without a window. The renderer
+ * can then only be used with gsk_renderer_render_texture(). Only the
+ * Cairo renderer supports this, it is used by benchmarks that run
+ * without a display.
+ *
+ * Returns: %TRUE if the renderer was realized
+ */
+gboolean
+gsk_renderer_realize_headless (GskRenderer  *renderer,
+                               GError      **error)
+{
+  g_return_val_if_fail (GSK_IS_RENDERER (renderer), FALSE);
+  g_return_val_if_fail (!gsk_renderer_is_realized (renderer), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-  priv->is_realized = TRUE;
-  return TRUE;
+  return gsk_renderer_realize_internal (renderer, NULL, error);
 }
 
 /**
@@ -868,6 +900,7 @@ gsk_renderer_begin_draw_frame (GskRenderer          *renderer,
 
   g_return_val_if_fail (GSK_IS_RENDERER (renderer), NULL);
   g_return_val_if_fail (region != NULL, NULL);
+  g_return_val_if_fail (priv->window != NULL, NULL);
   g_return_val_if_fail (priv->drawing_context == NULL, NULL);
 
   if (GSK_RENDER_MODE_CHECK (FULL_REDRAW))
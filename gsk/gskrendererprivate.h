@@ -59,6 +59,8 @@ struct _GskRendererClass
 };
 
 gboolean gsk_renderer_is_realized (GskRenderer *renderer);
+gboolean gsk_renderer_realize_headless (GskRenderer  *renderer,
+                                        GError      **error);
 
 GskRenderNode *         gsk_renderer_get_root_node              (GskRenderer    *renderer);
 GdkDrawingContext *     gsk_renderer_get_drawing_context        (GskRenderer    *renderer);
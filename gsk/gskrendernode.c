@@ -40,12 +40,14 @@
 
 #include "gskrendernodeprivate.h"
 
+#include "gskcairocacheprivate.h"
 #include "gskdebugprivate.h"
 #include "gskrendererprivate.h"
 
 #include <graphene-gobject.h>
 
 #include <math.h>
+#include <string.h>
 
 #include <gobject/gvaluecollector.h>
 
@@ -63,6 +65,193 @@ G_DEFINE_BOXED_TYPE (GskRenderNode, gsk_render_node,
 
 G_DEFINE_QUARK (gsk-serialization-error-quark, gsk_serialization_error)
 
+/* Render node arenas
+ *
+ * Snapshots create thousands of small nodes per frame and free them
+ * together when the next frame replaces them. While a snapshot is being
+ * taken, nodes are allocated from its arena by bumping a pointer into
+ * large chunks. Every node keeps a reference on its arena, and all the
+ * chunks are released at once when the last node of the arena goes
+ * away, instead of freeing each node on its own.
+ *
+ * Nodes that outlive their frame, like the ones kept by caches or the
+ * previous frame kept by a renderer, pin the whole arena. At most
+ * ARENA_MAX_PINNED arenas may be pinned, after that snapshots use the
+ * slice allocator until some of them are released, so a few long-lived
+ * nodes can't keep the memory of many frames alive.
+ * gsk_render_node_get_arena_stats() tells how much of the memory held
+ * by arenas is still used by nodes.
+ *
+ * Nodes created outside of a snapshot, in other threads or too large
+ * for a chunk use the slice allocator.
+ */
+#define ARENA_CHUNK_SIZE (16 * 1024)
+#define ARENA_ALIGN 16
+#define ARENA_ALIGN_SIZE(size) (((size) + ARENA_ALIGN - 1) & ~(gsize) (ARENA_ALIGN - 1))
+#define ARENA_CHUNK_HEADER_SIZE ARENA_ALIGN_SIZE (sizeof (GskRenderNodeArenaChunk))
+#define ARENA_MAX_NODE_SIZE ((ARENA_CHUNK_SIZE - ARENA_CHUNK_HEADER_SIZE) / 4)
+#define ARENA_MAX_PINNED 8
+
+typedef struct _GskRenderNodeArenaChunk GskRenderNodeArenaChunk;
+
+struct _GskRenderNodeArenaChunk
+{
+  GskRenderNodeArenaChunk *next;
+};
+
+struct _GskRenderNodeArena
+{
+  volatile int ref_count;
+  int depth;                    /* number of snapshots using the arena */
+  gboolean pinned;              /* all snapshots are done, but nodes are alive */
+
+  GskRenderNodeArenaChunk *chunks;
+  gsize offset;                 /* first free byte in the first chunk */
+};
+
+static GPrivate current_arena;
+
+static volatile gsize arena_bytes_held;
+static volatile gsize arena_bytes_used;
+static volatile int arena_n_pinned;
+
+static void
+gsk_render_node_arena_unref (GskRenderNodeArena *arena)
+{
+  GskRenderNodeArenaChunk *chunk, *next;
+
+  if (!g_atomic_int_dec_and_test (&arena->ref_count))
+    return;
+
+  for (chunk = arena->chunks; chunk; chunk = next)
+    {
+      next = chunk->next;
+      g_free (chunk);
+      g_atomic_pointer_add (&arena_bytes_held, - (gssize) ARENA_CHUNK_SIZE);
+    }
+
+  if (arena->pinned)
+    g_atomic_int_add (&arena_n_pinned, -1);
+
+  g_slice_free (GskRenderNodeArena, arena);
+}
+
+/*< private >
+ * gsk_render_node_arena_begin:
+ *
+ * Makes nodes created in this thread get allocated from an arena
+ * until gsk_render_node_arena_end() is called. Snapshots taken while
+ * another one is being taken share its arena.
+ *
+ * Returns: (transfer full) (nullable): the arena to pass to
+ *     gsk_render_node_arena_end(), or %NULL if too many arenas are
+ *     pinned by nodes that outlived their snapshot
+ */
+GskRenderNodeArena *
+gsk_render_node_arena_begin (void)
+{
+  GskRenderNodeArena *arena;
+
+  arena = g_private_get (&current_arena);
+  if (arena == NULL)
+    {
+      if (g_atomic_int_get (&arena_n_pinned) >= ARENA_MAX_PINNED)
+        return NULL;
+
+      arena = g_slice_new0 (GskRenderNodeArena);
+      arena->ref_count = 1;
+      g_private_set (&current_arena, arena);
+    }
+  else
+    g_atomic_int_inc (&arena->ref_count);
+
+  arena->depth++;
+
+  return arena;
+}
+
+/*< private >
+ * gsk_render_node_arena_end:
+ * @arena: (transfer full) (nullable): the arena returned by
+ *     gsk_render_node_arena_begin()
+ *
+ * Stops allocating nodes from @arena once every snapshot using
+ * it is done. The memory of the arena is released when the last
+ * node allocated from it is freed.
+ */
+void
+gsk_render_node_arena_end (GskRenderNodeArena *arena)
+{
+  if (arena == NULL)
+    return;
+
+  g_return_if_fail (g_private_get (&current_arena) == arena);
+
+  arena->depth--;
+  if (arena->depth == 0)
+    {
+      g_private_set (&current_arena, NULL);
+
+      /* Until its last node is freed */
+      arena->pinned = TRUE;
+      g_atomic_int_inc (&arena_n_pinned);
+    }
+
+  gsk_render_node_arena_unref (arena);
+}
+
+/*< private >
+ * gsk_render_node_get_arena_stats:
+ * @n_bytes_held: (out): return location for the bytes held by arenas
+ * @n_bytes_used: (out): return location for the bytes of the nodes
+ *     in arenas that have not been freed yet
+ * @n_pinned: (out): return location for the number of arenas that
+ *     are only kept alive by nodes that outlived their snapshot
+ *
+ * Gets the memory used by all node arenas, to measure how much memory
+ * is kept alive by nodes that outlive their arena.
+ */
+void
+gsk_render_node_get_arena_stats (gsize *n_bytes_held,
+                                 gsize *n_bytes_used,
+                                 guint *n_pinned)
+{
+  *n_bytes_held = (gsize) g_atomic_pointer_get (&arena_bytes_held);
+  *n_bytes_used = (gsize) g_atomic_pointer_get (&arena_bytes_used);
+  *n_pinned = g_atomic_int_get (&arena_n_pinned);
+}
+
+static gpointer
+gsk_render_node_arena_alloc (GskRenderNodeArena *arena,
+                             gsize               size)
+{
+  gpointer mem;
+
+  size = ARENA_ALIGN_SIZE (size);
+
+  if (arena->chunks == NULL || arena->offset + size > ARENA_CHUNK_SIZE)
+    {
+      GskRenderNodeArenaChunk *chunk;
+
+      /* Chunks are only touched by the thread owning the arena
+       * until they are all freed, so new ones come zeroed.
+       */
+      chunk = g_malloc0 (ARENA_CHUNK_SIZE);
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+      arena->offset = ARENA_CHUNK_HEADER_SIZE;
+      g_atomic_pointer_add (&arena_bytes_held, ARENA_CHUNK_SIZE);
+    }
+
+  mem = (guchar *) arena->chunks + arena->offset;
+  arena->offset += size;
+
+  g_atomic_int_inc (&arena->ref_count);
+  g_atomic_pointer_add (&arena_bytes_used, size);
+
+  return mem;
+}
+
 static void
 gsk_render_node_finalize (GskRenderNode *self)
 {
@@ -70,26 +259,49 @@ gsk_render_node_finalize (GskRenderNode *self)
 
   g_clear_pointer (&self->name, g_free);
 
-  g_free (self);
+  if (self->arena)
+    {
+      g_atomic_pointer_add (&arena_bytes_used, - (gssize) ARENA_ALIGN_SIZE (self->alloc_size));
+      gsk_render_node_arena_unref (self->arena);
+    }
+  else
+    g_slice_free1 (self->alloc_size, self);
 }
 
 /*< private >
  * gsk_render_node_new:
  * @node_class: class structure for this node
+ * @extra_size: the number of bytes to allocate after the node's struct
+ *
+ * Allocates a node from the arena of the snapshot being taken,
+ * if any, see gsk_render_node_arena_begin().
  *
  * Returns: (transfer full): the newly created #GskRenderNode
  */
 GskRenderNode *
 gsk_render_node_new (const GskRenderNodeClass *node_class, gsize extra_size)
 {
+  GskRenderNodeArena *arena;
   GskRenderNode *self;
+  gsize size;
 
   g_return_val_if_fail (node_class != NULL, NULL);
   g_return_val_if_fail (node_class->node_type != GSK_NOT_A_RENDER_NODE, NULL);
 
-  self = g_malloc0 (node_class->struct_size + extra_size);
+  size = node_class->struct_size + extra_size;
+  g_return_val_if_fail (size <= G_MAXUINT, NULL);
+
+  arena = g_private_get (&current_arena);
+  if (arena && size <= ARENA_MAX_NODE_SIZE)
+    {
+      self = gsk_render_node_arena_alloc (arena, size);
+      self->arena = arena;
+    }
+  else
+    self = g_slice_alloc0 (size);
 
   self->node_class = node_class;
+  self->alloc_size = size;
 
   self->ref_count = 1;
 
@@ -242,6 +454,174 @@ gsk_render_node_get_name (GskRenderNode *node)
   return node->name;
 }
 
+/*< private >
+ * gsk_render_node_hash:
+ * @node: a #GskRenderNode
+ *
+ * Computes a hash of the contents of @node, including all its children.
+ * Two nodes that are gsk_render_node_equal() have the same hash.
+ *
+ * As nodes are immutable, the hash is only computed once.
+ *
+ * Returns: the hash value
+ */
+guint
+gsk_render_node_hash (GskRenderNode *node)
+{
+  guint hash;
+
+  if (node->hash != 0)
+    return node->hash;
+
+  hash = GSK_HASH_INIT;
+  hash = gsk_hash_value (hash, node->node_class->node_type);
+  hash = gsk_hash_value (hash, node->bounds);
+  hash ^= node->node_class->hash (node);
+
+  /* 0 means "not computed yet" */
+  if (hash == 0)
+    hash = 1;
+
+  node->hash = hash;
+
+  return hash;
+}
+
+/*< private >
+ * gsk_render_node_equal:
+ * @node1: a #GskRenderNode
+ * @node2: a #GskRenderNode
+ *
+ * Checks if the two nodes, and all their children, would render
+ * exactly the same content. Objects like textures, fonts or cairo
+ * surfaces are compared by identity.
+ *
+ * Returns: %TRUE if the nodes are equal
+ */
+gboolean
+gsk_render_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  if (node1 == node2)
+    return TRUE;
+
+  if (node1->node_class != node2->node_class)
+    return FALSE;
+
+  if (memcmp (&node1->bounds, &node2->bounds, sizeof (graphene_rect_t)) != 0)
+    return FALSE;
+
+  if (node1->hash != 0 && node2->hash != 0 &&
+      node1->hash != node2->hash)
+    return FALSE;
+
+  return node1->node_class->equal (node1, node2);
+}
+
+/*< private >
+ * gsk_rect_to_cairo_rectangle_int:
+ * @rect: a #graphene_rect_t
+ * @int_rect: (out): return location for the result
+ *
+ * Computes the smallest integer rectangle that contains @rect.
+ */
+void
+gsk_rect_to_cairo_rectangle_int (const graphene_rect_t *rect,
+                                 cairo_rectangle_int_t *int_rect)
+{
+  int_rect->x = floor (rect->origin.x);
+  int_rect->y = floor (rect->origin.y);
+  int_rect->width = ceil (rect->origin.x + rect->size.width) - int_rect->x;
+  int_rect->height = ceil (rect->origin.y + rect->size.height) - int_rect->y;
+}
+
+/*< private >
+ * gsk_render_node_add_bounds_to_region:
+ * @node: a #GskRenderNode
+ * @region: the region to add to
+ *
+ * Adds all pixels that @node may draw to to @region.
+ */
+void
+gsk_render_node_add_bounds_to_region (GskRenderNode  *node,
+                                      cairo_region_t *region)
+{
+  cairo_rectangle_int_t rect;
+
+  gsk_rect_to_cairo_rectangle_int (&node->bounds, &rect);
+  cairo_region_union_rectangle (region, &rect);
+}
+
+/*< private >
+ * gsk_render_node_diff_impossible:
+ * @node1: a #GskRenderNode
+ * @node2: a #GskRenderNode
+ * @region: the region to add to
+ *
+ * The diff function for nodes whose differences can't be narrowed
+ * down any further. It adds the bounds of both nodes to @region.
+ */
+void
+gsk_render_node_diff_impossible (GskRenderNode  *node1,
+                                 GskRenderNode  *node2,
+                                 cairo_region_t *region)
+{
+  gsk_render_node_add_bounds_to_region (node1, region);
+  gsk_render_node_add_bounds_to_region (node2, region);
+}
+
+/*< private >
+ * gsk_render_node_diff:
+ * @node1: a #GskRenderNode
+ * @node2: the #GskRenderNode to compare with
+ * @region: a #cairo_region_t to add the differences to
+ *
+ * Finds the pixels that are drawn differently by @node1 and @node2
+ * and adds them to @region. The result may be larger than the actual
+ * difference, but never smaller.
+ *
+ * Children that are the same node or gsk_render_node_equal() are
+ * skipped, so this is cheap for trees that share most of their nodes
+ * or that are rebuilt from the same state.
+ */
+void
+gsk_render_node_diff (GskRenderNode  *node1,
+                      GskRenderNode  *node2,
+                      cairo_region_t *region)
+{
+  if (node1 == node2)
+    return;
+
+  if (node1->node_class != node2->node_class)
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  if (gsk_render_node_hash (node1) == gsk_render_node_hash (node2) &&
+      gsk_render_node_equal (node1, node2))
+    return;
+
+  node1->node_class->diff (node1, node2, region);
+}
+
+static const cairo_user_data_key_t draw_stats_key;
+
+/*< private >
+ * gsk_render_node_draw_stats_attach:
+ * @stats: (nullable): the statistics to update, or %NULL to detach
+ * @cr: the context to collect statistics for
+ *
+ * Makes gsk_render_node_draw() measure the time it takes to draw each
+ * node to @cr and add it to @stats.
+ */
+void
+gsk_render_node_draw_stats_attach (GskRenderNodeDrawStats *stats,
+                                   cairo_t                *cr)
+{
+  cairo_set_user_data (cr, &draw_stats_key, stats, NULL);
+}
+
 /**
  * gsk_render_node_draw:
  * @node: a #GskRenderNode
@@ -260,10 +640,22 @@ void
 gsk_render_node_draw (GskRenderNode *node,
                       cairo_t       *cr)
 {
+  GskRenderNodeDrawStats *stats;
+  GskCairoCache *cache;
+  gint64 start_time = 0, children_time = 0;
+
   g_return_if_fail (GSK_IS_RENDER_NODE (node));
   g_return_if_fail (cr != NULL);
   g_return_if_fail (cairo_status (cr) == CAIRO_STATUS_SUCCESS);
 
+  stats = cairo_get_user_data (cr, &draw_stats_key);
+  if (G_UNLIKELY (stats != NULL))
+    {
+      start_time = g_get_monotonic_time ();
+      children_time = stats->children_time;
+      stats->children_time = 0;
+    }
+
   cairo_save (cr);
 
   if (!GSK_RENDER_MODE_CHECK (GEOMETRY))
@@ -280,7 +672,9 @@ gsk_render_node_draw (GskRenderNode *node,
                             node->name ? node->name : node->node_class->type_name,
                             node));
 
-  node->node_class->draw (node, cr);
+  cache = gsk_cairo_cache_get_for_context (cr);
+  if (cache == NULL || !gsk_cairo_cache_draw (cache, node, cr))
+    node->node_class->draw (node, cr);
 
   if (GSK_RENDER_MODE_CHECK (GEOMETRY))
     {
@@ -294,6 +688,16 @@ gsk_render_node_draw (GskRenderNode *node,
 
   cairo_restore (cr);
 
+  if (G_UNLIKELY (stats != NULL))
+    {
+      GskRenderNodeType type = node->node_class->node_type;
+      gint64 elapsed = g_get_monotonic_time () - start_time;
+
+      stats->self_time[type] += elapsed - stats->children_time;
+      stats->n_nodes[type]++;
+      stats->children_time = children_time + elapsed;
+    }
+
   if (cairo_status (cr))
     {
       g_warning ("drawing failure for render node %s '%s': %s",
@@ -342,6 +746,40 @@ gsk_render_node_serialize (GskRenderNode *node)
   return result;
 }
 
+/**
+ * gsk_render_node_serialize_with_format:
+ * @node: a #GskRenderNode
+ * @format: the format to use
+ *
+ * Serializes the @node like gsk_render_node_serialize(), but allows
+ * choosing the format.
+ *
+ * %GSK_SERIALIZATION_FORMAT_BINARY is a lot faster to write and load
+ * than the #GVariant based format, in particular for nodes containing
+ * large textures, but it can only be loaded on machines with the same
+ * byte order.
+ *
+ * Returns: a #GBytes representing the node.
+ **/
+GBytes *
+gsk_render_node_serialize_with_format (GskRenderNode          *node,
+                                       GskSerializationFormat  format)
+{
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  switch (format)
+    {
+    case GSK_SERIALIZATION_FORMAT_BINARY:
+      return gsk_render_node_serialize_binary (node);
+
+    case GSK_SERIALIZATION_FORMAT_VARIANT:
+      return gsk_render_node_serialize (node);
+
+    default:
+      g_return_val_if_reached (NULL);
+    }
+}
+
 /**
  * gsk_render_node_write_to_file:
  * @node: a #GskRenderNode
@@ -384,8 +822,9 @@ gsk_render_node_write_to_file (GskRenderNode *node,
  * @bytes: the bytes containing the data
  * @error: (allow-none): location to store error or %NULL
  *
- * Loads data previously created via gsk_render_node_serialize(). For a
- * discussion of the supported format, see that function.
+ * Loads data previously created via gsk_render_node_serialize() or
+ * gsk_render_node_serialize_with_format(). For a discussion of the
+ * supported format, see that function.
  *
  * Returns: (nullable) (transfer full): a new #GskRenderNode or %NULL on
  *     error.
@@ -399,6 +838,9 @@ gsk_render_node_deserialize (GBytes  *bytes,
   GVariant *variant, *node_variant;
   GskRenderNode *node = NULL;
 
+  if (gsk_render_node_is_binary (bytes))
+    return gsk_render_node_deserialize_binary (bytes, error);
+
   variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("(suuv)"), bytes, FALSE);
 
   g_variant_get (variant, "(suuv)", &id_string, &version, &node_type, &node_variant);
@@ -427,3 +869,46 @@ out:
   return node;
 }
 
+/**
+ * gsk_render_node_load_from_file:
+ * @filename: the file to load
+ * @error: (allow-none): location to store error or %NULL
+ *
+ * Loads a node previously saved with gsk_render_node_write_to_file()
+ * or with the result of gsk_render_node_serialize_with_format().
+ *
+ * The file is mapped into memory instead of being read. For files in
+ * %GSK_SERIALIZATION_FORMAT_BINARY, the pixel data of textures is used
+ * directly from the mapping, so it is only read from disk when it is
+ * needed.
+ *
+ * Returns: (nullable) (transfer full): a new #GskRenderNode or %NULL on
+ *     error.
+ **/
+GskRenderNode *
+gsk_render_node_load_from_file (const char  *filename,
+                                GError     **error)
+{
+  GMappedFile *mapped;
+  GskRenderNode *node;
+  GBytes *bytes;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  /* Map privately, so that the file can never be changed through
+   * the surfaces of texture nodes.
+   */
+  mapped = g_mapped_file_new (filename, TRUE, error);
+  if (mapped == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  node = gsk_render_node_deserialize (bytes, error);
+  g_bytes_unref (bytes);
+
+  return node;
+}
+
@@ -86,6 +86,9 @@ void                    gsk_render_node_draw                    (GskRenderNode *
 
 GDK_AVAILABLE_IN_3_90
 GBytes *                gsk_render_node_serialize               (GskRenderNode *node);
+GDK_AVAILABLE_IN_3_94
+GBytes *                gsk_render_node_serialize_with_format   (GskRenderNode *node,
+                                                                 GskSerializationFormat format);
 GDK_AVAILABLE_IN_3_90
 gboolean                gsk_render_node_write_to_file           (GskRenderNode *node,
                                                                  const char    *filename,
@@ -93,6 +96,9 @@ gboolean                gsk_render_node_write_to_file           (GskRenderNode *
 GDK_AVAILABLE_IN_3_90
 GskRenderNode *         gsk_render_node_deserialize             (GBytes        *bytes,
                                                                  GError       **error);
+GDK_AVAILABLE_IN_3_94
+GskRenderNode *         gsk_render_node_load_from_file          (const char    *filename,
+                                                                 GError       **error);
 
 GDK_AVAILABLE_IN_3_90
 GskRenderNode *         gsk_color_node_new                      (const GdkRGBA            *rgba,
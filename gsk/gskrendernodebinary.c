@@ -0,0 +1,1398 @@
+/* GSK - The GTK Scene Kit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The binary serialization format
+ *
+ * Unlike the GVariant format, which nests one variant per node, this
+ * format is flat, so that it can be written and read in a single pass
+ * and large pixel data never needs to be copied:
+ *
+ *   Header
+ *   Node table   - one NodeRecord per node. Children always come before
+ *                  their parents, and the root is the last node.
+ *   Data section - the per-node data, referenced by offset from the node
+ *                  records. Children are referenced by their index in the
+ *                  node table, so nodes that are shared in the tree are
+ *                  only stored once.
+ *   Blob section - pixel data of textures and cairo surfaces, font
+ *                  descriptions and glyph strings. Identical blobs are
+ *                  only stored once. Every blob is aligned to BLOB_ALIGN
+ *                  bytes.
+ *
+ * All values are stored in host byte order, pixel data is in
+ * CAIRO_FORMAT_ARGB32 with a stride of 4 * width. When loading, the
+ * pixel blobs of textures are used in place, so when the bytes come from
+ * a mapped file, their pixel data is only paged in when it is drawn.
+ * Cairo nodes can be drawn to, so their pixels are copied.
+ *
+ * Because children come before their parents, the reader creates all
+ * nodes in table order without recursing. Nesting is limited to
+ * MAX_DEPTH levels, as deeper trees would overflow the stack when they
+ * are drawn or freed.
+ */
+
+#include "config.h"
+
+#include "gskrendernodeprivate.h"
+
+#include "gdk/gdktextureprivate.h"
+
+#include <pango/pangocairo.h>
+#include <string.h>
+
+#define BINARY_MAGIC "GskNodes"
+#define BINARY_VERSION 1
+#define BINARY_BYTE_ORDER 0x01020304
+#define BLOB_ALIGN 16
+#define MAX_DEPTH 256
+
+typedef struct {
+  char    magic[8];
+  guint32 byte_order;
+  guint32 version;
+  guint32 n_nodes;
+  guint32 reserved;
+  guint64 nodes_offset;
+  guint64 data_offset;
+  guint64 data_size;
+  guint64 blobs_offset;
+  guint64 blobs_size;
+} Header;
+
+typedef struct {
+  guint32 node_type;
+  guint32 data_size;
+  guint64 data_offset;
+  float   bounds[4];
+} NodeRecord;
+
+typedef struct {
+  guint64 offset;
+  guint64 size;
+} BlobRef;
+
+typedef struct {
+  guint32 glyph;
+  gint32  width;
+  gint32  x_offset;
+  gint32  y_offset;
+  guint32 is_cluster_start;
+} GlyphRecord;
+
+/*** Writing ***/
+
+typedef struct {
+  GArray *nodes;
+  GByteArray *data;
+  GByteArray *blobs;
+  /* GskRenderNode => index + 1 */
+  GHashTable *node_indices;
+  /* GBytes => offset + 1 */
+  GHashTable *blob_offsets;
+  /* GdkTexture => offset + 1, to avoid downloading textures twice */
+  GHashTable *texture_offsets;
+} Writer;
+
+static void
+write_data (Writer        *writer,
+            gconstpointer  data,
+            gsize          size)
+{
+  g_byte_array_append (writer->data, data, size);
+}
+
+#define write_value(writer, value) write_data ((writer), &(value), sizeof (value))
+
+static void
+write_uint (Writer  *writer,
+            guint32  value)
+{
+  write_value (writer, value);
+}
+
+static void
+write_float (Writer *writer,
+             float   value)
+{
+  write_value (writer, value);
+}
+
+static void
+write_double (Writer *writer,
+              double  value)
+{
+  write_value (writer, value);
+}
+
+static void
+write_rgba (Writer        *writer,
+            const GdkRGBA *rgba)
+{
+  write_double (writer, rgba->red);
+  write_double (writer, rgba->green);
+  write_double (writer, rgba->blue);
+  write_double (writer, rgba->alpha);
+}
+
+static void
+write_rect (Writer                *writer,
+            const graphene_rect_t *rect)
+{
+  write_float (writer, rect->origin.x);
+  write_float (writer, rect->origin.y);
+  write_float (writer, rect->size.width);
+  write_float (writer, rect->size.height);
+}
+
+static void
+write_rounded_rect (Writer               *writer,
+                    const GskRoundedRect *rect)
+{
+  int i;
+
+  write_rect (writer, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      write_float (writer, rect->corner[i].width);
+      write_float (writer, rect->corner[i].height);
+    }
+}
+
+static void
+write_matrix (Writer                  *writer,
+              const graphene_matrix_t *matrix)
+{
+  float values[16];
+
+  graphene_matrix_to_float (matrix, values);
+  write_data (writer, values, sizeof (values));
+}
+
+/* Takes ownership of @bytes */
+static void
+write_blob (Writer *writer,
+            GBytes *bytes)
+{
+  BlobRef ref;
+  gpointer offset;
+
+  ref.size = g_bytes_get_size (bytes);
+
+  offset = g_hash_table_lookup (writer->blob_offsets, bytes);
+  if (offset)
+    {
+      ref.offset = GPOINTER_TO_SIZE (offset) - 1;
+      g_bytes_unref (bytes);
+    }
+  else
+    {
+      static const guchar padding[BLOB_ALIGN] = { 0, };
+
+      if (writer->blobs->len % BLOB_ALIGN)
+        g_byte_array_append (writer->blobs, padding, BLOB_ALIGN - writer->blobs->len % BLOB_ALIGN);
+
+      ref.offset = writer->blobs->len;
+      g_byte_array_append (writer->blobs, g_bytes_get_data (bytes, NULL), ref.size);
+      g_hash_table_insert (writer->blob_offsets, bytes, GSIZE_TO_POINTER (ref.offset + 1));
+    }
+
+  write_value (writer, ref);
+}
+
+static GBytes *
+pixels_to_bytes (const guchar *data,
+                 int           width,
+                 int           height,
+                 int           stride)
+{
+  guchar *pixels;
+  int i;
+
+  if (stride == width * 4)
+    return g_bytes_new (data, (gsize) width * height * 4);
+
+  pixels = g_malloc ((gsize) width * height * 4);
+  for (i = 0; i < height; i++)
+    memcpy (pixels + (gsize) i * width * 4, data + (gsize) i * stride, width * 4);
+
+  return g_bytes_new_take (pixels, (gsize) width * height * 4);
+}
+
+static void
+write_texture (Writer     *writer,
+               GdkTexture *texture)
+{
+  gpointer offset;
+
+  write_uint (writer, gdk_texture_get_width (texture));
+  write_uint (writer, gdk_texture_get_height (texture));
+
+  offset = g_hash_table_lookup (writer->texture_offsets, texture);
+  if (offset)
+    {
+      BlobRef ref;
+
+      ref.offset = GPOINTER_TO_SIZE (offset) - 1;
+      ref.size = (gsize) gdk_texture_get_width (texture) * gdk_texture_get_height (texture) * 4;
+      write_value (writer, ref);
+    }
+  else
+    {
+      cairo_surface_t *surface;
+      BlobRef ref;
+
+      surface = gdk_texture_download_surface (texture);
+      write_blob (writer, pixels_to_bytes (cairo_image_surface_get_data (surface),
+                                           cairo_image_surface_get_width (surface),
+                                           cairo_image_surface_get_height (surface),
+                                           cairo_image_surface_get_stride (surface)));
+      cairo_surface_destroy (surface);
+
+      memcpy (&ref, writer->data->data + writer->data->len - sizeof (BlobRef), sizeof (BlobRef));
+      g_hash_table_insert (writer->texture_offsets, texture, GSIZE_TO_POINTER (ref.offset + 1));
+    }
+}
+
+static void
+write_font (Writer    *writer,
+            PangoFont *font)
+{
+  PangoFontDescription *desc;
+  char *s;
+
+  desc = pango_font_describe (font);
+  s = pango_font_description_to_string (desc);
+  write_blob (writer, g_bytes_new_take (s, strlen (s) + 1));
+  pango_font_description_free (desc);
+}
+
+static void
+write_glyphs (Writer               *writer,
+              const PangoGlyphInfo *glyphs,
+              guint                 n_glyphs)
+{
+  GlyphRecord *records;
+  guint i;
+
+  records = g_new (GlyphRecord, n_glyphs);
+  for (i = 0; i < n_glyphs; i++)
+    {
+      records[i].glyph = glyphs[i].glyph;
+      records[i].width = glyphs[i].geometry.width;
+      records[i].x_offset = glyphs[i].geometry.x_offset;
+      records[i].y_offset = glyphs[i].geometry.y_offset;
+      records[i].is_cluster_start = glyphs[i].attr.is_cluster_start;
+    }
+
+  write_blob (writer, g_bytes_new_take (records, n_glyphs * sizeof (GlyphRecord)));
+}
+
+static guint32
+write_node (Writer        *writer,
+            GskRenderNode *node)
+{
+  NodeRecord record;
+  gpointer index;
+  guint32 children[2];
+  guint32 *container_children = NULL;
+  guint i, n;
+
+  index = g_hash_table_lookup (writer->node_indices, node);
+  if (index)
+    return GPOINTER_TO_UINT (index) - 1;
+
+  /* Write all children before we start writing this node's data */
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      n = gsk_container_node_get_n_children (node);
+      container_children = g_new (guint32, n);
+      for (i = 0; i < n; i++)
+        container_children[i] = write_node (writer, gsk_container_node_get_child (node, i));
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      children[0] = write_node (writer, gsk_transform_node_get_child (node));
+      break;
+    case GSK_OPACITY_NODE:
+      children[0] = write_node (writer, gsk_opacity_node_get_child (node));
+      break;
+    case GSK_COLOR_MATRIX_NODE:
+      children[0] = write_node (writer, gsk_color_matrix_node_get_child (node));
+      break;
+    case GSK_REPEAT_NODE:
+      children[0] = write_node (writer, gsk_repeat_node_get_child (node));
+      break;
+    case GSK_CLIP_NODE:
+      children[0] = write_node (writer, gsk_clip_node_get_child (node));
+      break;
+    case GSK_ROUNDED_CLIP_NODE:
+      children[0] = write_node (writer, gsk_rounded_clip_node_get_child (node));
+      break;
+    case GSK_SHADOW_NODE:
+      children[0] = write_node (writer, gsk_shadow_node_get_child (node));
+      break;
+    case GSK_BLUR_NODE:
+      children[0] = write_node (writer, gsk_blur_node_get_child (node));
+      break;
+    case GSK_BLEND_NODE:
+      children[0] = write_node (writer, gsk_blend_node_get_bottom_child (node));
+      children[1] = write_node (writer, gsk_blend_node_get_top_child (node));
+      break;
+    case GSK_CROSS_FADE_NODE:
+      children[0] = write_node (writer, gsk_cross_fade_node_get_start_child (node));
+      children[1] = write_node (writer, gsk_cross_fade_node_get_end_child (node));
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_TEXTURE_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_TEXT_NODE:
+    default:
+      break;
+    }
+
+  record.node_type = gsk_render_node_get_node_type (node);
+  record.data_offset = writer->data->len;
+  record.bounds[0] = node->bounds.origin.x;
+  record.bounds[1] = node->bounds.origin.y;
+  record.bounds[2] = node->bounds.size.width;
+  record.bounds[3] = node->bounds.size.height;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_COLOR_NODE:
+      write_rgba (writer, gsk_color_node_peek_color (node));
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      {
+        const graphene_point_t *start = gsk_linear_gradient_node_peek_start (node);
+        const graphene_point_t *end = gsk_linear_gradient_node_peek_end (node);
+        const GskColorStop *stops = gsk_linear_gradient_node_peek_color_stops (node);
+
+        n = gsk_linear_gradient_node_get_n_color_stops (node);
+        write_float (writer, start->x);
+        write_float (writer, start->y);
+        write_float (writer, end->x);
+        write_float (writer, end->y);
+        write_uint (writer, n);
+        for (i = 0; i < n; i++)
+          {
+            write_double (writer, stops[i].offset);
+            write_rgba (writer, &stops[i].color);
+          }
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        const float *widths = gsk_border_node_peek_widths (node);
+        const GdkRGBA *colors = gsk_border_node_peek_colors (node);
+
+        write_rounded_rect (writer, gsk_border_node_peek_outline (node));
+        for (i = 0; i < 4; i++)
+          write_float (writer, widths[i]);
+        for (i = 0; i < 4; i++)
+          write_rgba (writer, &colors[i]);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      write_texture (writer, gsk_texture_node_get_texture (node));
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+      write_rounded_rect (writer, gsk_inset_shadow_node_peek_outline (node));
+      write_rgba (writer, gsk_inset_shadow_node_peek_color (node));
+      write_float (writer, gsk_inset_shadow_node_get_dx (node));
+      write_float (writer, gsk_inset_shadow_node_get_dy (node));
+      write_float (writer, gsk_inset_shadow_node_get_spread (node));
+      write_float (writer, gsk_inset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      write_rounded_rect (writer, gsk_outset_shadow_node_peek_outline (node));
+      write_rgba (writer, gsk_outset_shadow_node_peek_color (node));
+      write_float (writer, gsk_outset_shadow_node_get_dx (node));
+      write_float (writer, gsk_outset_shadow_node_get_dy (node));
+      write_float (writer, gsk_outset_shadow_node_get_spread (node));
+      write_float (writer, gsk_outset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_CAIRO_NODE:
+      {
+        cairo_surface_t *surface = (cairo_surface_t *) gsk_cairo_node_peek_surface (node);
+
+        if (surface == NULL)
+          {
+            write_uint (writer, 0);
+            write_uint (writer, 0);
+          }
+        else
+          {
+            cairo_surface_flush (surface);
+            write_uint (writer, cairo_image_surface_get_width (surface));
+            write_uint (writer, cairo_image_surface_get_height (surface));
+            write_blob (writer, pixels_to_bytes (cairo_image_surface_get_data (surface),
+                                                 cairo_image_surface_get_width (surface),
+                                                 cairo_image_surface_get_height (surface),
+                                                 cairo_image_surface_get_stride (surface)));
+          }
+      }
+      break;
+
+    case GSK_CONTAINER_NODE:
+      n = gsk_container_node_get_n_children (node);
+      write_uint (writer, n);
+      write_data (writer, container_children, n * sizeof (guint32));
+      g_free (container_children);
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      write_uint (writer, children[0]);
+      write_matrix (writer, gsk_transform_node_peek_transform (node));
+      break;
+
+    case GSK_OPACITY_NODE:
+      write_uint (writer, children[0]);
+      write_double (writer, gsk_opacity_node_get_opacity (node));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        float offset[4];
+
+        write_uint (writer, children[0]);
+        write_matrix (writer, gsk_color_matrix_node_peek_color_matrix (node));
+        graphene_vec4_to_float (gsk_color_matrix_node_peek_color_offset (node), offset);
+        write_data (writer, offset, sizeof (offset));
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      write_uint (writer, children[0]);
+      write_rect (writer, gsk_repeat_node_peek_child_bounds (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      write_uint (writer, children[0]);
+      write_rect (writer, gsk_clip_node_peek_clip (node));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      write_uint (writer, children[0]);
+      write_rounded_rect (writer, gsk_rounded_clip_node_peek_clip (node));
+      break;
+
+    case GSK_SHADOW_NODE:
+      n = gsk_shadow_node_get_n_shadows (node);
+      write_uint (writer, children[0]);
+      write_uint (writer, n);
+      for (i = 0; i < n; i++)
+        {
+          const GskShadow *shadow = gsk_shadow_node_peek_shadow (node, i);
+
+          write_rgba (writer, &shadow->color);
+          write_float (writer, shadow->dx);
+          write_float (writer, shadow->dy);
+          write_float (writer, shadow->radius);
+        }
+      break;
+
+    case GSK_BLEND_NODE:
+      write_uint (writer, children[0]);
+      write_uint (writer, children[1]);
+      write_uint (writer, gsk_blend_node_get_blend_mode (node));
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      write_uint (writer, children[0]);
+      write_uint (writer, children[1]);
+      write_double (writer, gsk_cross_fade_node_get_progress (node));
+      break;
+
+    case GSK_TEXT_NODE:
+      write_font (writer, (PangoFont *) gsk_text_node_peek_font (node));
+      write_rgba (writer, gsk_text_node_peek_color (node));
+      write_double (writer, gsk_text_node_get_x (node));
+      write_double (writer, gsk_text_node_get_y (node));
+      write_glyphs (writer, gsk_text_node_peek_glyphs (node), gsk_text_node_get_num_glyphs (node));
+      break;
+
+    case GSK_BLUR_NODE:
+      write_uint (writer, children[0]);
+      write_double (writer, gsk_blur_node_get_radius (node));
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+    }
+
+  record.data_size = writer->data->len - record.data_offset;
+
+  g_array_append_val (writer->nodes, record);
+  g_hash_table_insert (writer->node_indices, node, GUINT_TO_POINTER (writer->nodes->len));
+
+  return writer->nodes->len - 1;
+}
+
+static gsize
+align_offset (gsize offset)
+{
+  return (offset + BLOB_ALIGN - 1) / BLOB_ALIGN * BLOB_ALIGN;
+}
+
+/*< private >
+ * gsk_render_node_serialize_binary:
+ * @node: a #GskRenderNode
+ *
+ * Serializes @node into the binary format described at the top
+ * of this file.
+ *
+ * Returns: a #GBytes representing the node
+ */
+GBytes *
+gsk_render_node_serialize_binary (GskRenderNode *node)
+{
+  Writer writer;
+  Header header = { { 0, }, };
+  GByteArray *result;
+  static const guchar padding[BLOB_ALIGN] = { 0, };
+
+  writer.nodes = g_array_new (FALSE, FALSE, sizeof (NodeRecord));
+  writer.data = g_byte_array_new ();
+  writer.blobs = g_byte_array_new ();
+  writer.node_indices = g_hash_table_new (NULL, NULL);
+  writer.blob_offsets = g_hash_table_new_full (g_bytes_hash, g_bytes_equal, (GDestroyNotify) g_bytes_unref, NULL);
+  writer.texture_offsets = g_hash_table_new (NULL, NULL);
+
+  write_node (&writer, node);
+
+  memcpy (header.magic, BINARY_MAGIC, sizeof (header.magic));
+  header.byte_order = BINARY_BYTE_ORDER;
+  header.version = BINARY_VERSION;
+  header.n_nodes = writer.nodes->len;
+  header.nodes_offset = align_offset (sizeof (Header));
+  header.data_offset = align_offset (header.nodes_offset + writer.nodes->len * sizeof (NodeRecord));
+  header.data_size = writer.data->len;
+  header.blobs_offset = align_offset (header.data_offset + header.data_size);
+  header.blobs_size = writer.blobs->len;
+
+  result = g_byte_array_sized_new (header.blobs_offset + header.blobs_size);
+
+  g_byte_array_append (result, (guchar *) &header, sizeof (Header));
+  g_byte_array_append (result, padding, header.nodes_offset - result->len);
+  g_byte_array_append (result, (guchar *) writer.nodes->data, writer.nodes->len * sizeof (NodeRecord));
+  g_byte_array_append (result, padding, header.data_offset - result->len);
+  g_byte_array_append (result, writer.data->data, writer.data->len);
+  g_byte_array_append (result, padding, header.blobs_offset - result->len);
+  g_byte_array_append (result, writer.blobs->data, writer.blobs->len);
+
+  g_array_unref (writer.nodes);
+  g_byte_array_unref (writer.data);
+  g_byte_array_unref (writer.blobs);
+  g_hash_table_unref (writer.node_indices);
+  g_hash_table_unref (writer.blob_offsets);
+  g_hash_table_unref (writer.texture_offsets);
+
+  return g_byte_array_free_to_bytes (result);
+}
+
+/*** Reading ***/
+
+typedef struct {
+  GBytes *bytes;
+  const Header *header;
+  const NodeRecord *records;
+  const guchar *data;
+  const guchar *blobs;
+  /* created nodes and their depth, indexed like the node table */
+  GskRenderNode **nodes;
+  guint16 *depths;
+  /* blob offset => PangoFont */
+  GHashTable *fonts;
+  PangoContext *context;
+  GError **error;
+} Reader;
+
+typedef struct {
+  Reader *reader;
+  const guchar *data;
+  gsize size;
+  gsize pos;
+  gboolean failed;
+} Cursor;
+
+static gboolean
+read_data (Cursor   *cursor,
+           gpointer  data,
+           gsize     size)
+{
+  if (cursor->failed || cursor->size - cursor->pos < size)
+    {
+      if (!cursor->failed)
+        g_set_error (cursor->reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                     "Node data is truncated.");
+      cursor->failed = TRUE;
+      memset (data, 0, size);
+      return FALSE;
+    }
+
+  memcpy (data, cursor->data + cursor->pos, size);
+  cursor->pos += size;
+
+  return TRUE;
+}
+
+#define read_value(cursor, value) read_data ((cursor), (value), sizeof (*(value)))
+
+static guint32
+read_uint (Cursor *cursor)
+{
+  guint32 value;
+
+  read_value (cursor, &value);
+
+  return value;
+}
+
+static float
+read_float (Cursor *cursor)
+{
+  float value;
+
+  read_value (cursor, &value);
+
+  return value;
+}
+
+static double
+read_double (Cursor *cursor)
+{
+  double value;
+
+  read_value (cursor, &value);
+
+  return value;
+}
+
+static void
+read_rgba (Cursor  *cursor,
+           GdkRGBA *rgba)
+{
+  rgba->red = read_double (cursor);
+  rgba->green = read_double (cursor);
+  rgba->blue = read_double (cursor);
+  rgba->alpha = read_double (cursor);
+}
+
+static void
+read_rect (Cursor          *cursor,
+           graphene_rect_t *rect)
+{
+  float x, y, w, h;
+
+  x = read_float (cursor);
+  y = read_float (cursor);
+  w = read_float (cursor);
+  h = read_float (cursor);
+
+  graphene_rect_init (rect, x, y, w, h);
+}
+
+static void
+read_rounded_rect (Cursor         *cursor,
+                   GskRoundedRect *rect)
+{
+  int i;
+
+  read_rect (cursor, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      rect->corner[i].width = read_float (cursor);
+      rect->corner[i].height = read_float (cursor);
+    }
+}
+
+static void
+read_matrix (Cursor            *cursor,
+             graphene_matrix_t *matrix)
+{
+  float values[16];
+
+  read_data (cursor, values, sizeof (values));
+  graphene_matrix_init_from_float (matrix, values);
+}
+
+static const guchar *
+read_blob (Cursor *cursor,
+           gsize   expected_size,
+           gsize  *size)
+{
+  const Header *header = cursor->reader->header;
+  BlobRef ref;
+
+  if (!read_value (cursor, &ref))
+    return NULL;
+
+  if (ref.offset > header->blobs_size ||
+      ref.size > header->blobs_size - ref.offset ||
+      (expected_size != 0 && ref.size != expected_size))
+    {
+      g_set_error (cursor->reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid blob reference.");
+      cursor->failed = TRUE;
+      return NULL;
+    }
+
+  if (size)
+    *size = ref.size;
+
+  return cursor->reader->blobs + ref.offset;
+}
+
+static const cairo_user_data_key_t gsk_surface_bytes_key;
+
+/* Creates an image surface for pixel data. Unless @copy is %TRUE, the
+ * pixel data is used in place and the surface keeps the bytes alive,
+ * so such surfaces must never be drawn to.
+ */
+static cairo_surface_t *
+read_surface (Cursor   *cursor,
+              gboolean  copy)
+{
+  cairo_surface_t *surface;
+  const guchar *pixels;
+  guint32 width, height;
+
+  width = read_uint (cursor);
+  height = read_uint (cursor);
+  if (width == 0 || height == 0 || cursor->failed)
+    return NULL;
+
+  if (width > G_MAXINT / 4 || height > G_MAXSIZE / 4 / width)
+    {
+      g_set_error (cursor->reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid image size %ux%u.", width, height);
+      cursor->failed = TRUE;
+      return NULL;
+    }
+
+  pixels = read_blob (cursor, (gsize) width * height * 4, NULL);
+  if (pixels == NULL)
+    return NULL;
+
+  if (copy)
+    {
+      guchar *data;
+      int stride;
+      guint32 y;
+
+      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+      if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+        {
+          g_set_error (cursor->reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                       "Could not create %ux%u image.", width, height);
+          cursor->failed = TRUE;
+          cairo_surface_destroy (surface);
+          return NULL;
+        }
+
+      data = cairo_image_surface_get_data (surface);
+      stride = cairo_image_surface_get_stride (surface);
+      for (y = 0; y < height; y++)
+        memcpy (data + y * stride, pixels + (gsize) y * width * 4, width * 4);
+      cairo_surface_mark_dirty (surface);
+
+      return surface;
+    }
+
+  surface = cairo_image_surface_create_for_data ((guchar *) pixels,
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 width, height, width * 4);
+  cairo_surface_set_user_data (surface,
+                               &gsk_surface_bytes_key,
+                               g_bytes_ref (cursor->reader->bytes),
+                               (cairo_destroy_func_t) g_bytes_unref);
+
+  return surface;
+}
+
+static PangoFont *
+read_font (Cursor *cursor)
+{
+  Reader *reader = cursor->reader;
+  PangoFontDescription *desc;
+  PangoFontMap *fontmap;
+  const guchar *blob;
+  PangoFont *font;
+  gsize size;
+
+  blob = read_blob (cursor, 0, &size);
+  if (blob == NULL)
+    return NULL;
+
+  if (size == 0 || blob[size - 1] != '\0')
+    {
+      g_set_error (reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid font description.");
+      cursor->failed = TRUE;
+      return NULL;
+    }
+
+  font = g_hash_table_lookup (reader->fonts, blob);
+  if (font)
+    return font;
+
+  fontmap = pango_cairo_font_map_get_default ();
+  if (reader->context == NULL)
+    reader->context = pango_font_map_create_context (fontmap);
+
+  desc = pango_font_description_from_string ((const char *) blob);
+  font = pango_font_map_load_font (fontmap, reader->context, desc);
+  pango_font_description_free (desc);
+
+  if (font == NULL)
+    {
+      g_set_error (reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Could not load font \"%s\".", (const char *) blob);
+      cursor->failed = TRUE;
+      return NULL;
+    }
+
+  g_hash_table_insert (reader->fonts, (gpointer) blob, font);
+
+  return font;
+}
+
+static PangoGlyphString *
+read_glyphs (Cursor *cursor)
+{
+  PangoGlyphString *glyphs;
+  const GlyphRecord *records;
+  gsize size;
+  guint i, n;
+
+  records = (const GlyphRecord *) read_blob (cursor, 0, &size);
+  if (records == NULL)
+    return NULL;
+
+  n = size / sizeof (GlyphRecord);
+
+  glyphs = pango_glyph_string_new ();
+  pango_glyph_string_set_size (glyphs, n);
+  for (i = 0; i < n; i++)
+    {
+      glyphs->glyphs[i].glyph = records[i].glyph;
+      glyphs->glyphs[i].geometry.width = records[i].width;
+      glyphs->glyphs[i].geometry.x_offset = records[i].x_offset;
+      glyphs->glyphs[i].geometry.y_offset = records[i].y_offset;
+      glyphs->glyphs[i].attr.is_cluster_start = records[i].is_cluster_start;
+    }
+
+  return glyphs;
+}
+
+static GskRenderNode *
+read_child (Cursor  *cursor,
+            guint32  parent)
+{
+  Reader *reader = cursor->reader;
+  guint32 index = read_uint (cursor);
+
+  if (cursor->failed)
+    return NULL;
+
+  /* Children are always written before their parents, so they have
+   * been created already. This also protects us against cycles.
+   */
+  if (index >= parent)
+    {
+      g_set_error (reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid child node %u of node %u.", index, parent);
+      cursor->failed = TRUE;
+      return NULL;
+    }
+
+  if (reader->depths[index] >= MAX_DEPTH)
+    {
+      g_set_error (reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Node %u is nested more than %u levels deep.", parent, MAX_DEPTH);
+      cursor->failed = TRUE;
+      return NULL;
+    }
+
+  reader->depths[parent] = MAX (reader->depths[parent], reader->depths[index] + 1);
+
+  return reader->nodes[index];
+}
+
+static GskRenderNode *
+read_node_data (Reader           *reader,
+                guint32           index,
+                const NodeRecord *record,
+                Cursor           *cursor)
+{
+  graphene_rect_t bounds;
+  GskRenderNode *result = NULL;
+  guint i, n;
+
+  graphene_rect_init (&bounds, record->bounds[0], record->bounds[1], record->bounds[2], record->bounds[3]);
+
+  switch (record->node_type)
+    {
+    case GSK_COLOR_NODE:
+      {
+        GdkRGBA color;
+
+        read_rgba (cursor, &color);
+        if (!cursor->failed)
+          result = gsk_color_node_new (&color, &bounds);
+      }
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      {
+        graphene_point_t start, end;
+        GskColorStop *stops;
+
+        start.x = read_float (cursor);
+        start.y = read_float (cursor);
+        end.x = read_float (cursor);
+        end.y = read_float (cursor);
+        n = read_uint (cursor);
+        if (cursor->failed || n > cursor->size / (5 * sizeof (double)))
+          break;
+
+        stops = g_new (GskColorStop, n);
+        for (i = 0; i < n; i++)
+          {
+            stops[i].offset = read_double (cursor);
+            read_rgba (cursor, &stops[i].color);
+          }
+
+        if (cursor->failed)
+          ;
+        else if (record->node_type == GSK_LINEAR_GRADIENT_NODE)
+          result = gsk_linear_gradient_node_new (&bounds, &start, &end, stops, n);
+        else
+          result = gsk_repeating_linear_gradient_node_new (&bounds, &start, &end, stops, n);
+
+        g_free (stops);
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        GskRoundedRect outline;
+        float widths[4];
+        GdkRGBA colors[4];
+
+        read_rounded_rect (cursor, &outline);
+        for (i = 0; i < 4; i++)
+          widths[i] = read_float (cursor);
+        for (i = 0; i < 4; i++)
+          read_rgba (cursor, &colors[i]);
+
+        if (!cursor->failed)
+          result = gsk_border_node_new (&outline, widths, colors);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        cairo_surface_t *surface;
+        GdkTexture *texture;
+
+        surface = read_surface (cursor, FALSE);
+        if (surface == NULL)
+          break;
+
+        texture = gdk_texture_new_for_surface (surface);
+        result = gsk_texture_node_new (texture, &bounds);
+
+        g_object_unref (texture);
+        cairo_surface_destroy (surface);
+      }
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      {
+        GskRoundedRect outline;
+        GdkRGBA color;
+        float dx, dy, spread, radius;
+
+        read_rounded_rect (cursor, &outline);
+        read_rgba (cursor, &color);
+        dx = read_float (cursor);
+        dy = read_float (cursor);
+        spread = read_float (cursor);
+        radius = read_float (cursor);
+
+        if (cursor->failed)
+          ;
+        else if (record->node_type == GSK_INSET_SHADOW_NODE)
+          result = gsk_inset_shadow_node_new (&outline, &color, dx, dy, spread, radius);
+        else
+          result = gsk_outset_shadow_node_new (&outline, &color, dx, dy, spread, radius);
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      {
+        cairo_surface_t *surface;
+
+        surface = read_surface (cursor, TRUE);
+        if (cursor->failed)
+          break;
+
+        if (surface)
+          {
+            result = gsk_cairo_node_new_for_surface (&bounds, surface);
+            cairo_surface_destroy (surface);
+          }
+        else
+          {
+            result = gsk_cairo_node_new (&bounds);
+          }
+      }
+      break;
+
+    case GSK_CONTAINER_NODE:
+      {
+        GskRenderNode **children;
+
+        n = read_uint (cursor);
+        if (cursor->failed || n > cursor->size / sizeof (guint32))
+          break;
+
+        children = g_new0 (GskRenderNode *, n);
+        for (i = 0; i < n && !cursor->failed; i++)
+          children[i] = read_child (cursor, index);
+
+        if (!cursor->failed)
+          result = gsk_container_node_new (children, n);
+
+        g_free (children);
+      }
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        graphene_matrix_t transform;
+
+        read_matrix (cursor, &transform);
+        if (!cursor->failed)
+          result = gsk_transform_node_new (child, &transform);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        double opacity = read_double (cursor);
+
+        if (!cursor->failed)
+          result = gsk_opacity_node_new (child, opacity);
+      }
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        graphene_matrix_t matrix;
+        graphene_vec4_t offset;
+        float values[4];
+
+        read_matrix (cursor, &matrix);
+        read_data (cursor, values, sizeof (values));
+        graphene_vec4_init_from_float (&offset, values);
+        if (!cursor->failed)
+          result = gsk_color_matrix_node_new (child, &matrix, &offset);
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        graphene_rect_t child_bounds;
+
+        read_rect (cursor, &child_bounds);
+        if (!cursor->failed)
+          result = gsk_repeat_node_new (&bounds, child, &child_bounds);
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        graphene_rect_t clip;
+
+        read_rect (cursor, &clip);
+        if (!cursor->failed)
+          result = gsk_clip_node_new (child, &clip);
+      }
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        GskRoundedRect clip;
+
+        read_rounded_rect (cursor, &clip);
+        if (!cursor->failed)
+          result = gsk_rounded_clip_node_new (child, &clip);
+      }
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        GskShadow *shadows;
+
+        n = read_uint (cursor);
+        if (cursor->failed || n > cursor->size / (4 * sizeof (double)))
+          break;
+
+        shadows = g_new (GskShadow, n);
+        for (i = 0; i < n; i++)
+          {
+            read_rgba (cursor, &shadows[i].color);
+            shadows[i].dx = read_float (cursor);
+            shadows[i].dy = read_float (cursor);
+            shadows[i].radius = read_float (cursor);
+          }
+
+        if (!cursor->failed)
+          result = gsk_shadow_node_new (child, shadows, n);
+
+        g_free (shadows);
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      {
+        GskRenderNode *bottom = read_child (cursor, index);
+        GskRenderNode *top = read_child (cursor, index);
+        guint32 mode = read_uint (cursor);
+
+        if (!cursor->failed)
+          result = gsk_blend_node_new (bottom, top, mode);
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        GskRenderNode *start = read_child (cursor, index);
+        GskRenderNode *end = read_child (cursor, index);
+        double progress = read_double (cursor);
+
+        if (!cursor->failed)
+          result = gsk_cross_fade_node_new (start, end, progress);
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        PangoFont *font = read_font (cursor);
+        PangoGlyphString *glyphs;
+        GdkRGBA color;
+        double x, y;
+
+        read_rgba (cursor, &color);
+        x = read_double (cursor);
+        y = read_double (cursor);
+        glyphs = read_glyphs (cursor);
+
+        if (!cursor->failed)
+          result = gsk_text_node_new (font, glyphs, &color, x, y);
+
+        if (glyphs)
+          pango_glyph_string_free (glyphs);
+      }
+      break;
+
+    case GSK_BLUR_NODE:
+      {
+        GskRenderNode *child = read_child (cursor, index);
+        double radius = read_double (cursor);
+
+        if (!cursor->failed)
+          result = gsk_blur_node_new (child, radius);
+      }
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_set_error (reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid node type %u.", record->node_type);
+      cursor->failed = TRUE;
+      break;
+    }
+
+  if (result == NULL && !cursor->failed)
+    {
+      g_set_error (reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Could not create node %u.", index);
+    }
+
+  return result;
+}
+
+static GskRenderNode *
+read_node (Reader  *reader,
+           guint32  index)
+{
+  const NodeRecord *record;
+  Cursor cursor = { reader, };
+
+  record = &reader->records[index];
+  if (record->data_offset > reader->header->data_size ||
+      record->data_size > reader->header->data_size - record->data_offset)
+    {
+      g_set_error (reader->error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid data for node %u.", index);
+      return NULL;
+    }
+
+  cursor.data = reader->data + record->data_offset;
+  cursor.size = record->data_size;
+
+  reader->nodes[index] = read_node_data (reader, index, record, &cursor);
+
+  return reader->nodes[index];
+}
+
+/*< private >
+ * gsk_render_node_is_binary:
+ * @bytes: the serialized data
+ *
+ * Checks if @bytes is in the binary format.
+ *
+ * Returns: %TRUE if @bytes should be passed to
+ *     gsk_render_node_deserialize_binary()
+ */
+gboolean
+gsk_render_node_is_binary (GBytes *bytes)
+{
+  gsize size;
+  const guchar *data = g_bytes_get_data (bytes, &size);
+
+  return size >= sizeof (Header) && memcmp (data, BINARY_MAGIC, 8) == 0;
+}
+
+/*< private >
+ * gsk_render_node_deserialize_binary:
+ * @bytes: data created by gsk_render_node_serialize_binary()
+ * @error: return location for an error
+ *
+ * Loads a node tree from the binary format. The pixel data of textures
+ * is not copied, the created nodes keep a reference on @bytes instead.
+ *
+ * Returns: (nullable) (transfer full): the root node or %NULL on error
+ */
+GskRenderNode *
+gsk_render_node_deserialize_binary (GBytes  *bytes,
+                                    GError **error)
+{
+  Reader reader = { NULL, };
+  const guchar *data;
+  Header header;
+  GskRenderNode *result = NULL;
+  gsize size;
+  guint i;
+
+  data = g_bytes_get_data (bytes, &size);
+  if (size < sizeof (Header))
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_FORMAT,
+                   "Data not in GskRenderNode serialization format.");
+      return NULL;
+    }
+
+  memcpy (&header, data, sizeof (Header));
+
+  if (memcmp (header.magic, BINARY_MAGIC, sizeof (header.magic)) != 0 ||
+      header.byte_order != BINARY_BYTE_ORDER)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_FORMAT,
+                   "Data not in GskRenderNode binary serialization format.");
+      return NULL;
+    }
+
+  if (header.version != BINARY_VERSION)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_VERSION,
+                   "Format version %u not supported.", header.version);
+      return NULL;
+    }
+
+  if (header.n_nodes == 0 ||
+      header.nodes_offset % BLOB_ALIGN != 0 ||
+      header.nodes_offset > size ||
+      header.n_nodes > (size - header.nodes_offset) / sizeof (NodeRecord) ||
+      header.data_offset > size ||
+      header.data_size > size - header.data_offset ||
+      header.blobs_offset % BLOB_ALIGN != 0 ||
+      header.blobs_offset > size ||
+      header.blobs_size > size - header.blobs_offset)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid header.");
+      return NULL;
+    }
+
+  reader.bytes = bytes;
+  reader.header = &header;
+  reader.records = (const NodeRecord *) (data + header.nodes_offset);
+  reader.data = data + header.data_offset;
+  reader.blobs = data + header.blobs_offset;
+  reader.nodes = g_new0 (GskRenderNode *, header.n_nodes);
+  reader.depths = g_new0 (guint16, header.n_nodes);
+  reader.fonts = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+  reader.error = error;
+
+  /* Nodes that are shared in the tree are only created once */
+  for (i = 0; i < header.n_nodes; i++)
+    {
+      if (read_node (&reader, i) == NULL)
+        break;
+    }
+
+  if (i == header.n_nodes)
+    result = gsk_render_node_ref (reader.nodes[header.n_nodes - 1]);
+
+  for (i = 0; i < header.n_nodes; i++)
+    g_clear_pointer (&reader.nodes[i], gsk_render_node_unref);
+  g_free (reader.nodes);
+  g_free (reader.depths);
+  g_hash_table_unref (reader.fonts);
+  g_clear_object (&reader.context);
+
+  return result;
+}
@@ -26,6 +26,8 @@
 #include "gskroundedrectprivate.h"
 #include "gdk/gdktextureprivate.h"
 
+#include <string.h>
+
 static gboolean
 check_variant_type (GVariant *variant,
                     const char *type_string,
@@ -103,14 +105,38 @@ gsk_color_node_deserialize (GVariant  *variant,
   return gsk_color_node_new (&color, &GRAPHENE_RECT_INIT (x, y, w, h));
 }
 
+static guint
+gsk_color_node_hash (GskRenderNode *node)
+{
+  GskColorNode *self = (GskColorNode *) node;
+  guint hash = GSK_HASH_INIT;
+
+  hash = gsk_hash_value (hash, self->color);
+
+  return hash;
+}
+
+static gboolean
+gsk_color_node_equal (GskRenderNode *node1,
+                      GskRenderNode *node2)
+{
+  GskColorNode *self1 = (GskColorNode *) node1;
+  GskColorNode *self2 = (GskColorNode *) node2;
+
+  return gdk_rgba_equal (&self1->color, &self2->color);
+}
+
 static const GskRenderNodeClass GSK_COLOR_NODE_CLASS = {
   GSK_COLOR_NODE,
   sizeof (GskColorNode),
   "GskColorNode",
   gsk_color_node_finalize,
   gsk_color_node_draw,
+  gsk_color_node_hash,
+  gsk_color_node_equal,
   gsk_color_node_serialize,
   gsk_color_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 const GdkRGBA *
@@ -281,14 +307,43 @@ gsk_repeating_linear_gradient_node_deserialize (GVariant  *variant,
   return gsk_linear_gradient_node_real_deserialize (variant, TRUE, error);
 }
 
+static guint
+gsk_linear_gradient_node_hash (GskRenderNode *node)
+{
+  GskLinearGradientNode *self = (GskLinearGradientNode *) node;
+  guint hash = GSK_HASH_INIT;
+
+  hash = gsk_hash_value (hash, self->start);
+  hash = gsk_hash_value (hash, self->end);
+  hash = gsk_hash_data (hash, self->stops, self->n_stops * sizeof (GskColorStop));
+
+  return hash;
+}
+
+static gboolean
+gsk_linear_gradient_node_equal (GskRenderNode *node1,
+                                GskRenderNode *node2)
+{
+  GskLinearGradientNode *self1 = (GskLinearGradientNode *) node1;
+  GskLinearGradientNode *self2 = (GskLinearGradientNode *) node2;
+
+  return memcmp (&self1->start, &self2->start, sizeof (graphene_point_t)) == 0 &&
+         memcmp (&self1->end, &self2->end, sizeof (graphene_point_t)) == 0 &&
+         self1->n_stops == self2->n_stops &&
+         memcmp (self1->stops, self2->stops, self1->n_stops * sizeof (GskColorStop)) == 0;
+}
+
 static const GskRenderNodeClass GSK_LINEAR_GRADIENT_NODE_CLASS = {
   GSK_LINEAR_GRADIENT_NODE,
   sizeof (GskLinearGradientNode),
   "GskLinearGradientNode",
   gsk_linear_gradient_node_finalize,
   gsk_linear_gradient_node_draw,
+  gsk_linear_gradient_node_hash,
+  gsk_linear_gradient_node_equal,
   gsk_linear_gradient_node_serialize,
   gsk_linear_gradient_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 static const GskRenderNodeClass GSK_REPEATING_LINEAR_GRADIENT_NODE_CLASS = {
@@ -297,8 +352,11 @@ static const GskRenderNodeClass GSK_REPEATING_LINEAR_GRADIENT_NODE_CLASS = {
   "GskRepeatingLinearGradientNode",
   gsk_linear_gradient_node_finalize,
   gsk_linear_gradient_node_draw,
+  gsk_linear_gradient_node_hash,
+  gsk_linear_gradient_node_equal,
   gsk_linear_gradient_node_serialize,
   gsk_repeating_linear_gradient_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -584,14 +642,42 @@ gsk_border_node_deserialize (GVariant  *variant,
                               colors);
 }
 
+static guint
+gsk_border_node_hash (GskRenderNode *node)
+{
+  GskBorderNode *self = (GskBorderNode *) node;
+  guint hash = GSK_HASH_INIT;
+
+  hash = gsk_hash_value (hash, self->outline);
+  hash = gsk_hash_value (hash, self->border_width);
+  hash = gsk_hash_value (hash, self->border_color);
+
+  return hash;
+}
+
+static gboolean
+gsk_border_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  GskBorderNode *self1 = (GskBorderNode *) node1;
+  GskBorderNode *self2 = (GskBorderNode *) node2;
+
+  return memcmp (&self1->outline, &self2->outline, sizeof (self1->outline)) == 0 &&
+         memcmp (&self1->border_width, &self2->border_width, sizeof (self1->border_width)) == 0 &&
+         memcmp (&self1->border_color, &self2->border_color, sizeof (self1->border_color)) == 0;
+}
+
 static const GskRenderNodeClass GSK_BORDER_NODE_CLASS = {
   GSK_BORDER_NODE,
   sizeof (GskBorderNode),
   "GskBorderNode",
   gsk_border_node_finalize,
   gsk_border_node_draw,
+  gsk_border_node_hash,
+  gsk_border_node_equal,
   gsk_border_node_serialize,
-  gsk_border_node_deserialize
+  gsk_border_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 const GskRoundedRect *
@@ -757,14 +843,38 @@ gsk_texture_node_deserialize (GVariant  *variant,
   return node;
 }
 
+static guint
+gsk_texture_node_hash (GskRenderNode *node)
+{
+  GskTextureNode *self = (GskTextureNode *) node;
+  guint hash = GSK_HASH_INIT;
+
+  hash = gsk_hash_value (hash, self->texture);
+
+  return hash;
+}
+
+static gboolean
+gsk_texture_node_equal (GskRenderNode *node1,
+                        GskRenderNode *node2)
+{
+  GskTextureNode *self1 = (GskTextureNode *) node1;
+  GskTextureNode *self2 = (GskTextureNode *) node2;
+
+  return self1->texture == self2->texture;
+}
+
 static const GskRenderNodeClass GSK_TEXTURE_NODE_CLASS = {
   GSK_TEXTURE_NODE,
   sizeof (GskTextureNode),
   "GskTextureNode",
   gsk_texture_node_finalize,
   gsk_texture_node_draw,
+  gsk_texture_node_hash,
+  gsk_texture_node_equal,
   gsk_texture_node_serialize,
-  gsk_texture_node_deserialize
+  gsk_texture_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 GdkTexture *
@@ -1259,14 +1369,48 @@ gsk_inset_shadow_node_deserialize (GVariant  *variant,
                                     &color, dx, dy, spread, radius);
 }
 
+static guint
+gsk_inset_shadow_node_hash (GskRenderNode *node)
+{
+  GskInsetShadowNode *self = (GskInsetShadowNode *) node;
+  guint hash = GSK_HASH_INIT;
+
+  hash = gsk_hash_value (hash, self->outline);
+  hash = gsk_hash_value (hash, self->color);
+  hash = gsk_hash_value (hash, self->dx);
+  hash = gsk_hash_value (hash, self->dy);
+  hash = gsk_hash_value (hash, self->spread);
+  hash = gsk_hash_value (hash, self->blur_radius);
+
+  return hash;
+}
+
+static gboolean
+gsk_inset_shadow_node_equal (GskRenderNode *node1,
+                             GskRenderNode *node2)
+{
+  GskInsetShadowNode *self1 = (GskInsetShadowNode *) node1;
+  GskInsetShadowNode *self2 = (GskInsetShadowNode *) node2;
+
+  return memcmp (&self1->outline, &self2->outline, sizeof (self1->outline)) == 0 &&
+         gdk_rgba_equal (&self1->color, &self2->color) &&
+         self1->dx == self2->dx &&
+         self1->dy == self2->dy &&
+         self1->spread == self2->spread &&
+         self1->blur_radius == self2->blur_radius;
+}
+
 static const GskRenderNodeClass GSK_INSET_SHADOW_NODE_CLASS = {
   GSK_INSET_SHADOW_NODE,
   sizeof (GskInsetShadowNode),
   "GskInsetShadowNode",
   gsk_inset_shadow_node_finalize,
   gsk_inset_shadow_node_draw,
+  gsk_inset_shadow_node_hash,
+  gsk_inset_shadow_node_equal,
   gsk_inset_shadow_node_serialize,
-  gsk_inset_shadow_node_deserialize
+  gsk_inset_shadow_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -1562,14 +1706,48 @@ gsk_outset_shadow_node_deserialize (GVariant  *variant,
                                      &color, dx, dy, spread, radius);
 }
 
+static guint
+gsk_outset_shadow_node_hash (GskRenderNode *node)
+{
+  GskOutsetShadowNode *self = (GskOutsetShadowNode *) node;
+  guint hash = GSK_HASH_INIT;
+
+  hash = gsk_hash_value (hash, self->outline);
+  hash = gsk_hash_value (hash, self->color);
+  hash = gsk_hash_value (hash, self->dx);
+  hash = gsk_hash_value (hash, self->dy);
+  hash = gsk_hash_value (hash, self->spread);
+  hash = gsk_hash_value (hash, self->blur_radius);
+
+  return hash;
+}
+
+static gboolean
+gsk_outset_shadow_node_equal (GskRenderNode *node1,
+                              GskRenderNode *node2)
+{
+  GskOutsetShadowNode *self1 = (GskOutsetShadowNode *) node1;
+  GskOutsetShadowNode *self2 = (GskOutsetShadowNode *) node2;
+
+  return memcmp (&self1->outline, &self2->outline, sizeof (self1->outline)) == 0 &&
+         gdk_rgba_equal (&self1->color, &self2->color) &&
+         self1->dx == self2->dx &&
+         self1->dy == self2->dy &&
+         self1->spread == self2->spread &&
+         self1->blur_radius == self2->blur_radius;
+}
+
 static const GskRenderNodeClass GSK_OUTSET_SHADOW_NODE_CLASS = {
   GSK_OUTSET_SHADOW_NODE,
   sizeof (GskOutsetShadowNode),
   "GskOutsetShadowNode",
   gsk_outset_shadow_node_finalize,
   gsk_outset_shadow_node_draw,
+  gsk_outset_shadow_node_hash,
+  gsk_outset_shadow_node_equal,
   gsk_outset_shadow_node_serialize,
-  gsk_outset_shadow_node_deserialize
+  gsk_outset_shadow_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -1819,14 +1997,38 @@ gsk_cairo_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_cairo_node_hash (GskRenderNode *node)
+{
+  GskCairoNode *self = (GskCairoNode *) node;
+  guint hash = GSK_HASH_INIT;
+
+  hash = gsk_hash_value (hash, self->surface);
+
+  return hash;
+}
+
+static gboolean
+gsk_cairo_node_equal (GskRenderNode *node1,
+                      GskRenderNode *node2)
+{
+  GskCairoNode *self1 = (GskCairoNode *) node1;
+  GskCairoNode *self2 = (GskCairoNode *) node2;
+
+  return self1->surface == self2->surface;
+}
+
 static const GskRenderNodeClass GSK_CAIRO_NODE_CLASS = {
   GSK_CAIRO_NODE,
   sizeof (GskCairoNode),
   "GskCairoNode",
   gsk_cairo_node_finalize,
   gsk_cairo_node_draw,
+  gsk_cairo_node_hash,
+  gsk_cairo_node_equal,
   gsk_cairo_node_serialize,
-  gsk_cairo_node_deserialize
+  gsk_cairo_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 const cairo_surface_t *
@@ -2077,14 +2279,99 @@ gsk_container_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_container_node_hash (GskRenderNode *node)
+{
+  GskContainerNode *self = (GskContainerNode *) node;
+  guint hash = GSK_HASH_INIT;
+  guint i;
+
+  for (i = 0; i < self->n_children; i++)
+    hash = hash * 31 + gsk_render_node_hash (self->children[i]);
+
+  return hash;
+}
+
+static gboolean
+gsk_container_node_equal (GskRenderNode *node1,
+                          GskRenderNode *node2)
+{
+  GskContainerNode *self1 = (GskContainerNode *) node1;
+  GskContainerNode *self2 = (GskContainerNode *) node2;
+  guint i;
+
+  if (self1->n_children != self2->n_children)
+    return FALSE;
+
+  for (i = 0; i < self1->n_children; i++)
+    {
+      if (!gsk_render_node_equal (self1->children[i], self2->children[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gsk_container_node_children_equal (GskRenderNode *child1,
+                                   GskRenderNode *child2)
+{
+  return gsk_render_node_hash (child1) == gsk_render_node_hash (child2) &&
+         gsk_render_node_equal (child1, child2);
+}
+
+static void
+gsk_container_node_diff (GskRenderNode  *node1,
+                         GskRenderNode  *node2,
+                         cairo_region_t *region)
+{
+  GskContainerNode *self1 = (GskContainerNode *) node1;
+  GskContainerNode *self2 = (GskContainerNode *) node2;
+  guint start, end1, end2, i;
+
+  /* Skip the children that are the same at both ends, so that adding
+   * or removing a child only damages the area of that child.
+   */
+  for (start = 0; start < self1->n_children && start < self2->n_children; start++)
+    {
+      if (!gsk_container_node_children_equal (self1->children[start], self2->children[start]))
+        break;
+    }
+
+  end1 = self1->n_children;
+  end2 = self2->n_children;
+  while (end1 > start && end2 > start &&
+         gsk_container_node_children_equal (self1->children[end1 - 1], self2->children[end2 - 1]))
+    {
+      end1--;
+      end2--;
+    }
+
+  if (end1 - start == end2 - start)
+    {
+      for (i = 0; i < end1 - start; i++)
+        gsk_render_node_diff (self1->children[start + i], self2->children[start + i], region);
+    }
+  else
+    {
+      for (i = start; i < end1; i++)
+        gsk_render_node_add_bounds_to_region (self1->children[i], region);
+      for (i = start; i < end2; i++)
+        gsk_render_node_add_bounds_to_region (self2->children[i], region);
+    }
+}
+
 static const GskRenderNodeClass GSK_CONTAINER_NODE_CLASS = {
   GSK_CONTAINER_NODE,
   sizeof (GskContainerNode),
   "GskContainerNode",
   gsk_container_node_finalize,
   gsk_container_node_draw,
+  gsk_container_node_hash,
+  gsk_container_node_equal,
   gsk_container_node_serialize,
-  gsk_container_node_deserialize
+  gsk_container_node_deserialize,
+  gsk_container_node_diff
 };
 
 /**
@@ -2266,14 +2553,84 @@ gsk_transform_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_transform_node_hash (GskRenderNode *node)
+{
+  GskTransformNode *self = (GskTransformNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+
+  hash = gsk_hash_value (hash, self->transform);
+
+  return hash;
+}
+
+static gboolean
+gsk_transform_node_equal (GskRenderNode *node1,
+                          GskRenderNode *node2)
+{
+  GskTransformNode *self1 = (GskTransformNode *) node1;
+  GskTransformNode *self2 = (GskTransformNode *) node2;
+
+  return memcmp (&self1->transform, &self2->transform, sizeof (self1->transform)) == 0 &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
+/* Only translations by whole pixels keep the damage pixel-aligned */
+static gboolean
+gsk_transform_node_get_offset (GskTransformNode *self,
+                               int              *dx,
+                               int              *dy)
+{
+  double xx, yx, xy, yy, x0, y0;
+
+  if (!graphene_matrix_to_2d (&self->transform, &xx, &yx, &xy, &yy, &x0, &y0))
+    return FALSE;
+
+  if (xx != 1.0 || yx != 0.0 || xy != 0.0 || yy != 1.0 ||
+      x0 != floor (x0) || y0 != floor (y0))
+    return FALSE;
+
+  *dx = x0;
+  *dy = y0;
+
+  return TRUE;
+}
+
+static void
+gsk_transform_node_diff (GskRenderNode  *node1,
+                         GskRenderNode  *node2,
+                         cairo_region_t *region)
+{
+  GskTransformNode *self1 = (GskTransformNode *) node1;
+  GskTransformNode *self2 = (GskTransformNode *) node2;
+  cairo_region_t *sub;
+  int dx, dy;
+
+  if (memcmp (&self1->transform, &self2->transform, sizeof (self1->transform)) != 0 ||
+      !gsk_transform_node_get_offset (self1, &dx, &dy))
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  sub = cairo_region_create ();
+  gsk_render_node_diff (self1->child, self2->child, sub);
+  cairo_region_translate (sub, dx, dy);
+  cairo_region_union (region, sub);
+  cairo_region_destroy (sub);
+}
+
 static const GskRenderNodeClass GSK_TRANSFORM_NODE_CLASS = {
   GSK_TRANSFORM_NODE,
   sizeof (GskTransformNode),
   "GskTransformNode",
   gsk_transform_node_finalize,
   gsk_transform_node_draw,
+  gsk_transform_node_hash,
+  gsk_transform_node_equal,
   gsk_transform_node_serialize,
-  gsk_transform_node_deserialize
+  gsk_transform_node_deserialize,
+  gsk_transform_node_diff
 };
 
 /**
@@ -2421,14 +2778,53 @@ gsk_opacity_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_opacity_node_hash (GskRenderNode *node)
+{
+  GskOpacityNode *self = (GskOpacityNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+
+  hash = gsk_hash_value (hash, self->opacity);
+
+  return hash;
+}
+
+static gboolean
+gsk_opacity_node_equal (GskRenderNode *node1,
+                        GskRenderNode *node2)
+{
+  GskOpacityNode *self1 = (GskOpacityNode *) node1;
+  GskOpacityNode *self2 = (GskOpacityNode *) node2;
+
+  return self1->opacity == self2->opacity &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
+static void
+gsk_opacity_node_diff (GskRenderNode  *node1,
+                       GskRenderNode  *node2,
+                       cairo_region_t *region)
+{
+  GskOpacityNode *self1 = (GskOpacityNode *) node1;
+  GskOpacityNode *self2 = (GskOpacityNode *) node2;
+
+  if (self1->opacity == self2->opacity)
+    gsk_render_node_diff (self1->child, self2->child, region);
+  else
+    gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_OPACITY_NODE_CLASS = {
   GSK_OPACITY_NODE,
   sizeof (GskOpacityNode),
   "GskOpacityNode",
   gsk_opacity_node_finalize,
   gsk_opacity_node_draw,
+  gsk_opacity_node_hash,
+  gsk_opacity_node_equal,
   gsk_opacity_node_serialize,
-  gsk_opacity_node_deserialize
+  gsk_opacity_node_deserialize,
+  gsk_opacity_node_diff
 };
 
 /**
@@ -2658,14 +3054,57 @@ gsk_color_matrix_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_color_matrix_node_hash (GskRenderNode *node)
+{
+  GskColorMatrixNode *self = (GskColorMatrixNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+
+  hash = gsk_hash_value (hash, self->color_matrix);
+  hash = gsk_hash_value (hash, self->color_offset);
+
+  return hash;
+}
+
+static gboolean
+gsk_color_matrix_node_equal (GskRenderNode *node1,
+                             GskRenderNode *node2)
+{
+  GskColorMatrixNode *self1 = (GskColorMatrixNode *) node1;
+  GskColorMatrixNode *self2 = (GskColorMatrixNode *) node2;
+
+  return memcmp (&self1->color_matrix, &self2->color_matrix, sizeof (self1->color_matrix)) == 0 &&
+         memcmp (&self1->color_offset, &self2->color_offset, sizeof (self1->color_offset)) == 0 &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
+static void
+gsk_color_matrix_node_diff (GskRenderNode  *node1,
+                            GskRenderNode  *node2,
+                            cairo_region_t *region)
+{
+  GskColorMatrixNode *self1 = (GskColorMatrixNode *) node1;
+  GskColorMatrixNode *self2 = (GskColorMatrixNode *) node2;
+
+  /* The matrix is applied to each pixel separately */
+  if (memcmp (&self1->color_matrix, &self2->color_matrix, sizeof (self1->color_matrix)) == 0 &&
+      memcmp (&self1->color_offset, &self2->color_offset, sizeof (self1->color_offset)) == 0)
+    gsk_render_node_diff (self1->child, self2->child, region);
+  else
+    gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_COLOR_MATRIX_NODE_CLASS = {
   GSK_COLOR_MATRIX_NODE,
   sizeof (GskColorMatrixNode),
   "GskColorMatrixNode",
   gsk_color_matrix_node_finalize,
   gsk_color_matrix_node_draw,
+  gsk_color_matrix_node_hash,
+  gsk_color_matrix_node_equal,
   gsk_color_matrix_node_serialize,
-  gsk_color_matrix_node_deserialize
+  gsk_color_matrix_node_deserialize,
+  gsk_color_matrix_node_diff
 };
 
 /**
@@ -2848,14 +3287,39 @@ gsk_repeat_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_repeat_node_hash (GskRenderNode *node)
+{
+  GskRepeatNode *self = (GskRepeatNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+
+  hash = gsk_hash_value (hash, self->child_bounds);
+
+  return hash;
+}
+
+static gboolean
+gsk_repeat_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  GskRepeatNode *self1 = (GskRepeatNode *) node1;
+  GskRepeatNode *self2 = (GskRepeatNode *) node2;
+
+  return memcmp (&self1->child_bounds, &self2->child_bounds, sizeof (self1->child_bounds)) == 0 &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static const GskRenderNodeClass GSK_REPEAT_NODE_CLASS = {
   GSK_REPEAT_NODE,
   sizeof (GskRepeatNode),
   "GskRepeatNode",
   gsk_repeat_node_finalize,
   gsk_repeat_node_draw,
+  gsk_repeat_node_hash,
+  gsk_repeat_node_equal,
   gsk_repeat_node_serialize,
-  gsk_repeat_node_deserialize
+  gsk_repeat_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -2995,14 +3459,63 @@ gsk_clip_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_clip_node_hash (GskRenderNode *node)
+{
+  GskClipNode *self = (GskClipNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+
+  hash = gsk_hash_value (hash, self->clip);
+
+  return hash;
+}
+
+static gboolean
+gsk_clip_node_equal (GskRenderNode *node1,
+                     GskRenderNode *node2)
+{
+  GskClipNode *self1 = (GskClipNode *) node1;
+  GskClipNode *self2 = (GskClipNode *) node2;
+
+  return memcmp (&self1->clip, &self2->clip, sizeof (self1->clip)) == 0 &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
+static void
+gsk_clip_node_diff (GskRenderNode  *node1,
+                    GskRenderNode  *node2,
+                    cairo_region_t *region)
+{
+  GskClipNode *self1 = (GskClipNode *) node1;
+  GskClipNode *self2 = (GskClipNode *) node2;
+  cairo_region_t *sub;
+  cairo_rectangle_int_t clip;
+
+  if (memcmp (&self1->clip, &self2->clip, sizeof (self1->clip)) != 0)
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  sub = cairo_region_create ();
+  gsk_render_node_diff (self1->child, self2->child, sub);
+  gsk_rect_to_cairo_rectangle_int (&self1->clip, &clip);
+  cairo_region_intersect_rectangle (sub, &clip);
+  cairo_region_union (region, sub);
+  cairo_region_destroy (sub);
+}
+
 static const GskRenderNodeClass GSK_CLIP_NODE_CLASS = {
   GSK_CLIP_NODE,
   sizeof (GskClipNode),
   "GskClipNode",
   gsk_clip_node_finalize,
   gsk_clip_node_draw,
+  gsk_clip_node_hash,
+  gsk_clip_node_equal,
   gsk_clip_node_serialize,
-  gsk_clip_node_deserialize
+  gsk_clip_node_deserialize,
+  gsk_clip_node_diff
 };
 
 /**
@@ -3158,14 +3671,63 @@ gsk_rounded_clip_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_rounded_clip_node_hash (GskRenderNode *node)
+{
+  GskRoundedClipNode *self = (GskRoundedClipNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+
+  hash = gsk_hash_value (hash, self->clip);
+
+  return hash;
+}
+
+static gboolean
+gsk_rounded_clip_node_equal (GskRenderNode *node1,
+                             GskRenderNode *node2)
+{
+  GskRoundedClipNode *self1 = (GskRoundedClipNode *) node1;
+  GskRoundedClipNode *self2 = (GskRoundedClipNode *) node2;
+
+  return memcmp (&self1->clip, &self2->clip, sizeof (self1->clip)) == 0 &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
+static void
+gsk_rounded_clip_node_diff (GskRenderNode  *node1,
+                            GskRenderNode  *node2,
+                            cairo_region_t *region)
+{
+  GskRoundedClipNode *self1 = (GskRoundedClipNode *) node1;
+  GskRoundedClipNode *self2 = (GskRoundedClipNode *) node2;
+  cairo_region_t *sub;
+  cairo_rectangle_int_t clip;
+
+  if (memcmp (&self1->clip, &self2->clip, sizeof (self1->clip)) != 0)
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  sub = cairo_region_create ();
+  gsk_render_node_diff (self1->child, self2->child, sub);
+  gsk_rect_to_cairo_rectangle_int (&self1->clip.bounds, &clip);
+  cairo_region_intersect_rectangle (sub, &clip);
+  cairo_region_union (region, sub);
+  cairo_region_destroy (sub);
+}
+
 static const GskRenderNodeClass GSK_ROUNDED_CLIP_NODE_CLASS = {
   GSK_ROUNDED_CLIP_NODE,
   sizeof (GskRoundedClipNode),
   "GskRoundedClipNode",
   gsk_rounded_clip_node_finalize,
   gsk_rounded_clip_node_draw,
+  gsk_rounded_clip_node_hash,
+  gsk_rounded_clip_node_equal,
   gsk_rounded_clip_node_serialize,
-  gsk_rounded_clip_node_deserialize
+  gsk_rounded_clip_node_deserialize,
+  gsk_rounded_clip_node_diff
 };
 
 /**
@@ -3383,14 +3945,62 @@ gsk_shadow_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_shadow_node_hash (GskRenderNode *node)
+{
+  GskShadowNode *self = (GskShadowNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+  gsize i;
+
+  /* GskShadow has padding, so hash the members one by one */
+  for (i = 0; i < self->n_shadows; i++)
+    {
+      hash = gsk_hash_value (hash, self->shadows[i].color);
+      hash = gsk_hash_value (hash, self->shadows[i].dx);
+      hash = gsk_hash_value (hash, self->shadows[i].dy);
+      hash = gsk_hash_value (hash, self->shadows[i].radius);
+    }
+
+  return hash;
+}
+
+static gboolean
+gsk_shadow_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  GskShadowNode *self1 = (GskShadowNode *) node1;
+  GskShadowNode *self2 = (GskShadowNode *) node2;
+  gsize i;
+
+  if (self1->n_shadows != self2->n_shadows)
+    return FALSE;
+
+  for (i = 0; i < self1->n_shadows; i++)
+    {
+      const GskShadow *shadow1 = &self1->shadows[i];
+      const GskShadow *shadow2 = &self2->shadows[i];
+
+      if (!gdk_rgba_equal (&shadow1->color, &shadow2->color) ||
+          shadow1->dx != shadow2->dx ||
+          shadow1->dy != shadow2->dy ||
+          shadow1->radius != shadow2->radius)
+        return FALSE;
+    }
+
+  return gsk_render_node_equal (self1->child, self2->child);
+}
+
 static const GskRenderNodeClass GSK_SHADOW_NODE_CLASS = {
   GSK_SHADOW_NODE,
   sizeof (GskShadowNode),
   "GskShadowNode",
   gsk_shadow_node_finalize,
   gsk_shadow_node_draw,
+  gsk_shadow_node_hash,
+  gsk_shadow_node_equal,
   gsk_shadow_node_serialize,
-  gsk_shadow_node_deserialize
+  gsk_shadow_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -3599,14 +4209,41 @@ gsk_blend_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_blend_node_hash (GskRenderNode *node)
+{
+  GskBlendNode *self = (GskBlendNode *) node;
+  guint hash = gsk_render_node_hash (self->bottom);
+
+  hash = hash * 31 + gsk_render_node_hash (self->top);
+  hash = gsk_hash_value (hash, self->blend_mode);
+
+  return hash;
+}
+
+static gboolean
+gsk_blend_node_equal (GskRenderNode *node1,
+                      GskRenderNode *node2)
+{
+  GskBlendNode *self1 = (GskBlendNode *) node1;
+  GskBlendNode *self2 = (GskBlendNode *) node2;
+
+  return self1->blend_mode == self2->blend_mode &&
+         gsk_render_node_equal (self1->bottom, self2->bottom) &&
+         gsk_render_node_equal (self1->top, self2->top);
+}
+
 static const GskRenderNodeClass GSK_BLEND_NODE_CLASS = {
   GSK_BLEND_NODE,
   sizeof (GskBlendNode),
   "GskBlendNode",
   gsk_blend_node_finalize,
   gsk_blend_node_draw,
+  gsk_blend_node_hash,
+  gsk_blend_node_equal,
   gsk_blend_node_serialize,
-  gsk_blend_node_deserialize
+  gsk_blend_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -3771,14 +4408,41 @@ gsk_cross_fade_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_cross_fade_node_hash (GskRenderNode *node)
+{
+  GskCrossFadeNode *self = (GskCrossFadeNode *) node;
+  guint hash = gsk_render_node_hash (self->start);
+
+  hash = hash * 31 + gsk_render_node_hash (self->end);
+  hash = gsk_hash_value (hash, self->progress);
+
+  return hash;
+}
+
+static gboolean
+gsk_cross_fade_node_equal (GskRenderNode *node1,
+                           GskRenderNode *node2)
+{
+  GskCrossFadeNode *self1 = (GskCrossFadeNode *) node1;
+  GskCrossFadeNode *self2 = (GskCrossFadeNode *) node2;
+
+  return self1->progress == self2->progress &&
+         gsk_render_node_equal (self1->start, self2->start) &&
+         gsk_render_node_equal (self1->end, self2->end);
+}
+
 static const GskRenderNodeClass GSK_CROSS_FADE_NODE_CLASS = {
   GSK_CROSS_FADE_NODE,
   sizeof (GskCrossFadeNode),
   "GskCrossFadeNode",
   gsk_cross_fade_node_finalize,
   gsk_cross_fade_node_draw,
+  gsk_cross_fade_node_hash,
+  gsk_cross_fade_node_equal,
   gsk_cross_fade_node_serialize,
-  gsk_cross_fade_node_deserialize
+  gsk_cross_fade_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -4029,14 +4693,69 @@ gsk_text_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_text_node_hash (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+  guint hash = GSK_HASH_INIT;
+  guint i;
+
+  hash = gsk_hash_value (hash, self->font);
+  hash = gsk_hash_value (hash, self->color);
+  hash = gsk_hash_value (hash, self->x);
+  hash = gsk_hash_value (hash, self->y);
+
+  /* Skip the attr bitfield, its unused bits are undefined */
+  for (i = 0; i < self->num_glyphs; i++)
+    {
+      hash = gsk_hash_value (hash, self->glyphs[i].glyph);
+      hash = gsk_hash_value (hash, self->glyphs[i].geometry);
+    }
+
+  return hash;
+}
+
+static gboolean
+gsk_text_node_equal (GskRenderNode *node1,
+                     GskRenderNode *node2)
+{
+  GskTextNode *self1 = (GskTextNode *) node1;
+  GskTextNode *self2 = (GskTextNode *) node2;
+  guint i;
+
+  if (self1->font != self2->font ||
+      !gdk_rgba_equal (&self1->color, &self2->color) ||
+      self1->x != self2->x ||
+      self1->y != self2->y ||
+      self1->num_glyphs != self2->num_glyphs)
+    return FALSE;
+
+  for (i = 0; i < self1->num_glyphs; i++)
+    {
+      const PangoGlyphInfo *glyph1 = &self1->glyphs[i];
+      const PangoGlyphInfo *glyph2 = &self2->glyphs[i];
+
+      if (glyph1->glyph != glyph2->glyph ||
+          glyph1->geometry.width != glyph2->geometry.width ||
+          glyph1->geometry.x_offset != glyph2->geometry.x_offset ||
+          glyph1->geometry.y_offset != glyph2->geometry.y_offset)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static const GskRenderNodeClass GSK_TEXT_NODE_CLASS = {
   GSK_TEXT_NODE,
   sizeof (GskTextNode),
   "GskTextNode",
   gsk_text_node_finalize,
   gsk_text_node_draw,
+  gsk_text_node_hash,
+  gsk_text_node_equal,
   gsk_text_node_serialize,
-  gsk_text_node_deserialize
+  gsk_text_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -4384,14 +5103,39 @@ gsk_blur_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static guint
+gsk_blur_node_hash (GskRenderNode *node)
+{
+  GskBlurNode *self = (GskBlurNode *) node;
+  guint hash = gsk_render_node_hash (self->child);
+
+  hash = gsk_hash_value (hash, self->radius);
+
+  return hash;
+}
+
+static gboolean
+gsk_blur_node_equal (GskRenderNode *node1,
+                     GskRenderNode *node2)
+{
+  GskBlurNode *self1 = (GskBlurNode *) node1;
+  GskBlurNode *self2 = (GskBlurNode *) node2;
+
+  return self1->radius == self2->radius &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static const GskRenderNodeClass GSK_BLUR_NODE_CLASS = {
   GSK_BLUR_NODE,
   sizeof (GskBlurNode),
   "GskBlurNode",
   gsk_blur_node_finalize,
   gsk_blur_node_draw,
+  gsk_blur_node_hash,
+  gsk_blur_node_equal,
   gsk_blur_node_serialize,
-  gsk_blur_node_deserialize
+  gsk_blur_node_deserialize,
+  gsk_render_node_diff_impossible
 };
 
 /**
@@ -7,6 +7,7 @@
 G_BEGIN_DECLS
 
 typedef struct _GskRenderNodeClass GskRenderNodeClass;
+typedef struct _GskRenderNodeArena GskRenderNodeArena;
 
 #define GSK_IS_RENDER_NODE_TYPE(node,type) (GSK_IS_RENDER_NODE (node) && (node)->node_class->node_type == (type))
 
@@ -24,6 +25,15 @@ struct _GskRenderNode
   GskScalingFilter mag_filter;
 
   graphene_rect_t bounds;
+
+  /* Cached result of gsk_render_node_hash(), 0 if not computed yet */
+  guint hash;
+
+  /* The size of the allocation, including the extra size */
+  guint alloc_size;
+
+  /* The arena the node was allocated from, or %NULL for a slice */
+  GskRenderNodeArena *arena;
 };
 
 struct _GskRenderNodeClass
@@ -35,19 +45,88 @@ struct _GskRenderNodeClass
   void            (* finalize)    (GskRenderNode  *node);
   void            (* draw)        (GskRenderNode  *node,
                                    cairo_t        *cr);
+  guint           (* hash)        (GskRenderNode  *node);
+  gboolean        (* equal)       (GskRenderNode  *node1,
+                                   GskRenderNode  *node2);
   GVariant *      (* serialize)   (GskRenderNode  *node);
   GskRenderNode * (* deserialize) (GVariant       *variant,
                                    GError        **error);
+  void            (* diff)        (GskRenderNode  *node1,
+                                   GskRenderNode  *node2,
+                                   cairo_region_t *region);
 };
 
+/* FNV-1a, used to combine the contents of nodes into their hash */
+static inline guint
+gsk_hash_data (guint          hash,
+               gconstpointer  data,
+               gsize          size)
+{
+  const guchar *p = data;
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    hash = (hash ^ p[i]) * 16777619u;
+
+  return hash;
+}
+
+#define GSK_HASH_INIT 2166136261u
+#define gsk_hash_value(hash, value) gsk_hash_data ((hash), &(value), sizeof (value))
+
+#define GSK_N_RENDER_NODE_TYPES (GSK_BLUR_NODE + 1)
+
+/* Time spent in gsk_render_node_draw() per node type, excluding the
+ * time spent drawing children, see gsk_render_node_draw_stats_attach().
+ * Times are in whole microseconds, so they are only meaningful when
+ * summed up over many nodes or frames.
+ */
+typedef struct {
+  gint64 self_time[GSK_N_RENDER_NODE_TYPES];
+  guint n_nodes[GSK_N_RENDER_NODE_TYPES];
+
+  /*< private >*/
+  gint64 children_time;
+} GskRenderNodeDrawStats;
+
 GskRenderNode * gsk_render_node_new              (const GskRenderNodeClass  *node_class,
                                                   gsize                      extra_size);
 
+GskRenderNodeArena * gsk_render_node_arena_begin (void);
+void            gsk_render_node_arena_end        (GskRenderNodeArena        *arena);
+void            gsk_render_node_get_arena_stats  (gsize                     *n_bytes_held,
+                                                  gsize                     *n_bytes_used,
+                                                  guint                     *n_pinned);
+
+void            gsk_render_node_draw_stats_attach (GskRenderNodeDrawStats   *stats,
+                                                   cairo_t                  *cr);
+
+guint           gsk_render_node_hash             (GskRenderNode             *node);
+gboolean        gsk_render_node_equal            (GskRenderNode             *node1,
+                                                  GskRenderNode             *node2);
+
+GDK_AVAILABLE_IN_ALL
+void            gsk_render_node_diff             (GskRenderNode             *node1,
+                                                  GskRenderNode             *node2,
+                                                  cairo_region_t            *region);
+void            gsk_render_node_diff_impossible  (GskRenderNode             *node1,
+                                                  GskRenderNode             *node2,
+                                                  cairo_region_t            *region);
+void            gsk_render_node_add_bounds_to_region (GskRenderNode         *node,
+                                                      cairo_region_t        *region);
+void            gsk_rect_to_cairo_rectangle_int  (const graphene_rect_t     *rect,
+                                                  cairo_rectangle_int_t     *int_rect);
+
 GVariant *      gsk_render_node_serialize_node   (GskRenderNode             *node);
 GskRenderNode * gsk_render_node_deserialize_node (GskRenderNodeType          type,
                                                   GVariant                  *variant,
                                                   GError                   **error);
 
+GBytes *        gsk_render_node_serialize_binary   (GskRenderNode          *node);
+gboolean        gsk_render_node_is_binary          (GBytes                 *bytes);
+GskRenderNode * gsk_render_node_deserialize_binary (GBytes                 *bytes,
+                                                    GError                **error);
+
 GskRenderNode * gsk_cairo_node_new_for_surface   (const graphene_rect_t    *bounds,
                                                   cairo_surface_t          *surface);
 
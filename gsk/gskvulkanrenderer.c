@@ -115,6 +115,13 @@ gsk_vulkan_renderer_realize (GskRenderer  *renderer,
 {
   GskVulkanRenderer *self = GSK_VULKAN_RENDERER (renderer);
 
+  if (window == NULL)
+    {
+      g_set_error_literal (error, GDK_VULKAN_ERROR, GDK_VULKAN_ERROR_NOT_AVAILABLE,
+                           "The Vulkan renderer needs a window");
+      return FALSE;
+    }
+
   self->vulkan = gdk_window_create_vulkan_context (window, error);
   if (self->vulkan == NULL)
     return FALSE;
@@ -0,0 +1,224 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkcssancestorfilterprivate.h"
+
+#include "gtkcssnodeprivate.h"
+#include "gtkcsspathnodeprivate.h"
+
+/* While validating styles, GtkCssNode pushes every node before
+ * validating its children and pops it afterwards, so the filter contains
+ * exactly the ancestors of the nodes whose style gets computed.
+ *
+ * Counters saturate instead of overflowing; a saturated counter is
+ * never decremented again, which only makes the filter less precise.
+ */
+
+typedef struct {
+  GtkCssNode *node;
+  guint n_hashes;
+  guint unfiltered : 1;
+} Entry;
+
+GtkCssAncestorFilter *
+gtk_css_ancestor_filter_get_default (void)
+{
+  static GtkCssAncestorFilter *filter = NULL;
+  static gboolean initialized = FALSE;
+
+  if (G_UNLIKELY (!initialized))
+    {
+      const char *env = g_getenv ("GTK_CSS_ANCESTOR_FILTER");
+
+      /* Allows comparing the performance with and without the filter */
+      if (env == NULL || !g_str_equal (env, "0"))
+        {
+          filter = g_new0 (GtkCssAncestorFilter, 1);
+          filter->hashes = g_array_new (FALSE, FALSE, sizeof (guint));
+          filter->entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+        }
+
+      initialized = TRUE;
+    }
+
+  return filter;
+}
+
+static void
+gtk_css_ancestor_filter_add (GtkCssAncestorFilter *filter,
+                             Entry                *entry,
+                             guint                 hash)
+{
+  guint8 *count;
+
+  count = &filter->counts[hash & (GTK_CSS_ANCESTOR_FILTER_SIZE - 1)];
+  if (*count < G_MAXUINT8)
+    (*count)++;
+  count = &filter->counts[(hash >> 16) & (GTK_CSS_ANCESTOR_FILTER_SIZE - 1)];
+  if (*count < G_MAXUINT8)
+    (*count)++;
+
+  g_array_append_val (filter->hashes, hash);
+  entry->n_hashes++;
+}
+
+static void
+gtk_css_ancestor_filter_remove (GtkCssAncestorFilter *filter,
+                                guint                 hash)
+{
+  guint8 *count;
+
+  count = &filter->counts[hash & (GTK_CSS_ANCESTOR_FILTER_SIZE - 1)];
+  if (*count < G_MAXUINT8)
+    (*count)--;
+  count = &filter->counts[(hash >> 16) & (GTK_CSS_ANCESTOR_FILTER_SIZE - 1)];
+  if (*count < G_MAXUINT8)
+    (*count)--;
+}
+
+/*< private >
+ * gtk_css_ancestor_filter_push:
+ * @filter: a #GtkCssAncestorFilter
+ * @node: the node to add
+ *
+ * Adds the name, id and style classes of @node to @filter. The node's
+ * children may then use the filter, see gtk_css_ancestor_filter_get_for_node().
+ */
+void
+gtk_css_ancestor_filter_push (GtkCssAncestorFilter *filter,
+                              GtkCssNode           *node)
+{
+  const GQuark *classes;
+  const char *name, *id;
+  guint i, n_classes;
+  Entry entry;
+
+  entry.node = node;
+  entry.n_hashes = 0;
+  /* Matching continues with the widget path above path nodes */
+  entry.unfiltered = GTK_IS_CSS_PATH_NODE (node);
+  if (entry.unfiltered)
+    filter->n_unfiltered++;
+
+  name = gtk_css_node_get_name (node);
+  if (name)
+    gtk_css_ancestor_filter_add (filter, &entry,
+                                 gtk_css_ancestor_filter_hash (GPOINTER_TO_SIZE (name),
+                                                               GTK_CSS_ANCESTOR_FILTER_SALT_NAME));
+
+  id = gtk_css_node_get_id (node);
+  if (id)
+    gtk_css_ancestor_filter_add (filter, &entry,
+                                 gtk_css_ancestor_filter_hash (GPOINTER_TO_SIZE (id),
+                                                               GTK_CSS_ANCESTOR_FILTER_SALT_ID));
+
+  classes = gtk_css_node_list_classes (node, &n_classes);
+  for (i = 0; i < n_classes; i++)
+    gtk_css_ancestor_filter_add (filter, &entry,
+                                 gtk_css_ancestor_filter_hash (classes[i],
+                                                               GTK_CSS_ANCESTOR_FILTER_SALT_CLASS));
+
+  g_array_append_val (filter->entries, entry);
+}
+
+/*< private >
+ * gtk_css_ancestor_filter_push_ancestors:
+ * @filter: a #GtkCssAncestorFilter
+ * @node: a node
+ *
+ * Pushes all ancestors of @node, starting with the root.
+ *
+ * Returns: the number of pushed nodes
+ */
+guint
+gtk_css_ancestor_filter_push_ancestors (GtkCssAncestorFilter *filter,
+                                        GtkCssNode           *node)
+{
+  GtkCssNode *parent;
+  guint n;
+
+  parent = gtk_css_node_get_parent (node);
+  if (parent == NULL)
+    return 0;
+
+  n = gtk_css_ancestor_filter_push_ancestors (filter, parent);
+  gtk_css_ancestor_filter_push (filter, parent);
+
+  return n + 1;
+}
+
+/*< private >
+ * gtk_css_ancestor_filter_pop:
+ * @filter: a #GtkCssAncestorFilter
+ * @n_nodes: the number of nodes to remove
+ *
+ * Removes the @n_nodes nodes that were pushed last.
+ */
+void
+gtk_css_ancestor_filter_pop (GtkCssAncestorFilter *filter,
+                             guint                 n_nodes)
+{
+  guint i;
+
+  g_return_if_fail (n_nodes <= filter->entries->len);
+
+  for (; n_nodes > 0; n_nodes--)
+    {
+      Entry *entry = &g_array_index (filter->entries, Entry, filter->entries->len - 1);
+      guint first = filter->hashes->len - entry->n_hashes;
+
+      for (i = first; i < filter->hashes->len; i++)
+        gtk_css_ancestor_filter_remove (filter, g_array_index (filter->hashes, guint, i));
+      g_array_set_size (filter->hashes, first);
+
+      if (entry->unfiltered)
+        filter->n_unfiltered--;
+
+      g_array_set_size (filter->entries, filter->entries->len - 1);
+    }
+}
+
+/*< private >
+ * gtk_css_ancestor_filter_get_for_node:
+ * @filter: (nullable): a #GtkCssAncestorFilter
+ * @node: a node
+ *
+ * Checks if @filter contains all ancestors of @node, which is the case
+ * while @node's parent is the last pushed node.
+ *
+ * Returns: (nullable): @filter if it can be used to match selectors
+ *     for @node, %NULL otherwise
+ */
+const GtkCssAncestorFilter *
+gtk_css_ancestor_filter_get_for_node (GtkCssAncestorFilter *filter,
+                                      GtkCssNode           *node)
+{
+  Entry *entry;
+
+  if (filter == NULL ||
+      filter->entries->len == 0 ||
+      filter->n_unfiltered > 0)
+    return NULL;
+
+  entry = &g_array_index (filter->entries, Entry, filter->entries->len - 1);
+  if (entry->node != gtk_css_node_get_parent (node))
+    return NULL;
+
+  return filter;
+}
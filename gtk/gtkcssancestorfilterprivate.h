@@ -0,0 +1,104 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_CSS_ANCESTOR_FILTER_PRIVATE_H__
+#define __GTK_CSS_ANCESTOR_FILTER_PRIVATE_H__
+
+#include "gtkcsstypesprivate.h"
+
+G_BEGIN_DECLS
+
+#define GTK_CSS_ANCESTOR_FILTER_BITS 12
+#define GTK_CSS_ANCESTOR_FILTER_SIZE (1 << GTK_CSS_ANCESTOR_FILTER_BITS)
+
+/* A counting Bloom filter of the names, ids and style classes of a
+ * stack of nodes. It may claim to contain things that it doesn't, but
+ * never the other way around, so it can tell when a descendant selector
+ * cannot match without looking at the ancestors.
+ */
+struct _GtkCssAncestorFilter
+{
+  guint8 counts[GTK_CSS_ANCESTOR_FILTER_SIZE];
+  GArray *hashes;       /* the hashes of all pushed nodes */
+  GArray *entries;      /* one entry for every pushed node */
+  guint n_unfiltered;   /* pushed nodes whose ancestors are not tracked */
+};
+
+GtkCssAncestorFilter *  gtk_css_ancestor_filter_get_default     (void);
+
+void                    gtk_css_ancestor_filter_push            (GtkCssAncestorFilter       *filter,
+                                                                 GtkCssNode                 *node);
+guint                   gtk_css_ancestor_filter_push_ancestors  (GtkCssAncestorFilter       *filter,
+                                                                 GtkCssNode                 *node);
+void                    gtk_css_ancestor_filter_pop             (GtkCssAncestorFilter       *filter,
+                                                                 guint                       n_nodes);
+
+const GtkCssAncestorFilter *
+                        gtk_css_ancestor_filter_get_for_node    (GtkCssAncestorFilter       *filter,
+                                                                 GtkCssNode                 *node);
+
+static inline guint
+gtk_css_ancestor_filter_hash (gsize key,
+                              guint salt)
+{
+  guint64 h = ((guint64) key + salt) * G_GUINT64_CONSTANT (0x9E3779B97F4A7C15);
+
+  return h >> 32;
+}
+
+#define GTK_CSS_ANCESTOR_FILTER_SALT_NAME  0
+#define GTK_CSS_ANCESTOR_FILTER_SALT_ID    0x2c9277b5
+#define GTK_CSS_ANCESTOR_FILTER_SALT_CLASS 0x5bd1e995
+
+static inline gboolean
+gtk_css_ancestor_filter_may_contain (const GtkCssAncestorFilter *filter,
+                                     guint                       hash)
+{
+  return filter->counts[hash & (GTK_CSS_ANCESTOR_FILTER_SIZE - 1)] != 0 &&
+         filter->counts[(hash >> 16) & (GTK_CSS_ANCESTOR_FILTER_SIZE - 1)] != 0;
+}
+
+static inline gboolean
+gtk_css_ancestor_filter_may_have_name (const GtkCssAncestorFilter *filter,
+                                       /*interned*/ const char     *name)
+{
+  return gtk_css_ancestor_filter_may_contain (filter,
+                                              gtk_css_ancestor_filter_hash (GPOINTER_TO_SIZE (name),
+                                                                            GTK_CSS_ANCESTOR_FILTER_SALT_NAME));
+}
+
+static inline gboolean
+gtk_css_ancestor_filter_may_have_id (const GtkCssAncestorFilter *filter,
+                                     /*interned*/ const char     *id)
+{
+  return gtk_css_ancestor_filter_may_contain (filter,
+                                              gtk_css_ancestor_filter_hash (GPOINTER_TO_SIZE (id),
+                                                                            GTK_CSS_ANCESTOR_FILTER_SALT_ID));
+}
+
+static inline gboolean
+gtk_css_ancestor_filter_may_have_class (const GtkCssAncestorFilter *filter,
+                                        GQuark                      class_name)
+{
+  return gtk_css_ancestor_filter_may_contain (filter,
+                                              gtk_css_ancestor_filter_hash (class_name,
+                                                                            GTK_CSS_ANCESTOR_FILTER_SALT_CLASS));
+}
+
+G_END_DECLS
+
+#endif /* __GTK_CSS_ANCESTOR_FILTER_PRIVATE_H__ */
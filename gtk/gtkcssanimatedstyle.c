@@ -489,3 +489,82 @@ gtk_css_animated_style_new_advance (GtkCssAnimatedStyle *source,
 
   return GTK_CSS_STYLE (result);
 }
+
+/*< private >
+ * gtk_css_animated_style_advance:
+ * @style: a #GtkCssAnimatedStyle that nobody else uses
+ * @timestamp: the new time
+ * @changes: (out) (transfer full): return location for the ids of
+ *   the properties that changed
+ *
+ * Advances the animations of @style to @timestamp and updates the
+ * animated values in place, without touching the other properties.
+ *
+ * This only works while all animations are still running, because
+ * finished ones need to be removed. Use
+ * gtk_css_animated_style_new_advance() if this fails.
+ *
+ * Returns: %TRUE if @style was advanced
+ */
+gboolean
+gtk_css_animated_style_advance (GtkCssAnimatedStyle  *style,
+                                gint64                timestamp,
+                                GtkBitmask          **changes)
+{
+  GPtrArray *old_values;
+  GSList *l;
+  guint i, n;
+
+  gtk_internal_return_val_if_fail (GTK_IS_CSS_ANIMATED_STYLE (style), FALSE);
+
+  if (timestamp <= style->current_time)
+    return FALSE;
+
+  for (l = style->animations; l; l = l->next)
+    {
+      if (_gtk_style_animation_is_finished (l->data))
+        return FALSE;
+    }
+
+  for (l = style->animations; l; l = l->next)
+    {
+      GtkStyleAnimation *animation = l->data;
+
+      l->data = _gtk_style_animation_advance (animation, timestamp);
+      g_object_unref (animation);
+    }
+
+  style->current_time = timestamp;
+
+  old_values = style->animated_values;
+  style->animated_values = NULL;
+
+  gtk_css_animated_style_apply_animations (style);
+
+  *changes = _gtk_bitmask_new ();
+  n = MAX (old_values ? old_values->len : 0,
+           style->animated_values ? style->animated_values->len : 0);
+
+  for (i = 0; i < n; i++)
+    {
+      GtkCssValue *old_value, *new_value;
+
+      old_value = old_values && i < old_values->len ? g_ptr_array_index (old_values, i) : NULL;
+      new_value = style->animated_values && i < style->animated_values->len ? g_ptr_array_index (style->animated_values, i) : NULL;
+      if (old_value == NULL && new_value == NULL)
+        continue;
+
+      if (old_value == NULL)
+        old_value = gtk_css_animated_style_get_intrinsic_value (style, i);
+      if (new_value == NULL)
+        new_value = gtk_css_animated_style_get_intrinsic_value (style, i);
+
+      if (!_gtk_css_value_equal (old_value, new_value))
+        *changes = _gtk_bitmask_set (*changes, i, TRUE);
+    }
+
+  if (old_values)
+    g_ptr_array_unref (old_values);
+
+  return TRUE;
+}
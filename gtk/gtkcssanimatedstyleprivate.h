@@ -60,6 +60,9 @@ GtkCssStyle *           gtk_css_animated_style_new              (GtkCssStyle
 GtkCssStyle *           gtk_css_animated_style_new_advance      (GtkCssAnimatedStyle    *source,
                                                                  GtkCssStyle            *base,
                                                                  gint64                  timestamp);
+gboolean                gtk_css_animated_style_advance          (GtkCssAnimatedStyle    *style,
+                                                                 gint64                  timestamp,
+                                                                 GtkBitmask            **changes);
 
 void                    gtk_css_animated_style_set_animated_value(GtkCssAnimatedStyle   *style,
                                                                  guint                   id,
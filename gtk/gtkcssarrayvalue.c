@@ -49,33 +49,26 @@ gtk_css_value_array_compute (GtkCssValue      *value,
                              GtkCssStyle      *style,
                              GtkCssStyle      *parent_style)
 {
-  GtkCssValue *result;
-  GtkCssValue *i_value;
-  guint i, j;
+  GtkCssValue **values;
+  gboolean changed;
+  guint i;
 
-  result = NULL;
+  /* Computed values get interned, so they are collected first */
+  values = g_newa (GtkCssValue *, value->n_values);
+  changed = FALSE;
   for (i = 0; i < value->n_values; i++)
     {
-      i_value =  _gtk_css_value_compute (value->values[i], property_id, provider, style, parent_style);
-
-      if (result == NULL &&
-	  i_value != value->values[i])
-	{
-	  result = _gtk_css_array_value_new_from_array (value->values, value->n_values);
-	  for (j = 0; j < i; j++)
-	    _gtk_css_value_ref (result->values[j]);
-	}
-
-      if (result != NULL)
-	result->values[i] = i_value;
-      else
-	_gtk_css_value_unref (i_value);
+      values[i] = _gtk_css_value_compute (value->values[i], property_id, provider, style, parent_style);
+      changed |= values[i] != value->values[i];
     }
 
-  if (result == NULL)
-    return _gtk_css_value_ref (value);
+  if (changed)
+    return _gtk_css_array_value_new_from_array (values, value->n_values);
 
-  return result;
+  for (i = 0; i < value->n_values; i++)
+    _gtk_css_value_unref (values[i]);
+
+  return _gtk_css_value_ref (value);
 }
 
 static gboolean
@@ -97,6 +90,18 @@ gtk_css_value_array_equal (const GtkCssValue *value1,
   return TRUE;
 }
 
+static guint
+gtk_css_value_array_hash (const GtkCssValue *value)
+{
+  guint i, hash;
+
+  hash = value->n_values;
+  for (i = 0; i < value->n_values; i++)
+    hash = hash * 31 + _gtk_css_value_hash (value->values[i]);
+
+  return hash;
+}
+
 static guint
 gcd (guint a, guint b)
 {
@@ -323,7 +328,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_ARRAY = {
   gtk_css_value_array_compute,
   gtk_css_value_array_equal,
   gtk_css_value_array_transition,
-  gtk_css_value_array_print
+  gtk_css_value_array_print,
+  gtk_css_value_array_hash
 };
 
 GtkCssValue *
@@ -347,7 +353,7 @@ _gtk_css_array_value_new_from_array (GtkCssValue **values,
   result->n_values = n_values;
   memcpy (&result->values[0], values, sizeof (GtkCssValue *) * n_values);
             
-  return result;
+  return _gtk_css_value_intern (result);
 }
 
 GtkCssValue *
@@ -88,6 +88,13 @@ gtk_css_value_bg_size_equal (const GtkCssValue *value1,
            _gtk_css_value_equal (value1->y, value2->y)));
 }
 
+static guint
+gtk_css_value_bg_size_hash (const GtkCssValue *value)
+{
+  return (value->cover << 1 | value->contain)
+         ^ (_gtk_css_value_hash (value->x) * 31 + _gtk_css_value_hash (value->y));
+}
+
 static GtkCssValue *
 gtk_css_value_bg_size_transition (GtkCssValue *start,
                                   GtkCssValue *end,
@@ -157,7 +164,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_BG_SIZE = {
   gtk_css_value_bg_size_compute,
   gtk_css_value_bg_size_equal,
   gtk_css_value_bg_size_transition,
-  gtk_css_value_bg_size_print
+  gtk_css_value_bg_size_print,
+  gtk_css_value_bg_size_hash
 };
 
 static GtkCssValue auto_singleton = { &GTK_CSS_VALUE_BG_SIZE, 1, FALSE, FALSE, NULL, NULL };
@@ -177,7 +185,7 @@ _gtk_css_bg_size_value_new (GtkCssValue *x,
   result->x = x;
   result->y = y;
 
-  return result;
+  return _gtk_css_value_intern (result);
 }
 
 GtkCssValue *
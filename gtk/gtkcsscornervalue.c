@@ -65,6 +65,12 @@ gtk_css_value_corner_equal (const GtkCssValue *corner1,
       && _gtk_css_value_equal (corner1->y, corner2->y);
 }
 
+static guint
+gtk_css_value_corner_hash (const GtkCssValue *corner)
+{
+  return _gtk_css_value_hash (corner->x) * 31 + _gtk_css_value_hash (corner->y);
+}
+
 static GtkCssValue *
 gtk_css_value_corner_transition (GtkCssValue *start,
                                  GtkCssValue *end,
@@ -103,7 +109,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_CORNER = {
   gtk_css_value_corner_compute,
   gtk_css_value_corner_equal,
   gtk_css_value_corner_transition,
-  gtk_css_value_corner_print
+  gtk_css_value_corner_print,
+  gtk_css_value_corner_hash
 };
 
 GtkCssValue *
@@ -116,7 +123,7 @@ _gtk_css_corner_value_new (GtkCssValue *x,
   result->x = x;
   result->y = y;
 
-  return result;
+  return _gtk_css_value_intern (result);
 }
 
 GtkCssValue *
@@ -167,6 +167,12 @@ gtk_css_value_dimension_equal (const GtkCssValue *number1,
          number1->value == number2->value;
 }
 
+static guint
+gtk_css_value_dimension_hash (const GtkCssValue *number)
+{
+  return number->unit ^ gtk_css_double_hash (number->value);
+}
+
 static void
 gtk_css_value_dimension_print (const GtkCssValue *number,
                             GString           *string)
@@ -276,7 +282,8 @@ static const GtkCssNumberValueClass GTK_CSS_VALUE_DIMENSION = {
     gtk_css_value_dimension_compute,
     gtk_css_value_dimension_equal,
     gtk_css_number_value_transition,
-    gtk_css_value_dimension_print
+    gtk_css_value_dimension_print,
+    gtk_css_value_dimension_hash
   },
   gtk_css_value_dimension_get,
   gtk_css_value_dimension_get_dimension,
@@ -320,6 +327,6 @@ gtk_css_dimension_value_new (double     value,
   result->unit = unit;
   result->value = value;
 
-  return result;
+  return _gtk_css_value_intern (result);
 }
 
@@ -158,6 +158,13 @@ gtk_css_matcher_widget_path_has_position (const GtkCssMatcher *matcher,
   return x / a >= 0;
 }
 
+static guint64
+gtk_css_matcher_widget_path_get_fingerprint (const GtkCssMatcher *matcher)
+{
+  /* Names and ids may come from the widget path instead of the declaration */
+  return GTK_CSS_FINGERPRINT_ALL;
+}
+
 static const GtkCssMatcherClass GTK_CSS_MATCHER_WIDGET_PATH = {
   gtk_css_matcher_widget_path_get_parent,
   gtk_css_matcher_widget_path_get_previous,
@@ -166,6 +173,7 @@ static const GtkCssMatcherClass GTK_CSS_MATCHER_WIDGET_PATH = {
   gtk_css_matcher_widget_path_has_class,
   gtk_css_matcher_widget_path_has_id,
   gtk_css_matcher_widget_path_has_position,
+  gtk_css_matcher_widget_path_get_fingerprint,
   FALSE
 };
 
@@ -308,6 +316,12 @@ gtk_css_matcher_node_has_position (const GtkCssMatcher *matcher,
                                          a, b);
 }
 
+static guint64
+gtk_css_matcher_node_get_fingerprint (const GtkCssMatcher *matcher)
+{
+  return gtk_css_node_declaration_get_fingerprint (gtk_css_node_get_declaration (matcher->node.node));
+}
+
 static const GtkCssMatcherClass GTK_CSS_MATCHER_NODE = {
   gtk_css_matcher_node_get_parent,
   gtk_css_matcher_node_get_previous,
@@ -316,6 +330,7 @@ static const GtkCssMatcherClass GTK_CSS_MATCHER_NODE = {
   gtk_css_matcher_node_has_class,
   gtk_css_matcher_node_has_id,
   gtk_css_matcher_node_has_position,
+  gtk_css_matcher_node_get_fingerprint,
   FALSE
 };
 
@@ -325,6 +340,33 @@ _gtk_css_matcher_node_init (GtkCssMatcher *matcher,
 {
   matcher->node.klass = &GTK_CSS_MATCHER_NODE;
   matcher->node.node = node;
+  matcher->node.filter = NULL;
+}
+
+/*< private >
+ * _gtk_css_matcher_set_ancestor_filter:
+ * @matcher: a node matcher
+ * @filter: (nullable): a filter containing all ancestors of the node
+ *
+ * Lets selector matching reject descendant selectors that cannot match
+ * without looking at the node's ancestors. Only node matchers use the
+ * filter, it is ignored for other matchers.
+ */
+void
+_gtk_css_matcher_set_ancestor_filter (GtkCssMatcher              *matcher,
+                                      const GtkCssAncestorFilter *filter)
+{
+  if (matcher->klass == &GTK_CSS_MATCHER_NODE)
+    matcher->node.filter = filter;
+}
+
+const GtkCssAncestorFilter *
+_gtk_css_matcher_get_ancestor_filter (const GtkCssMatcher *matcher)
+{
+  if (matcher->klass == &GTK_CSS_MATCHER_NODE)
+    return matcher->node.filter;
+
+  return NULL;
 }
 
 /* GTK_CSS_MATCHER_WIDGET_ANY */
@@ -388,6 +430,12 @@ gtk_css_matcher_any_has_position (const GtkCssMatcher *matcher,
   return TRUE;
 }
 
+static guint64
+gtk_css_matcher_any_get_fingerprint (const GtkCssMatcher *matcher)
+{
+  return GTK_CSS_FINGERPRINT_ALL;
+}
+
 static const GtkCssMatcherClass GTK_CSS_MATCHER_ANY = {
   gtk_css_matcher_any_get_parent,
   gtk_css_matcher_any_get_previous,
@@ -396,6 +444,7 @@ static const GtkCssMatcherClass GTK_CSS_MATCHER_ANY = {
   gtk_css_matcher_any_has_class,
   gtk_css_matcher_any_has_id,
   gtk_css_matcher_any_has_position,
+  gtk_css_matcher_any_get_fingerprint,
   TRUE
 };
 
@@ -481,6 +530,15 @@ gtk_css_matcher_superset_has_position (const GtkCssMatcher *matcher,
     return TRUE;
 }
 
+static guint64
+gtk_css_matcher_superset_get_fingerprint (const GtkCssMatcher *matcher)
+{
+  if ((matcher->superset.relevant & (GTK_CSS_CHANGE_CLASS | GTK_CSS_CHANGE_NAME)) == (GTK_CSS_CHANGE_CLASS | GTK_CSS_CHANGE_NAME))
+    return _gtk_css_matcher_get_fingerprint (matcher->superset.subset);
+  else
+    return GTK_CSS_FINGERPRINT_ALL;
+}
+
 static const GtkCssMatcherClass GTK_CSS_MATCHER_SUPERSET = {
   gtk_css_matcher_superset_get_parent,
   gtk_css_matcher_superset_get_previous,
@@ -489,6 +547,7 @@ static const GtkCssMatcherClass GTK_CSS_MATCHER_SUPERSET = {
   gtk_css_matcher_superset_has_class,
   gtk_css_matcher_superset_has_id,
   gtk_css_matcher_superset_has_position,
+  gtk_css_matcher_superset_get_fingerprint,
   FALSE
 };
 
@@ -46,6 +46,7 @@ struct _GtkCssMatcherClass {
                                                    gboolean               forward,
                                                    int                    a,
                                                    int                    b);
+  guint64         (* get_fingerprint)             (const GtkCssMatcher   *matcher);
   gboolean is_any;
 };
 
@@ -60,6 +61,7 @@ struct _GtkCssMatcherWidgetPath {
 struct _GtkCssMatcherNode {
   const GtkCssMatcherClass *klass;
   GtkCssNode               *node;
+  const GtkCssAncestorFilter *filter;
 };
 
 struct _GtkCssMatcherSuperset {
@@ -81,6 +83,10 @@ gboolean          _gtk_css_matcher_init           (GtkCssMatcher          *match
 void              _gtk_css_matcher_node_init      (GtkCssMatcher          *matcher,
                                                    GtkCssNode             *node);
 void              _gtk_css_matcher_any_init       (GtkCssMatcher          *matcher);
+void              _gtk_css_matcher_set_ancestor_filter (GtkCssMatcher     *matcher,
+                                                   const GtkCssAncestorFilter *filter);
+const GtkCssAncestorFilter *
+                  _gtk_css_matcher_get_ancestor_filter (const GtkCssMatcher *matcher);
 void              _gtk_css_matcher_superset_init  (GtkCssMatcher          *matcher,
                                                    const GtkCssMatcher    *subset,
                                                    GtkCssChange            relevant);
@@ -136,6 +142,14 @@ _gtk_css_matcher_has_position (const GtkCssMatcher *matcher,
   return matcher->klass->has_position (matcher, forward, a, b);
 }
 
+/* Returns the fingerprint of the matched node's name, id and classes,
+ * or GTK_CSS_FINGERPRINT_ALL if anything may match */
+static inline guint64
+_gtk_css_matcher_get_fingerprint (const GtkCssMatcher *matcher)
+{
+  return matcher->klass->get_fingerprint (matcher);
+}
+
 static inline gboolean
 _gtk_css_matcher_matches_any (const GtkCssMatcher *matcher)
 {
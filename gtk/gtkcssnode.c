@@ -19,8 +19,12 @@
 
 #include "gtkcssnodeprivate.h"
 
+#include "gtkcssancestorfilterprivate.h"
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcsslookupprivate.h"
+#include "gtkcssprofilerprivate.h"
 #include "gtkcsssectionprivate.h"
+#include "gtkcssstylebatchprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkintl.h"
 #include "gtkmarshalers.h"
@@ -87,6 +91,10 @@
  * if we need to change things. */
 #define GTK_CSS_RADICAL_CHANGE (GTK_CSS_CHANGE_ID | GTK_CSS_CHANGE_NAME | GTK_CSS_CHANGE_CLASS | GTK_CSS_CHANGE_SOURCE | GTK_CSS_CHANGE_PARENT_STYLE)
 
+/* Validating this many nodes with radical changes looks up their
+ * styles in parallel first, see gtkcssstylebatch.c */
+#define GTK_CSS_STYLE_BATCH_MIN_SIZE 256
+
 G_DEFINE_TYPE (GtkCssNode, gtk_css_node, G_TYPE_OBJECT)
 
 enum {
@@ -254,7 +262,7 @@ gtk_css_node_finalize (GObject *object)
   G_OBJECT_CLASS (gtk_css_node_parent_class)->finalize (object);
 }
 
-static gboolean
+gboolean
 gtk_css_node_is_first_child (GtkCssNode *node)
 {
   GtkCssNode *iter;
@@ -269,7 +277,7 @@ gtk_css_node_is_first_child (GtkCssNode *node)
   return TRUE;
 }
 
-static gboolean
+gboolean
 gtk_css_node_is_last_child (GtkCssNode *node)
 {
   GtkCssNode *iter;
@@ -352,10 +360,22 @@ store_in_global_parent_cache (GtkCssNode                  *node,
                                                  style);
 }
 
+/* The batch of the validation that is running, if any. It is dropped
+ * as soon as the tree changes in a way that can change its lookups.
+ */
+static GtkCssStyleBatch *style_batch = NULL;
+
+static void
+gtk_css_node_discard_style_batch (void)
+{
+  g_clear_pointer (&style_batch, gtk_css_style_batch_free);
+}
+
 static GtkCssStyle *
 gtk_css_node_create_style (GtkCssNode *cssnode)
 {
   const GtkCssNodeDeclaration *decl;
+  GtkStyleProvider *provider;
   GtkCssMatcher matcher;
   GtkCssStyle *parent;
   GtkCssStyle *style;
@@ -364,20 +384,67 @@ gtk_css_node_create_style (GtkCssNode *cssnode)
 
   style = lookup_in_global_parent_cache (cssnode, decl);
   if (style)
-    return g_object_ref (style);
+    {
+      gtk_css_profiler_set_result (GTK_CSS_PROFILER_PARENT_CACHE);
+      return g_object_ref (style);
+    }
 
+  provider = gtk_css_node_get_style_provider (cssnode);
   parent = cssnode->parent ? cssnode->parent->style : NULL;
 
-  if (gtk_css_node_init_matcher (cssnode, &matcher))
-    style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
-                                              &matcher,
-                                              parent);
-  else
-    style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
-                                              NULL,
-                                              parent);
+  style = gtk_css_node_style_cache_lookup_shared (provider,
+                                                  cssnode->parent,
+                                                  parent,
+                                                  decl,
+                                                  gtk_css_node_is_first_child (cssnode),
+                                                  gtk_css_node_is_last_child (cssnode));
+  if (style)
+    {
+      gtk_css_profiler_set_result (GTK_CSS_PROFILER_SHARED_CACHE);
+      store_in_global_parent_cache (cssnode, decl, style);
+      return g_object_ref (style);
+    }
+
+  gtk_css_profiler_set_result (GTK_CSS_PROFILER_COMPUTED);
+
+  if (style_batch)
+    {
+      GtkCssLookup *lookup;
+      GtkCssChange change;
+
+      lookup = gtk_css_style_batch_steal_lookup (style_batch, cssnode, provider, &change);
+      if (lookup)
+        {
+          style = gtk_css_static_style_new_from_lookup (provider, lookup, change, parent);
+          _gtk_css_lookup_free (lookup);
+        }
+    }
+
+  if (style == NULL)
+    {
+      if (gtk_css_node_init_matcher (cssnode, &matcher))
+        {
+          _gtk_css_matcher_set_ancestor_filter (&matcher,
+                                                gtk_css_ancestor_filter_get_for_node (gtk_css_ancestor_filter_get_default (),
+                                                                                      cssnode));
+          style = gtk_css_static_style_new_compute (provider,
+                                                    &matcher,
+                                                    parent);
+        }
+      else
+        style = gtk_css_static_style_new_compute (provider,
+                                                  NULL,
+                                                  parent);
+    }
 
   store_in_global_parent_cache (cssnode, decl, style);
+  gtk_css_node_style_cache_insert_shared (provider,
+                                          cssnode->parent,
+                                          parent,
+                                          decl,
+                                          gtk_css_node_is_first_child (cssnode),
+                                          gtk_css_node_is_last_child (cssnode),
+                                          style);
 
   return style;
 }
@@ -423,7 +490,17 @@ gtk_css_node_real_update_style (GtkCssNode   *cssnode,
     }
 
   if (gtk_css_style_needs_recreation (static_style, change))
-    new_static_style = gtk_css_node_create_style (cssnode);
+    {
+      new_static_style = gtk_css_node_create_style (cssnode);
+
+      /* Keep the old style if nothing changed, so we don't create
+       * a new animated style and notify about changes for nothing.
+       */
+      if (new_static_style != static_style &&
+          gtk_css_static_style_equal (GTK_CSS_STATIC_STYLE (new_static_style),
+                                      GTK_CSS_STATIC_STYLE (static_style)))
+        g_set_object (&new_static_style, static_style);
+    }
   else
     new_static_style = g_object_ref (static_style);
 
@@ -743,6 +820,8 @@ gtk_css_node_reposition (GtkCssNode *node,
 
   g_assert (! (new_parent == NULL && previous != NULL));
 
+  gtk_css_node_discard_style_batch ();
+
   old_parent = node->parent;
   /* Take a reference here so the whole function has a reference */
   g_object_ref (node);
@@ -978,6 +1057,81 @@ gtk_css_node_propagate_pending_changes (GtkCssNode *cssnode,
   cssnode->needs_propagation = FALSE;
 }
 
+static gboolean
+gtk_css_node_uses_explicit_inherit (GtkCssNode *cssnode)
+{
+  GtkCssStyle *style = cssnode->style;
+
+  if (GTK_IS_CSS_ANIMATED_STYLE (style))
+    style = GTK_CSS_ANIMATED_STYLE (style)->style;
+
+  return gtk_css_static_style_uses_explicit_inherit (GTK_CSS_STATIC_STYLE (style));
+}
+
+/* When only time passed, only the animated values can change. Update
+ * them in the existing style instead of creating a new one, and only
+ * restyle the children if they can see the change.
+ */
+static gboolean
+gtk_css_node_advance_animations (GtkCssNode *cssnode,
+                                 gint64      timestamp,
+                                 gboolean   *parent_style_changed)
+{
+  GtkCssStyleChange change;
+  GtkBitmask *changes;
+  gboolean inherited_changed;
+  GtkCssNode *child;
+  guint i;
+
+  if (cssnode->pending_changes != GTK_CSS_CHANGE_TIMESTAMP ||
+      !GTK_IS_CSS_ANIMATED_STYLE (cssnode->style))
+    return FALSE;
+
+  /* Nobody else may see the style change under their feet */
+  if (G_OBJECT (cssnode->style)->ref_count > 1)
+    return FALSE;
+
+  if (!gtk_css_animated_style_advance (GTK_CSS_ANIMATED_STYLE (cssnode->style), timestamp, &changes))
+    return FALSE;
+
+  if (!gtk_css_style_is_static (cssnode->style))
+    gtk_css_node_set_invalid (cssnode, TRUE);
+
+  gtk_css_style_change_init_for_changes (&change, cssnode->style, changes);
+  if (gtk_css_style_change_has_change (&change))
+    g_signal_emit (cssnode, cssnode_signals[STYLE_CHANGED], 0, &change);
+  gtk_css_style_change_finish (&change);
+
+  inherited_changed = FALSE;
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (_gtk_bitmask_get (changes, i) &&
+          _gtk_css_style_property_is_inherit (_gtk_css_style_property_lookup_by_id (i)))
+        {
+          inherited_changed = TRUE;
+          break;
+        }
+    }
+
+  /* Children that don't inherit anything that changed keep their style */
+  if (!inherited_changed && !_gtk_bitmask_is_empty (changes))
+    {
+      for (child = gtk_css_node_get_first_child (cssnode);
+           child;
+           child = gtk_css_node_get_next_sibling (child))
+        {
+          if (gtk_css_node_uses_explicit_inherit (child))
+            gtk_css_node_invalidate (child, GTK_CSS_CHANGE_PARENT_STYLE);
+        }
+    }
+
+  _gtk_bitmask_free (changes);
+
+  *parent_style_changed = inherited_changed;
+
+  return TRUE;
+}
+
 static gboolean
 gtk_css_node_needs_new_style (GtkCssNode *cssnode)
 {
@@ -999,19 +1153,27 @@ gtk_css_node_ensure_style (GtkCssNode *cssnode,
   if (cssnode->style_is_invalid)
     {
       GtkCssStyle *new_style;
+      gint64 start_time;
 
       if (cssnode->previous_sibling)
         gtk_css_node_ensure_style (cssnode->previous_sibling, current_time);
 
       g_clear_pointer (&cssnode->cache, gtk_css_node_style_cache_unref);
 
-      new_style = GTK_CSS_NODE_GET_CLASS (cssnode)->update_style (cssnode,
-                                                                  cssnode->pending_changes,
-                                                                  current_time,
-                                                                  cssnode->style);
+      start_time = gtk_css_profiler_get_time ();
+
+      if (!gtk_css_node_advance_animations (cssnode, current_time, &style_changed))
+        {
+          new_style = GTK_CSS_NODE_GET_CLASS (cssnode)->update_style (cssnode,
+                                                                      cssnode->pending_changes,
+                                                                      current_time,
+                                                                      cssnode->style);
 
-      style_changed = gtk_css_node_set_style (cssnode, new_style);
-      g_object_unref (new_style);
+          style_changed = gtk_css_node_set_style (cssnode, new_style);
+          g_object_unref (new_style);
+        }
+
+      gtk_css_profiler_add_restyle (cssnode, cssnode->pending_changes, start_time);
     }
   else
     {
@@ -1321,6 +1483,12 @@ gtk_css_node_invalidate (GtkCssNode   *cssnode,
   if (change == 0)
     return;
 
+  gtk_css_profiler_add_invalidation (cssnode, change);
+
+  /* Changes to a node itself also change how others match */
+  if (change & (GTK_CSS_CHANGE_ANY_SELF | GTK_CSS_CHANGE_SOURCE))
+    gtk_css_node_discard_style_batch ();
+
   cssnode->pending_changes |= change;
 
   GTK_CSS_NODE_GET_CLASS (cssnode)->invalidate (cssnode);
@@ -1331,8 +1499,9 @@ gtk_css_node_invalidate (GtkCssNode   *cssnode,
 }
 
 static void
-gtk_css_node_validate_internal (GtkCssNode *cssnode,
-                                gint64      timestamp)
+gtk_css_node_validate_internal (GtkCssNode           *cssnode,
+                                GtkCssAncestorFilter *filter,
+                                gint64                timestamp)
 {
   GtkCssNode *child;
 
@@ -1348,23 +1517,95 @@ gtk_css_node_validate_internal (GtkCssNode *cssnode,
 
   GTK_CSS_NODE_GET_CLASS (cssnode)->validate (cssnode);
 
+  if (cssnode->first_child == NULL)
+    return;
+
+  if (filter)
+    gtk_css_ancestor_filter_push (filter, cssnode);
+
   for (child = gtk_css_node_get_first_child (cssnode);
        child;
        child = gtk_css_node_get_next_sibling (child))
     {
       if (child->visible)
-        gtk_css_node_validate_internal (child, timestamp);
+        gtk_css_node_validate_internal (child, filter, timestamp);
+    }
+
+  if (filter)
+    gtk_css_ancestor_filter_pop (filter, 1);
+}
+
+static void
+gtk_css_node_collect_style_batch (GtkCssNode       *cssnode,
+                                  GtkCssStyleBatch *batch)
+{
+  GtkCssNode *child;
+
+  if (!cssnode->invalid)
+    return;
+
+  if (cssnode->style_is_invalid &&
+      (cssnode->pending_changes & GTK_CSS_RADICAL_CHANGE))
+    gtk_css_style_batch_add (batch, cssnode, gtk_css_node_get_style_provider (cssnode));
+
+  for (child = gtk_css_node_get_first_child (cssnode);
+       child;
+       child = gtk_css_node_get_next_sibling (child))
+    {
+      if (child->visible)
+        gtk_css_node_collect_style_batch (child, batch);
     }
 }
 
 void
 gtk_css_node_validate (GtkCssNode *cssnode)
 {
+  GtkCssAncestorFilter *filter;
+  gboolean owns_batch = FALSE;
   gint64 timestamp;
+  guint n_ancestors;
 
   timestamp = gtk_css_node_get_timestamp (cssnode);
 
-  gtk_css_node_validate_internal (cssnode, timestamp);
+  gtk_css_profiler_begin_validate (timestamp);
+
+  /* Theme and scale changes restyle everything. Look up the styles
+   * of all nodes at once on multiple threads in that case.
+   */
+  if (style_batch == NULL && gtk_css_style_batch_is_enabled ())
+    {
+      GtkCssStyleBatch *batch = gtk_css_style_batch_new ();
+
+      gtk_css_node_collect_style_batch (cssnode, batch);
+
+      if (gtk_css_style_batch_get_size (batch) >= GTK_CSS_STYLE_BATCH_MIN_SIZE)
+        {
+          gint64 start_time = gtk_css_profiler_get_time ();
+
+          gtk_css_style_batch_run (batch);
+          gtk_css_profiler_add_phase_time (GTK_CSS_PROFILER_MATCH, start_time);
+          style_batch = batch;
+          owns_batch = TRUE;
+        }
+      else
+        gtk_css_style_batch_free (batch);
+    }
+
+  /* Keep the ancestors of the nodes being validated in the filter, so
+   * descendant selectors can be rejected without walking up the tree.
+   */
+  filter = gtk_css_ancestor_filter_get_default ();
+  n_ancestors = filter ? gtk_css_ancestor_filter_push_ancestors (filter, cssnode) : 0;
+
+  gtk_css_node_validate_internal (cssnode, filter, timestamp);
+
+  if (filter)
+    gtk_css_ancestor_filter_pop (filter, n_ancestors);
+
+  if (owns_batch)
+    gtk_css_node_discard_style_batch ();
+
+  gtk_css_profiler_end_validate ();
 }
 
 gboolean
@@ -28,6 +28,7 @@ struct _GtkCssNodeDeclaration {
   const /* interned */ char *name;
   const /* interned */ char *id;
   GtkStateFlags state;
+  guint64 fingerprint;
   guint n_classes;
   /* GQuark classes[n_classes]; */
 };
@@ -51,6 +52,23 @@ sizeof_this_node (GtkCssNodeDeclaration *decl)
   return sizeof_node (decl->n_classes);
 }
 
+static void
+gtk_css_node_declaration_update_fingerprint (GtkCssNodeDeclaration *decl)
+{
+  GQuark *classes = get_classes (decl);
+  guint64 fingerprint = 0;
+  guint i;
+
+  if (decl->name)
+    fingerprint |= gtk_css_fingerprint_for_name (decl->name);
+  if (decl->id)
+    fingerprint |= gtk_css_fingerprint_for_id (decl->id);
+  for (i = 0; i < decl->n_classes; i++)
+    fingerprint |= gtk_css_fingerprint_for_class (classes[i]);
+
+  decl->fingerprint = fingerprint;
+}
+
 static void
 gtk_css_node_declaration_make_writable (GtkCssNodeDeclaration **decl)
 {
@@ -103,6 +121,7 @@ gtk_css_node_declaration_new (void)
     NULL,
     NULL,
     0,
+    0,
     0
   };
 
@@ -155,6 +174,7 @@ gtk_css_node_declaration_set_name (GtkCssNodeDeclaration   **decl,
 
   gtk_css_node_declaration_make_writable (decl);
   (*decl)->name = name;
+  gtk_css_node_declaration_update_fingerprint (*decl);
 
   return TRUE;
 }
@@ -176,6 +196,7 @@ gtk_css_node_declaration_set_id (GtkCssNodeDeclaration **decl,
 
   gtk_css_node_declaration_make_writable (decl);
   (*decl)->id = id;
+  gtk_css_node_declaration_update_fingerprint (*decl);
 
   return TRUE;
 }
@@ -267,6 +288,7 @@ gtk_css_node_declaration_add_class (GtkCssNodeDeclaration **decl,
                                                  0);
   (*decl)->n_classes++;
   get_classes(*decl)[pos] = class_quark;
+  (*decl)->fingerprint |= gtk_css_fingerprint_for_class (class_quark);
 
   return TRUE;
 }
@@ -285,6 +307,7 @@ gtk_css_node_declaration_remove_class (GtkCssNodeDeclaration **decl,
                                                  0,
                                                  sizeof (GQuark));
   (*decl)->n_classes--;
+  gtk_css_node_declaration_update_fingerprint (*decl);
 
   return TRUE;
 }
@@ -300,6 +323,7 @@ gtk_css_node_declaration_clear_classes (GtkCssNodeDeclaration **decl)
                                                  0,
                                                  sizeof (GQuark) * (*decl)->n_classes);
   (*decl)->n_classes = 0;
+  gtk_css_node_declaration_update_fingerprint (*decl);
 
   return TRUE;
 }
@@ -342,6 +366,21 @@ gtk_css_node_declaration_get_classes (const GtkCssNodeDeclaration *decl,
   return get_classes (decl);
 }
 
+/*< private >
+ * gtk_css_node_declaration_get_fingerprint:
+ * @decl: a declaration
+ *
+ * Gets the bits for the name, id and style classes of @decl, see
+ * gtk_css_fingerprint_bit().
+ *
+ * Returns: the fingerprint of @decl
+ */
+guint64
+gtk_css_node_declaration_get_fingerprint (const GtkCssNodeDeclaration *decl)
+{
+  return decl->fingerprint;
+}
+
 guint
 gtk_css_node_declaration_hash (gconstpointer elem)
 {
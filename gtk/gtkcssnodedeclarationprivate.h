@@ -24,6 +24,44 @@
 
 G_BEGIN_DECLS
 
+/* The fingerprint of a declaration is a 64 bit Bloom filter of its name,
+ * id and style classes. If a bit required by a selector is missing from
+ * it, the selector cannot match, so most selectors can be rejected with
+ * a single AND.
+ */
+#define GTK_CSS_FINGERPRINT_ALL G_GUINT64_CONSTANT (0xFFFFFFFFFFFFFFFF)
+
+#define GTK_CSS_FINGERPRINT_SALT_NAME  0
+#define GTK_CSS_FINGERPRINT_SALT_ID    0x2c9277b5
+#define GTK_CSS_FINGERPRINT_SALT_CLASS 0x5bd1e995
+
+static inline guint64
+gtk_css_fingerprint_bit (gsize key,
+                         guint salt)
+{
+  guint64 h = ((guint64) key + salt) * G_GUINT64_CONSTANT (0x9E3779B97F4A7C15);
+
+  return G_GUINT64_CONSTANT (1) << (h >> 58);
+}
+
+static inline guint64
+gtk_css_fingerprint_for_name (/*interned*/ const char *name)
+{
+  return gtk_css_fingerprint_bit (GPOINTER_TO_SIZE (name), GTK_CSS_FINGERPRINT_SALT_NAME);
+}
+
+static inline guint64
+gtk_css_fingerprint_for_id (/*interned*/ const char *id)
+{
+  return gtk_css_fingerprint_bit (GPOINTER_TO_SIZE (id), GTK_CSS_FINGERPRINT_SALT_ID);
+}
+
+static inline guint64
+gtk_css_fingerprint_for_class (GQuark class_quark)
+{
+  return gtk_css_fingerprint_bit (class_quark, GTK_CSS_FINGERPRINT_SALT_CLASS);
+}
+
 GtkCssNodeDeclaration * gtk_css_node_declaration_new                    (void);
 GtkCssNodeDeclaration * gtk_css_node_declaration_ref                    (GtkCssNodeDeclaration         *decl);
 void                    gtk_css_node_declaration_unref                  (GtkCssNodeDeclaration         *decl);
@@ -50,6 +88,7 @@ gboolean                gtk_css_node_declaration_has_class              (const G
                                                                          GQuark                         class_quark);
 const GQuark *          gtk_css_node_declaration_get_classes            (const GtkCssNodeDeclaration   *decl,
                                                                          guint                         *n_classes);
+guint64                 gtk_css_node_declaration_get_fingerprint        (const GtkCssNodeDeclaration   *decl);
 
 guint                   gtk_css_node_declaration_hash                   (gconstpointer                  elem);
 gboolean                gtk_css_node_declaration_equal                  (gconstpointer                  elem1,
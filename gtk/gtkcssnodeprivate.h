@@ -112,6 +112,8 @@ GtkCssNode *            gtk_css_node_get_first_child    (GtkCssNode            *
 GtkCssNode *            gtk_css_node_get_last_child     (GtkCssNode            *cssnode);
 GtkCssNode *            gtk_css_node_get_previous_sibling(GtkCssNode           *cssnode);
 GtkCssNode *            gtk_css_node_get_next_sibling   (GtkCssNode            *cssnode);
+gboolean                gtk_css_node_is_first_child     (GtkCssNode            *node);
+gboolean                gtk_css_node_is_last_child      (GtkCssNode            *node);
 
 void                    gtk_css_node_set_visible        (GtkCssNode            *cssnode,
                                                          gboolean               visible);
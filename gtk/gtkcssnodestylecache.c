@@ -20,6 +20,7 @@
 #include "gtkcssnodestylecacheprivate.h"
 
 #include "gtkdebug.h"
+#include "gtkcssnodeprivate.h"
 #include "gtkcssstaticstyleprivate.h"
 
 struct _GtkCssNodeStyleCache {
@@ -180,3 +181,358 @@ gtk_css_node_style_cache_lookup (GtkCssNodeStyleCache        *parent,
   return gtk_css_node_style_cache_ref (result);
 }
 
+
+/* The shared cache
+ *
+ * The caches above only help siblings. The shared cache is used by all
+ * nodes in the process, so identical nodes in different containers or
+ * windows can share styles, too. Styles are looked up by the node and
+ * its parent's style. Styles that depend on the ancestors of the node,
+ * like the ones matched by "box label", are stored separately and also
+ * keyed by the declarations and positions of all ancestors.
+ */
+
+#define SHARED_CACHE_MAX_ENTRIES 1024
+
+/* Changes that the ancestors can't be keyed by */
+#define GTK_CSS_CHANGE_PARENT_SIBLING (GTK_CSS_CHANGE_PARENT_SIBLING_CLASS | GTK_CSS_CHANGE_PARENT_SIBLING_NAME | \
+                                       GTK_CSS_CHANGE_PARENT_SIBLING_ID | GTK_CSS_CHANGE_PARENT_SIBLING_POSITION | \
+                                       GTK_CSS_CHANGE_PARENT_SIBLING_STATE)
+#define GTK_CSS_CHANGE_UNSHAREABLE (GTK_CSS_CHANGE_PARENT_SIBLING | \
+                                    GTK_CSS_CHANGE_PARENT_NTH_CHILD | GTK_CSS_CHANGE_PARENT_NTH_LAST_CHILD)
+
+typedef struct {
+  GtkCssNodeDeclaration *decl;
+  guint                  is_first : 1;
+  guint                  is_last : 1;
+} SharedAncestor;
+
+typedef struct {
+  GtkStyleProvider      *provider;
+  GtkCssStyle           *parent;
+  GtkCssNodeDeclaration *decl;
+  guint                  is_first : 1;
+  guint                  is_last : 1;
+  guint                  hash;
+  /* Only for styles depending on the ancestors, parent first. Keys
+   * used for lookups set ancestor_node instead.
+   */
+  SharedAncestor        *ancestors;
+  guint                  n_ancestors;
+  GtkCssNode            *ancestor_node;
+  GtkCssStyle           *style;
+  GHashTable            *table;
+  GList                  link;   /* in shared_lru */
+} SharedEntry;
+
+static GHashTable *shared_entries;
+static GHashTable *shared_ancestor_entries;
+static GQueue shared_lru = G_QUEUE_INIT;
+static guint64 shared_hits;
+static guint64 shared_misses;
+
+static guint
+shared_entry_hash_node (GtkStyleProvider            *provider,
+                        GtkCssStyle                 *parent,
+                        const GtkCssNodeDeclaration *decl,
+                        gboolean                     is_first,
+                        gboolean                     is_last)
+{
+  return gtk_css_node_declaration_hash (decl) ^
+         GPOINTER_TO_UINT (parent) ^
+         GPOINTER_TO_UINT (provider) ^
+         (is_first << 1 | is_last);
+}
+
+static guint
+shared_entry_hash_ancestors (GtkCssNode *node)
+{
+  guint hash = 0;
+
+  for (; node; node = gtk_css_node_get_parent (node))
+    hash = hash * 31 +
+           (gtk_css_node_declaration_hash (gtk_css_node_get_declaration (node)) ^
+            (gtk_css_node_is_first_child (node) << 1 | gtk_css_node_is_last_child (node)));
+
+  return hash;
+}
+
+static guint
+shared_entry_hash (gconstpointer data)
+{
+  const SharedEntry *entry = data;
+
+  return entry->hash;
+}
+
+static gboolean
+shared_entry_ancestors_equal (const SharedEntry *entry,
+                              const SharedEntry *key)
+{
+  GtkCssNode *node;
+  guint i;
+
+  if (key->ancestor_node == NULL)
+    {
+      if (entry->n_ancestors != key->n_ancestors)
+        return FALSE;
+
+      for (i = 0; i < entry->n_ancestors; i++)
+        {
+          if (entry->ancestors[i].is_first != key->ancestors[i].is_first ||
+              entry->ancestors[i].is_last != key->ancestors[i].is_last ||
+              !gtk_css_node_declaration_equal (entry->ancestors[i].decl, key->ancestors[i].decl))
+            return FALSE;
+        }
+
+      return TRUE;
+    }
+
+  node = key->ancestor_node;
+  for (i = 0; i < entry->n_ancestors; i++)
+    {
+      if (node == NULL ||
+          entry->ancestors[i].is_first != gtk_css_node_is_first_child (node) ||
+          entry->ancestors[i].is_last != gtk_css_node_is_last_child (node) ||
+          !gtk_css_node_declaration_equal (entry->ancestors[i].decl, gtk_css_node_get_declaration (node)))
+        return FALSE;
+
+      node = gtk_css_node_get_parent (node);
+    }
+
+  return node == NULL;
+}
+
+static gboolean
+shared_entry_equal (gconstpointer data1,
+                    gconstpointer data2)
+{
+  const SharedEntry *entry1 = data1;
+  const SharedEntry *entry2 = data2;
+
+  if (entry1->hash != entry2->hash ||
+      entry1->provider != entry2->provider ||
+      entry1->parent != entry2->parent ||
+      entry1->is_first != entry2->is_first ||
+      entry1->is_last != entry2->is_last ||
+      !gtk_css_node_declaration_equal (entry1->decl, entry2->decl))
+    return FALSE;
+
+  if (entry1->ancestor_node != NULL)
+    return shared_entry_ancestors_equal (entry2, entry1);
+  else
+    return shared_entry_ancestors_equal (entry1, entry2);
+}
+
+static void
+shared_entry_free (gpointer data)
+{
+  SharedEntry *entry = data;
+  guint i;
+
+  g_queue_unlink (&shared_lru, &entry->link);
+
+  g_object_unref (entry->provider);
+  g_clear_object (&entry->parent);
+  gtk_css_node_declaration_unref (entry->decl);
+  for (i = 0; i < entry->n_ancestors; i++)
+    gtk_css_node_declaration_unref (entry->ancestors[i].decl);
+  g_free (entry->ancestors);
+  g_object_unref (entry->style);
+
+  g_slice_free (SharedEntry, entry);
+}
+
+static GHashTable *
+shared_table_new (void)
+{
+  return g_hash_table_new_full (shared_entry_hash,
+                                shared_entry_equal,
+                                shared_entry_free,
+                                NULL);
+}
+
+/*< private >
+ * gtk_css_node_style_cache_lookup_shared:
+ * @provider: the style provider of the node
+ * @parent_node: (nullable): the node's parent
+ * @parent: (nullable): the style of the node's parent
+ * @decl: the node's declaration
+ * @is_first: if the node is the first child
+ * @is_last: if the node is the last child
+ *
+ * Looks for a style that was computed for another node with the same
+ * declaration, position and parent style, and the same ancestors if
+ * the style depends on them.
+ *
+ * Returns: (nullable) (transfer none): the style, or %NULL
+ */
+GtkCssStyle *
+gtk_css_node_style_cache_lookup_shared (GtkStyleProvider            *provider,
+                                        GtkCssNode                  *parent_node,
+                                        GtkCssStyle                 *parent,
+                                        const GtkCssNodeDeclaration *decl,
+                                        gboolean                     is_first,
+                                        gboolean                     is_last)
+{
+  SharedEntry key, *entry;
+
+  if (shared_entries == NULL ||
+      (parent && !GTK_IS_CSS_STATIC_STYLE (parent)))
+    {
+      shared_misses++;
+      return NULL;
+    }
+
+  key.provider = provider;
+  key.parent = parent;
+  key.decl = (GtkCssNodeDeclaration *) decl;
+  key.is_first = is_first;
+  key.is_last = is_last;
+  key.hash = shared_entry_hash_node (provider, parent, decl, is_first, is_last);
+  key.ancestors = NULL;
+  key.n_ancestors = 0;
+  key.ancestor_node = NULL;
+
+  entry = g_hash_table_lookup (shared_entries, &key);
+  if (entry == NULL && g_hash_table_size (shared_ancestor_entries) > 0)
+    {
+      key.ancestor_node = parent_node;
+      key.hash ^= shared_entry_hash_ancestors (parent_node);
+      entry = g_hash_table_lookup (shared_ancestor_entries, &key);
+    }
+
+  if (entry == NULL)
+    {
+      shared_misses++;
+      return NULL;
+    }
+
+  shared_hits++;
+
+  g_queue_unlink (&shared_lru, &entry->link);
+  g_queue_push_head_link (&shared_lru, &entry->link);
+
+  return entry->style;
+}
+
+/*< private >
+ * gtk_css_node_style_cache_insert_shared:
+ * @provider: the style provider of the node
+ * @parent_node: (nullable): the node's parent
+ * @parent: (nullable): the style of the node's parent
+ * @decl: the node's declaration
+ * @is_first: if the node is the first child
+ * @is_last: if the node is the last child
+ * @style: the style computed for the node
+ *
+ * Makes @style available to other nodes with the same declaration,
+ * position and parent style, and the same ancestors if @style depends
+ * on them. When the cache is full, the least recently used style is
+ * dropped.
+ */
+void
+gtk_css_node_style_cache_insert_shared (GtkStyleProvider            *provider,
+                                        GtkCssNode                  *parent_node,
+                                        GtkCssStyle                 *parent,
+                                        const GtkCssNodeDeclaration *decl,
+                                        gboolean                     is_first,
+                                        gboolean                     is_last,
+                                        GtkCssStyle                 *style)
+{
+  SharedEntry *entry;
+  GtkCssChange change;
+  GtkCssNode *node;
+  guint i;
+
+  if (!may_be_stored_in_cache (style))
+    return;
+
+  change = gtk_css_static_style_get_change (GTK_CSS_STATIC_STYLE (style));
+  if (change & GTK_CSS_CHANGE_UNSHAREABLE)
+    return;
+
+  /* Animated styles change every frame, and are updated in place */
+  if (parent && !GTK_IS_CSS_STATIC_STYLE (parent))
+    return;
+
+  if (shared_entries == NULL)
+    {
+      shared_entries = shared_table_new ();
+      shared_ancestor_entries = shared_table_new ();
+    }
+
+  entry = g_slice_new0 (SharedEntry);
+  entry->provider = g_object_ref (provider);
+  entry->parent = parent ? g_object_ref (parent) : NULL;
+  entry->decl = gtk_css_node_declaration_ref ((GtkCssNodeDeclaration *) decl);
+  entry->is_first = is_first;
+  entry->is_last = is_last;
+  entry->hash = shared_entry_hash_node (provider, parent, decl, is_first, is_last);
+  entry->style = g_object_ref (style);
+  entry->link.data = entry;
+
+  if (change & GTK_CSS_CHANGE_ANY_PARENT)
+    {
+      for (node = parent_node; node; node = gtk_css_node_get_parent (node))
+        entry->n_ancestors++;
+
+      entry->ancestors = g_new (SharedAncestor, entry->n_ancestors);
+      for (node = parent_node, i = 0; node; node = gtk_css_node_get_parent (node), i++)
+        {
+          entry->ancestors[i].decl = gtk_css_node_declaration_ref ((GtkCssNodeDeclaration *) gtk_css_node_get_declaration (node));
+          entry->ancestors[i].is_first = gtk_css_node_is_first_child (node);
+          entry->ancestors[i].is_last = gtk_css_node_is_last_child (node);
+        }
+
+      entry->hash ^= shared_entry_hash_ancestors (parent_node);
+      entry->table = shared_ancestor_entries;
+    }
+  else
+    entry->table = shared_entries;
+
+  /* Replaces and frees an existing entry for the same key */
+  g_hash_table_add (entry->table, entry);
+  g_queue_push_head_link (&shared_lru, &entry->link);
+
+  while (shared_lru.length > SHARED_CACHE_MAX_ENTRIES)
+    {
+      SharedEntry *last = g_queue_peek_tail (&shared_lru);
+
+      g_hash_table_remove (last->table, last);
+    }
+}
+
+/*< private >
+ * gtk_css_node_style_cache_clear_shared:
+ *
+ * Drops all styles from the shared cache. This needs to happen when
+ * a style provider changes.
+ */
+void
+gtk_css_node_style_cache_clear_shared (void)
+{
+  if (shared_entries == NULL || shared_lru.length == 0)
+    return;
+
+  g_hash_table_remove_all (shared_entries);
+  g_hash_table_remove_all (shared_ancestor_entries);
+}
+
+/*< private >
+ * gtk_css_node_style_cache_get_shared_stats:
+ * @hits: (out): return location for the number of found styles
+ * @misses: (out): return location for the number of styles not found
+ * @n_entries: (out): return location for the number of cached styles
+ *
+ * Gets statistics about the shared cache, for the inspector.
+ */
+void
+gtk_css_node_style_cache_get_shared_stats (guint64 *hits,
+                                           guint64 *misses,
+                                           guint   *n_entries)
+{
+  *hits = shared_hits;
+  *misses = shared_misses;
+  *n_entries = shared_lru.length;
+}
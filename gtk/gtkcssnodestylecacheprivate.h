@@ -20,6 +20,7 @@
 
 #include "gtkcssnodedeclarationprivate.h"
 #include "gtkcssstyleprivate.h"
+#include "gtkstyleprovider.h"
 
 G_BEGIN_DECLS
 
@@ -41,6 +42,24 @@ GtkCssNodeStyleCache *  gtk_css_node_style_cache_lookup         (GtkCssNodeStyle
                                                                  gboolean                     is_first,
                                                                  gboolean                     is_last);
 
+GtkCssStyle *           gtk_css_node_style_cache_lookup_shared  (GtkStyleProvider            *provider,
+                                                                 GtkCssNode                  *parent_node,
+                                                                 GtkCssStyle                 *parent,
+                                                                 const GtkCssNodeDeclaration *decl,
+                                                                 gboolean                     is_first,
+                                                                 gboolean                     is_last);
+void                    gtk_css_node_style_cache_insert_shared  (GtkStyleProvider            *provider,
+                                                                 GtkCssNode                  *parent_node,
+                                                                 GtkCssStyle                 *parent,
+                                                                 const GtkCssNodeDeclaration *decl,
+                                                                 gboolean                     is_first,
+                                                                 gboolean                     is_last,
+                                                                 GtkCssStyle                 *style);
+void                    gtk_css_node_style_cache_clear_shared   (void);
+void                    gtk_css_node_style_cache_get_shared_stats (guint64                   *hits,
+                                                                 guint64                     *misses,
+                                                                 guint                       *n_entries);
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_NODE_STYLE_CACHE_PRIVATE_H__ */
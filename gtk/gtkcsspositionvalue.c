@@ -65,6 +65,12 @@ gtk_css_value_position_equal (const GtkCssValue *position1,
       && _gtk_css_value_equal (position1->y, position2->y);
 }
 
+static guint
+gtk_css_value_position_hash (const GtkCssValue *position)
+{
+  return _gtk_css_value_hash (position->x) * 31 + _gtk_css_value_hash (position->y);
+}
+
 static GtkCssValue *
 gtk_css_value_position_transition (GtkCssValue *start,
                                    GtkCssValue *end,
@@ -154,7 +160,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_POSITION = {
   gtk_css_value_position_compute,
   gtk_css_value_position_equal,
   gtk_css_value_position_transition,
-  gtk_css_value_position_print
+  gtk_css_value_position_print,
+  gtk_css_value_position_hash
 };
 
 GtkCssValue *
@@ -167,7 +174,7 @@ _gtk_css_position_value_new (GtkCssValue *x,
   result->x = x;
   result->y = y;
 
-  return result;
+  return _gtk_css_value_intern (result);
 }
 
 static GtkCssValue *
@@ -0,0 +1,360 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkcssprofilerprivate.h"
+
+#include "gtkcssnodedeclarationprivate.h"
+#include "gtkcssnodeprivate.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Records what style validation spends its time on.
+ *
+ * Statistics are collected per frame, which is identified by the
+ * timestamp the nodes are validated with. Invalidations that happen
+ * between validations are accounted to the frame validating them.
+ *
+ * If the GTK_CSS_TRACE environment variable is set to a filename, every
+ * validation, restyled node and invalidation is also written to that
+ * file in the Trace Event Format, which can be loaded into
+ * chrome://tracing, Perfetto and other trace viewers.
+ */
+
+static const char *result_names[GTK_CSS_PROFILER_N_RESULTS] = {
+  "kept",
+  "parent-cache",
+  "shared-cache",
+  "computed"
+};
+
+static guint running = 0;
+static FILE *trace_file = NULL;
+
+static guint validate_depth = 0;
+static gint64 validate_start = 0;
+static GtkCssProfilerResult current_result = GTK_CSS_PROFILER_KEPT;
+
+static GtkCssProfilerFrame pending = { 0, };
+static GtkCssProfilerFrame current = { 0, };
+static GtkCssProfilerFrame last = { 0, };
+static gboolean have_last = FALSE;
+
+static void
+gtk_css_profiler_ensure_trace_file (void)
+{
+  static gboolean initialized = FALSE;
+  const char *filename;
+
+  if (initialized)
+    return;
+
+  initialized = TRUE;
+
+  filename = g_getenv ("GTK_CSS_TRACE");
+  if (filename == NULL || filename[0] == '\0')
+    return;
+
+  trace_file = g_fopen (filename, "w");
+  if (trace_file == NULL)
+    {
+      g_warning ("Could not open CSS trace file %s: %s", filename, g_strerror (errno));
+      return;
+    }
+
+  /* The closing bracket is optional in this format, so the file
+   * stays valid no matter how the application exits.
+   */
+  fputs ("[\n", trace_file);
+
+  running++;
+}
+
+/*< private >
+ * gtk_css_profiler_is_running:
+ *
+ * Returns: %TRUE if style validation is being profiled
+ */
+gboolean
+gtk_css_profiler_is_running (void)
+{
+  gtk_css_profiler_ensure_trace_file ();
+
+  return running > 0;
+}
+
+/*< private >
+ * gtk_css_profiler_start:
+ *
+ * Starts collecting statistics until the matching call to
+ * gtk_css_profiler_stop().
+ */
+void
+gtk_css_profiler_start (void)
+{
+  gtk_css_profiler_ensure_trace_file ();
+
+  running++;
+}
+
+void
+gtk_css_profiler_stop (void)
+{
+  g_return_if_fail (running > 0);
+
+  running--;
+}
+
+/*< private >
+ * gtk_css_profiler_get_time:
+ *
+ * Gets the start time for a measurement.
+ *
+ * Returns: the current time, or 0 if the profiler is not running
+ */
+gint64
+gtk_css_profiler_get_time (void)
+{
+  if (!gtk_css_profiler_is_running ())
+    return 0;
+
+  return g_get_monotonic_time ();
+}
+
+void
+gtk_css_profiler_add_phase_time (GtkCssProfilerPhase phase,
+                                 gint64              start_time)
+{
+  if (start_time == 0)
+    return;
+
+  current.phase_time[phase] += g_get_monotonic_time () - start_time;
+}
+
+static void
+print_escaped (FILE       *file,
+               const char *str)
+{
+  for (; *str; str++)
+    {
+      if (*str == '"' || *str == '\\')
+        fputc ('\\', file);
+      fputc (*str, file);
+    }
+}
+
+static void
+print_node (FILE       *file,
+            GtkCssNode *node)
+{
+  char *str;
+
+  str = gtk_css_node_declaration_to_string (gtk_css_node_get_declaration (node));
+  print_escaped (file, str);
+  g_free (str);
+}
+
+static void
+print_change (FILE         *file,
+              GtkCssChange  change)
+{
+  char *str;
+
+  str = gtk_css_change_to_string (change);
+  print_escaped (file, str);
+  g_free (str);
+}
+
+static void
+gtk_css_profiler_finish_frame (void)
+{
+  if (current.n_validations == 0)
+    return;
+
+  last = current;
+  have_last = TRUE;
+  memset (&current, 0, sizeof (GtkCssProfilerFrame));
+}
+
+/*< private >
+ * gtk_css_profiler_begin_validate:
+ * @frame_time: the timestamp nodes are validated with
+ *
+ * Marks the start of validating a node tree.
+ */
+void
+gtk_css_profiler_begin_validate (gint64 frame_time)
+{
+  if (!gtk_css_profiler_is_running ())
+    return;
+
+  if (validate_depth++ > 0)
+    return;
+
+  if (current.n_validations > 0 && current.frame_time != frame_time)
+    gtk_css_profiler_finish_frame ();
+
+  current.frame_time = frame_time;
+  current.n_validations++;
+  current.n_invalidated += pending.n_invalidated;
+  current.invalidated_changes |= pending.invalidated_changes;
+  memset (&pending, 0, sizeof (GtkCssProfilerFrame));
+
+  validate_start = g_get_monotonic_time ();
+}
+
+void
+gtk_css_profiler_end_validate (void)
+{
+  gint64 now;
+
+  if (validate_depth == 0)
+    return;
+
+  if (--validate_depth > 0)
+    return;
+
+  now = g_get_monotonic_time ();
+  current.validate_time += now - validate_start;
+
+  if (trace_file)
+    {
+      fprintf (trace_file,
+               "{\"name\":\"Validate styles\",\"cat\":\"css\",\"ph\":\"X\","
+               "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":1,"
+               "\"args\":{\"frame-time\":%" G_GINT64_FORMAT ",\"invalidated\":%u,\"restyled\":%u,"
+               "\"match-us\":%" G_GINT64_FORMAT ",\"compute-us\":%" G_GINT64_FORMAT ","
+               "\"parent-cache\":%u,\"shared-cache\":%u,\"computed\":%u}},\n",
+               validate_start, now - validate_start,
+               current.frame_time, current.n_invalidated, current.n_restyled,
+               current.phase_time[GTK_CSS_PROFILER_MATCH],
+               current.phase_time[GTK_CSS_PROFILER_COMPUTE],
+               current.results[GTK_CSS_PROFILER_PARENT_CACHE],
+               current.results[GTK_CSS_PROFILER_SHARED_CACHE],
+               current.results[GTK_CSS_PROFILER_COMPUTED]);
+      fflush (trace_file);
+    }
+}
+
+/*< private >
+ * gtk_css_profiler_add_invalidation:
+ * @node: the invalidated node
+ * @change: the reason
+ *
+ * Records that the style of @node needs to be updated.
+ */
+void
+gtk_css_profiler_add_invalidation (GtkCssNode   *node,
+                                   GtkCssChange  change)
+{
+  if (!gtk_css_profiler_is_running ())
+    return;
+
+  pending.n_invalidated++;
+  pending.invalidated_changes |= change;
+
+  if (trace_file)
+    {
+      fprintf (trace_file,
+               "{\"name\":\"Invalidate\",\"cat\":\"css\",\"ph\":\"i\",\"s\":\"t\","
+               "\"ts\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":1,\"args\":{\"node\":\"",
+               g_get_monotonic_time ());
+      print_node (trace_file, node);
+      fputs ("\",\"change\":\"", trace_file);
+      print_change (trace_file, change);
+      fputs ("\"}},\n", trace_file);
+    }
+}
+
+/*< private >
+ * gtk_css_profiler_set_result:
+ * @result: how the new style was obtained
+ *
+ * Sets the result for the restyle that is in progress.
+ */
+void
+gtk_css_profiler_set_result (GtkCssProfilerResult result)
+{
+  current_result = result;
+}
+
+/*< private >
+ * gtk_css_profiler_add_restyle:
+ * @node: the node
+ * @change: the changes that caused the restyle
+ * @start_time: the result of gtk_css_profiler_get_time() before
+ *   updating the style
+ *
+ * Records that the style of @node was updated.
+ */
+void
+gtk_css_profiler_add_restyle (GtkCssNode   *node,
+                              GtkCssChange  change,
+                              gint64        start_time)
+{
+  GtkCssProfilerResult result = current_result;
+
+  current_result = GTK_CSS_PROFILER_KEPT;
+
+  if (start_time == 0)
+    return;
+
+  current.n_restyled++;
+  current.results[result]++;
+
+  if (trace_file)
+    {
+      fputs ("{\"name\":\"", trace_file);
+      print_node (trace_file, node);
+      fprintf (trace_file,
+               "\",\"cat\":\"css\",\"ph\":\"X\","
+               "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":1,"
+               "\"args\":{\"result\":\"%s\",\"change\":\"",
+               start_time, g_get_monotonic_time () - start_time,
+               result_names[result]);
+      print_change (trace_file, change);
+      fputs ("\"}},\n", trace_file);
+
+      /* Styles looked up outside of a validation */
+      if (validate_depth == 0)
+        fflush (trace_file);
+    }
+}
+
+/*< private >
+ * gtk_css_profiler_get_last_frame:
+ * @frame: (out): return location for the statistics
+ *
+ * Gets the statistics of the last frame that has been completely
+ * validated.
+ *
+ * Returns: %TRUE if there is such a frame
+ */
+gboolean
+gtk_css_profiler_get_last_frame (GtkCssProfilerFrame *frame)
+{
+  if (!have_last)
+    return FALSE;
+
+  *frame = last;
+
+  return TRUE;
+}
@@ -0,0 +1,76 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_CSS_PROFILER_PRIVATE_H__
+#define __GTK_CSS_PROFILER_PRIVATE_H__
+
+#include "gtkcsstypesprivate.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GTK_CSS_PROFILER_MATCH,
+  GTK_CSS_PROFILER_COMPUTE,
+  GTK_CSS_PROFILER_N_PHASES
+} GtkCssProfilerPhase;
+
+typedef enum {
+  GTK_CSS_PROFILER_KEPT,
+  GTK_CSS_PROFILER_PARENT_CACHE,
+  GTK_CSS_PROFILER_SHARED_CACHE,
+  GTK_CSS_PROFILER_COMPUTED,
+  GTK_CSS_PROFILER_N_RESULTS
+} GtkCssProfilerResult;
+
+typedef struct _GtkCssProfilerFrame GtkCssProfilerFrame;
+
+struct _GtkCssProfilerFrame {
+  gint64       frame_time;
+  guint        n_validations;
+  gint64       validate_time;
+
+  guint        n_invalidated;
+  GtkCssChange invalidated_changes;
+
+  guint        n_restyled;
+  gint64       phase_time[GTK_CSS_PROFILER_N_PHASES];
+  guint        results[GTK_CSS_PROFILER_N_RESULTS];
+};
+
+gboolean        gtk_css_profiler_is_running             (void);
+void            gtk_css_profiler_start                  (void);
+void            gtk_css_profiler_stop                   (void);
+
+gint64          gtk_css_profiler_get_time               (void);
+void            gtk_css_profiler_add_phase_time         (GtkCssProfilerPhase     phase,
+                                                         gint64                  start_time);
+
+void            gtk_css_profiler_begin_validate         (gint64                  frame_time);
+void            gtk_css_profiler_end_validate           (void);
+
+void            gtk_css_profiler_add_invalidation       (GtkCssNode             *node,
+                                                         GtkCssChange            change);
+void            gtk_css_profiler_set_result             (GtkCssProfilerResult    result);
+void            gtk_css_profiler_add_restyle            (GtkCssNode             *node,
+                                                         GtkCssChange            change,
+                                                         gint64                  start_time);
+
+gboolean        gtk_css_profiler_get_last_frame         (GtkCssProfilerFrame    *frame);
+
+G_END_DECLS
+
+#endif /* __GTK_CSS_PROFILER_PRIVATE_H__ */
@@ -34,6 +34,7 @@
 #include "gtkcssselectorprivate.h"
 #include "gtkcssshorthandpropertyprivate.h"
 #include "gtkcssstylefuncsprivate.h"
+#include "gtkcssthemecacheprivate.h"
 #include "gtksettingsprivate.h"
 #include "gtkstyleprovider.h"
 #include "gtkstylecontextprivate.h"
@@ -81,6 +82,7 @@
 typedef struct GtkCssRuleset GtkCssRuleset;
 typedef struct _GtkCssScanner GtkCssScanner;
 typedef struct _PropertyValue PropertyValue;
+typedef struct _ThemeRecording ThemeRecording;
 typedef enum ParserScope ParserScope;
 typedef enum ParserSymbol ParserSymbol;
 
@@ -97,7 +99,17 @@ struct GtkCssRuleset
   PropertyValue *styles;
   GtkBitmask *set_styles;
   guint n_styles;
+  /* indexes into the declarations of the theme cache */
+  guint32 *declarations;
+  guint n_declarations;
+  /* where the values of the declarations are, 4 numbers for
+   * each one, only while recording a theme */
+  guint32 *locations;
   guint owns_styles : 1;
+  guint owns_declarations : 1;
+  /* styles still need to be parsed from declarations, accessed
+   * atomically because styles may be looked up from other threads */
+  gint parse_declarations;
 };
 
 struct _GtkCssScanner
@@ -107,6 +119,19 @@ struct _GtkCssScanner
   GtkCssSection *section;
   GtkCssScanner *parent;
   GSList *state;
+  guint source;
+};
+
+/* What goes into the theme cache, collected while parsing a theme */
+struct _ThemeRecording
+{
+  GVariantBuilder sources;
+  guint n_sources;
+  GVariantBuilder colors;
+  GVariantBuilder keyframes;
+  GPtrArray *declarations;
+  GHashTable *declaration_indexes;
+  gboolean failed;
 };
 
 struct _GtkCssProviderPrivate
@@ -120,8 +145,29 @@ struct _GtkCssProviderPrivate
   GtkCssSelectorTree *tree;
   GResource *resource;
   gchar *path;
+
+  ThemeRecording *recording;
+
+  /* Set if the theme was loaded from the cache */
+  GFile *cache_theme;
+  GVariant *cache;
+  GVariant *cache_sources;
+  GVariant *cache_declarations;
+  GVariant *cache_locations;
+  GFile **cache_files;
+  GtkCssSection **cache_documents;
+  GtkStyleProperty **cache_properties;
+  GtkCssValue **cache_values;
+  /* Set when text from the cache failed to parse, until the
+   * theme has been loaded from its files again */
+  gint cache_broken;
 };
 
+/* colors, keyframes, declarations, selector tree, the declarations
+ * of each ruleset and the locations of their values
+ */
+#define GTK_CSS_PROVIDER_CACHE_TYPE "(a(ssu)a(ssu)a(ssu)" GTK_CSS_SELECTOR_TREE_VARIANT_TYPE "aauaau)"
+
 enum {
   PARSING_ERROR,
   LAST_SIGNAL
@@ -240,6 +286,8 @@ gtk_css_ruleset_init_copy (GtkCssRuleset       *new,
   /* First copy takes over ownership */
   if (ruleset->owns_styles)
     ruleset->owns_styles = FALSE;
+  if (ruleset->owns_declarations)
+    ruleset->owns_declarations = FALSE;
   if (new->set_styles)
     new->set_styles = _gtk_bitmask_copy (new->set_styles);
 }
@@ -260,6 +308,11 @@ gtk_css_ruleset_clear (GtkCssRuleset *ruleset)
         }
       g_free (ruleset->styles);
     }
+  if (ruleset->owns_declarations)
+    {
+      g_free (ruleset->declarations);
+      g_free (ruleset->locations);
+    }
   if (ruleset->set_styles)
     _gtk_bitmask_free (ruleset->set_styles);
   if (ruleset->selector)
@@ -278,12 +331,19 @@ gtk_css_ruleset_add (GtkCssRuleset       *ruleset,
 
   g_return_if_fail (ruleset->owns_styles || ruleset->n_styles == 0);
 
-  if (ruleset->set_styles == NULL)
-    ruleset->set_styles = _gtk_bitmask_new ();
+  /* Rulesets loaded from the theme cache know their styles from the
+   * start, and other threads may be reading them while the values are
+   * parsed.
+   */
+  if (!g_atomic_int_get (&ruleset->parse_declarations))
+    {
+      if (ruleset->set_styles == NULL)
+        ruleset->set_styles = _gtk_bitmask_new ();
 
-  ruleset->set_styles = _gtk_bitmask_set (ruleset->set_styles,
-                                          _gtk_css_style_property_get_id (property),
-                                          TRUE);
+      ruleset->set_styles = _gtk_bitmask_set (ruleset->set_styles,
+                                              _gtk_css_style_property_get_id (property),
+                                              TRUE);
+    }
 
   ruleset->owns_styles = TRUE;
 
@@ -307,12 +367,159 @@ gtk_css_ruleset_add (GtkCssRuleset       *ruleset,
     }
 
   ruleset->styles[i].value = value;
-  if (gtk_keep_css_sections)
+  if (gtk_keep_css_sections && section != NULL)
     ruleset->styles[i].section = gtk_css_section_ref (section);
   else
     ruleset->styles[i].section = NULL;
 }
 
+/* Like gtk_css_ruleset_add(), but also splits up values of
+ * shorthand properties.
+ */
+static void
+gtk_css_ruleset_add_value (GtkCssRuleset    *ruleset,
+                           GtkStyleProperty *property,
+                           GtkCssValue      *value,
+                           GtkCssSection    *section)
+{
+  if (GTK_IS_CSS_SHORTHAND_PROPERTY (property))
+    {
+      GtkCssShorthandProperty *shorthand = GTK_CSS_SHORTHAND_PROPERTY (property);
+      guint i;
+
+      for (i = 0; i < _gtk_css_shorthand_property_get_n_subproperties (shorthand); i++)
+        {
+          GtkCssStyleProperty *child = _gtk_css_shorthand_property_get_subproperty (shorthand, i);
+          GtkCssValue *sub = _gtk_css_array_value_get_nth (value, i);
+
+          gtk_css_ruleset_add (ruleset, child, _gtk_css_value_ref (sub), section);
+        }
+
+      _gtk_css_value_unref (value);
+    }
+  else if (GTK_IS_CSS_STYLE_PROPERTY (property))
+    {
+      gtk_css_ruleset_add (ruleset, GTK_CSS_STYLE_PROPERTY (property), value, section);
+    }
+  else
+    {
+      g_assert_not_reached ();
+      _gtk_css_value_unref (value);
+    }
+}
+
+static void
+gtk_css_ruleset_add_declaration (GtkCssRuleset *ruleset,
+                                 guint          declaration,
+                                 GtkCssSection *section,
+                                 GtkCssParser  *parser)
+{
+  guint32 *location;
+
+  g_return_if_fail (ruleset->owns_declarations || ruleset->n_declarations == 0);
+
+  ruleset->owns_declarations = TRUE;
+  ruleset->n_declarations++;
+  ruleset->declarations = g_renew (guint32, ruleset->declarations, ruleset->n_declarations);
+  ruleset->declarations[ruleset->n_declarations - 1] = declaration;
+
+  /* The value's section ends where the parser is now */
+  ruleset->locations = g_renew (guint32, ruleset->locations, 4 * ruleset->n_declarations);
+  location = &ruleset->locations[4 * (ruleset->n_declarations - 1)];
+  location[0] = gtk_css_section_get_start_line (section);
+  location[1] = gtk_css_section_get_start_position (section);
+  location[2] = _gtk_css_parser_get_line (parser);
+  location[3] = _gtk_css_parser_get_position (parser);
+}
+
+static void
+theme_recording_init (ThemeRecording *recording)
+{
+  g_variant_builder_init (&recording->sources, G_VARIANT_TYPE (GTK_CSS_THEME_CACHE_SOURCES_TYPE));
+  recording->n_sources = 0;
+  g_variant_builder_init (&recording->colors, G_VARIANT_TYPE ("a(ssu)"));
+  g_variant_builder_init (&recording->keyframes, G_VARIANT_TYPE ("a(ssu)"));
+  recording->declarations = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+  recording->declaration_indexes = g_hash_table_new_full (g_variant_hash, g_variant_equal,
+                                                          (GDestroyNotify) g_variant_unref, NULL);
+  recording->failed = FALSE;
+}
+
+static void
+theme_recording_clear (ThemeRecording *recording)
+{
+  g_variant_builder_clear (&recording->sources);
+  g_variant_builder_clear (&recording->colors);
+  g_variant_builder_clear (&recording->keyframes);
+  g_ptr_array_unref (recording->declarations);
+  g_hash_table_unref (recording->declaration_indexes);
+}
+
+static guint
+theme_recording_add_source (ThemeRecording *recording,
+                            GFile          *file,
+                            const char     *text,
+                            gsize           length)
+{
+  char *uri, *checksum;
+
+  uri = g_file_get_uri (file);
+  checksum = gtk_css_theme_cache_compute_checksum (text, length);
+  g_variant_builder_add (&recording->sources, "(ss)", uri, checksum);
+  g_free (checksum);
+  g_free (uri);
+
+  return recording->n_sources++;
+}
+
+/* Definitions and declarations are stored as the text they were parsed
+ * from, along with the file it came from, so that url()s resolve the
+ * same way when parsing them again.
+ */
+static void
+theme_recording_add_definition (GVariantBuilder *builder,
+                                const char      *name,
+                                const char      *start,
+                                const char      *end,
+                                guint            source)
+{
+  char *text;
+
+  text = g_strndup (start, end - start);
+  g_variant_builder_add (builder, "(ssu)", name, text, source);
+  g_free (text);
+}
+
+static guint
+theme_recording_add_declaration (ThemeRecording *recording,
+                                 const char     *property,
+                                 const char     *start,
+                                 const char     *end,
+                                 guint           source)
+{
+  GVariant *declaration;
+  gpointer index;
+  char *text;
+
+  text = g_strndup (start, end - start);
+  declaration = g_variant_ref_sink (g_variant_new ("(ssu)", property, text, source));
+  g_free (text);
+
+  /* Themes repeat the same declarations a lot, so we only store,
+   * and later parse, each of them once.
+   */
+  if (g_hash_table_lookup_extended (recording->declaration_indexes, declaration, NULL, &index))
+    {
+      g_variant_unref (declaration);
+      return GPOINTER_TO_UINT (index);
+    }
+
+  g_hash_table_insert (recording->declaration_indexes, declaration, GUINT_TO_POINTER (recording->declarations->len));
+  g_ptr_array_add (recording->declarations, g_variant_ref (declaration));
+
+  return recording->declarations->len - 1;
+}
+
 static void
 gtk_css_scanner_destroy (GtkCssScanner *scanner)
 {
@@ -337,6 +544,10 @@ gtk_css_provider_emit_error (GtkCssProvider *provider,
                              GtkCssScanner  *scanner,
                              const GError   *error)
 {
+  /* Don't cache broken themes, so the errors show up every time */
+  if (provider->priv->recording)
+    provider->priv->recording->failed = TRUE;
+
   gtk_css_style_provider_emit_error (GTK_STYLE_PROVIDER (provider),
                                      scanner ? scanner->section : NULL,
                                      error);
@@ -534,6 +745,227 @@ verify_tree_get_change_results (GtkCssProvider *provider,
 #endif
 }
 
+static void gtk_css_provider_load_theme (GtkCssProvider *css_provider,
+                                         GFile          *file);
+
+static gboolean
+gtk_css_provider_reload_broken_cache (gpointer data)
+{
+  GtkCssProvider *css_provider = data;
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GResource *resource;
+  GFile *theme;
+  char *path, *uri;
+
+  /* Another theme was loaded meanwhile */
+  if (priv->cache == NULL)
+    {
+      g_atomic_int_set (&priv->cache_broken, FALSE);
+      return G_SOURCE_REMOVE;
+    }
+
+  theme = g_object_ref (priv->cache_theme);
+
+  uri = g_file_get_uri (theme);
+  g_warning ("The theme cache of %s is broken, loading the theme again", uri);
+  g_free (uri);
+
+  gtk_css_theme_cache_remove (theme);
+
+  /* Loading the theme resets the provider */
+  resource = priv->resource;
+  priv->resource = NULL;
+  path = priv->path;
+  priv->path = NULL;
+
+  gtk_css_provider_load_theme (css_provider, theme);
+
+  priv->resource = resource;
+  priv->path = path;
+
+  g_atomic_int_set (&priv->cache_broken, FALSE);
+  g_object_unref (theme);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* All text in the cache parsed without errors when it was written, so
+ * any error means that the cache is broken. Values are only parsed when
+ * their rulesets first match, possibly in a thread, so the theme gets
+ * loaded from its files again, without the cache, once the main loop
+ * is idle. Lookups until then miss the values that failed to parse.
+ */
+static void
+gtk_css_provider_cache_broken (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+
+  if (!g_atomic_int_compare_and_exchange (&priv->cache_broken, FALSE, TRUE))
+    return;
+
+  g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                   gtk_css_provider_reload_broken_cache,
+                   g_object_ref (css_provider),
+                   g_object_unref);
+}
+
+static void
+gtk_css_provider_cache_parser_error (GtkCssParser *parser,
+                                     const GError *error,
+                                     gpointer      user_data)
+{
+  gtk_css_provider_cache_broken (user_data);
+}
+
+static GtkCssParser *
+gtk_css_provider_new_cache_parser (GtkCssProvider *css_provider,
+                                   const char     *text,
+                                   guint           source)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+
+  if (priv->cache_files[source] == NULL)
+    {
+      const char *uri;
+
+      g_variant_get_child (priv->cache_sources, source, "(&s&s)", &uri, NULL);
+      priv->cache_files[source] = g_file_new_for_uri (uri);
+    }
+
+  return _gtk_css_parser_new (text,
+                              priv->cache_files[source],
+                              gtk_css_provider_cache_parser_error,
+                              css_provider);
+}
+
+static GtkCssValue *
+gtk_css_provider_get_cached_value (GtkCssProvider *css_provider,
+                                   guint           declaration)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+
+  if (priv->cache_values[declaration] == NULL)
+    {
+      GtkCssParser *parser;
+      const char *text;
+      guint source;
+
+      g_variant_get_child (priv->cache_declarations, declaration, "(&s&su)", NULL, &text, &source);
+
+      parser = gtk_css_provider_new_cache_parser (css_provider, text, source);
+      priv->cache_values[declaration] = _gtk_style_property_parse_value (priv->cache_properties[declaration], parser);
+      if (priv->cache_values[declaration] == NULL)
+        gtk_css_provider_cache_broken (css_provider);
+      _gtk_css_parser_free (parser);
+    }
+
+  return priv->cache_values[declaration];
+}
+
+/* Sections for values from the cache are made from the locations
+ * stored with each ruleset. Their only parent is the section of the
+ * whole file, the sections of rulesets and declarations are not kept.
+ */
+static GtkCssSection *
+gtk_css_provider_new_cached_section (GtkCssProvider *css_provider,
+                                     guint           declaration,
+                                     const guint32  *location)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  guint source;
+
+  g_variant_get_child (priv->cache_declarations, declaration, "(&s&su)", NULL, NULL, &source);
+
+  if (priv->cache_documents[source] == NULL)
+    {
+      const char *uri;
+
+      if (priv->cache_files[source] == NULL)
+        {
+          g_variant_get_child (priv->cache_sources, source, "(&s&s)", &uri, NULL);
+          priv->cache_files[source] = g_file_new_for_uri (uri);
+        }
+
+      priv->cache_documents[source] = _gtk_css_section_new_for_file (GTK_CSS_SECTION_DOCUMENT,
+                                                                     priv->cache_files[source]);
+    }
+
+  return _gtk_css_section_new_for_location (priv->cache_documents[source],
+                                            GTK_CSS_SECTION_VALUE,
+                                            priv->cache_files[source],
+                                            location[0], location[1],
+                                            location[2], location[3]);
+}
+
+/* Rulesets loaded from the cache only know the declarations they
+ * contain, their styles are parsed the first time they match.
+ */
+static void
+gtk_css_ruleset_parse_declarations (GtkCssRuleset  *ruleset,
+                                    GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  const guint32 *locations = NULL;
+  GVariant *cached_locations = NULL;
+  guint i;
+
+  if (gtk_keep_css_sections)
+    {
+      gsize n;
+
+      cached_locations = g_variant_get_child_value (priv->cache_locations,
+                                                    ruleset - (GtkCssRuleset *) priv->rulesets->data);
+      locations = g_variant_get_fixed_array (cached_locations, &n, sizeof (guint32));
+      if (n != 4 * ruleset->n_declarations)
+        locations = NULL;
+    }
+
+  for (i = 0; i < ruleset->n_declarations; i++)
+    {
+      guint declaration = ruleset->declarations[i];
+      GtkCssSection *section = NULL;
+      GtkCssValue *value;
+
+      /* The cache is broken and will be replaced */
+      value = gtk_css_provider_get_cached_value (css_provider, declaration);
+      if (value == NULL)
+        continue;
+
+      if (locations)
+        section = gtk_css_provider_new_cached_section (css_provider, declaration, &locations[4 * i]);
+
+      gtk_css_ruleset_add_value (ruleset,
+                                 priv->cache_properties[declaration],
+                                 _gtk_css_value_ref (value),
+                                 section);
+
+      if (section)
+        gtk_css_section_unref (section);
+    }
+
+  g_clear_pointer (&cached_locations, g_variant_unref);
+
+  g_atomic_int_set (&ruleset->parse_declarations, FALSE);
+}
+
+/* Style lookups may happen on multiple threads at once, see
+ * gtkcssstylebatch.c. Parsing creates values and modifies the
+ * provider, so only one thread may do it at a time.
+ */
+static void
+gtk_css_ruleset_ensure_styles (GtkCssRuleset  *ruleset,
+                               GtkCssProvider *css_provider)
+{
+  static GMutex parse_mutex;
+
+  if (!g_atomic_int_get (&ruleset->parse_declarations))
+    return;
+
+  g_mutex_lock (&parse_mutex);
+  if (g_atomic_int_get (&ruleset->parse_declarations))
+    gtk_css_ruleset_parse_declarations (ruleset, css_provider);
+  g_mutex_unlock (&parse_mutex);
+}
 
 static GtkCssValue *
 gtk_css_style_provider_get_color (GtkStyleProvider *provider,
@@ -578,12 +1010,18 @@ gtk_css_style_provider_lookup (GtkStyleProvider    *provider,
         {
           ruleset = tree_rules->pdata[i];
 
-          if (ruleset->styles == NULL)
+          if (ruleset->set_styles == NULL)
             continue;
 
           if (!_gtk_bitmask_intersects (_gtk_css_lookup_get_missing (lookup),
                                         ruleset->set_styles))
-          continue;
+            continue;
+
+          /* Only parse rulesets from the cache once they are needed */
+          gtk_css_ruleset_ensure_styles (ruleset, css_provider);
+
+          if (ruleset->styles == NULL)
+            continue;
 
           for (j = 0; j < ruleset->n_styles; j++)
             {
@@ -626,6 +1064,40 @@ gtk_css_style_provider_iface_init (GtkStyleProviderInterface *iface)
   iface->emit_error = gtk_css_style_provider_emit_error;
 }
 
+static void
+gtk_css_provider_clear_cache (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  gsize i, n;
+
+  if (priv->cache == NULL)
+    return;
+
+  n = g_variant_n_children (priv->cache_declarations);
+  for (i = 0; i < n; i++)
+    {
+      if (priv->cache_values[i])
+        _gtk_css_value_unref (priv->cache_values[i]);
+    }
+
+  n = g_variant_n_children (priv->cache_sources);
+  for (i = 0; i < n; i++)
+    {
+      g_clear_pointer (&priv->cache_documents[i], gtk_css_section_unref);
+      g_clear_object (&priv->cache_files[i]);
+    }
+
+  g_clear_pointer (&priv->cache_values, g_free);
+  g_clear_pointer (&priv->cache_properties, g_free);
+  g_clear_pointer (&priv->cache_documents, g_free);
+  g_clear_pointer (&priv->cache_files, g_free);
+  g_clear_pointer (&priv->cache_locations, g_variant_unref);
+  g_clear_pointer (&priv->cache_declarations, g_variant_unref);
+  g_clear_pointer (&priv->cache_sources, g_variant_unref);
+  g_clear_pointer (&priv->cache, g_variant_unref);
+  g_clear_object (&priv->cache_theme);
+}
+
 static void
 gtk_css_provider_finalize (GObject *object)
 {
@@ -642,6 +1114,8 @@ gtk_css_provider_finalize (GObject *object)
   g_array_free (priv->rulesets, TRUE);
   _gtk_css_selector_tree_free (priv->tree);
 
+  gtk_css_provider_clear_cache (css_provider);
+
   g_hash_table_destroy (priv->symbolic_colors);
   g_hash_table_destroy (priv->keyframes);
 
@@ -783,6 +1257,7 @@ gtk_css_provider_reset (GtkCssProvider *css_provider)
   _gtk_css_selector_tree_free (priv->tree);
   priv->tree = NULL;
 
+  gtk_css_provider_clear_cache (css_provider);
 }
 
 static gboolean
@@ -853,7 +1328,9 @@ parse_import (GtkCssScanner *scanner)
 static gboolean
 parse_color_definition (GtkCssScanner *scanner)
 {
+  ThemeRecording *recording = scanner->provider->priv->recording;
   GtkCssValue *color;
+  const char *start, *end;
   char *name;
 
   gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_COLOR_DEFINITION);
@@ -877,6 +1354,7 @@ parse_color_definition (GtkCssScanner *scanner)
       return TRUE;
     }
 
+  start = _gtk_css_parser_get_data (scanner->parser);
   color = _gtk_css_color_value_parse (scanner->parser);
   if (color == NULL)
     {
@@ -885,6 +1363,7 @@ parse_color_definition (GtkCssScanner *scanner)
       gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_COLOR_DEFINITION);
       return TRUE;
     }
+  end = _gtk_css_parser_get_data (scanner->parser);
 
   if (!_gtk_css_parser_try (scanner->parser, ";", TRUE))
     {
@@ -901,6 +1380,9 @@ parse_color_definition (GtkCssScanner *scanner)
       return TRUE;
     }
 
+  if (recording)
+    theme_recording_add_definition (&recording->colors, name, start, end, scanner->source);
+
   g_hash_table_insert (scanner->provider->priv->symbolic_colors, name, color);
 
   gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_COLOR_DEFINITION);
@@ -921,6 +1403,12 @@ parse_binding_set (GtkCssScanner *scanner)
       return FALSE;
     }
 
+  /* Binding sets are global, loading a theme from the cache would
+   * not create them.
+   */
+  if (scanner->provider->priv->recording)
+    scanner->provider->priv->recording->failed = TRUE;
+
   name = _gtk_css_parser_try_ident (scanner->parser, TRUE);
   if (name == NULL)
     {
@@ -1018,7 +1506,9 @@ skip_semicolon:
 static gboolean
 parse_keyframes (GtkCssScanner *scanner)
 {
+  ThemeRecording *recording = scanner->provider->priv->recording;
   GtkCssKeyframes *keyframes;
+  const char *start;
   char *name;
 
   gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_KEYFRAMES);
@@ -1041,6 +1531,7 @@ parse_keyframes (GtkCssScanner *scanner)
       goto exit;
     }
 
+  start = _gtk_css_parser_get_data (scanner->parser);
   if (!_gtk_css_parser_try (scanner->parser, "{", TRUE))
     {
       gtk_css_provider_error_literal (scanner->provider,
@@ -1073,6 +1564,13 @@ parse_keyframes (GtkCssScanner *scanner)
       if (!_gtk_css_parser_is_eof (scanner->parser))
         _gtk_css_parser_resync (scanner->parser, FALSE, 0);
     }
+  else if (recording)
+    {
+      /* The braces are recorded, too, as they delimit the keyframes */
+      theme_recording_add_definition (&recording->keyframes, name, start,
+                                      _gtk_css_parser_get_data (scanner->parser),
+                                      scanner->source);
+    }
 
 exit:
   gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_KEYFRAMES);
@@ -1156,12 +1654,15 @@ parse_declaration (GtkCssScanner *scanner,
 
   if (property)
     {
+      ThemeRecording *recording = scanner->provider->priv->recording;
       GtkCssValue *value;
+      const char *start;
 
       g_free (name);
 
       gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_VALUE);
 
+      start = _gtk_css_parser_get_data (scanner->parser);
       value = _gtk_style_property_parse_value (property,
                                                scanner->parser);
 
@@ -1188,31 +1689,17 @@ parse_declaration (GtkCssScanner *scanner,
           return;
         }
 
-      if (GTK_IS_CSS_SHORTHAND_PROPERTY (property))
-        {
-          GtkCssShorthandProperty *shorthand = GTK_CSS_SHORTHAND_PROPERTY (property);
-          guint i;
-
-          for (i = 0; i < _gtk_css_shorthand_property_get_n_subproperties (shorthand); i++)
-            {
-              GtkCssStyleProperty *child = _gtk_css_shorthand_property_get_subproperty (shorthand, i);
-              GtkCssValue *sub = _gtk_css_array_value_get_nth (value, i);
-              
-              gtk_css_ruleset_add (ruleset, child, _gtk_css_value_ref (sub), scanner->section);
-            }
-          
-            _gtk_css_value_unref (value);
-        }
-      else if (GTK_IS_CSS_STYLE_PROPERTY (property))
-        {
-          gtk_css_ruleset_add (ruleset, GTK_CSS_STYLE_PROPERTY (property), value, scanner->section);
-        }
-      else
-        {
-          g_assert_not_reached ();
-          _gtk_css_value_unref (value);
-        }
+      if (recording)
+        gtk_css_ruleset_add_declaration (ruleset,
+                                         theme_recording_add_declaration (recording,
+                                                                          property->name,
+                                                                          start,
+                                                                          _gtk_css_parser_get_data (scanner->parser),
+                                                                          scanner->source),
+                                         scanner->section,
+                                         scanner->parser);
 
+      gtk_css_ruleset_add_value (ruleset, property, value, scanner->section);
 
       gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_VALUE);
     }
@@ -1388,13 +1875,14 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
 {
   GtkCssScanner *scanner;
   char *free_data = NULL;
+  gsize length = 0;
 
   if (text == NULL)
     {
       GError *load_error = NULL;
 
       if (g_file_load_contents (file, NULL,
-                                &free_data, NULL,
+                                &free_data, &length,
                                 NULL, &load_error))
         {
           text = free_data;
@@ -1438,6 +1926,15 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
                                      file,
                                      text);
 
+      if (css_provider->priv->recording)
+        {
+          if (free_data)
+            scanner->source = theme_recording_add_source (css_provider->priv->recording,
+                                                          file, free_data, length);
+          else
+            css_provider->priv->recording->failed = TRUE;
+        }
+
       parse_stylesheet (scanner);
 
       gtk_css_scanner_destroy (scanner);
@@ -1449,6 +1946,335 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
   g_free (free_data);
 }
 
+static gboolean
+gtk_css_provider_load_cached_colors (GtkCssProvider *css_provider,
+                                     GVariant       *colors)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  gsize n_sources = g_variant_n_children (priv->cache_sources);
+  GVariantIter iter;
+  const char *name, *text;
+  guint source;
+
+  g_variant_iter_init (&iter, colors);
+  while (g_variant_iter_next (&iter, "(&s&su)", &name, &text, &source))
+    {
+      GtkCssParser *parser;
+      GtkCssValue *color;
+
+      if (source >= n_sources)
+        return FALSE;
+
+      parser = gtk_css_provider_new_cache_parser (css_provider, text, source);
+      color = _gtk_css_color_value_parse (parser);
+      if (color != NULL && !_gtk_css_parser_is_eof (parser))
+        g_clear_pointer (&color, _gtk_css_value_unref);
+      _gtk_css_parser_free (parser);
+
+      if (color == NULL)
+        return FALSE;
+
+      g_hash_table_insert (priv->symbolic_colors, g_strdup (name), color);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_provider_load_cached_keyframes (GtkCssProvider *css_provider,
+                                        GVariant       *keyframes)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  gsize n_sources = g_variant_n_children (priv->cache_sources);
+  GVariantIter iter;
+  const char *name, *text;
+  guint source;
+
+  g_variant_iter_init (&iter, keyframes);
+  while (g_variant_iter_next (&iter, "(&s&su)", &name, &text, &source))
+    {
+      GtkCssParser *parser;
+      GtkCssKeyframes *frames = NULL;
+
+      if (source >= n_sources)
+        return FALSE;
+
+      parser = gtk_css_provider_new_cache_parser (css_provider, text, source);
+      if (_gtk_css_parser_try (parser, "{", TRUE))
+        {
+          frames = _gtk_css_keyframes_parse (parser);
+          if (frames != NULL &&
+              (!_gtk_css_parser_try (parser, "}", TRUE) || !_gtk_css_parser_is_eof (parser)))
+            g_clear_pointer (&frames, _gtk_css_keyframes_unref);
+        }
+      _gtk_css_parser_free (parser);
+
+      if (frames == NULL)
+        return FALSE;
+
+      g_hash_table_insert (priv->keyframes, g_strdup (name), frames);
+    }
+
+  return TRUE;
+}
+
+static GtkBitmask *
+add_property_to_bitmask (GtkBitmask       *bitmask,
+                         GtkStyleProperty *property)
+{
+  if (GTK_IS_CSS_SHORTHAND_PROPERTY (property))
+    {
+      GtkCssShorthandProperty *shorthand = GTK_CSS_SHORTHAND_PROPERTY (property);
+      guint i;
+
+      for (i = 0; i < _gtk_css_shorthand_property_get_n_subproperties (shorthand); i++)
+        {
+          GtkCssStyleProperty *child = _gtk_css_shorthand_property_get_subproperty (shorthand, i);
+
+          bitmask = _gtk_bitmask_set (bitmask, _gtk_css_style_property_get_id (child), TRUE);
+        }
+
+      return bitmask;
+    }
+
+  return _gtk_bitmask_set (bitmask,
+                           _gtk_css_style_property_get_id (GTK_CSS_STYLE_PROPERTY (property)),
+                           TRUE);
+}
+
+static gboolean
+gtk_css_provider_load_cached_rulesets (GtkCssProvider *css_provider,
+                                       GVariant       *rulesets,
+                                       GVariant       *tree)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  gsize n_declarations = g_variant_n_children (priv->cache_declarations);
+  GtkCssSelectorTree ***selector_matches;
+  gpointer *matches;
+  gsize i, j, n_rulesets;
+  gboolean result = FALSE;
+
+  n_rulesets = g_variant_n_children (rulesets);
+  g_array_set_size (priv->rulesets, n_rulesets);
+  matches = g_new (gpointer, n_rulesets);
+  selector_matches = g_new (GtkCssSelectorTree **, n_rulesets);
+
+  for (i = 0; i < n_rulesets; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      GVariant *declarations;
+      gconstpointer data;
+      gsize n;
+
+      memset (ruleset, 0, sizeof (GtkCssRuleset));
+      matches[i] = ruleset;
+      selector_matches[i] = &ruleset->selector_match;
+
+      declarations = g_variant_get_child_value (rulesets, i);
+      data = g_variant_get_fixed_array (declarations, &n, sizeof (guint32));
+      if (n > 0)
+        {
+          ruleset->declarations = g_memdup (data, n * sizeof (guint32));
+          ruleset->n_declarations = n;
+          ruleset->owns_declarations = TRUE;
+          ruleset->parse_declarations = TRUE;
+          ruleset->set_styles = _gtk_bitmask_new ();
+        }
+      g_variant_unref (declarations);
+
+      /* Lookups skip rulesets that set none of the missing
+       * styles, without parsing their values */
+      for (j = 0; j < ruleset->n_declarations; j++)
+        {
+          if (ruleset->declarations[j] >= n_declarations)
+            goto out;
+
+          ruleset->set_styles = add_property_to_bitmask (ruleset->set_styles,
+                                                         priv->cache_properties[ruleset->declarations[j]]);
+        }
+    }
+
+  result = _gtk_css_selector_tree_deserialize (tree, matches, selector_matches, n_rulesets, &priv->tree);
+
+out:
+  g_free (selector_matches);
+  g_free (matches);
+
+  return result;
+}
+
+/* Loads a theme from the contents of its cache file, which are built
+ * by gtk_css_provider_serialize_cache(). On failure, the provider may
+ * be partially loaded and needs to be reset.
+ */
+static gboolean
+gtk_css_provider_load_cached (GtkCssProvider *css_provider,
+                              GVariant       *cache,
+                              GVariant       *sources)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GVariant *colors, *keyframes, *tree, *rulesets;
+  gsize i, n_declarations;
+  gboolean result = FALSE;
+
+  g_variant_get (cache, "(@a(ssu)@a(ssu)@a(ssu)@" GTK_CSS_SELECTOR_TREE_VARIANT_TYPE "@aau@aau)",
+                 &colors, &keyframes, &priv->cache_declarations, &tree, &rulesets,
+                 &priv->cache_locations);
+
+  priv->cache = g_variant_ref (cache);
+  priv->cache_sources = g_variant_ref (sources);
+  n_declarations = g_variant_n_children (priv->cache_declarations);
+  priv->cache_files = g_new0 (GFile *, g_variant_n_children (sources));
+  priv->cache_documents = g_new0 (GtkCssSection *, g_variant_n_children (sources));
+  priv->cache_properties = g_new0 (GtkStyleProperty *, n_declarations);
+  priv->cache_values = g_new0 (GtkCssValue *, n_declarations);
+
+  for (i = 0; i < n_declarations; i++)
+    {
+      GtkStyleProperty *property;
+      const char *name;
+      guint source;
+
+      g_variant_get_child (priv->cache_declarations, i, "(&s&su)", &name, NULL, &source);
+
+      property = _gtk_style_property_lookup (name);
+      if (property == NULL ||
+          !(GTK_IS_CSS_SHORTHAND_PROPERTY (property) || GTK_IS_CSS_STYLE_PROPERTY (property)) ||
+          source >= g_variant_n_children (sources))
+        goto out;
+
+      priv->cache_properties[i] = property;
+    }
+
+  if (g_variant_n_children (priv->cache_locations) != g_variant_n_children (rulesets))
+    goto out;
+
+  result = gtk_css_provider_load_cached_colors (css_provider, colors) &&
+           gtk_css_provider_load_cached_keyframes (css_provider, keyframes) &&
+           gtk_css_provider_load_cached_rulesets (css_provider, rulesets, tree);
+
+out:
+  g_variant_unref (colors);
+  g_variant_unref (keyframes);
+  g_variant_unref (tree);
+  g_variant_unref (rulesets);
+
+  return result;
+}
+
+static GVariant *
+gtk_css_provider_serialize_cache (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  ThemeRecording *recording = priv->recording;
+  GVariantBuilder rulesets, locations;
+  GHashTable *match_indexes;
+  GVariant *result;
+  guint i;
+
+  match_indexes = g_hash_table_new (NULL, NULL);
+  g_variant_builder_init (&rulesets, G_VARIANT_TYPE ("aau"));
+  g_variant_builder_init (&locations, G_VARIANT_TYPE ("aau"));
+
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      g_hash_table_insert (match_indexes, ruleset, GUINT_TO_POINTER (i + 1));
+      g_variant_builder_add_value (&rulesets,
+                                   g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+                                                              ruleset->declarations,
+                                                              ruleset->n_declarations,
+                                                              sizeof (guint32)));
+      g_variant_builder_add_value (&locations,
+                                   g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+                                                              ruleset->locations,
+                                                              4 * ruleset->n_declarations,
+                                                              sizeof (guint32)));
+    }
+
+  result = g_variant_new ("(@a(ssu)@a(ssu)@a(ssu)@" GTK_CSS_SELECTOR_TREE_VARIANT_TYPE "@aau@aau)",
+                          g_variant_builder_end (&recording->colors),
+                          g_variant_builder_end (&recording->keyframes),
+                          g_variant_new_array (G_VARIANT_TYPE ("(ssu)"),
+                                               (GVariant **) recording->declarations->pdata,
+                                               recording->declarations->len),
+                          _gtk_css_selector_tree_serialize (priv->tree, match_indexes),
+                          g_variant_builder_end (&rulesets),
+                          g_variant_builder_end (&locations));
+
+  g_hash_table_unref (match_indexes);
+
+  return result;
+}
+
+/* Loads a theme from @file, using the theme cache if possible.
+ * Loading themes from the cache skips parsing and sorting all selectors
+ * and building the selector tree, and values only get parsed once a
+ * ruleset matches. Themes that fail to parse are not cached.
+ *
+ * The cache also stores where each value is in the theme's files, so
+ * sections can be made for them when they are kept.
+ */
+static void
+gtk_css_provider_load_theme (GtkCssProvider *css_provider,
+                             GFile          *file)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GVariant *cache, *sources = NULL;
+  gboolean use_cache;
+
+  gtk_css_provider_reset (css_provider);
+
+  /* The cache has no selectors to verify the tree with */
+  use_cache = gtk_css_theme_cache_is_enabled () &&
+              !g_atomic_int_get (&priv->cache_broken);
+#ifdef VERIFY_TREE
+  use_cache = FALSE;
+#endif
+
+  if (use_cache)
+    cache = gtk_css_theme_cache_load (file, G_VARIANT_TYPE (GTK_CSS_PROVIDER_CACHE_TYPE), &sources);
+  else
+    cache = NULL;
+
+  if (cache != NULL && gtk_css_provider_load_cached (css_provider, cache, sources))
+    {
+      priv->cache_theme = g_object_ref (file);
+    }
+  else
+    {
+      ThemeRecording recording;
+
+      if (cache != NULL)
+        gtk_css_provider_reset (css_provider);
+
+      if (use_cache)
+        {
+          theme_recording_init (&recording);
+          priv->recording = &recording;
+        }
+
+      gtk_css_provider_load_internal (css_provider, NULL, file, NULL);
+
+      if (use_cache)
+        {
+          if (!recording.failed)
+            gtk_css_theme_cache_save (file,
+                                      g_variant_builder_end (&recording.sources),
+                                      gtk_css_provider_serialize_cache (css_provider));
+
+          priv->recording = NULL;
+          theme_recording_clear (&recording);
+        }
+    }
+
+  g_clear_pointer (&cache, g_variant_unref);
+  g_clear_pointer (&sources, g_variant_unref);
+
+  gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
+}
+
 /**
  * gtk_css_provider_load_from_data:
  * @css_provider: a #GtkCssProvider
@@ -1745,7 +2571,19 @@ _gtk_css_provider_load_named (GtkCssProvider *provider,
 
   if (g_resources_get_info (resource_path, 0, NULL, NULL, NULL))
     {
-      gtk_css_provider_load_from_resource (provider, resource_path);
+      GFile *file;
+      char *uri, *escaped;
+
+      escaped = g_uri_escape_string (resource_path,
+                                     G_URI_RESERVED_CHARS_ALLOWED_IN_PATH, FALSE);
+      uri = g_strconcat ("resource://", escaped, NULL);
+      file = g_file_new_for_uri (uri);
+
+      gtk_css_provider_load_theme (provider, file);
+
+      g_object_unref (file);
+      g_free (uri);
+      g_free (escaped);
       g_free (resource_path);
       return;
     }
@@ -1757,6 +2595,7 @@ _gtk_css_provider_load_named (GtkCssProvider *provider,
     {
       char *dir, *resource_file;
       GResource *resource;
+      GFile *file;
 
       dir = g_path_get_dirname (path);
       resource_file = g_build_filename (dir, "gtk.gresource", NULL);
@@ -1766,9 +2605,11 @@ _gtk_css_provider_load_named (GtkCssProvider *provider,
       if (resource != NULL)
         g_resources_register (resource);
 
-      gtk_css_provider_load_from_path (provider, path);
+      file = g_file_new_for_path (path);
+      gtk_css_provider_load_theme (provider, file);
+      g_object_unref (file);
 
-      /* Only set this after load, as load_from_path will clear it */
+      /* Only set this after load, as load_theme will clear it */
       provider->priv->resource = resource;
       provider->priv->path = dir;
 
@@ -1965,9 +2806,13 @@ gtk_css_provider_to_string (GtkCssProvider *provider)
 
   for (i = 0; i < priv->rulesets->len; i++)
     {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      gtk_css_ruleset_ensure_styles (ruleset, provider);
+
       if (str->len != 0)
         g_string_append (str, "\n");
-      gtk_css_ruleset_print (&g_array_index (priv->rulesets, GtkCssRuleset, i), str);
+      gtk_css_ruleset_print (ruleset, str);
     }
 
   return g_string_free (str, FALSE);
@@ -50,6 +50,19 @@ gtk_css_value_rgba_equal (const GtkCssValue *rgba1,
   return gdk_rgba_equal (&rgba1->rgba, &rgba2->rgba);
 }
 
+static guint
+gtk_css_value_rgba_hash (const GtkCssValue *rgba)
+{
+  guint hash;
+
+  hash = gtk_css_double_hash (rgba->rgba.red);
+  hash = hash * 31 + gtk_css_double_hash (rgba->rgba.green);
+  hash = hash * 31 + gtk_css_double_hash (rgba->rgba.blue);
+  hash = hash * 31 + gtk_css_double_hash (rgba->rgba.alpha);
+
+  return hash;
+}
+
 static inline double
 transition (double start,
             double end,
@@ -102,7 +115,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_RGBA = {
   gtk_css_value_rgba_compute,
   gtk_css_value_rgba_equal,
   gtk_css_value_rgba_transition,
-  gtk_css_value_rgba_print
+  gtk_css_value_rgba_print,
+  gtk_css_value_rgba_hash
 };
 
 GtkCssValue *
@@ -115,7 +129,7 @@ _gtk_css_rgba_value_new_from_rgba (const GdkRGBA *rgba)
   value = _gtk_css_value_new (GtkCssValue, &GTK_CSS_VALUE_RGBA);
   value->rgba = *rgba;
 
-  return value;
+  return _gtk_css_value_intern (value);
 }
 
 const GdkRGBA *
@@ -79,6 +79,34 @@ _gtk_css_section_new_for_file (GtkCssSectionType  type,
   return section;
 }
 
+GtkCssSection *
+_gtk_css_section_new_for_location (GtkCssSection     *parent,
+                                   GtkCssSectionType  type,
+                                   GFile             *file,
+                                   guint              start_line,
+                                   guint              start_position,
+                                   guint              end_line,
+                                   guint              end_position)
+{
+  GtkCssSection *section;
+
+  gtk_internal_return_val_if_fail (G_IS_FILE (file), NULL);
+
+  section = g_slice_new0 (GtkCssSection);
+
+  section->ref_count = 1;
+  section->section_type = type;
+  if (parent)
+    section->parent = gtk_css_section_ref (parent);
+  section->file = g_object_ref (file);
+  section->start_line = start_line;
+  section->start_position = start_position;
+  section->end_line = end_line;
+  section->end_position = end_position;
+
+  return section;
+}
+
 void
 _gtk_css_section_end (GtkCssSection *section)
 {
@@ -29,6 +29,13 @@ GtkCssSection *    _gtk_css_section_new                (GtkCssSection        *pa
                                                         GtkCssParser         *parser);
 GtkCssSection *    _gtk_css_section_new_for_file       (GtkCssSectionType     type,
                                                         GFile                *file);
+GtkCssSection *    _gtk_css_section_new_for_location   (GtkCssSection        *parent,
+                                                        GtkCssSectionType     type,
+                                                        GFile                *file,
+                                                        guint                 start_line,
+                                                        guint                 start_position,
+                                                        guint                 end_line,
+                                                        guint                 end_position);
 
 void               _gtk_css_section_end                (GtkCssSection        *section);
 
@@ -22,6 +22,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "gtkcssancestorfilterprivate.h"
+#include "gtkcssnodedeclarationprivate.h"
 #include "gtkcssprovider.h"
 #include "gtkstylecontextprivate.h"
 
@@ -107,6 +109,8 @@ struct _GtkCssSelectorTree
   gint32 previous_offset;
   gint32 sibling_offset;
   gint32 matches_offset; /* pointers that we return as matches if selector matches */
+  guint64 fingerprint; /* bits a node needs to have in its fingerprint to match the selector */
+  guint64 previous_fingerprint; /* a node needs one of these bits to match a previous selector, or 0 */
 };
 
 static gboolean
@@ -1476,6 +1480,104 @@ gtk_css_selectors_skip_initial_selector (GtkCssSelector *selector, const GtkCssS
   return (GtkCssSelector *)gtk_css_selector_previous (selector);
 }
 
+typedef struct {
+  GPtrArray                  *array;
+  const GtkCssAncestorFilter *filter;
+} GtkCssSelectorTreeMatchData;
+
+/* Checks if @selector can match an ancestor of a node whose ancestors
+ * are all in @filter. Only names, ids and classes are in the filter,
+ * any other selector may match.
+ */
+static gboolean
+gtk_css_selector_may_match_ancestor (const GtkCssSelector       *selector,
+                                     const GtkCssAncestorFilter *filter)
+{
+  if (selector->class == &GTK_CSS_SELECTOR_NAME)
+    return gtk_css_ancestor_filter_may_have_name (filter, selector->name.name);
+  else if (selector->class == &GTK_CSS_SELECTOR_CLASS)
+    return gtk_css_ancestor_filter_may_have_class (filter, selector->style_class.style_class);
+  else if (selector->class == &GTK_CSS_SELECTOR_ID)
+    return gtk_css_ancestor_filter_may_have_id (filter, selector->id.name);
+  else
+    return TRUE;
+}
+
+/* Nodes that are missing any of the bits in @tree's fingerprint do not
+ * match @tree's selector. Only combinators change the node to match, so
+ * a combinator's fingerprint is always 0.
+ */
+static inline gboolean
+gtk_css_selector_tree_may_match (const GtkCssSelectorTree *tree,
+                                 guint64                   fingerprint)
+{
+  return (tree->fingerprint & ~fingerprint) == 0;
+}
+
+static gboolean gtk_css_selector_tree_match_foreach (const GtkCssSelector *selector,
+                                                     const GtkCssMatcher  *matcher,
+                                                     gpointer              res);
+
+#define GTK_CSS_SELECTOR_TREE_MAX_CANDIDATES 32
+
+/* Matches the selectors following the descendant combinator @tree
+ * against the ancestors of @matcher, skipping the ones the ancestor
+ * filter rules out. Every matcher reached from the node being styled
+ * only has ancestors that are ancestors of that node, so the filter
+ * applies to all of them.
+ *
+ * Returns %FALSE if the tree is not suited for this, so the caller
+ * has to walk the ancestors for all selectors.
+ */
+static gboolean
+gtk_css_selector_tree_match_descendants (const GtkCssSelectorTree    *tree,
+                                         const GtkCssMatcher         *matcher,
+                                         GtkCssSelectorTreeMatchData *data)
+{
+  const GtkCssSelectorTree *candidates[GTK_CSS_SELECTOR_TREE_MAX_CANDIDATES];
+  const GtkCssSelectorTree *prev;
+  GtkCssMatcher ancestor;
+  guint64 fingerprint;
+  guint i, n_candidates;
+
+  if (gtk_css_selector_tree_get_matches (tree) != NULL)
+    return FALSE;
+
+  n_candidates = 0;
+  for (prev = gtk_css_selector_tree_get_previous (tree);
+       prev != NULL;
+       prev = gtk_css_selector_tree_get_sibling (prev))
+    {
+      if (!gtk_css_selector_may_match_ancestor (&prev->selector, data->filter))
+        continue;
+
+      if (n_candidates == GTK_CSS_SELECTOR_TREE_MAX_CANDIDATES)
+        return FALSE;
+
+      candidates[n_candidates++] = prev;
+    }
+
+  if (n_candidates == 0)
+    return TRUE;
+
+  while (_gtk_css_matcher_get_parent (&ancestor, matcher))
+    {
+      matcher = &ancestor;
+      fingerprint = _gtk_css_matcher_get_fingerprint (matcher);
+
+      for (i = 0; i < n_candidates; i++)
+        {
+          if (gtk_css_selector_tree_may_match (candidates[i], fingerprint))
+            gtk_css_selector_foreach (&candidates[i]->selector, &ancestor, gtk_css_selector_tree_match_foreach, data);
+        }
+
+      if (_gtk_css_matcher_matches_any (matcher))
+        break;
+    }
+
+  return TRUE;
+}
+
 static gboolean
 gtk_css_selector_tree_match_foreach (const GtkCssSelector *selector,
                                      const GtkCssMatcher  *matcher,
@@ -1483,16 +1585,38 @@ gtk_css_selector_tree_match_foreach (const GtkCssSelector *selector,
 {
   const GtkCssSelectorTree *tree = (const GtkCssSelectorTree *) selector;
   const GtkCssSelectorTree *prev;
+  GtkCssSelectorTreeMatchData *data = res;
+  guint64 fingerprint;
 
   if (!gtk_css_selector_match (selector, matcher))
     return FALSE;
 
-  gtk_css_selector_tree_found_match (tree, res);
+  gtk_css_selector_tree_found_match (tree, &data->array);
 
-  for (prev = gtk_css_selector_tree_get_previous (tree);
-       prev != NULL;
+  prev = gtk_css_selector_tree_get_previous (tree);
+  if (prev == NULL)
+    return FALSE;
+
+  fingerprint = _gtk_css_matcher_get_fingerprint (matcher);
+
+  /* Skip all previous selectors at once if none of them can match */
+  if (tree->previous_fingerprint != 0 &&
+      (tree->previous_fingerprint & fingerprint) == 0)
+    return FALSE;
+
+  for (; prev != NULL;
        prev = gtk_css_selector_tree_get_sibling (prev))
-    gtk_css_selector_foreach (&prev->selector, matcher, gtk_css_selector_tree_match_foreach, res);
+    {
+      if (!gtk_css_selector_tree_may_match (prev, fingerprint))
+        continue;
+
+      if (data->filter &&
+          prev->selector.class == &GTK_CSS_SELECTOR_DESCENDANT &&
+          gtk_css_selector_tree_match_descendants (prev, matcher, data))
+        continue;
+
+      gtk_css_selector_foreach (&prev->selector, matcher, gtk_css_selector_tree_match_foreach, data);
+    }
 
   return FALSE;
 }
@@ -1501,13 +1625,21 @@ GPtrArray *
 _gtk_css_selector_tree_match_all (const GtkCssSelectorTree *tree,
 				  const GtkCssMatcher *matcher)
 {
-  GPtrArray *array = NULL;
+  GtkCssSelectorTreeMatchData data;
+  guint64 fingerprint;
+
+  data.array = NULL;
+  data.filter = _gtk_css_matcher_get_ancestor_filter (matcher);
+  fingerprint = _gtk_css_matcher_get_fingerprint (matcher);
 
   for (; tree != NULL;
        tree = gtk_css_selector_tree_get_sibling (tree))
-    gtk_css_selector_foreach (&tree->selector, matcher, gtk_css_selector_tree_match_foreach, &array);
+    {
+      if (gtk_css_selector_tree_may_match (tree, fingerprint))
+        gtk_css_selector_foreach (&tree->selector, matcher, gtk_css_selector_tree_match_foreach, &data);
+    }
 
-  return array;
+  return data.array;
 }
 
 /* When checking for changes via the tree we need to know if a rule further
@@ -1539,12 +1671,14 @@ gtk_css_selector_tree_collect_change (const GtkCssSelectorTree *tree)
 
 static GtkCssChange
 gtk_css_selector_tree_get_change (const GtkCssSelectorTree *tree,
-				  const GtkCssMatcher      *matcher)
+				  const GtkCssMatcher      *matcher,
+                                  guint64                   fingerprint)
 {
   GtkCssChange change = 0;
   const GtkCssSelectorTree *prev;
 
-  if (!gtk_css_selector_match (&tree->selector, matcher))
+  if (!gtk_css_selector_tree_may_match (tree, fingerprint) ||
+      !gtk_css_selector_match (&tree->selector, matcher))
     return 0;
 
   if (!tree->selector.class->is_simple)
@@ -1553,7 +1687,7 @@ gtk_css_selector_tree_get_change (const GtkCssSelectorTree *tree,
   for (prev = gtk_css_selector_tree_get_previous (tree);
        prev != NULL;
        prev = gtk_css_selector_tree_get_sibling (prev))
-    change |= gtk_css_selector_tree_get_change (prev, matcher);
+    change |= gtk_css_selector_tree_get_change (prev, matcher, fingerprint);
 
   if (change || gtk_css_selector_tree_get_matches (tree))
     change = tree->selector.class->get_change (&tree->selector, change & ~GTK_CSS_CHANGE_GOT_MATCH) | GTK_CSS_CHANGE_GOT_MATCH;
@@ -1566,13 +1700,15 @@ _gtk_css_selector_tree_get_change_all (const GtkCssSelectorTree *tree,
 				       const GtkCssMatcher *matcher)
 {
   GtkCssChange change;
+  guint64 fingerprint;
 
   change = 0;
+  fingerprint = _gtk_css_matcher_get_fingerprint (matcher);
 
   /* no need to foreach here because we abort for non-simple selectors */
   for (; tree != NULL;
        tree = gtk_css_selector_tree_get_sibling (tree))
-    change |= gtk_css_selector_tree_get_change (tree, matcher);
+    change |= gtk_css_selector_tree_get_change (tree, matcher, fingerprint);
 
   /* Never return reserved bit set */
   return change & ~GTK_CSS_CHANGE_RESERVED_BIT;
@@ -1861,6 +1997,52 @@ fixup_offsets (GtkCssSelectorTree *tree, guint8 *data)
     }
 }
 
+static guint64
+gtk_css_selector_get_fingerprint (const GtkCssSelector *selector)
+{
+  if (selector->class == &GTK_CSS_SELECTOR_NAME)
+    return gtk_css_fingerprint_for_name (selector->name.name);
+  else if (selector->class == &GTK_CSS_SELECTOR_CLASS)
+    return gtk_css_fingerprint_for_class (selector->style_class.style_class);
+  else if (selector->class == &GTK_CSS_SELECTOR_ID)
+    return gtk_css_fingerprint_for_id (selector->id.name);
+  else
+    return 0;
+}
+
+/* Fingerprints depend on the values of quarks and interned strings, so
+ * they are computed whenever a tree is built or deserialized */
+static void
+update_fingerprints (GtkCssSelectorTree *tree)
+{
+  while (tree != NULL)
+    {
+      GtkCssSelectorTree *prev;
+      guint64 previous_fingerprint = 0;
+
+      tree->fingerprint = gtk_css_selector_get_fingerprint (&tree->selector);
+
+      prev = (GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree);
+      update_fingerprints (prev);
+
+      for (; prev != NULL;
+           prev = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (prev))
+        {
+          if (prev->fingerprint == 0)
+            {
+              previous_fingerprint = 0;
+              break;
+            }
+
+          previous_fingerprint |= prev->fingerprint;
+        }
+
+      tree->previous_fingerprint = previous_fingerprint;
+
+      tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree);
+    }
+}
+
 GtkCssSelectorTree *
 _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 {
@@ -1883,6 +2065,7 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
   tree = (GtkCssSelectorTree *)data;
 
   fixup_offsets (tree, data);
+  update_fingerprints (tree);
 
   /* Convert offsets to final pointers */
   for (l = builder->infos; l != NULL; l = l->next)
@@ -1903,3 +2086,379 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 
   return tree;
 }
+
+/* SERIALIZATION */
+
+/* Trees are serialized as a copy of their memory, with the pointers
+ * replaced by indexes: selector classes index into this table, names
+ * and style classes into a table of strings that is serialized along
+ * with the tree, and matches into the caller's table of matches.
+ */
+static const GtkCssSelectorClass *selector_classes[] = {
+  &GTK_CSS_SELECTOR_DESCENDANT,
+  &GTK_CSS_SELECTOR_CHILD,
+  &GTK_CSS_SELECTOR_SIBLING,
+  &GTK_CSS_SELECTOR_ADJACENT,
+  &GTK_CSS_SELECTOR_ANY,
+  &GTK_CSS_SELECTOR_NOT_ANY,
+  &GTK_CSS_SELECTOR_NAME,
+  &GTK_CSS_SELECTOR_NOT_NAME,
+  &GTK_CSS_SELECTOR_CLASS,
+  &GTK_CSS_SELECTOR_NOT_CLASS,
+  &GTK_CSS_SELECTOR_ID,
+  &GTK_CSS_SELECTOR_NOT_ID,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_POSITION
+};
+
+typedef enum {
+  SELECTOR_DATA_NONE,
+  SELECTOR_DATA_NAME,
+  SELECTOR_DATA_ID,
+  SELECTOR_DATA_STYLE_CLASS
+} SelectorDataType;
+
+static SelectorDataType
+gtk_css_selector_get_data_type (const GtkCssSelectorClass *klass)
+{
+  if (klass == &GTK_CSS_SELECTOR_NAME || klass == &GTK_CSS_SELECTOR_NOT_NAME)
+    return SELECTOR_DATA_NAME;
+  else if (klass == &GTK_CSS_SELECTOR_ID || klass == &GTK_CSS_SELECTOR_NOT_ID)
+    return SELECTOR_DATA_ID;
+  else if (klass == &GTK_CSS_SELECTOR_CLASS || klass == &GTK_CSS_SELECTOR_NOT_CLASS)
+    return SELECTOR_DATA_STYLE_CLASS;
+  else
+    return SELECTOR_DATA_NONE;
+}
+
+static guint
+gtk_css_selector_get_class_index (const GtkCssSelectorClass *klass)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (selector_classes); i++)
+    {
+      if (selector_classes[i] == klass)
+        return i;
+    }
+
+  g_assert_not_reached ();
+  return 0;
+}
+
+static gsize
+gtk_css_selector_tree_get_size (const GtkCssSelectorTree *tree,
+                                const guint8             *data)
+{
+  gsize size = 0;
+
+  while (tree != NULL)
+    {
+      gpointer *matches;
+
+      size = MAX (size, (const guint8 *) tree - data + sizeof (GtkCssSelectorTree));
+
+      matches = gtk_css_selector_tree_get_matches (tree);
+      if (matches)
+        {
+          while (*matches)
+            matches++;
+          size = MAX (size, (const guint8 *) (matches + 1) - data);
+        }
+
+      size = MAX (size, gtk_css_selector_tree_get_size (gtk_css_selector_tree_get_previous (tree), data));
+
+      tree = gtk_css_selector_tree_get_sibling (tree);
+    }
+
+  return size;
+}
+
+static guint
+add_string (GPtrArray  *strings,
+            GHashTable *string_indexes,
+            const char *string)
+{
+  gpointer index;
+
+  if (g_hash_table_lookup_extended (string_indexes, string, NULL, &index))
+    return GPOINTER_TO_UINT (index);
+
+  g_hash_table_insert (string_indexes, (gpointer) string, GUINT_TO_POINTER (strings->len));
+  g_ptr_array_add (strings, (gpointer) string);
+
+  return strings->len - 1;
+}
+
+static void
+serialize_tree (GtkCssSelectorTree *tree,
+                GPtrArray          *strings,
+                GHashTable         *string_indexes,
+                GHashTable         *match_indexes)
+{
+  while (tree != NULL)
+    {
+      GtkCssSelector *selector = &tree->selector;
+      gpointer *matches;
+
+      switch (gtk_css_selector_get_data_type (selector->class))
+        {
+        case SELECTOR_DATA_NAME:
+          selector->name.name = GUINT_TO_POINTER (add_string (strings, string_indexes, selector->name.name));
+          break;
+        case SELECTOR_DATA_ID:
+          selector->id.name = GUINT_TO_POINTER (add_string (strings, string_indexes, selector->id.name));
+          break;
+        case SELECTOR_DATA_STYLE_CLASS:
+          selector->style_class.style_class = add_string (strings, string_indexes,
+                                                          g_quark_to_string (selector->style_class.style_class));
+          break;
+        case SELECTOR_DATA_NONE:
+        default:
+          break;
+        }
+      selector->class = GUINT_TO_POINTER (gtk_css_selector_get_class_index (selector->class));
+
+      matches = gtk_css_selector_tree_get_matches (tree);
+      if (matches)
+        {
+          for (; *matches; matches++)
+            *matches = g_hash_table_lookup (match_indexes, *matches);
+        }
+
+      serialize_tree ((GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree),
+                      strings, string_indexes, match_indexes);
+
+      tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree);
+    }
+}
+
+/*< private >
+ * _gtk_css_selector_tree_serialize:
+ * @tree: (nullable): the tree to serialize
+ * @match_indexes: a hash table mapping all matches of @tree to their
+ *     index plus one
+ *
+ * Serializes @tree, for loading it again with
+ * _gtk_css_selector_tree_deserialize() in the same build of GTK.
+ *
+ * Returns: (transfer floating): a #GVariant of type
+ *     %GTK_CSS_SELECTOR_TREE_VARIANT_TYPE
+ */
+GVariant *
+_gtk_css_selector_tree_serialize (const GtkCssSelectorTree *tree,
+                                  GHashTable               *match_indexes)
+{
+  GPtrArray *strings;
+  GHashTable *string_indexes;
+  GVariant *result;
+  guint8 *data;
+  gsize size;
+
+  strings = g_ptr_array_new ();
+  string_indexes = g_hash_table_new (g_str_hash, g_str_equal);
+
+  if (tree)
+    {
+      size = gtk_css_selector_tree_get_size (tree, (const guint8 *) tree);
+      data = g_memdup (tree, size);
+      serialize_tree ((GtkCssSelectorTree *) data, strings, string_indexes, match_indexes);
+    }
+  else
+    {
+      size = 0;
+      data = NULL;
+    }
+
+  g_ptr_array_add (strings, NULL);
+  result = g_variant_new ("(^as@ay)",
+                          (const char * const *) strings->pdata,
+                          g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, data, size, 1));
+
+  g_free (data);
+  g_hash_table_unref (string_indexes);
+  g_ptr_array_unref (strings);
+
+  return result;
+}
+
+typedef struct {
+  guint8 *data;
+  gsize size;
+  const char **strings;
+  gsize n_strings;
+  gpointer *matches;
+  GtkCssSelectorTree ***selector_matches;
+  guint n_matches;
+} DeserializeData;
+
+static gboolean
+deserialize_offset_is_valid (DeserializeData *d,
+                             const guint8    *from,
+                             gint32           offset,
+                             gsize            size)
+{
+  gssize pos;
+
+  pos = from - d->data + offset;
+
+  return pos >= 0 &&
+         pos % sizeof (gpointer) == 0 &&
+         (gsize) pos + size <= d->size;
+}
+
+static gboolean
+deserialize_tree (DeserializeData    *d,
+                  GtkCssSelectorTree *tree,
+                  GtkCssSelectorTree *parent)
+{
+  while (tree != NULL)
+    {
+      GtkCssSelector *selector = &tree->selector;
+      guint index;
+
+      if ((parent == NULL && tree->parent_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET) ||
+          (parent != NULL && (guint8 *) tree + tree->parent_offset != (guint8 *) parent))
+        return FALSE;
+
+      index = GPOINTER_TO_UINT (selector->class);
+      if (index >= G_N_ELEMENTS (selector_classes))
+        return FALSE;
+      selector->class = selector_classes[index];
+
+      switch (gtk_css_selector_get_data_type (selector->class))
+        {
+        case SELECTOR_DATA_NAME:
+          index = GPOINTER_TO_UINT (selector->name.name);
+          if (index >= d->n_strings)
+            return FALSE;
+          selector->name.name = g_intern_string (d->strings[index]);
+          break;
+        case SELECTOR_DATA_ID:
+          index = GPOINTER_TO_UINT (selector->id.name);
+          if (index >= d->n_strings)
+            return FALSE;
+          selector->id.name = g_intern_string (d->strings[index]);
+          break;
+        case SELECTOR_DATA_STYLE_CLASS:
+          index = selector->style_class.style_class;
+          if (index >= d->n_strings)
+            return FALSE;
+          selector->style_class.style_class = g_quark_from_string (d->strings[index]);
+          break;
+        case SELECTOR_DATA_NONE:
+        default:
+          break;
+        }
+
+      if (tree->matches_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          gpointer *matches;
+
+          if (tree->matches_offset <= 0)
+            return FALSE;
+
+          for (matches = (gpointer *) ((guint8 *) tree + tree->matches_offset); ; matches++)
+            {
+              if (!deserialize_offset_is_valid (d, (guint8 *) matches, 0, sizeof (gpointer)))
+                return FALSE;
+              if (*matches == NULL)
+                break;
+
+              index = GPOINTER_TO_UINT (*matches) - 1;
+              if (index >= d->n_matches)
+                return FALSE;
+              *matches = d->matches[index];
+              if (d->selector_matches && d->selector_matches[index])
+                *d->selector_matches[index] = tree;
+            }
+        }
+
+      /* Children and siblings always come after a node, which makes sure
+       * we can't run into loops */
+      if (tree->previous_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          if (tree->previous_offset <= 0 ||
+              !deserialize_offset_is_valid (d, (guint8 *) tree, tree->previous_offset, sizeof (GtkCssSelectorTree)) ||
+              !deserialize_tree (d, (GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree), tree))
+            return FALSE;
+        }
+
+      if (tree->sibling_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          if (tree->sibling_offset <= 0 ||
+              !deserialize_offset_is_valid (d, (guint8 *) tree, tree->sibling_offset, sizeof (GtkCssSelectorTree)))
+            return FALSE;
+        }
+
+      tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree);
+    }
+
+  return TRUE;
+}
+
+/*< private >
+ * _gtk_css_selector_tree_deserialize:
+ * @variant: a #GVariant created by _gtk_css_selector_tree_serialize()
+ * @matches: (array length=n_matches): the matches, in the order of
+ *     their indexes
+ * @selector_matches: (array length=n_matches) (nullable): locations to
+ *     store the node matching each match in, like the ones passed to
+ *     _gtk_css_selector_tree_builder_add()
+ * @n_matches: the number of matches
+ * @tree: (out): return location for the tree
+ *
+ * Recreates a tree serialized with _gtk_css_selector_tree_serialize().
+ *
+ * Returns: %FALSE if @variant does not contain a valid tree
+ */
+gboolean
+_gtk_css_selector_tree_deserialize (GVariant             *variant,
+                                    gpointer             *matches,
+                                    GtkCssSelectorTree ***selector_matches,
+                                    guint                 n_matches,
+                                    GtkCssSelectorTree  **tree)
+{
+  DeserializeData d;
+  GVariant *strings, *bytes;
+  gconstpointer data;
+  gboolean result;
+
+  g_return_val_if_fail (g_variant_is_of_type (variant, G_VARIANT_TYPE (GTK_CSS_SELECTOR_TREE_VARIANT_TYPE)), FALSE);
+
+  strings = g_variant_get_child_value (variant, 0);
+  bytes = g_variant_get_child_value (variant, 1);
+
+  d.strings = g_variant_get_strv (strings, &d.n_strings);
+  data = g_variant_get_fixed_array (bytes, &d.size, 1);
+  d.data = g_memdup (data, d.size);
+  d.matches = matches;
+  d.selector_matches = selector_matches;
+  d.n_matches = n_matches;
+
+  if (d.size == 0)
+    result = TRUE;
+  else if (d.size < sizeof (GtkCssSelectorTree))
+    result = FALSE;
+  else
+    result = deserialize_tree (&d, (GtkCssSelectorTree *) d.data, NULL);
+
+  if (result)
+    {
+      *tree = (GtkCssSelectorTree *) d.data;
+      update_fingerprints (*tree);
+    }
+  else
+    {
+      *tree = NULL;
+      g_free (d.data);
+    }
+
+  g_free (d.strings);
+  g_variant_unref (strings);
+  g_variant_unref (bytes);
+
+  return result;
+}
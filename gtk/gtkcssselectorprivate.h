@@ -48,6 +48,16 @@ GtkCssChange _gtk_css_selector_tree_get_change_all   (const GtkCssSelectorTree *
 void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *tree,
 						      GString                  *str);
 
+#define GTK_CSS_SELECTOR_TREE_VARIANT_TYPE "(asay)"
+
+GVariant *   _gtk_css_selector_tree_serialize        (const GtkCssSelectorTree *tree,
+                                                      GHashTable               *match_indexes);
+gboolean     _gtk_css_selector_tree_deserialize      (GVariant                 *variant,
+                                                      gpointer                 *matches,
+                                                      GtkCssSelectorTree     ***selector_matches,
+                                                      guint                     n_matches,
+                                                      GtkCssSelectorTree      **tree);
+
 
 GtkCssSelectorTreeBuilder *_gtk_css_selector_tree_builder_new   (void);
 void                       _gtk_css_selector_tree_builder_add   (GtkCssSelectorTreeBuilder *builder,
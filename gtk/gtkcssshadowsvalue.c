@@ -57,40 +57,29 @@ gtk_css_value_shadows_compute (GtkCssValue      *value,
                                GtkCssStyle      *style,
                                GtkCssStyle      *parent_style)
 {
-  GtkCssValue *result, *tmp;
-  guint i, j;
+  GtkCssValue **values;
+  gboolean changed;
+  guint i;
 
   if (value->len == 0)
     return _gtk_css_value_ref (value);
 
-  result = NULL;
+  /* Computed values get interned, so they are collected first */
+  values = g_newa (GtkCssValue *, value->len);
+  changed = FALSE;
   for (i = 0; i < value->len; i++)
     {
-      tmp = _gtk_css_value_compute (value->values[i], property_id, provider, style, parent_style);
-
-      if (result)
-        {
-          result->values[i] = tmp;
-        }
-      else if (tmp != value->values[i])
-        {
-          result = gtk_css_shadows_value_new (value->values, value->len);
-          for (j = 0; j < i; j++)
-            {
-              _gtk_css_value_ref (result->values[j]);
-            }
-          result->values[i] = tmp;
-        }
-      else
-        {
-          _gtk_css_value_unref (tmp);
-        }
+      values[i] = _gtk_css_value_compute (value->values[i], property_id, provider, style, parent_style);
+      changed |= values[i] != value->values[i];
     }
 
-  if (result != NULL)
-    return result;
-  else
-    return _gtk_css_value_ref (value);
+  if (changed)
+    return gtk_css_shadows_value_new (values, value->len);
+
+  for (i = 0; i < value->len; i++)
+    _gtk_css_value_unref (values[i]);
+
+  return _gtk_css_value_ref (value);
 }
 
 static gboolean
@@ -113,6 +102,18 @@ gtk_css_value_shadows_equal (const GtkCssValue *value1,
   return TRUE;
 }
 
+static guint
+gtk_css_value_shadows_hash (const GtkCssValue *value)
+{
+  guint i, hash;
+
+  hash = value->len;
+  for (i = 0; i < value->len; i++)
+    hash = hash * 31 + _gtk_css_value_hash (value->values[i]);
+
+  return hash;
+}
+
 static GtkCssValue *
 gtk_css_value_shadows_transition (GtkCssValue *start,
                                   GtkCssValue *end,
@@ -204,7 +205,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_SHADOWS = {
   gtk_css_value_shadows_compute,
   gtk_css_value_shadows_equal,
   gtk_css_value_shadows_transition,
-  gtk_css_value_shadows_print
+  gtk_css_value_shadows_print,
+  gtk_css_value_shadows_hash
 };
 
 static GtkCssValue none_singleton = { &GTK_CSS_VALUE_SHADOWS, 1, 0, { NULL } };
@@ -228,7 +230,7 @@ gtk_css_shadows_value_new (GtkCssValue **values,
   result->len = len;
   memcpy (&result->values[0], values, sizeof (GtkCssValue *) * len);
             
-  return result;
+  return _gtk_css_value_intern (result);
 }
 
 GtkCssValue *
@@ -27,6 +27,7 @@
 #include "gtkcssinheritvalueprivate.h"
 #include "gtkcssinitialvalueprivate.h"
 #include "gtkcssnumbervalueprivate.h"
+#include "gtkcssprofilerprivate.h"
 #include "gtkcsssectionprivate.h"
 #include "gtkcssshorthandpropertyprivate.h"
 #include "gtkcssstringvalueprivate.h"
@@ -39,6 +40,298 @@
 #include "gtkstylepropertyprivate.h"
 #include "gtkstyleproviderprivate.h"
 
+#include <string.h>
+
+/* A group of computed values. Groups are immutable once they are
+ * shared, which happens when the style computing them is done.
+ * Shared groups are hash-consed, so styles with the same values
+ * for all properties of a group share a single copy.
+ */
+struct _GtkCssValues {
+  guint ref_count;
+  guint shared : 1;
+  GtkCssPropertyGroup group;
+  GtkCssValue *values[1];
+};
+
+#define PROPERTY_GROUP(group, ...) \
+  static const guint16 group ## _properties[] = { __VA_ARGS__ }
+
+PROPERTY_GROUP (core,
+                GTK_CSS_PROPERTY_COLOR,
+                GTK_CSS_PROPERTY_DPI,
+                GTK_CSS_PROPERTY_FONT_SIZE,
+                GTK_CSS_PROPERTY_ICON_THEME,
+                GTK_CSS_PROPERTY_ICON_PALETTE);
+PROPERTY_GROUP (background,
+                GTK_CSS_PROPERTY_BACKGROUND_COLOR,
+                GTK_CSS_PROPERTY_BOX_SHADOW,
+                GTK_CSS_PROPERTY_BACKGROUND_CLIP,
+                GTK_CSS_PROPERTY_BACKGROUND_ORIGIN,
+                GTK_CSS_PROPERTY_BACKGROUND_SIZE,
+                GTK_CSS_PROPERTY_BACKGROUND_POSITION,
+                GTK_CSS_PROPERTY_BACKGROUND_REPEAT,
+                GTK_CSS_PROPERTY_BACKGROUND_IMAGE,
+                GTK_CSS_PROPERTY_BACKGROUND_BLEND_MODE);
+PROPERTY_GROUP (border,
+                GTK_CSS_PROPERTY_BORDER_TOP_STYLE,
+                GTK_CSS_PROPERTY_BORDER_TOP_WIDTH,
+                GTK_CSS_PROPERTY_BORDER_LEFT_STYLE,
+                GTK_CSS_PROPERTY_BORDER_LEFT_WIDTH,
+                GTK_CSS_PROPERTY_BORDER_BOTTOM_STYLE,
+                GTK_CSS_PROPERTY_BORDER_BOTTOM_WIDTH,
+                GTK_CSS_PROPERTY_BORDER_RIGHT_STYLE,
+                GTK_CSS_PROPERTY_BORDER_RIGHT_WIDTH,
+                GTK_CSS_PROPERTY_BORDER_TOP_LEFT_RADIUS,
+                GTK_CSS_PROPERTY_BORDER_TOP_RIGHT_RADIUS,
+                GTK_CSS_PROPERTY_BORDER_BOTTOM_RIGHT_RADIUS,
+                GTK_CSS_PROPERTY_BORDER_BOTTOM_LEFT_RADIUS,
+                GTK_CSS_PROPERTY_BORDER_TOP_COLOR,
+                GTK_CSS_PROPERTY_BORDER_RIGHT_COLOR,
+                GTK_CSS_PROPERTY_BORDER_BOTTOM_COLOR,
+                GTK_CSS_PROPERTY_BORDER_LEFT_COLOR,
+                GTK_CSS_PROPERTY_BORDER_IMAGE_SOURCE,
+                GTK_CSS_PROPERTY_BORDER_IMAGE_REPEAT,
+                GTK_CSS_PROPERTY_BORDER_IMAGE_SLICE,
+                GTK_CSS_PROPERTY_BORDER_IMAGE_WIDTH);
+PROPERTY_GROUP (outline,
+                GTK_CSS_PROPERTY_OUTLINE_STYLE,
+                GTK_CSS_PROPERTY_OUTLINE_WIDTH,
+                GTK_CSS_PROPERTY_OUTLINE_OFFSET,
+                GTK_CSS_PROPERTY_OUTLINE_TOP_LEFT_RADIUS,
+                GTK_CSS_PROPERTY_OUTLINE_TOP_RIGHT_RADIUS,
+                GTK_CSS_PROPERTY_OUTLINE_BOTTOM_RIGHT_RADIUS,
+                GTK_CSS_PROPERTY_OUTLINE_BOTTOM_LEFT_RADIUS,
+                GTK_CSS_PROPERTY_OUTLINE_COLOR);
+PROPERTY_GROUP (font,
+                GTK_CSS_PROPERTY_FONT_FAMILY,
+                GTK_CSS_PROPERTY_FONT_STYLE,
+                GTK_CSS_PROPERTY_FONT_WEIGHT,
+                GTK_CSS_PROPERTY_FONT_STRETCH,
+                GTK_CSS_PROPERTY_LETTER_SPACING,
+                GTK_CSS_PROPERTY_TEXT_SHADOW);
+PROPERTY_GROUP (font_variant,
+                GTK_CSS_PROPERTY_FONT_KERNING,
+                GTK_CSS_PROPERTY_FONT_VARIANT_LIGATURES,
+                GTK_CSS_PROPERTY_FONT_VARIANT_POSITION,
+                GTK_CSS_PROPERTY_FONT_VARIANT_CAPS,
+                GTK_CSS_PROPERTY_FONT_VARIANT_NUMERIC,
+                GTK_CSS_PROPERTY_FONT_VARIANT_ALTERNATES,
+                GTK_CSS_PROPERTY_FONT_VARIANT_EAST_ASIAN);
+PROPERTY_GROUP (text_decoration,
+                GTK_CSS_PROPERTY_TEXT_DECORATION_LINE,
+                GTK_CSS_PROPERTY_TEXT_DECORATION_COLOR,
+                GTK_CSS_PROPERTY_TEXT_DECORATION_STYLE);
+PROPERTY_GROUP (size,
+                GTK_CSS_PROPERTY_MARGIN_TOP,
+                GTK_CSS_PROPERTY_MARGIN_LEFT,
+                GTK_CSS_PROPERTY_MARGIN_BOTTOM,
+                GTK_CSS_PROPERTY_MARGIN_RIGHT,
+                GTK_CSS_PROPERTY_PADDING_TOP,
+                GTK_CSS_PROPERTY_PADDING_LEFT,
+                GTK_CSS_PROPERTY_PADDING_BOTTOM,
+                GTK_CSS_PROPERTY_PADDING_RIGHT,
+                GTK_CSS_PROPERTY_BORDER_SPACING,
+                GTK_CSS_PROPERTY_MIN_WIDTH,
+                GTK_CSS_PROPERTY_MIN_HEIGHT);
+PROPERTY_GROUP (icon,
+                GTK_CSS_PROPERTY_ICON_SOURCE,
+                GTK_CSS_PROPERTY_ICON_SIZE,
+                GTK_CSS_PROPERTY_ICON_SHADOW,
+                GTK_CSS_PROPERTY_ICON_STYLE,
+                GTK_CSS_PROPERTY_ICON_TRANSFORM,
+                GTK_CSS_PROPERTY_ICON_FILTER);
+PROPERTY_GROUP (transition,
+                GTK_CSS_PROPERTY_TRANSITION_PROPERTY,
+                GTK_CSS_PROPERTY_TRANSITION_DURATION,
+                GTK_CSS_PROPERTY_TRANSITION_TIMING_FUNCTION,
+                GTK_CSS_PROPERTY_TRANSITION_DELAY);
+PROPERTY_GROUP (animation,
+                GTK_CSS_PROPERTY_ANIMATION_NAME,
+                GTK_CSS_PROPERTY_ANIMATION_DURATION,
+                GTK_CSS_PROPERTY_ANIMATION_TIMING_FUNCTION,
+                GTK_CSS_PROPERTY_ANIMATION_ITERATION_COUNT,
+                GTK_CSS_PROPERTY_ANIMATION_DIRECTION,
+                GTK_CSS_PROPERTY_ANIMATION_PLAY_STATE,
+                GTK_CSS_PROPERTY_ANIMATION_DELAY,
+                GTK_CSS_PROPERTY_ANIMATION_FILL_MODE);
+PROPERTY_GROUP (other,
+                GTK_CSS_PROPERTY_OPACITY,
+                GTK_CSS_PROPERTY_FILTER,
+                GTK_CSS_PROPERTY_GTK_KEY_BINDINGS,
+                GTK_CSS_PROPERTY_CARET_COLOR,
+                GTK_CSS_PROPERTY_SECONDARY_CARET_COLOR);
+
+static const struct {
+  const guint16 *properties;
+  guint n_properties;
+} property_groups[GTK_CSS_PROPERTY_GROUP_N_GROUPS] = {
+#define GROUP(group) { group ## _properties, G_N_ELEMENTS (group ## _properties) }
+  GROUP (core),
+  GROUP (background),
+  GROUP (border),
+  GROUP (outline),
+  GROUP (font),
+  GROUP (font_variant),
+  GROUP (text_decoration),
+  GROUP (size),
+  GROUP (icon),
+  GROUP (transition),
+  GROUP (animation),
+  GROUP (other)
+#undef GROUP
+};
+
+/* The group of every property and its index in the group */
+static guint8 property_group[GTK_CSS_PROPERTY_N_PROPERTIES];
+static guint8 property_index[GTK_CSS_PROPERTY_N_PROPERTIES];
+
+static GHashTable *shared_values;
+
+static void
+gtk_css_values_init_properties (void)
+{
+  guint group, i, id;
+
+  memset (property_group, 0xff, sizeof (property_group));
+
+  for (group = 0; group < GTK_CSS_PROPERTY_GROUP_N_GROUPS; group++)
+    {
+      for (i = 0; i < property_groups[group].n_properties; i++)
+        {
+          id = property_groups[group].properties[i];
+          g_assert (property_group[id] == 0xff);
+          property_group[id] = group;
+          property_index[id] = i;
+        }
+    }
+
+  for (id = 0; id < GTK_CSS_PROPERTY_N_PROPERTIES; id++)
+    g_assert (property_group[id] != 0xff);
+}
+
+static GtkCssValues *
+gtk_css_values_new (GtkCssPropertyGroup group)
+{
+  GtkCssValues *values;
+
+  values = g_malloc0 (sizeof (GtkCssValues) +
+                      (property_groups[group].n_properties - 1) * sizeof (GtkCssValue *));
+  values->ref_count = 1;
+  values->group = group;
+
+  return values;
+}
+
+static GtkCssValues *
+gtk_css_values_ref (GtkCssValues *values)
+{
+  values->ref_count++;
+
+  return values;
+}
+
+static void
+gtk_css_values_unref (GtkCssValues *values)
+{
+  guint i;
+
+  values->ref_count--;
+  if (values->ref_count > 0)
+    return;
+
+  if (values->shared)
+    g_hash_table_remove (shared_values, values);
+
+  for (i = 0; i < property_groups[values->group].n_properties; i++)
+    {
+      if (values->values[i])
+        _gtk_css_value_unref (values->values[i]);
+    }
+
+  g_free (values);
+}
+
+static guint
+gtk_css_values_hash (gconstpointer data)
+{
+  const GtkCssValues *values = data;
+  guint i, hash;
+
+  hash = values->group;
+  for (i = 0; i < property_groups[values->group].n_properties; i++)
+    hash = (hash << 5) - hash + GPOINTER_TO_UINT (values->values[i]);
+
+  return hash;
+}
+
+static gboolean
+gtk_css_values_equal (gconstpointer data1,
+                      gconstpointer data2)
+{
+  const GtkCssValues *values1 = data1;
+  const GtkCssValues *values2 = data2;
+
+  if (values1->group != values2->group)
+    return FALSE;
+
+  return memcmp (values1->values,
+                 values2->values,
+                 property_groups[values1->group].n_properties * sizeof (GtkCssValue *)) == 0;
+}
+
+/* Returns the shared group with the same values as @values,
+ * consuming @values.
+ */
+static GtkCssValues *
+gtk_css_values_share (GtkCssValues *values)
+{
+  GtkCssValues *shared;
+
+  if (values->shared)
+    return values;
+
+  if (shared_values == NULL)
+    shared_values = g_hash_table_new (gtk_css_values_hash, gtk_css_values_equal);
+
+  shared = g_hash_table_lookup (shared_values, values);
+  if (shared)
+    {
+      gtk_css_values_ref (shared);
+      gtk_css_values_unref (values);
+      return shared;
+    }
+
+  values->shared = TRUE;
+  g_hash_table_add (shared_values, values);
+
+  return values;
+}
+
+/* Returns a group with the values of @values that may be modified,
+ * consuming @values.
+ */
+static GtkCssValues *
+gtk_css_values_make_writable (GtkCssValues *values)
+{
+  GtkCssValues *copy;
+  guint i;
+
+  if (!values->shared && values->ref_count == 1)
+    return values;
+
+  copy = gtk_css_values_new (values->group);
+  for (i = 0; i < property_groups[values->group].n_properties; i++)
+    {
+      if (values->values[i])
+        copy->values[i] = _gtk_css_value_ref (values->values[i]);
+    }
+
+  gtk_css_values_unref (values);
+
+  return copy;
+}
+
 G_DEFINE_TYPE (GtkCssStaticStyle, gtk_css_static_style, GTK_TYPE_CSS_STYLE)
 
 static GtkCssValue *
@@ -47,8 +340,12 @@ gtk_css_static_style_get_value (GtkCssStyle *style,
 {
   /* This is called a lot, so we avoid a dynamic type check here */
   GtkCssStaticStyle *sstyle = (GtkCssStaticStyle *) style;
+  GtkCssValues *values = sstyle->groups[property_group[id]];
 
-  return sstyle->values[id];
+  if (values == NULL)
+    return NULL;
+
+  return values->values[property_index[id]];
 }
 
 static GtkCssSection *
@@ -70,11 +367,8 @@ gtk_css_static_style_dispose (GObject *object)
   GtkCssStaticStyle *style = GTK_CSS_STATIC_STYLE (object);
   guint i;
 
-  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
-    {
-      if (style->values[i])
-        _gtk_css_value_unref (style->values[i]);
-    }
+  for (i = 0; i < GTK_CSS_PROPERTY_GROUP_N_GROUPS; i++)
+    g_clear_pointer (&style->groups[i], gtk_css_values_unref);
   if (style->sections)
     {
       g_ptr_array_unref (style->sections);
@@ -94,6 +388,8 @@ gtk_css_static_style_class_init (GtkCssStaticStyleClass *klass)
 
   style_class->get_value = gtk_css_static_style_get_value;
   style_class->get_section = gtk_css_static_style_get_section;
+
+  gtk_css_values_init_properties ();
 }
 
 static void
@@ -114,9 +410,17 @@ gtk_css_static_style_set_value (GtkCssStaticStyle *style,
                                 GtkCssValue       *value,
                                 GtkCssSection     *section)
 {
-  if (style->values[id])
-    _gtk_css_value_unref (style->values[id]);
-  style->values[id] = _gtk_css_value_ref (value);
+  GtkCssValues **values = &style->groups[property_group[id]];
+  guint index = property_index[id];
+
+  if (*values == NULL)
+    *values = gtk_css_values_new (property_group[id]);
+  else
+    *values = gtk_css_values_make_writable (*values);
+
+  if ((*values)->values[index])
+    _gtk_css_value_unref ((*values)->values[index]);
+  (*values)->values[index] = _gtk_css_value_ref (value);
 
   if (style->sections && style->sections->len > id && g_ptr_array_index (style->sections, id))
     {
@@ -135,6 +439,114 @@ gtk_css_static_style_set_value (GtkCssStaticStyle *style,
     }
 }
 
+static void
+gtk_css_static_style_share_values (GtkCssStaticStyle *style,
+                                   GtkCssStyle       *parent)
+{
+  GtkCssStaticStyle *sparent;
+  guint i;
+
+  sparent = GTK_IS_CSS_STATIC_STYLE (parent) ? GTK_CSS_STATIC_STYLE (parent) : NULL;
+
+  for (i = 0; i < GTK_CSS_PROPERTY_GROUP_N_GROUPS; i++)
+    {
+      if (style->groups[i] == NULL)
+        continue;
+
+      /* Inherited groups often have values that are equal, but not
+       * identical, to the parent's, so try those first.
+       */
+      if (sparent && sparent->groups[i] && sparent->groups[i] != style->groups[i])
+        {
+          GtkCssValues *values = style->groups[i];
+          GtkCssValues *parent_values = sparent->groups[i];
+          guint j;
+
+          for (j = 0; j < property_groups[i].n_properties; j++)
+            {
+              if (!_gtk_css_value_equal0 (values->values[j], parent_values->values[j]))
+                break;
+            }
+
+          if (j == property_groups[i].n_properties)
+            {
+              gtk_css_values_unref (values);
+              style->groups[i] = gtk_css_values_share (gtk_css_values_ref (parent_values));
+              continue;
+            }
+        }
+
+      style->groups[i] = gtk_css_values_share (style->groups[i]);
+    }
+}
+
+/*< private >
+ * gtk_css_static_style_equal:
+ * @style: a #GtkCssStaticStyle
+ * @other: another #GtkCssStaticStyle
+ *
+ * Checks if the two styles have the same values and change, so one
+ * can be used instead of the other.
+ *
+ * Returns: %TRUE if the styles are equal
+ */
+gboolean
+gtk_css_static_style_equal (GtkCssStaticStyle *style,
+                            GtkCssStaticStyle *other)
+{
+  guint i;
+
+  if (style == other)
+    return TRUE;
+
+  /* The inspector shows where values were defined */
+  if (style->sections || other->sections)
+    return FALSE;
+
+  if (style->change != other->change ||
+      style->explicit_inherit != other->explicit_inherit)
+    return FALSE;
+
+  for (i = 0; i < GTK_CSS_PROPERTY_GROUP_N_GROUPS; i++)
+    {
+      if (style->groups[i] != other->groups[i])
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+GtkBitmask *
+gtk_css_static_style_add_difference (GtkBitmask        *accumulated,
+                                     GtkCssStaticStyle *style,
+                                     GtkCssStaticStyle *other)
+{
+  guint i, j, id;
+
+  for (i = 0; i < GTK_CSS_PROPERTY_GROUP_N_GROUPS; i++)
+    {
+      GtkCssValues *values = style->groups[i];
+      GtkCssValues *other_values = other->groups[i];
+
+      if (values == other_values)
+        continue;
+
+      for (j = 0; j < property_groups[i].n_properties; j++)
+        {
+          id = property_groups[i].properties[j];
+
+          if (_gtk_bitmask_get (accumulated, id))
+            continue;
+
+          if (!_gtk_css_value_equal0 (values ? values->values[j] : NULL,
+                                      other_values ? other_values->values[j] : NULL))
+            accumulated = _gtk_bitmask_set (accumulated, id, TRUE);
+        }
+    }
+
+  return accumulated;
+}
+
 static GtkCssStyle *default_style;
 
 static void
@@ -171,17 +583,53 @@ gtk_css_static_style_new_compute (GtkStyleProvider    *provider,
                                   const GtkCssMatcher *matcher,
                                   GtkCssStyle         *parent)
 {
-  GtkCssStaticStyle *result;
+  GtkCssStyle *result;
   GtkCssLookup *lookup;
   GtkCssChange change = GTK_CSS_CHANGE_ANY_SELF | GTK_CSS_CHANGE_ANY_SIBLING | GTK_CSS_CHANGE_ANY_PARENT;
 
   lookup = _gtk_css_lookup_new (NULL);
 
   if (matcher)
-    gtk_style_provider_lookup (provider,
-                               matcher,
-                               lookup,
-                               &change);
+    {
+      gint64 start_time = gtk_css_profiler_get_time ();
+
+      gtk_style_provider_lookup (provider,
+                                 matcher,
+                                 lookup,
+                                 &change);
+
+      gtk_css_profiler_add_phase_time (GTK_CSS_PROFILER_MATCH, start_time);
+    }
+
+  result = gtk_css_static_style_new_from_lookup (provider, lookup, change, parent);
+
+  _gtk_css_lookup_free (lookup);
+
+  return result;
+}
+
+/*< private >
+ * gtk_css_static_style_new_from_lookup:
+ * @provider: the provider @lookup was done with
+ * @lookup: the values that apply to the node
+ * @change: the change returned by the lookup
+ * @parent: (nullable): the parent's style
+ *
+ * Computes a style from a lookup that has already been done, possibly
+ * on another thread.
+ *
+ * Returns: (transfer full): the new style
+ */
+GtkCssStyle *
+gtk_css_static_style_new_from_lookup (GtkStyleProvider *provider,
+                                      GtkCssLookup     *lookup,
+                                      GtkCssChange      change,
+                                      GtkCssStyle      *parent)
+{
+  GtkCssStaticStyle *result;
+  gint64 start_time;
+
+  start_time = gtk_css_profiler_get_time ();
 
   result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
 
@@ -192,7 +640,9 @@ gtk_css_static_style_new_compute (GtkStyleProvider    *provider,
                            result,
                            parent);
 
-  _gtk_css_lookup_free (lookup);
+  gtk_css_static_style_share_values (result, parent);
+
+  gtk_css_profiler_add_phase_time (GTK_CSS_PROFILER_COMPUTE, start_time);
 
   return GTK_CSS_STYLE (result);
 }
@@ -227,7 +677,13 @@ gtk_css_static_style_compute_value (GtkCssStaticStyle *style,
         specified = _gtk_css_initial_value_new ();
     }
   else
-    _gtk_css_value_ref (specified);
+    {
+      if (specified == _gtk_css_inherit_value_get () &&
+          !_gtk_css_style_property_is_inherit (_gtk_css_style_property_lookup_by_id (id)))
+        style->explicit_inherit = TRUE;
+
+      _gtk_css_value_ref (specified);
+    }
 
   value = _gtk_css_value_compute (specified, id, provider, GTK_CSS_STYLE (style), parent_style);
 
@@ -244,3 +700,20 @@ gtk_css_static_style_get_change (GtkCssStaticStyle *style)
 
   return style->change;
 }
+
+/*< private >
+ * gtk_css_static_style_uses_explicit_inherit:
+ * @style: a #GtkCssStaticStyle
+ *
+ * Checks if @style takes the value of a property from its parent
+ * that is not inherited by default, because it was set to `inherit`.
+ *
+ * Returns: %TRUE if @style depends on non-inherited parent values
+ */
+gboolean
+gtk_css_static_style_uses_explicit_inherit (GtkCssStaticStyle *style)
+{
+  g_return_val_if_fail (GTK_IS_CSS_STATIC_STYLE (style), TRUE);
+
+  return style->explicit_inherit;
+}
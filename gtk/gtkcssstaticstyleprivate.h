@@ -34,15 +34,37 @@ G_BEGIN_DECLS
 
 typedef struct _GtkCssStaticStyle           GtkCssStaticStyle;
 typedef struct _GtkCssStaticStyleClass      GtkCssStaticStyleClass;
+typedef struct _GtkCssValues                GtkCssValues;
+
+/* Properties are grouped by what they are about and what usually gets
+ * set together. Styles that have the same values for all properties of
+ * a group share the group.
+ */
+typedef enum {
+  GTK_CSS_PROPERTY_GROUP_CORE,
+  GTK_CSS_PROPERTY_GROUP_BACKGROUND,
+  GTK_CSS_PROPERTY_GROUP_BORDER,
+  GTK_CSS_PROPERTY_GROUP_OUTLINE,
+  GTK_CSS_PROPERTY_GROUP_FONT,
+  GTK_CSS_PROPERTY_GROUP_FONT_VARIANT,
+  GTK_CSS_PROPERTY_GROUP_TEXT_DECORATION,
+  GTK_CSS_PROPERTY_GROUP_SIZE,
+  GTK_CSS_PROPERTY_GROUP_ICON,
+  GTK_CSS_PROPERTY_GROUP_TRANSITION,
+  GTK_CSS_PROPERTY_GROUP_ANIMATION,
+  GTK_CSS_PROPERTY_GROUP_OTHER,
+  GTK_CSS_PROPERTY_GROUP_N_GROUPS
+} GtkCssPropertyGroup;
 
 struct _GtkCssStaticStyle
 {
   GtkCssStyle parent;
 
-  GtkCssValue           *values[GTK_CSS_PROPERTY_N_PROPERTIES]; /* the values */
+  GtkCssValues          *groups[GTK_CSS_PROPERTY_GROUP_N_GROUPS]; /* the values, shared with other styles */
   GPtrArray             *sections;             /* sections the values are defined in */
 
   GtkCssChange           change;               /* change as returned by value lookup */
+  guint                  explicit_inherit :1;  /* inherits a property that isn't inherited by default */
 };
 
 struct _GtkCssStaticStyleClass
@@ -56,6 +78,10 @@ GtkCssStyle *           gtk_css_static_style_get_default        (void);
 GtkCssStyle *           gtk_css_static_style_new_compute        (GtkStyleProvider       *provider,
                                                                  const GtkCssMatcher    *matcher,
                                                                  GtkCssStyle            *parent);
+GtkCssStyle *           gtk_css_static_style_new_from_lookup    (GtkStyleProvider       *provider,
+                                                                 GtkCssLookup           *lookup,
+                                                                 GtkCssChange            change,
+                                                                 GtkCssStyle            *parent);
 
 void                    gtk_css_static_style_compute_value      (GtkCssStaticStyle      *style,
                                                                  GtkStyleProvider       *provider,
@@ -65,6 +91,12 @@ void                    gtk_css_static_style_compute_value      (GtkCssStaticSty
                                                                  GtkCssSection          *section);
 
 GtkCssChange            gtk_css_static_style_get_change         (GtkCssStaticStyle      *style);
+gboolean                gtk_css_static_style_uses_explicit_inherit (GtkCssStaticStyle   *style);
+gboolean                gtk_css_static_style_equal              (GtkCssStaticStyle      *style,
+                                                                 GtkCssStaticStyle      *other);
+GtkBitmask *            gtk_css_static_style_add_difference     (GtkBitmask             *accumulated,
+                                                                 GtkCssStaticStyle      *style,
+                                                                 GtkCssStaticStyle      *other);
 
 G_END_DECLS
 
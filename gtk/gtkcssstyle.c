@@ -31,6 +31,7 @@
 #include "gtkcssrgbavalueprivate.h"
 #include "gtkcsssectionprivate.h"
 #include "gtkcssshorthandpropertyprivate.h"
+#include "gtkcssstaticstyleprivate.h"
 #include "gtkcssstringvalueprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkcsstransitionprivate.h"
@@ -91,6 +92,12 @@ gtk_css_style_add_difference (GtkBitmask  *accumulated,
   if (style == other)
     return accumulated;
 
+  /* Static styles can skip the groups of values they share */
+  if (GTK_IS_CSS_STATIC_STYLE (style) && GTK_IS_CSS_STATIC_STYLE (other))
+    return gtk_css_static_style_add_difference (accumulated,
+                                                GTK_CSS_STATIC_STYLE (style),
+                                                GTK_CSS_STATIC_STYLE (other));
+
   len = _gtk_css_style_property_get_n_properties ();
   for (i = 0; i < len; i++)
     {
@@ -0,0 +1,284 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkcssstylebatchprivate.h"
+
+#include "gtkcsslookupprivate.h"
+#include "gtkcssmatcherprivate.h"
+#include "gtkcssnodeprivate.h"
+#include "gtkstyleproviderprivate.h"
+
+/* When the styles of many nodes have to be recomputed at once, like
+ * after a theme change, most of the time is spent finding the rules
+ * that apply to each node. That only reads the node tree and the
+ * style providers, so it is done for all nodes of a batch on a thread
+ * pool while the main thread waits.
+ *
+ * Computing values from the found rules refs and creates values and
+ * uses caches that are not thread-safe, so that still happens on the
+ * main thread when the node's style is updated, using the lookup from
+ * the batch.
+ */
+
+#define JOBS_PER_CHUNK 32
+
+typedef struct {
+  GtkCssNode       *node;
+  GtkStyleProvider *provider;
+  GtkCssLookup     *lookup;
+  GtkCssChange      change;
+} GtkCssStyleJob;
+
+struct _GtkCssStyleBatch {
+  GArray     *jobs;
+  GHashTable *job_for_node;    /* node => index + 1 */
+
+  gint        next_job;        /* atomic */
+  GMutex      mutex;
+  GCond       cond;
+  guint       n_running;
+};
+
+/*< private >
+ * gtk_css_style_batch_is_enabled:
+ *
+ * Checks if styles should be looked up on multiple threads. Setting
+ * the `GTK_CSS_PARALLEL_STYLES` environment variable to 0 turns it off.
+ *
+ * Returns: %TRUE if batches should be used
+ */
+gboolean
+gtk_css_style_batch_is_enabled (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    {
+      const char *env = g_getenv ("GTK_CSS_PARALLEL_STYLES");
+
+      enabled = (env == NULL || !g_str_equal (env, "0")) &&
+                g_get_num_processors () > 1;
+    }
+
+  return enabled;
+}
+
+GtkCssStyleBatch *
+gtk_css_style_batch_new (void)
+{
+  GtkCssStyleBatch *batch;
+
+  batch = g_slice_new0 (GtkCssStyleBatch);
+  batch->jobs = g_array_new (FALSE, FALSE, sizeof (GtkCssStyleJob));
+  batch->job_for_node = g_hash_table_new (NULL, NULL);
+  g_mutex_init (&batch->mutex);
+  g_cond_init (&batch->cond);
+
+  return batch;
+}
+
+void
+gtk_css_style_batch_free (GtkCssStyleBatch *batch)
+{
+  guint i;
+
+  for (i = 0; i < batch->jobs->len; i++)
+    {
+      GtkCssStyleJob *job = &g_array_index (batch->jobs, GtkCssStyleJob, i);
+
+      g_object_unref (job->node);
+      g_object_unref (job->provider);
+      g_clear_pointer (&job->lookup, _gtk_css_lookup_free);
+    }
+
+  g_array_free (batch->jobs, TRUE);
+  g_hash_table_unref (batch->job_for_node);
+  g_mutex_clear (&batch->mutex);
+  g_cond_clear (&batch->cond);
+
+  g_slice_free (GtkCssStyleBatch, batch);
+}
+
+/*< private >
+ * gtk_css_style_batch_add:
+ * @batch: a #GtkCssStyleBatch
+ * @node: a node whose style will be recomputed
+ * @provider: the style provider of @node
+ *
+ * Adds @node to the nodes that gtk_css_style_batch_run() looks up
+ * styles for.
+ */
+void
+gtk_css_style_batch_add (GtkCssStyleBatch *batch,
+                         GtkCssNode       *node,
+                         GtkStyleProvider *provider)
+{
+  GtkCssStyleJob job;
+
+  job.node = g_object_ref (node);
+  job.provider = g_object_ref (provider);
+  job.lookup = NULL;
+  job.change = 0;
+
+  g_array_append_val (batch->jobs, job);
+  g_hash_table_insert (batch->job_for_node, node, GUINT_TO_POINTER (batch->jobs->len));
+}
+
+guint
+gtk_css_style_batch_get_size (GtkCssStyleBatch *batch)
+{
+  return batch->jobs->len;
+}
+
+static void
+gtk_css_style_job_run (GtkCssStyleJob *job)
+{
+  GtkCssMatcher matcher;
+
+  /* Nodes without a matcher get the default style, which is
+   * cheap to compute on the main thread */
+  if (!gtk_css_node_init_matcher (job->node, &matcher))
+    return;
+
+  job->lookup = _gtk_css_lookup_new (NULL);
+  gtk_style_provider_lookup (job->provider, &matcher, job->lookup, &job->change);
+}
+
+static void
+gtk_css_style_batch_run_jobs (GtkCssStyleBatch *batch)
+{
+  guint i, start, end;
+
+  while (TRUE)
+    {
+      start = g_atomic_int_add (&batch->next_job, JOBS_PER_CHUNK);
+      if (start >= batch->jobs->len)
+        break;
+
+      end = MIN (start + JOBS_PER_CHUNK, batch->jobs->len);
+      for (i = start; i < end; i++)
+        gtk_css_style_job_run (&g_array_index (batch->jobs, GtkCssStyleJob, i));
+    }
+}
+
+static void
+gtk_css_style_batch_thread_func (gpointer data,
+                                 gpointer user_data)
+{
+  GtkCssStyleBatch *batch = data;
+
+  gtk_css_style_batch_run_jobs (batch);
+
+  g_mutex_lock (&batch->mutex);
+  batch->n_running--;
+  if (batch->n_running == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->mutex);
+}
+
+static GThreadPool *
+gtk_css_style_batch_get_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (pool == NULL)
+    pool = g_thread_pool_new (gtk_css_style_batch_thread_func,
+                              NULL,
+                              g_get_num_processors () - 1,
+                              FALSE,
+                              NULL);
+
+  return pool;
+}
+
+/*< private >
+ * gtk_css_style_batch_run:
+ * @batch: a #GtkCssStyleBatch
+ *
+ * Looks up the styles of all nodes in @batch, using the thread pool
+ * and the calling thread. Returns when all lookups are done. The node
+ * tree and the style providers must not change while this runs.
+ */
+void
+gtk_css_style_batch_run (GtkCssStyleBatch *batch)
+{
+  GThreadPool *pool;
+  guint i, n_threads;
+
+  pool = gtk_css_style_batch_get_pool ();
+  n_threads = MIN ((guint) g_thread_pool_get_max_threads (pool),
+                   batch->jobs->len / JOBS_PER_CHUNK);
+
+  batch->next_job = 0;
+  batch->n_running = n_threads;
+
+  for (i = 0; i < n_threads; i++)
+    {
+      if (!g_thread_pool_push (pool, batch, NULL))
+        {
+          g_mutex_lock (&batch->mutex);
+          batch->n_running--;
+          g_mutex_unlock (&batch->mutex);
+        }
+    }
+
+  gtk_css_style_batch_run_jobs (batch);
+
+  g_mutex_lock (&batch->mutex);
+  while (batch->n_running > 0)
+    g_cond_wait (&batch->cond, &batch->mutex);
+  g_mutex_unlock (&batch->mutex);
+}
+
+/*< private >
+ * gtk_css_style_batch_steal_lookup:
+ * @batch: a #GtkCssStyleBatch
+ * @node: a node
+ * @provider: the style provider of @node
+ * @change: (out): return location for the change of the lookup
+ *
+ * Takes the result of looking up the style of @node, if @batch has
+ * one for it and @provider.
+ *
+ * Returns: (nullable) (transfer full): the lookup or %NULL
+ */
+GtkCssLookup *
+gtk_css_style_batch_steal_lookup (GtkCssStyleBatch *batch,
+                                  GtkCssNode       *node,
+                                  GtkStyleProvider *provider,
+                                  GtkCssChange     *change)
+{
+  GtkCssStyleJob *job;
+  GtkCssLookup *lookup;
+  guint index;
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (batch->job_for_node, node));
+  if (index == 0)
+    return NULL;
+
+  job = &g_array_index (batch->jobs, GtkCssStyleJob, index - 1);
+  if (job->provider != provider)
+    return NULL;
+
+  lookup = job->lookup;
+  job->lookup = NULL;
+  *change = job->change;
+
+  return lookup;
+}
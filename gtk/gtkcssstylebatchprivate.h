@@ -0,0 +1,47 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_CSS_STYLE_BATCH_PRIVATE_H__
+#define __GTK_CSS_STYLE_BATCH_PRIVATE_H__
+
+#include "gtkcsstypesprivate.h"
+#include "gtkstyleprovider.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GtkCssStyleBatch GtkCssStyleBatch;
+
+gboolean                gtk_css_style_batch_is_enabled          (void);
+
+GtkCssStyleBatch *      gtk_css_style_batch_new                 (void);
+void                    gtk_css_style_batch_free                (GtkCssStyleBatch       *batch);
+
+void                    gtk_css_style_batch_add                 (GtkCssStyleBatch       *batch,
+                                                                 GtkCssNode             *node,
+                                                                 GtkStyleProvider       *provider);
+guint                   gtk_css_style_batch_get_size            (GtkCssStyleBatch       *batch);
+
+void                    gtk_css_style_batch_run                 (GtkCssStyleBatch       *batch);
+
+GtkCssLookup *          gtk_css_style_batch_steal_lookup        (GtkCssStyleBatch       *batch,
+                                                                 GtkCssNode             *node,
+                                                                 GtkStyleProvider       *provider,
+                                                                 GtkCssChange           *change);
+
+G_END_DECLS
+
+#endif /* __GTK_CSS_STYLE_BATCH_PRIVATE_H__ */
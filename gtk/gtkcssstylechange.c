@@ -39,6 +39,38 @@ gtk_css_style_change_init (GtkCssStyleChange *change,
     change->n_compared = GTK_CSS_PROPERTY_N_PROPERTIES;
 }
 
+/*< private >
+ * gtk_css_style_change_init_for_changes:
+ * @change: the change to initialize
+ * @style: a style that was changed in place
+ * @changes: the ids of the properties that changed
+ *
+ * Initializes @change for a style that was modified instead of being
+ * replaced. The old values are gone, so both the old and the new style
+ * of @change are @style.
+ */
+void
+gtk_css_style_change_init_for_changes (GtkCssStyleChange *change,
+                                       GtkCssStyle       *style,
+                                       const GtkBitmask  *changes)
+{
+  guint i;
+
+  change->old_style = g_object_ref (style);
+  change->new_style = g_object_ref (style);
+
+  change->n_compared = GTK_CSS_PROPERTY_N_PROPERTIES;
+
+  change->affects = 0;
+  change->changes = _gtk_bitmask_copy (changes);
+
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (_gtk_bitmask_get (changes, i))
+        change->affects |= _gtk_css_style_property_get_affects (_gtk_css_style_property_lookup_by_id (i));
+    }
+}
+
 void
 gtk_css_style_change_finish (GtkCssStyleChange *change)
 {
@@ -37,6 +37,9 @@ struct _GtkCssStyleChange {
 void            gtk_css_style_change_init               (GtkCssStyleChange      *change,
                                                          GtkCssStyle            *old_style,
                                                          GtkCssStyle            *new_style);
+void            gtk_css_style_change_init_for_changes   (GtkCssStyleChange      *change,
+                                                         GtkCssStyle            *style,
+                                                         const GtkBitmask       *changes);
 void            gtk_css_style_change_finish             (GtkCssStyleChange      *change);
 
 GtkCssStyle *   gtk_css_style_change_get_old_style      (GtkCssStyleChange      *change);
@@ -0,0 +1,258 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkcssthemecacheprivate.h"
+
+#include "gtkversion.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+/* Compiled themes are stored in the user's cache directory, one file per
+ * theme, named after the URI of the theme's main file. A cache file is a
+ * GVariant of type (syssa(ss)v):
+ *
+ * - a header, which changes with every version of GTK, the format and the
+ *   architecture, because the contents refer to GTK internals
+ * - the byte order the numbers in the file were written in, 'l' or 'B',
+ *   as the file is used without byteswapping it
+ * - the URI of the theme, to catch hash collisions
+ * - the URIs and checksums of all files the theme was loaded from
+ * - the contents, which are up to the caller
+ *
+ * The file gets mapped into memory, so the contents can be used without
+ * copying them. A cache file is only used if all files still have the
+ * same contents.
+ */
+
+#define GTK_CSS_THEME_CACHE_FORMAT_VERSION 4
+#define GTK_CSS_THEME_CACHE_TYPE "(sysa(ss)v)"
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define GTK_CSS_THEME_CACHE_BYTE_ORDER 'l'
+#else
+#define GTK_CSS_THEME_CACHE_BYTE_ORDER 'B'
+#endif
+
+static const char *
+gtk_css_theme_cache_get_header (void)
+{
+  static char *header = NULL;
+
+  if (g_once_init_enter (&header))
+    {
+      char *h = g_strdup_printf ("GTK %d.%d.%d CSS theme cache %d, %d bit",
+                                 GTK_MAJOR_VERSION, GTK_MINOR_VERSION, GTK_MICRO_VERSION,
+                                 GTK_CSS_THEME_CACHE_FORMAT_VERSION,
+                                 GLIB_SIZEOF_VOID_P * 8);
+      g_once_init_leave (&header, h);
+    }
+
+  return header;
+}
+
+/*< private >
+ * gtk_css_theme_cache_is_enabled:
+ *
+ * Checks if themes should be loaded from and saved to the cache.
+ * Setting the `GTK_CSS_THEME_CACHE` environment variable to 0
+ * turns the cache off.
+ *
+ * Returns: %TRUE if the cache should be used
+ */
+gboolean
+gtk_css_theme_cache_is_enabled (void)
+{
+  const char *env = g_getenv ("GTK_CSS_THEME_CACHE");
+
+  return env == NULL || !g_str_equal (env, "0");
+}
+
+char *
+gtk_css_theme_cache_compute_checksum (const char *data,
+                                      gsize       length)
+{
+  return g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) data, length);
+}
+
+static char *
+gtk_css_theme_cache_get_path (GFile *theme)
+{
+  char *uri, *basename, *path;
+
+  uri = g_file_get_uri (theme);
+  basename = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+  path = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "themes", basename, NULL);
+  g_free (basename);
+  g_free (uri);
+
+  return path;
+}
+
+static gboolean
+gtk_css_theme_cache_sources_are_valid (GVariant *sources)
+{
+  GVariantIter iter;
+  const char *uri, *checksum;
+
+  g_variant_iter_init (&iter, sources);
+  while (g_variant_iter_next (&iter, "(&s&s)", &uri, &checksum))
+    {
+      GFile *file;
+      char *data, *computed;
+      gsize length;
+      gboolean valid;
+
+      file = g_file_new_for_uri (uri);
+      valid = g_file_load_contents (file, NULL, &data, &length, NULL, NULL);
+      g_object_unref (file);
+
+      if (!valid)
+        return FALSE;
+
+      computed = gtk_css_theme_cache_compute_checksum (data, length);
+      valid = g_str_equal (computed, checksum);
+      g_free (computed);
+      g_free (data);
+
+      if (!valid)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*< private >
+ * gtk_css_theme_cache_load:
+ * @theme: the main file of the theme
+ * @type: the type of the contents
+ * @sources: (out): return location for the files the theme was loaded
+ *     from, see %GTK_CSS_THEME_CACHE_SOURCES_TYPE
+ *
+ * Looks up the cached contents for @theme, if they exist and the files
+ * the theme was loaded from have not changed.
+ *
+ * Returns: (nullable) (transfer full): the contents, or %NULL
+ */
+GVariant *
+gtk_css_theme_cache_load (GFile               *theme,
+                          const GVariantType  *type,
+                          GVariant           **sources)
+{
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *cache, *contents;
+  const char *header, *theme_uri;
+  char *path, *uri;
+  guchar byte_order;
+  gboolean valid;
+
+  path = gtk_css_theme_cache_get_path (theme);
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  g_free (path);
+  if (mapped == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GTK_CSS_THEME_CACHE_TYPE), bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (cache, "(&sy&s@a(ss)v)", &header, &byte_order, &theme_uri, sources, &contents);
+  uri = g_file_get_uri (theme);
+
+  valid = g_str_equal (header, gtk_css_theme_cache_get_header ()) &&
+          byte_order == GTK_CSS_THEME_CACHE_BYTE_ORDER &&
+          g_str_equal (theme_uri, uri) &&
+          g_variant_is_of_type (contents, type) &&
+          gtk_css_theme_cache_sources_are_valid (*sources);
+
+  g_free (uri);
+  g_variant_unref (cache);
+
+  if (!valid)
+    {
+      g_clear_pointer (sources, g_variant_unref);
+      g_variant_unref (contents);
+      return NULL;
+    }
+
+  return contents;
+}
+
+/*< private >
+ * gtk_css_theme_cache_save:
+ * @theme: the main file of the theme
+ * @sources: the files the theme was loaded from, see
+ *     %GTK_CSS_THEME_CACHE_SOURCES_TYPE
+ * @contents: the contents to cache
+ *
+ * Writes the cache for @theme. Failures are silently ignored, as the
+ * theme will just be loaded from its files again next time.
+ */
+void
+gtk_css_theme_cache_save (GFile    *theme,
+                          GVariant *sources,
+                          GVariant *contents)
+{
+  GVariant *cache;
+  char *path, *dir, *uri;
+
+  path = gtk_css_theme_cache_get_path (theme);
+  dir = g_path_get_dirname (path);
+  uri = g_file_get_uri (theme);
+
+  cache = g_variant_ref_sink (g_variant_new ("(sys@a(ss)v)",
+                                             gtk_css_theme_cache_get_header (),
+                                             GTK_CSS_THEME_CACHE_BYTE_ORDER,
+                                             uri,
+                                             sources,
+                                             contents));
+
+  /* g_file_set_contents() writes to a temporary file and renames it,
+   * so processes that have the old file mapped are not affected.
+   */
+  if (g_mkdir_with_parents (dir, 0755) == 0)
+    g_file_set_contents (path,
+                         g_variant_get_data (cache),
+                         g_variant_get_size (cache),
+                         NULL);
+
+  g_variant_unref (cache);
+  g_free (uri);
+  g_free (dir);
+  g_free (path);
+}
+
+/*< private >
+ * gtk_css_theme_cache_remove:
+ * @theme: the main file of the theme
+ *
+ * Removes the cache for @theme, when it turned out to be unusable.
+ */
+void
+gtk_css_theme_cache_remove (GFile *theme)
+{
+  char *path;
+
+  path = gtk_css_theme_cache_get_path (theme);
+  g_unlink (path);
+  g_free (path);
+}
@@ -0,0 +1,43 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2017 The GTK+ Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_CSS_THEME_CACHE_PRIVATE_H__
+#define __GTK_CSS_THEME_CACHE_PRIVATE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The files a theme was loaded from, as (uri, checksum) pairs */
+#define GTK_CSS_THEME_CACHE_SOURCES_TYPE "a(ss)"
+
+gboolean        gtk_css_theme_cache_is_enabled          (void);
+
+char *          gtk_css_theme_cache_compute_checksum    (const char             *data,
+                                                         gsize                   length);
+
+GVariant *      gtk_css_theme_cache_load                (GFile                  *theme,
+                                                         const GVariantType     *type,
+                                                         GVariant              **sources);
+void            gtk_css_theme_cache_save                (GFile                  *theme,
+                                                         GVariant               *sources,
+                                                         GVariant               *contents);
+void            gtk_css_theme_cache_remove              (GFile                  *theme);
+
+G_END_DECLS
+
+#endif /* __GTK_CSS_THEME_CACHE_PRIVATE_H__ */
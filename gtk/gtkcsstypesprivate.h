@@ -24,6 +24,8 @@
 
 G_BEGIN_DECLS
 
+typedef struct _GtkCssAncestorFilter GtkCssAncestorFilter;
+typedef struct _GtkCssLookup GtkCssLookup;
 typedef union _GtkCssMatcher GtkCssMatcher;
 typedef struct _GtkCssNode GtkCssNode;
 typedef struct _GtkCssNodeDeclaration GtkCssNodeDeclaration;
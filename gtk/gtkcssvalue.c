@@ -29,6 +29,38 @@ struct _GtkCssValue {
 
 G_DEFINE_BOXED_TYPE (GtkCssValue, _gtk_css_value, _gtk_css_value_ref, _gtk_css_value_unref)
 
+/* All live values of classes implementing the hash vfunc. The table
+ * does not hold references, values remove themselves when freed.
+ * Like the reference counts, it is not thread-safe.
+ */
+static GHashTable *interned_values = NULL;
+
+static guint
+gtk_css_value_intern_hash (gconstpointer data)
+{
+  const GtkCssValue *value = data;
+
+  return value->class->hash (value);
+}
+
+static gboolean
+gtk_css_value_intern_equal (gconstpointer data1,
+                            gconstpointer data2)
+{
+  const GtkCssValue *value1 = data1;
+  const GtkCssValue *value2 = data2;
+
+  /* Values that aren't equal to themselves (think NaN) must still
+   * be found when removing them */
+  if (value1 == value2)
+    return TRUE;
+
+  /* Don't use _gtk_css_value_equal(), it assumes both values are
+   * already interned */
+  return value1->class == value2->class &&
+         value1->class->equal (value1, value2);
+}
+
 GtkCssValue *
 _gtk_css_value_alloc (const GtkCssValueClass *klass,
                       gsize                   size)
@@ -43,6 +75,44 @@ _gtk_css_value_alloc (const GtkCssValueClass *klass,
   return value;
 }
 
+/*< private >
+ * _gtk_css_value_intern:
+ * @value: (transfer full): a newly created value
+ *
+ * Replaces @value with an existing equal value if there is one, so
+ * that equal values share a single instance. Constructors of value
+ * classes implementing the hash vfunc must call this once all fields
+ * of the new value have been set. The value must not be modified
+ * afterwards.
+ *
+ * Returns: (transfer full): @value or an equal interned value
+ **/
+GtkCssValue *
+_gtk_css_value_intern (GtkCssValue *value)
+{
+  GtkCssValue *interned;
+
+  gtk_internal_return_val_if_fail (value != NULL, NULL);
+  gtk_internal_return_val_if_fail (value->class->hash != NULL, value);
+  gtk_internal_return_val_if_fail (value->ref_count == 1, value);
+
+  if (G_UNLIKELY (interned_values == NULL))
+    interned_values = g_hash_table_new (gtk_css_value_intern_hash,
+                                        gtk_css_value_intern_equal);
+
+  interned = g_hash_table_lookup (interned_values, value);
+  if (interned == NULL)
+    {
+      g_hash_table_add (interned_values, value);
+      return value;
+    }
+
+  /* Not via unref, that would remove @interned from the table */
+  value->class->free (value);
+
+  return _gtk_css_value_ref (interned);
+}
+
 GtkCssValue *
 _gtk_css_value_ref (GtkCssValue *value)
 {
@@ -63,6 +133,9 @@ _gtk_css_value_unref (GtkCssValue *value)
   if (value->ref_count > 0)
     return;
 
+  if (value->class->hash)
+    g_hash_table_remove (interned_values, value);
+
   value->class->free (value);
 }
 
@@ -110,6 +183,10 @@ _gtk_css_value_equal (const GtkCssValue *value1,
   if (value1->class != value2->class)
     return FALSE;
 
+  /* Interned values are unique */
+  if (value1->class->hash)
+    return FALSE;
+
   return value1->class->equal (value1, value2);
 }
 
@@ -127,6 +204,54 @@ _gtk_css_value_equal0 (const GtkCssValue *value1,
   return _gtk_css_value_equal (value1, value2);
 }
 
+/*< private >
+ * _gtk_css_value_hash:
+ * @value: (nullable): a value
+ *
+ * Computes a hash for @value that is consistent with
+ * _gtk_css_value_equal(). This is meant for the hash vfunc of
+ * values containing other values.
+ *
+ * Returns: the hash
+ **/
+guint
+_gtk_css_value_hash (const GtkCssValue *value)
+{
+  if (value == NULL)
+    return 0;
+
+  /* Equal interned values are the same instance, and values that are
+   * not interned are only equal to values of the same class */
+  if (value->class->hash)
+    return g_direct_hash (value);
+  else
+    return g_direct_hash (value->class);
+}
+
+/*< private >
+ * _gtk_css_value_get_n_interned:
+ *
+ * Returns: the number of live interned values
+ **/
+guint
+_gtk_css_value_get_n_interned (void)
+{
+  if (interned_values == NULL)
+    return 0;
+
+  return g_hash_table_size (interned_values);
+}
+
+guint
+gtk_css_double_hash (double d)
+{
+  /* 0.0 == -0.0 */
+  if (d == 0.0)
+    return 0;
+
+  return g_double_hash (&d);
+}
+
 GtkCssValue *
 _gtk_css_value_transition (GtkCssValue *start,
                            GtkCssValue *end,
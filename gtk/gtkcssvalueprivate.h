@@ -53,6 +53,8 @@ struct _GtkCssValueClass {
                                                        double                      progress);
   void          (* print)                             (const GtkCssValue          *value,
                                                        GString                    *string);
+  /* optional, values of classes implementing it must be interned */
+  guint         (* hash)                              (const GtkCssValue          *value);
 };
 
 GType        _gtk_css_value_get_type                  (void) G_GNUC_CONST;
@@ -61,6 +63,7 @@ GtkCssValue *_gtk_css_value_alloc                     (const GtkCssValueClass
                                                        gsize                       size);
 #define _gtk_css_value_new(_name, _klass) ((_name *) _gtk_css_value_alloc ((_klass), sizeof (_name)))
 
+GtkCssValue *_gtk_css_value_intern                    (GtkCssValue                *value);
 GtkCssValue *_gtk_css_value_ref                       (GtkCssValue                *value);
 void         _gtk_css_value_unref                     (GtkCssValue                *value);
 
@@ -73,6 +76,9 @@ gboolean     _gtk_css_value_equal                     (const GtkCssValue
                                                        const GtkCssValue          *value2);
 gboolean     _gtk_css_value_equal0                    (const GtkCssValue          *value1,
                                                        const GtkCssValue          *value2);
+guint        _gtk_css_value_hash                      (const GtkCssValue          *value);
+guint        gtk_css_double_hash                      (double                      d);
+guint        _gtk_css_value_get_n_interned            (void);
 GtkCssValue *_gtk_css_value_transition                (GtkCssValue                *start,
                                                        GtkCssValue                *end,
                                                        guint                       property_id,
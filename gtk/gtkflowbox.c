@@ -80,6 +80,7 @@
 #include "gtkprivate.h"
 #include "gtkorientableprivate.h"
 #include "gtkintl.h"
+#include "gtkmain.h"
 #include "gtkcssnodeprivate.h"
 #include "gtkwidgetprivate.h"
 #include "gtkstylecontextprivate.h"
@@ -114,6 +115,13 @@ static void gtk_flow_box_bound_model_changed (GListModel *list,
 
 static void gtk_flow_box_check_model_compat  (GtkFlowBox *box);
 
+static void gtk_flow_box_set_item_selected   (GtkFlowBox *box,
+                                              guint       position,
+                                              gboolean    selected);
+static void gtk_flow_box_queue_update_children (GtkFlowBox *box);
+static guint gtk_flow_box_get_first_item     (GtkFlowBox *box);
+static void gtk_flow_box_clear_virtual       (GtkFlowBox *box);
+
 static void
 get_current_selection_modifiers (GtkWidget *widget,
                                  gboolean  *modify,
@@ -268,6 +276,7 @@ struct _GtkFlowBoxChildPrivate
 {
   GSequenceIter *iter;
   gboolean       selected;
+  gboolean       wrapper;
 };
 
 #define CHILD_PRIV(child) ((GtkFlowBoxChildPrivate*)gtk_flow_box_child_get_instance_private ((GtkFlowBoxChild*)(child)))
@@ -519,7 +528,14 @@ gtk_flow_box_child_get_index (GtkFlowBoxChild *child)
   priv = CHILD_PRIV (child);
 
   if (priv->iter != NULL)
-    return g_sequence_iter_get_position (priv->iter);
+    {
+      GtkFlowBox *box = gtk_flow_box_child_get_box (child);
+
+      if (box)
+        return gtk_flow_box_get_first_item (box) + g_sequence_iter_get_position (priv->iter);
+
+      return g_sequence_iter_get_position (priv->iter);
+    }
 
   return -1;
 }
@@ -674,6 +690,17 @@ struct _GtkFlowBoxPrivate {
   GtkFlowBoxCreateWidgetFunc  create_widget_func;
   gpointer                    create_widget_func_data;
   GDestroyNotify              create_widget_func_data_destroy;
+
+  /* Virtual mode, only children for the lines near the visible area
+   * exist; it is used if bind_widget_func is set
+   */
+  GtkFlowBoxBindWidgetFunc    bind_widget_func;
+  guint                       n_items;
+  guint                       first_item;       /* Position of the first child in the model */
+  gint                        line_size;        /* Size of the lines at the last allocation */
+  GSList                     *recycled_children;
+  GArray                     *selected_items;   /* Sorted positions of selected items */
+  guint                       update_children_id;
 };
 
 #define BOX_PRIV(box) ((GtkFlowBoxPrivate*)gtk_flow_box_get_instance_private ((GtkFlowBox*)(box)))
@@ -710,6 +737,10 @@ get_visible_children (GtkFlowBox *box)
   GSequenceIter *iter;
   gint i = 0;
 
+  /* In virtual mode, the items without children take up space too */
+  if (BOX_PRIV (box)->bind_widget_func)
+    return BOX_PRIV (box)->n_items;
+
   for (iter = g_sequence_get_begin_iter (BOX_PRIV (box)->children);
        !g_sequence_iter_is_end (iter);
        iter = g_sequence_iter_next (iter))
@@ -775,6 +806,8 @@ gtk_flow_box_child_set_selected (GtkFlowBoxChild *child,
 {
   if (CHILD_PRIV (child)->selected != selected)
     {
+      GtkFlowBox *box;
+
       CHILD_PRIV (child)->selected = selected;
       if (selected)
         gtk_widget_set_state_flags (GTK_WIDGET (child),
@@ -783,6 +816,10 @@ gtk_flow_box_child_set_selected (GtkFlowBoxChild *child,
         gtk_widget_unset_state_flags (GTK_WIDGET (child),
                                       GTK_STATE_FLAG_SELECTED);
 
+      box = gtk_flow_box_child_get_box (child);
+      if (box && BOX_PRIV (box)->bind_widget_func)
+        gtk_flow_box_set_item_selected (box, gtk_flow_box_child_get_index (child), selected);
+
       return TRUE;
     }
 
@@ -807,6 +844,13 @@ gtk_flow_box_unselect_all_internal (GtkFlowBox *box)
       dirty |= gtk_flow_box_child_set_selected (child, FALSE);
     }
 
+  if (BOX_PRIV (box)->bind_widget_func &&
+      BOX_PRIV (box)->selected_items->len > 0)
+    {
+      g_array_set_size (BOX_PRIV (box)->selected_items, 0);
+      dirty = TRUE;
+    }
+
   return dirty;
 }
 
@@ -1402,7 +1446,7 @@ gtk_flow_box_size_allocate (GtkWidget           *widget,
   gint line_offset, item_offset, n_children, n_lines, line_count;
   gint extra_pixels = 0, extra_per_item = 0, extra_extra = 0;
   gint extra_line_pixels = 0, extra_per_line = 0, extra_line_extra = 0;
-  gint i, this_line_size;
+  gint i, this_line_size, first_item;
   GSequenceIter *iter;
 
   min_items = MAX (1, priv->min_children_per_line);
@@ -1482,6 +1526,8 @@ gtk_flow_box_size_allocate (GtkWidget           *widget,
       /* Get the real extra pixels incase of GTK_ALIGN_START lines */
       extra_pixels = avail_size - (line_length - 1) * item_spacing - item_size * line_length;
       extra_line_pixels = avail_other_size - (n_lines - 1) * line_spacing - line_size * n_lines;
+
+      priv->line_size = line_size;
     }
   else
     {
@@ -1601,8 +1647,12 @@ gtk_flow_box_size_allocate (GtkWidget           *widget,
         }
     }
 
-  i = 0;
-  line_count = 0;
+  /* In virtual mode, the children start at the line of the first item */
+  first_item = gtk_flow_box_get_first_item (box);
+  line_count = first_item / line_length;
+  line_offset += line_count * (this_line_size + line_spacing);
+
+  i = first_item;
   for (iter = g_sequence_get_begin_iter (priv->children);
        !g_sequence_iter_is_end (iter);
        iter = g_sequence_iter_next (iter))
@@ -1620,7 +1670,7 @@ gtk_flow_box_size_allocate (GtkWidget           *widget,
       position = i % line_length;
 
       /* adjust the line_offset/count at the beginning of each new line */
-      if (i > 0 && position == 0)
+      if (i > first_item && position == 0)
         {
           /* Push the line_offset */
           line_offset += this_line_size + line_spacing;
@@ -1729,6 +1779,9 @@ gtk_flow_box_size_allocate (GtkWidget           *widget,
 
   g_free (item_sizes);
   g_free (line_sizes);
+
+  /* The children may not cover the visible area anymore */
+  gtk_flow_box_queue_update_children (box);
 }
 
 static GtkSizeRequestMode
@@ -3346,6 +3399,10 @@ gtk_flow_box_finalize (GObject *obj)
     priv->sort_destroy (priv->sort_data);
 
   g_sequence_free (priv->children);
+  if (priv->hadjustment)
+    g_signal_handlers_disconnect_by_func (priv->hadjustment, gtk_flow_box_queue_update_children, obj);
+  if (priv->vadjustment)
+    g_signal_handlers_disconnect_by_func (priv->vadjustment, gtk_flow_box_queue_update_children, obj);
   g_clear_object (&priv->hadjustment);
   g_clear_object (&priv->vadjustment);
 
@@ -3361,6 +3418,8 @@ gtk_flow_box_finalize (GObject *obj)
       g_clear_object (&priv->bound_model);
     }
 
+  gtk_flow_box_clear_virtual (GTK_FLOW_BOX (obj));
+
   G_OBJECT_CLASS (gtk_flow_box_parent_class)->finalize (obj);
 }
 
@@ -3734,6 +3793,399 @@ gtk_flow_box_init (GtkFlowBox *box)
                     G_CALLBACK (gtk_flow_box_drag_gesture_end), box);
 }
 
+/* Virtual mode
+ *
+ * Only the items between first_item and first_item + n_children have
+ * children, they are kept in priv->children like all other children.
+ * Since all lines have the same size in homogeneous boxes, the other
+ * items take up space in the allocation as if they had children.
+ */
+
+static guint
+gtk_flow_box_get_first_item (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (priv->bind_widget_func)
+    return priv->first_item;
+
+  return 0;
+}
+
+static gboolean
+gtk_flow_box_find_selected_item (GtkFlowBox *box,
+                                 guint       position,
+                                 guint      *index)
+{
+  GArray *items = BOX_PRIV (box)->selected_items;
+  guint lo, hi, mid;
+
+  lo = 0;
+  hi = items->len;
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (g_array_index (items, guint, mid) < position)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  if (index)
+    *index = lo;
+
+  return lo < items->len && g_array_index (items, guint, lo) == position;
+}
+
+static void
+gtk_flow_box_set_item_selected (GtkFlowBox *box,
+                                guint       position,
+                                gboolean    selected)
+{
+  GArray *items = BOX_PRIV (box)->selected_items;
+  guint index;
+
+  if (gtk_flow_box_find_selected_item (box, position, &index))
+    {
+      if (!selected)
+        g_array_remove_index (items, index);
+    }
+  else
+    {
+      if (selected)
+        g_array_insert_val (items, index, position);
+    }
+}
+
+/* The adjustment that scrolls across lines */
+static GtkAdjustment *
+gtk_flow_box_get_line_adjustment (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+    return priv->vadjustment;
+  else
+    return priv->hadjustment;
+}
+
+static GtkFlowBoxChild *
+gtk_flow_box_insert_item (GtkFlowBox *box,
+                          guint       position,
+                          gint        index)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GtkFlowBoxChild *child;
+  GtkWidget *widget;
+  gpointer item;
+
+  item = g_list_model_get_item (priv->bound_model, position);
+
+  if (priv->recycled_children)
+    {
+      child = priv->recycled_children->data;
+      priv->recycled_children = g_slist_delete_link (priv->recycled_children, priv->recycled_children);
+
+      if (CHILD_PRIV (child)->wrapper)
+        widget = gtk_bin_get_child (GTK_BIN (child));
+      else
+        widget = GTK_WIDGET (child);
+
+      priv->bind_widget_func (item, widget, priv->create_widget_func_data);
+      gtk_flow_box_insert (box, GTK_WIDGET (child), index);
+      g_object_unref (child);
+    }
+  else
+    {
+      widget = priv->create_widget_func (item, priv->create_widget_func_data);
+      if (g_object_is_floating (widget))
+        g_object_ref_sink (widget);
+
+      gtk_widget_show (widget);
+      gtk_flow_box_insert (box, widget, index);
+
+      if (GTK_IS_FLOW_BOX_CHILD (widget))
+        child = GTK_FLOW_BOX_CHILD (widget);
+      else
+        child = GTK_FLOW_BOX_CHILD (gtk_widget_get_parent (widget));
+
+      g_object_unref (widget);
+    }
+
+  if (gtk_flow_box_find_selected_item (box, position, NULL))
+    {
+      CHILD_PRIV (child)->selected = TRUE;
+      gtk_widget_set_state_flags (GTK_WIDGET (child), GTK_STATE_FLAG_SELECTED, FALSE);
+      if (priv->selection_mode != GTK_SELECTION_MULTIPLE)
+        priv->selected_child = child;
+    }
+
+  g_object_unref (item);
+
+  return child;
+}
+
+static void
+gtk_flow_box_recycle_child (GtkFlowBox      *box,
+                            GtkFlowBoxChild *child)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  /* The selection is kept in selected_items, so this must not be
+   * reported as a change
+   */
+  if (CHILD_PRIV (child)->selected)
+    {
+      CHILD_PRIV (child)->selected = FALSE;
+      gtk_widget_unset_state_flags (GTK_WIDGET (child), GTK_STATE_FLAG_SELECTED);
+    }
+
+  if (child == priv->cursor_child)
+    priv->cursor_child = NULL;
+  if (child == priv->rubberband_first)
+    priv->rubberband_first = NULL;
+  if (child == priv->rubberband_last)
+    priv->rubberband_last = NULL;
+
+  g_object_ref (child);
+  gtk_flow_box_remove (GTK_CONTAINER (box), GTK_WIDGET (child));
+  CHILD_PRIV (child)->iter = NULL;
+
+  priv->recycled_children = g_slist_prepend (priv->recycled_children, child);
+}
+
+static void
+gtk_flow_box_recycle_children_from (GtkFlowBox *box,
+                                    guint       index)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  while (g_sequence_get_length (priv->children) > index)
+    {
+      GSequenceIter *last;
+
+      last = g_sequence_iter_prev (g_sequence_get_end_iter (priv->children));
+      gtk_flow_box_recycle_child (box, g_sequence_get (last));
+    }
+}
+
+static void
+gtk_flow_box_update_virtual_children (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GtkAdjustment *adjustment;
+  guint n_children, line_length, want_first, want_last;
+  gboolean changed = FALSE;
+  GSList *l;
+
+  if (priv->update_children_id != 0)
+    {
+      g_source_remove (priv->update_children_id);
+      priv->update_children_id = 0;
+    }
+
+  if (!priv->bind_widget_func)
+    return;
+
+  n_children = g_sequence_get_length (priv->children);
+  line_length = MAX (priv->cur_children_per_line, 1);
+  adjustment = gtk_flow_box_get_line_adjustment (box);
+
+  /* Keep a page of lines before and after the visible ones */
+  if (priv->n_items == 0)
+    {
+      want_first = 0;
+      want_last = 0;
+    }
+  else if (adjustment == NULL)
+    {
+      want_first = 0;
+      want_last = priv->n_items;
+    }
+  else if (priv->line_size <= 0)
+    {
+      /* Not allocated yet, one line is enough to find the line size */
+      want_first = MIN (priv->first_item, priv->n_items - 1);
+      want_first -= want_first % line_length;
+      want_last = MIN (want_first + line_length, priv->n_items);
+    }
+  else
+    {
+      gdouble value = gtk_adjustment_get_value (adjustment);
+      gdouble page = gtk_adjustment_get_page_size (adjustment);
+      gint line_spacing, stride;
+
+      if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+        line_spacing = priv->row_spacing;
+      else
+        line_spacing = priv->column_spacing;
+
+      stride = priv->line_size + line_spacing;
+
+      want_first = MAX (value - page, 0) / stride;
+      want_last = (value + 2 * page) / stride + 1;
+      want_first = MIN (want_first * line_length, priv->n_items);
+      want_last = MIN (want_last * line_length, priv->n_items);
+    }
+
+  if (want_last <= priv->first_item ||
+      want_first >= priv->first_item + n_children)
+    {
+      /* None of the children are needed anymore */
+      if (n_children > 0)
+        {
+          gtk_flow_box_recycle_children_from (box, 0);
+          changed = TRUE;
+        }
+
+      priv->first_item = want_first;
+      n_children = 0;
+    }
+  else
+    {
+      while (priv->first_item < want_first)
+        {
+          gtk_flow_box_recycle_child (box, g_sequence_get (g_sequence_get_begin_iter (priv->children)));
+          priv->first_item++;
+          n_children--;
+          changed = TRUE;
+        }
+
+      if (priv->first_item + n_children > want_last)
+        {
+          n_children = want_last - priv->first_item;
+          gtk_flow_box_recycle_children_from (box, n_children);
+          changed = TRUE;
+        }
+    }
+
+  while (priv->first_item + n_children < want_last)
+    {
+      gtk_flow_box_insert_item (box, priv->first_item + n_children, -1);
+      n_children++;
+      changed = TRUE;
+    }
+
+  while (priv->first_item > want_first)
+    {
+      priv->first_item--;
+      gtk_flow_box_insert_item (box, priv->first_item, 0);
+      n_children++;
+      changed = TRUE;
+    }
+
+  /* Keep as many children around as are in use */
+  l = n_children > 0 ? g_slist_nth (priv->recycled_children, n_children - 1) : NULL;
+  if (l)
+    {
+      g_slist_free_full (l->next, g_object_unref);
+      l->next = NULL;
+    }
+  else if (n_children == 0)
+    {
+      g_slist_free_full (priv->recycled_children, g_object_unref);
+      priv->recycled_children = NULL;
+    }
+
+  if (changed)
+    gtk_widget_queue_resize (GTK_WIDGET (box));
+}
+
+static gboolean
+gtk_flow_box_update_children_cb (gpointer data)
+{
+  GtkFlowBox *box = data;
+
+  BOX_PRIV (box)->update_children_id = 0;
+  gtk_flow_box_update_virtual_children (box);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_flow_box_queue_update_children (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (!priv->bind_widget_func || priv->update_children_id != 0)
+    return;
+
+  /* Before the resize, so new children get allocated in the same frame */
+  priv->update_children_id = gdk_threads_add_idle_full (GTK_PRIORITY_RESIZE - 1,
+                                                        gtk_flow_box_update_children_cb,
+                                                        box, NULL);
+  g_source_set_name_by_id (priv->update_children_id, "[gtk+] gtk_flow_box_update_children_cb");
+}
+
+static void
+gtk_flow_box_clear_virtual (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (priv->update_children_id != 0)
+    {
+      g_source_remove (priv->update_children_id);
+      priv->update_children_id = 0;
+    }
+
+  g_slist_free_full (priv->recycled_children, g_object_unref);
+  priv->recycled_children = NULL;
+  g_clear_pointer (&priv->selected_items, g_array_unref);
+
+  priv->bind_widget_func = NULL;
+  priv->n_items = 0;
+  priv->first_item = 0;
+  priv->line_size = 0;
+}
+
+static void
+gtk_flow_box_virtual_model_changed (GtkFlowBox *box,
+                                    guint       position,
+                                    guint       removed,
+                                    guint       added)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GArray *selected_items = priv->selected_items;
+  gboolean selection_changed = FALSE;
+  guint n_children, i, j;
+
+  /* Selected items move with the items around them */
+  for (i = 0, j = 0; i < selected_items->len; i++)
+    {
+      guint item = g_array_index (selected_items, guint, i);
+
+      if (item >= position + removed)
+        g_array_index (selected_items, guint, j++) = item - removed + added;
+      else if (item >= position)
+        selection_changed = TRUE;
+      else
+        g_array_index (selected_items, guint, j++) = item;
+    }
+  g_array_set_size (selected_items, j);
+
+  /* The children stay in their place in the grid, the ones that
+   * show other items now are created again
+   */
+  n_children = g_sequence_get_length (priv->children);
+  if (position < priv->first_item + n_children)
+    {
+      if (position <= priv->first_item)
+        gtk_flow_box_recycle_children_from (box, 0);
+      else
+        gtk_flow_box_recycle_children_from (box, position - priv->first_item);
+    }
+
+  priv->n_items = priv->n_items - removed + added;
+  if (g_sequence_is_empty (priv->children))
+    priv->first_item = MIN (priv->first_item, priv->n_items);
+
+  gtk_flow_box_update_virtual_children (box);
+  gtk_widget_queue_resize (GTK_WIDGET (box));
+
+  if (selection_changed)
+    g_signal_emit (box, signals[SELECTED_CHILDREN_CHANGED], 0);
+}
+
 static void
 gtk_flow_box_bound_model_changed (GListModel *list,
                                   guint       position,
@@ -3745,6 +4197,12 @@ gtk_flow_box_bound_model_changed (GListModel *list,
   GtkFlowBoxPrivate *priv = BOX_PRIV (box);
   gint i;
 
+  if (priv->bind_widget_func)
+    {
+      gtk_flow_box_virtual_model_changed (box, position, removed, added);
+      return;
+    }
+
   while (removed--)
     {
       GtkFlowBoxChild *child;
@@ -3854,6 +4312,7 @@ gtk_flow_box_insert (GtkFlowBox *box,
       child = GTK_FLOW_BOX_CHILD (gtk_flow_box_child_new ());
       gtk_widget_show (GTK_WIDGET (child));
       gtk_container_add (GTK_CONTAINER (child), widget);
+      CHILD_PRIV (child)->wrapper = TRUE;
     }
 
   if (priv->sort_func != NULL)
@@ -3898,6 +4357,14 @@ gtk_flow_box_get_child_at_index (GtkFlowBox *box,
 
   g_return_val_if_fail (GTK_IS_FLOW_BOX (box), NULL);
 
+  if (BOX_PRIV (box)->bind_widget_func)
+    {
+      if (idx < (gint) BOX_PRIV (box)->first_item)
+        return NULL;
+
+      idx -= BOX_PRIV (box)->first_item;
+    }
+
   iter = g_sequence_get_iter_at_pos (BOX_PRIV (box)->children, idx);
   if (!g_sequence_iter_is_end (iter))
     return g_sequence_get (iter);
@@ -3975,11 +4442,23 @@ gtk_flow_box_set_hadjustment (GtkFlowBox    *box,
 
   priv = BOX_PRIV (box);
 
+  if (adjustment == priv->hadjustment)
+    return;
+
   g_object_ref (adjustment);
+  g_signal_connect_swapped (adjustment, "value-changed",
+                            G_CALLBACK (gtk_flow_box_queue_update_children), box);
+  g_signal_connect_swapped (adjustment, "changed",
+                            G_CALLBACK (gtk_flow_box_queue_update_children), box);
   if (priv->hadjustment)
-    g_object_unref (priv->hadjustment);
+    {
+      g_signal_handlers_disconnect_by_func (priv->hadjustment, gtk_flow_box_queue_update_children, box);
+      g_object_unref (priv->hadjustment);
+    }
   priv->hadjustment = adjustment;
   gtk_container_set_focus_hadjustment (GTK_CONTAINER (box), adjustment);
+
+  gtk_flow_box_queue_update_children (box);
 }
 
 /**
@@ -4012,11 +4491,23 @@ gtk_flow_box_set_vadjustment (GtkFlowBox    *box,
 
   priv = BOX_PRIV (box);
 
+  if (adjustment == priv->vadjustment)
+    return;
+
   g_object_ref (adjustment);
+  g_signal_connect_swapped (adjustment, "value-changed",
+                            G_CALLBACK (gtk_flow_box_queue_update_children), box);
+  g_signal_connect_swapped (adjustment, "changed",
+                            G_CALLBACK (gtk_flow_box_queue_update_children), box);
   if (priv->vadjustment)
-    g_object_unref (priv->vadjustment);
+    {
+      g_signal_handlers_disconnect_by_func (priv->vadjustment, gtk_flow_box_queue_update_children, box);
+      g_object_unref (priv->vadjustment);
+    }
   priv->vadjustment = adjustment;
   gtk_container_set_focus_vadjustment (GTK_CONTAINER (box), adjustment);
+
+  gtk_flow_box_queue_update_children (box);
 }
 
 static void
@@ -4029,6 +4520,52 @@ gtk_flow_box_check_model_compat (GtkFlowBox *box)
     g_warning ("GtkFlowBox with a model will ignore sort and filter functions");
 }
 
+static void
+gtk_flow_box_bind_model_internal (GtkFlowBox                 *box,
+                                  GListModel                 *model,
+                                  GtkFlowBoxCreateWidgetFunc  create_widget_func,
+                                  GtkFlowBoxBindWidgetFunc    bind_widget_func,
+                                  gpointer                    user_data,
+                                  GDestroyNotify              user_data_free_func)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (priv->bound_model)
+    {
+      if (priv->create_widget_func_data_destroy)
+        priv->create_widget_func_data_destroy (priv->create_widget_func_data);
+
+      g_signal_handlers_disconnect_by_func (priv->bound_model, gtk_flow_box_bound_model_changed, box);
+      g_clear_object (&priv->bound_model);
+    }
+
+  gtk_flow_box_forall (GTK_CONTAINER (box), (GtkCallback) gtk_widget_destroy, NULL);
+
+  gtk_flow_box_clear_virtual (box);
+
+  if (model == NULL)
+    return;
+
+  priv->bound_model = g_object_ref (model);
+  priv->create_widget_func = create_widget_func;
+  priv->create_widget_func_data = user_data;
+  priv->create_widget_func_data_destroy = user_data_free_func;
+
+  gtk_flow_box_check_model_compat (box);
+
+  g_signal_connect (priv->bound_model, "items-changed", G_CALLBACK (gtk_flow_box_bound_model_changed), box);
+
+  if (bind_widget_func)
+    {
+      priv->bind_widget_func = bind_widget_func;
+      priv->n_items = g_list_model_get_n_items (model);
+      priv->selected_items = g_array_new (FALSE, FALSE, sizeof (guint));
+      gtk_flow_box_update_virtual_children (box);
+    }
+  else
+    gtk_flow_box_bound_model_changed (model, 0, 0, g_list_model_get_n_items (model), box);
+}
+
 /**
  * gtk_flow_box_bind_model:
  * @box: a #GtkFlowBox
@@ -4063,35 +4600,66 @@ gtk_flow_box_bind_model (GtkFlowBox                 *box,
                          gpointer                    user_data,
                          GDestroyNotify              user_data_free_func)
 {
-  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
-
   g_return_if_fail (GTK_IS_FLOW_BOX (box));
   g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
   g_return_if_fail (model == NULL || create_widget_func != NULL);
 
-  if (priv->bound_model)
-    {
-      if (priv->create_widget_func_data_destroy)
-        priv->create_widget_func_data_destroy (priv->create_widget_func_data);
-
-      g_signal_handlers_disconnect_by_func (priv->bound_model, gtk_flow_box_bound_model_changed, box);
-      g_clear_object (&priv->bound_model);
-    }
-
-  gtk_flow_box_forall (GTK_CONTAINER (box), (GtkCallback) gtk_widget_destroy, NULL);
-
-  if (model == NULL)
-    return;
-
-  priv->bound_model = g_object_ref (model);
-  priv->create_widget_func = create_widget_func;
-  priv->create_widget_func_data = user_data;
-  priv->create_widget_func_data_destroy = user_data_free_func;
+  gtk_flow_box_bind_model_internal (box, model,
+                                    create_widget_func, NULL,
+                                    user_data, user_data_free_func);
+}
 
-  gtk_flow_box_check_model_compat (box);
+/**
+ * gtk_flow_box_bind_model_virtual:
+ * @box: a homogeneous #GtkFlowBox
+ * @model: (nullable): the #GListModel to be bound to @box
+ * @create_widget_func: (nullable): a function that creates widgets for items
+ *   or %NULL in case you also passed %NULL as @model
+ * @bind_widget_func: (nullable): a function that makes a widget created by
+ *   @create_widget_func show another item, or %NULL in case you also
+ *   passed %NULL as @model
+ * @user_data: user data passed to @create_widget_func and @bind_widget_func
+ * @user_data_free_func: function for freeing @user_data
+ *
+ * Binds @model to @box like gtk_flow_box_bind_model(), but only creates
+ * children for the lines that are visible in the adjustment set with
+ * gtk_flow_box_set_vadjustment() (or gtk_flow_box_set_hadjustment() for
+ * vertical boxes), plus a page before and after them. When scrolling,
+ * the children that are no longer needed are reused for other items by
+ * calling @bind_widget_func on them, so @create_widget_func is only
+ * called as often as necessary to fill the visible area. This makes
+ * @box usable with models containing a large number of items.
+ *
+ * This only works for homogeneous boxes, where every line has the
+ * same size, and @box has to stay homogeneous while it is bound.
+ *
+ * Selection is tracked by position in @model. Functions that return
+ * children, like gtk_flow_box_get_child_at_index() or
+ * gtk_flow_box_get_selected_children(), only see the children that
+ * currently exist. gtk_flow_box_child_get_index() returns the position
+ * of the child's item in @model.
+ *
+ * If no adjustment has been set, children are created for all items.
+ *
+ * Since: 3.94
+ */
+void
+gtk_flow_box_bind_model_virtual (GtkFlowBox                 *box,
+                                 GListModel                 *model,
+                                 GtkFlowBoxCreateWidgetFunc  create_widget_func,
+                                 GtkFlowBoxBindWidgetFunc    bind_widget_func,
+                                 gpointer                    user_data,
+                                 GDestroyNotify              user_data_free_func)
+{
+  g_return_if_fail (GTK_IS_FLOW_BOX (box));
+  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
+  g_return_if_fail (model == NULL || create_widget_func != NULL);
+  g_return_if_fail (model == NULL || bind_widget_func != NULL);
+  g_return_if_fail (model == NULL || BOX_PRIV (box)->homogeneous);
 
-  g_signal_connect (priv->bound_model, "items-changed", G_CALLBACK (gtk_flow_box_bound_model_changed), box);
-  gtk_flow_box_bound_model_changed (model, 0, 0, g_list_model_get_n_items (model), box);
+  gtk_flow_box_bind_model_internal (box, model,
+                                    create_widget_func, bind_widget_func,
+                                    user_data, user_data_free_func);
 }
 
 /* Setters and getters {{{2 */
@@ -4132,6 +4700,7 @@ gtk_flow_box_set_homogeneous (GtkFlowBox *box,
                               gboolean    homogeneous)
 {
   g_return_if_fail (GTK_IS_FLOW_BOX (box));
+  g_return_if_fail (homogeneous || BOX_PRIV (box)->bind_widget_func == NULL);
 
   homogeneous = homogeneous != FALSE;
 
@@ -4460,6 +5029,18 @@ gtk_flow_box_select_all (GtkFlowBox *box)
   if (g_sequence_get_length (BOX_PRIV (box)->children) > 0)
     {
       gtk_flow_box_select_all_between (box, NULL, NULL, FALSE);
+
+      /* Including the items that have no children */
+      if (BOX_PRIV (box)->bind_widget_func)
+        {
+          GArray *selected_items = BOX_PRIV (box)->selected_items;
+          guint i;
+
+          g_array_set_size (selected_items, BOX_PRIV (box)->n_items);
+          for (i = 0; i < selected_items->len; i++)
+            g_array_index (selected_items, guint, i) = i;
+        }
+
       g_signal_emit (box, signals[SELECTED_CHILDREN_CHANGED], 0);
     }
 }
@@ -24,6 +24,7 @@
 #include "gtkmarshalers.h"
 #include "gtkprivate.h"
 #include "gtkintl.h"
+#include "gtkmain.h"
 #include "gtkwidgetprivate.h"
 #include "gtkcontainerprivate.h"
 
@@ -116,6 +117,20 @@ typedef struct
   GtkListBoxCreateWidgetFunc create_widget_func;
   gpointer create_widget_func_data;
   GDestroyNotify create_widget_func_data_destroy;
+
+  /* Virtual mode, only rows for the items near the visible area
+   * exist; it is used if bind_widget_func is set
+   */
+  GtkListBoxBindWidgetFunc bind_widget_func;
+  guint n_items;
+  guint first_item;             /* Position of the first row in the model */
+  gint first_item_y;            /* Estimated y of the first row */
+  gint row_height_estimate;     /* Average height of the rows */
+  GSList *recycled_rows;
+  GArray *selected_items;       /* Sorted positions of selected items */
+  GtkListBoxRow *kept_row;      /* Cursor or focus row of an item without rows */
+  guint kept_item;
+  guint update_rows_id;
 } GtkListBoxPrivate;
 
 typedef struct
@@ -128,6 +143,7 @@ typedef struct
   guint selected    :1;
   guint activatable :1;
   guint selectable  :1;
+  guint wrapper     :1;
 } GtkListBoxRowPrivate;
 
 enum {
@@ -258,6 +274,17 @@ static void                 gtk_list_box_bound_model_changed            (GListMo
 
 static void                 gtk_list_box_check_model_compat             (GtkListBox          *box);
 
+static void                 gtk_list_box_set_item_selected              (GtkListBox          *box,
+                                                                         guint                position,
+                                                                         gboolean             selected);
+static gint                 gtk_list_box_get_item_y                     (GtkListBox          *box,
+                                                                         guint                position);
+static void                 gtk_list_box_queue_update_rows              (GtkListBox          *box);
+static void                 gtk_list_box_restore_kept_row               (GtkListBox          *box);
+static void                 gtk_list_box_scroll_to_item                 (GtkListBox          *box,
+                                                                         guint                position);
+static void                 gtk_list_box_clear_virtual                  (GtkListBox          *box);
+
 static void gtk_list_box_measure (GtkWidget     *widget,
                                   GtkOrientation  orientation,
                                   int             for_size,
@@ -344,6 +371,8 @@ gtk_list_box_finalize (GObject *obj)
   if (priv->update_header_func_target_destroy_notify != NULL)
     priv->update_header_func_target_destroy_notify (priv->update_header_func_target);
 
+  if (priv->adjustment)
+    g_signal_handlers_disconnect_by_func (priv->adjustment, gtk_list_box_queue_update_rows, obj);
   g_clear_object (&priv->adjustment);
   g_clear_object (&priv->drag_highlighted_row);
   g_clear_object (&priv->multipress_gesture);
@@ -360,6 +389,8 @@ gtk_list_box_finalize (GObject *obj)
       g_clear_object (&priv->bound_model);
     }
 
+  gtk_list_box_clear_virtual (GTK_LIST_BOX (obj));
+
   G_OBJECT_CLASS (gtk_list_box_parent_class)->finalize (obj);
 }
 
@@ -651,6 +682,14 @@ gtk_list_box_get_row_at_index (GtkListBox *box,
 
   g_return_val_if_fail (GTK_IS_LIST_BOX (box), NULL);
 
+  if (BOX_PRIV (box)->bind_widget_func)
+    {
+      if (index_ < (gint) BOX_PRIV (box)->first_item)
+        return NULL;
+
+      index_ -= BOX_PRIV (box)->first_item;
+    }
+
   iter = g_sequence_get_iter_at_pos (BOX_PRIV (box)->children, index_);
   if (!g_sequence_iter_is_end (iter))
     return g_sequence_get (iter);
@@ -774,6 +813,18 @@ gtk_list_box_select_all (GtkListBox *box)
   if (g_sequence_get_length (BOX_PRIV (box)->children) > 0)
     {
       gtk_list_box_select_all_between (box, NULL, NULL, FALSE);
+
+      /* Including the items that have no rows */
+      if (BOX_PRIV (box)->bind_widget_func)
+        {
+          GArray *selected_items = BOX_PRIV (box)->selected_items;
+          guint i;
+
+          g_array_set_size (selected_items, BOX_PRIV (box)->n_items);
+          for (i = 0; i < selected_items->len; i++)
+            g_array_index (selected_items, guint, i) = i;
+        }
+
       g_signal_emit (box, signals[SELECTED_ROWS_CHANGED], 0);
     }
 }
@@ -948,11 +999,25 @@ gtk_list_box_set_adjustment (GtkListBox    *box,
   g_return_if_fail (GTK_IS_LIST_BOX (box));
   g_return_if_fail (adjustment == NULL || GTK_IS_ADJUSTMENT (adjustment));
 
+  if (adjustment == priv->adjustment)
+    return;
+
   if (adjustment)
-    g_object_ref_sink (adjustment);
+    {
+      g_object_ref_sink (adjustment);
+      g_signal_connect_swapped (adjustment, "value-changed",
+                                G_CALLBACK (gtk_list_box_queue_update_rows), box);
+      g_signal_connect_swapped (adjustment, "changed",
+                                G_CALLBACK (gtk_list_box_queue_update_rows), box);
+    }
   if (priv->adjustment)
-    g_object_unref (priv->adjustment);
+    {
+      g_signal_handlers_disconnect_by_func (priv->adjustment, gtk_list_box_queue_update_rows, box);
+      g_object_unref (priv->adjustment);
+    }
   priv->adjustment = adjustment;
+
+  gtk_list_box_queue_update_rows (box);
 }
 
 /**
@@ -1331,6 +1396,9 @@ gtk_list_box_got_row_changed (GtkListBox    *box,
   g_return_if_fail (GTK_IS_LIST_BOX (box));
   g_return_if_fail (GTK_IS_LIST_BOX_ROW (row));
 
+  if (row == priv->kept_row)
+    return;
+
   prev_next = gtk_list_box_get_next_visible (box, row_priv->iter);
   if (priv->sort_func != NULL)
     {
@@ -1448,9 +1516,18 @@ ensure_row_visible (GtkListBox    *box,
   if (!priv->adjustment)
     return;
 
-  gtk_widget_get_outer_allocation (GTK_WIDGET (row), &allocation);
-  y = allocation.y;
-  height = allocation.height;
+  /* In virtual mode, the row may have been created for this */
+  if (priv->bind_widget_func)
+    {
+      y = ROW_PRIV (row)->y;
+      height = ROW_PRIV (row)->height;
+    }
+  else
+    {
+      gtk_widget_get_outer_allocation (GTK_WIDGET (row), &allocation);
+      y = allocation.y;
+      height = allocation.height;
+    }
 
   /* If the row has a header, we want to ensure that it is visible as well. */
   header = ROW_PRIV (row)->header;
@@ -1504,6 +1581,8 @@ gtk_list_box_row_set_selected (GtkListBoxRow *row,
 
   if (ROW_PRIV (row)->selected != selected)
     {
+      GtkListBox *box;
+
       ROW_PRIV (row)->selected = selected;
       if (selected)
         gtk_widget_set_state_flags (GTK_WIDGET (row),
@@ -1512,6 +1591,10 @@ gtk_list_box_row_set_selected (GtkListBoxRow *row,
         gtk_widget_unset_state_flags (GTK_WIDGET (row),
                                       GTK_STATE_FLAG_SELECTED);
 
+      box = gtk_list_box_row_get_box (row);
+      if (box && BOX_PRIV (box)->bind_widget_func)
+        gtk_list_box_set_item_selected (box, gtk_list_box_row_get_index (row), selected);
+
       return TRUE;
     }
 
@@ -1538,6 +1621,13 @@ gtk_list_box_unselect_all_internal (GtkListBox *box)
 
   BOX_PRIV (box)->selected_row = NULL;
 
+  if (BOX_PRIV (box)->bind_widget_func &&
+      BOX_PRIV (box)->selected_items->len > 0)
+    {
+      g_array_set_size (BOX_PRIV (box)->selected_items, 0);
+      dirty = TRUE;
+    }
+
   return dirty;
 }
 
@@ -1860,6 +1950,10 @@ gtk_list_box_focus (GtkWidget        *widget,
   GtkWidget *row;
   GtkWidget *header;
 
+  if (priv->kept_row &&
+      gtk_widget_get_focus_child (widget) == GTK_WIDGET (priv->kept_row))
+    gtk_list_box_restore_kept_row (box);
+
   focus_child = gtk_widget_get_focus_child (widget);
 
   next_focus_row = NULL;
@@ -2214,6 +2308,10 @@ static void
 gtk_list_box_row_visibility_changed (GtkListBox    *box,
                                      GtkListBoxRow *row)
 {
+  /* Updated when the row is back in the list */
+  if (row == BOX_PRIV (box)->kept_row)
+    return;
+
   update_row_is_visible (box, row);
 
   if (gtk_widget_get_visible (GTK_WIDGET (box)))
@@ -2274,6 +2372,20 @@ gtk_list_box_remove (GtkContainer *container,
     }
 
   row = GTK_LIST_BOX_ROW (child);
+  if (row == priv->kept_row)
+    {
+      priv->kept_row = NULL;
+      if (row == priv->cursor_row)
+        priv->cursor_row = NULL;
+      if (row == priv->active_row)
+        {
+          gtk_widget_unset_state_flags (GTK_WIDGET (row), GTK_STATE_FLAG_ACTIVE);
+          priv->active_row = NULL;
+        }
+      gtk_widget_unparent (child);
+      return;
+    }
+
   if (g_sequence_iter_get_sequence (ROW_PRIV (row)->iter) != priv->children)
     {
       g_warning ("Tried to remove non-child %p", child);
@@ -2333,6 +2445,9 @@ gtk_list_box_forall (GtkContainer *container,
   if (priv->placeholder != NULL)
     callback (priv->placeholder, callback_target);
 
+  if (priv->kept_row != NULL)
+    callback (GTK_WIDGET (priv->kept_row), callback_target);
+
   iter = g_sequence_get_begin_iter (priv->children);
   while (!g_sequence_iter_is_end (iter))
     {
@@ -2466,6 +2581,15 @@ gtk_list_box_measure (GtkWidget     *widget,
           *minimum += row_min;
         }
 
+      /* Add the estimated height of the items without rows */
+      if (priv->bind_widget_func)
+        {
+          guint n_rows = g_sequence_get_length (priv->children);
+
+          *minimum += priv->first_item_y +
+                      (priv->n_items - priv->first_item - n_rows) * priv->row_height_estimate;
+        }
+
       /* We always allocate the minimum height, since handling expanding rows
        * is way too costly, and unlikely to be used, as lists are generally put
        * inside a scrolling window anyway.
@@ -2487,6 +2611,7 @@ gtk_list_box_size_allocate (GtkWidget           *widget,
   GtkListBoxRow *row;
   GSequenceIter *iter;
   int child_min;
+  int kept_y = 0;
 
 
   child_allocation.x = allocation->x;
@@ -2511,6 +2636,13 @@ gtk_list_box_size_allocate (GtkWidget           *widget,
       child_allocation.y += child_min;
     }
 
+  if (priv->bind_widget_func)
+    {
+      if (priv->kept_row)
+        kept_y = gtk_list_box_get_item_y (GTK_LIST_BOX (widget), priv->kept_item);
+      child_allocation.y += priv->first_item_y;
+    }
+
   for (iter = g_sequence_get_begin_iter (priv->children);
        !g_sequence_iter_is_end (iter);
        iter = g_sequence_iter_next (iter))
@@ -2550,6 +2682,17 @@ gtk_list_box_size_allocate (GtkWidget           *widget,
       gdk_rectangle_union (out_clip, &child_clip, out_clip);
       child_allocation.y += child_min;
     }
+
+  /* The kept row goes where its item would be, outside the page */
+  if (priv->kept_row)
+    {
+      gtk_widget_measure (GTK_WIDGET (priv->kept_row), GTK_ORIENTATION_VERTICAL,
+                          child_allocation.width,
+                          &child_min, NULL, NULL, NULL);
+      child_allocation.y = allocation->y + kept_y;
+      child_allocation.height = child_min;
+      gtk_widget_size_allocate (GTK_WIDGET (priv->kept_row), &child_allocation, -1, &child_clip);
+    }
 }
 
 /**
@@ -2623,6 +2766,7 @@ gtk_list_box_insert (GtkListBox *box,
     {
       row = GTK_LIST_BOX_ROW (gtk_list_box_row_new ());
       gtk_container_add (GTK_CONTAINER (row), child);
+      ROW_PRIV (row)->wrapper = TRUE;
     }
 
   if (priv->sort_func != NULL)
@@ -2723,6 +2867,7 @@ gtk_list_box_drag_leave (GtkWidget      *widget,
 static void
 gtk_list_box_activate_cursor_row (GtkListBox *box)
 {
+  gtk_list_box_restore_kept_row (box);
   gtk_list_box_select_and_activate (box, BOX_PRIV (box)->cursor_row);
 }
 
@@ -2731,6 +2876,8 @@ gtk_list_box_toggle_cursor_row (GtkListBox *box)
 {
   GtkListBoxPrivate *priv = BOX_PRIV (box);
 
+  gtk_list_box_restore_kept_row (box);
+
   if (priv->cursor_row == NULL)
     return;
 
@@ -2757,10 +2904,15 @@ gtk_list_box_move_cursor (GtkListBox      *box,
   gint end_y;
   int height;
 
+  gtk_list_box_restore_kept_row (box);
+
   row = NULL;
   switch ((guint) step)
     {
     case GTK_MOVEMENT_BUFFER_ENDS:
+      if (priv->bind_widget_func && priv->n_items > 0)
+        gtk_list_box_scroll_to_item (box, count < 0 ? 0 : priv->n_items - 1);
+
       if (count < 0)
         row = gtk_list_box_get_first_focusable (box);
       else
@@ -3100,7 +3252,14 @@ gtk_list_box_row_get_index (GtkListBoxRow *row)
   priv = ROW_PRIV (row);
 
   if (priv->iter != NULL)
-    return g_sequence_iter_get_position (priv->iter);
+    {
+      GtkListBox *box = gtk_list_box_row_get_box (row);
+
+      if (box && BOX_PRIV (box)->bind_widget_func)
+        return BOX_PRIV (box)->first_item + g_sequence_iter_get_position (priv->iter);
+
+      return g_sequence_iter_get_position (priv->iter);
+    }
 
   return -1;
 }
@@ -3414,131 +3573,955 @@ gtk_list_box_buildable_interface_init (GtkBuildableIface *iface)
   iface->add_child = gtk_list_box_buildable_add_child;
 }
 
-static void
-gtk_list_box_bound_model_changed (GListModel *list,
-                                  guint       position,
-                                  guint       removed,
-                                  guint       added,
-                                  gpointer    user_data)
+/* Virtual mode
+ *
+ * Only the items between first_item and first_item + n_rows have rows,
+ * they are kept in priv->children like all other rows. The items before
+ * them are assumed to take up first_item_y pixels, the items after them
+ * row_height_estimate pixels each.
+ *
+ * When the cursor or focus row scrolls away it is taken out of the list
+ * as kept_row instead of being recycled, so it keeps the focus.
+ */
+
+static gboolean
+gtk_list_box_find_selected_item (GtkListBox *box,
+                                 guint       position,
+                                 guint      *index)
 {
-  GtkListBox *box = user_data;
-  GtkListBoxPrivate *priv = BOX_PRIV (user_data);
-  guint i;
+  GArray *items = BOX_PRIV (box)->selected_items;
+  guint lo, hi, mid;
 
-  while (removed--)
+  lo = 0;
+  hi = items->len;
+  while (lo < hi)
     {
-      GtkListBoxRow *row;
+      mid = (lo + hi) / 2;
+      if (g_array_index (items, guint, mid) < position)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
 
-      row = gtk_list_box_get_row_at_index (box, position);
-      gtk_container_remove (GTK_CONTAINER (box), GTK_WIDGET (row));
+  if (index)
+    *index = lo;
+
+  return lo < items->len && g_array_index (items, guint, lo) == position;
+}
+
+static void
+gtk_list_box_set_item_selected (GtkListBox *box,
+                                guint       position,
+                                gboolean    selected)
+{
+  GArray *items = BOX_PRIV (box)->selected_items;
+  guint index;
+
+  if (gtk_list_box_find_selected_item (box, position, &index))
+    {
+      if (!selected)
+        g_array_remove_index (items, index);
+    }
+  else
+    {
+      if (selected)
+        g_array_insert_val (items, index, position);
     }
+}
 
-  for (i = 0; i < added; i++)
+static gint
+gtk_list_box_get_row_extent (GtkListBoxRow *row,
+                             gint           width)
+{
+  gint extent = 0;
+  gint min;
+
+  if (!row_is_visible (row))
+    return 0;
+
+  if (ROW_PRIV (row)->header != NULL)
     {
-      GObject *item;
-      GtkWidget *widget;
+      gtk_widget_measure (ROW_PRIV (row)->header, GTK_ORIENTATION_VERTICAL,
+                          width, &min, NULL, NULL, NULL);
+      extent += min;
+    }
 
-      item = g_list_model_get_item (list, position + i);
-      widget = priv->create_widget_func (item, priv->create_widget_func_data);
+  gtk_widget_measure (GTK_WIDGET (row), GTK_ORIENTATION_VERTICAL,
+                      width, &min, NULL, NULL, NULL);
+  extent += min;
 
-      /* We allow the create_widget_func to either return a full
-       * reference or a floating reference.  If we got the floating
-       * reference, then turn it into a full reference now.  That means
-       * that gtk_list_box_insert() will take another full reference.
-       * Finally, we'll release this full reference below, leaving only
-       * the one held by the box.
-       */
-      if (g_object_is_floating (widget))
-        g_object_ref_sink (widget);
+  return extent;
+}
 
-      gtk_widget_show (widget);
-      gtk_list_box_insert (box, widget, position + i);
+/* Updates the positions of the rows like gtk_list_box_size_allocate()
+ * does, so they can be used before the next allocation.
+ */
+static gint
+gtk_list_box_layout_virtual_rows (GtkListBox *box,
+                                  gint        width)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GSequenceIter *iter;
+  GtkListBoxRow *row;
+  gint y, min;
 
-      g_object_unref (widget);
-      g_object_unref (item);
+  y = priv->first_item_y;
+
+  for (iter = g_sequence_get_begin_iter (priv->children);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      row = g_sequence_get (iter);
+      if (!row_is_visible (row))
+        {
+          ROW_PRIV (row)->y = y;
+          ROW_PRIV (row)->height = 0;
+          continue;
+        }
+
+      if (ROW_PRIV (row)->header != NULL)
+        {
+          gtk_widget_measure (ROW_PRIV (row)->header, GTK_ORIENTATION_VERTICAL,
+                              width, &min, NULL, NULL, NULL);
+          y += min;
+        }
+
+      gtk_widget_measure (GTK_WIDGET (row), GTK_ORIENTATION_VERTICAL,
+                          width, &min, NULL, NULL, NULL);
+      ROW_PRIV (row)->y = y;
+      ROW_PRIV (row)->height = min;
+      y += min;
     }
+
+  return y;
 }
 
-static void
-gtk_list_box_check_model_compat (GtkListBox *box)
+static gint
+gtk_list_box_get_rows_end (GtkListBox *box)
 {
   GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GtkListBoxRow *row;
 
-  if (priv->bound_model &&
-      (priv->sort_func || priv->filter_func))
-    g_warning ("GtkListBox with a model will ignore sort and filter functions");
+  if (g_sequence_is_empty (priv->children))
+    return priv->first_item_y;
+
+  row = g_sequence_get (g_sequence_iter_prev (g_sequence_get_end_iter (priv->children)));
+
+  return ROW_PRIV (row)->y + ROW_PRIV (row)->height;
 }
 
-/**
- * gtk_list_box_bind_model:
- * @box: a #GtkListBox
- * @model: (nullable): the #GListModel to be bound to @box
- * @create_widget_func: (nullable): a function that creates widgets for items
- *   or %NULL in case you also passed %NULL as @model
- * @user_data: user data passed to @create_widget_func
- * @user_data_free_func: function for freeing @user_data
- *
- * Binds @model to @box.
- *
- * If @box was already bound to a model, that previous binding is
- * destroyed.
- *
- * The contents of @box are cleared and then filled with widgets that
- * represent items from @model. @box is updated whenever @model changes.
- * If @model is %NULL, @box is left empty.
- *
- * It is undefined to add or remove widgets directly (for example, with
- * gtk_list_box_insert() or gtk_container_add()) while @box is bound to a
- * model.
- *
- * Note that using a model is incompatible with the filtering and sorting
- * functionality in GtkListBox. When using a model, filtering and sorting
- * should be implemented by the model.
- *
- * Since: 3.16
- */
-void
-gtk_list_box_bind_model (GtkListBox                 *box,
-                         GListModel                 *model,
-                         GtkListBoxCreateWidgetFunc  create_widget_func,
-                         gpointer                    user_data,
-                         GDestroyNotify              user_data_free_func)
+static guint
+gtk_list_box_get_item_at_y (GtkListBox *box,
+                            gint        y)
 {
   GtkListBoxPrivate *priv = BOX_PRIV (box);
   GSequenceIter *iter;
+  GtkListBoxRow *row;
+  gint estimate;
+  guint position, n;
 
-  g_return_if_fail (GTK_IS_LIST_BOX (box));
-  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
-  g_return_if_fail (model == NULL || create_widget_func != NULL);
+  if (priv->n_items == 0)
+    return 0;
 
-  if (priv->bound_model)
+  estimate = MAX (priv->row_height_estimate, 1);
+
+  if (y < priv->first_item_y)
     {
-      if (priv->create_widget_func_data_destroy)
-        priv->create_widget_func_data_destroy (priv->create_widget_func_data);
+      n = (priv->first_item_y - y + estimate - 1) / estimate;
+      return n < priv->first_item ? priv->first_item - n : 0;
+    }
 
-      g_signal_handlers_disconnect_by_func (priv->bound_model, gtk_list_box_bound_model_changed, box);
-      g_clear_object (&priv->bound_model);
+  position = priv->first_item;
+  for (iter = g_sequence_get_begin_iter (priv->children);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      row = g_sequence_get (iter);
+      if (y < ROW_PRIV (row)->y + ROW_PRIV (row)->height)
+        return position;
+      position++;
     }
 
-  iter = g_sequence_get_begin_iter (priv->children);
-  while (!g_sequence_iter_is_end (iter))
+  position += (y - gtk_list_box_get_rows_end (box)) / estimate;
+
+  return MIN (position, priv->n_items - 1);
+}
+
+static gint
+gtk_list_box_get_item_y (GtkListBox *box,
+                         guint       position)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  guint n_rows;
+
+  n_rows = g_sequence_get_length (priv->children);
+
+  if (position < priv->first_item)
+    return priv->first_item_y - (gint) (priv->first_item - position) * priv->row_height_estimate;
+
+  if (position < priv->first_item + n_rows)
     {
-      GtkWidget *row = g_sequence_get (iter);
-      iter = g_sequence_iter_next (iter);
-      gtk_list_box_remove (GTK_CONTAINER (box), row);
+      GSequenceIter *iter;
+
+      iter = g_sequence_get_iter_at_pos (priv->children, position - priv->first_item);
+
+      return ROW_PRIV (g_sequence_get (iter))->y;
     }
 
+  return gtk_list_box_get_rows_end (box) +
+         (gint) (position - priv->first_item - n_rows) * priv->row_height_estimate;
+}
+
+/* Puts the kept row back into the list, it is still parented
+ * and bound to its item
+ */
+static GtkListBoxRow *
+gtk_list_box_attach_kept_row (GtkListBox *box,
+                              gint        index)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GtkListBoxRow *row;
+  GSequenceIter *iter;
 
-  if (model == NULL)
-    return;
+  row = priv->kept_row;
+  priv->kept_row = NULL;
 
-  priv->bound_model = g_object_ref (model);
-  priv->create_widget_func = create_widget_func;
-  priv->create_widget_func_data = user_data;
-  priv->create_widget_func_data_destroy = user_data_free_func;
+  if (index == 0)
+    iter = g_sequence_prepend (priv->children, row);
+  else
+    iter = g_sequence_append (priv->children, row);
 
-  gtk_list_box_check_model_compat (box);
+  gtk_list_box_insert_css_node (box, GTK_WIDGET (row), iter);
 
-  g_signal_connect (priv->bound_model, "items-changed", G_CALLBACK (gtk_list_box_bound_model_changed), box);
-  gtk_list_box_bound_model_changed (model, 0, 0, g_list_model_get_n_items (model), box);
+  ROW_PRIV (row)->iter = iter;
+  ROW_PRIV (row)->visible = gtk_widget_get_visible (GTK_WIDGET (row));
+  if (ROW_PRIV (row)->visible)
+    list_box_add_visible_rows (box, 1);
+  gtk_list_box_apply_filter (box, row);
+  gtk_list_box_update_row_style (box, row);
+  if (gtk_widget_get_visible (GTK_WIDGET (box)))
+    {
+      gtk_list_box_update_header (box, ROW_PRIV (row)->iter);
+      gtk_list_box_update_header (box,
+                                  gtk_list_box_get_next_visible (box, ROW_PRIV (row)->iter));
+    }
+
+  return row;
+}
+
+static GtkListBoxRow *
+gtk_list_box_insert_item (GtkListBox *box,
+                          guint       position,
+                          gint        index)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GtkListBoxRow *row;
+  GtkWidget *widget;
+  gpointer item;
+
+  if (priv->kept_row && priv->kept_item == position)
+    row = gtk_list_box_attach_kept_row (box, index);
+  else if (priv->recycled_rows)
+    {
+      row = priv->recycled_rows->data;
+      priv->recycled_rows = g_slist_delete_link (priv->recycled_rows, priv->recycled_rows);
+
+      if (ROW_PRIV (row)->wrapper)
+        widget = gtk_bin_get_child (GTK_BIN (row));
+      else
+        widget = GTK_WIDGET (row);
+
+      item = g_list_model_get_item (priv->bound_model, position);
+      priv->bind_widget_func (item, widget, priv->create_widget_func_data);
+      gtk_list_box_insert (box, GTK_WIDGET (row), index);
+      g_object_unref (row);
+      g_object_unref (item);
+    }
+  else
+    {
+      item = g_list_model_get_item (priv->bound_model, position);
+      widget = priv->create_widget_func (item, priv->create_widget_func_data);
+      if (g_object_is_floating (widget))
+        g_object_ref_sink (widget);
+
+      gtk_widget_show (widget);
+      gtk_list_box_insert (box, widget, index);
+
+      if (GTK_IS_LIST_BOX_ROW (widget))
+        row = GTK_LIST_BOX_ROW (widget);
+      else
+        row = GTK_LIST_BOX_ROW (gtk_widget_get_parent (widget));
+
+      g_object_unref (widget);
+      g_object_unref (item);
+    }
+
+  if (gtk_list_box_find_selected_item (box, position, NULL))
+    {
+      ROW_PRIV (row)->selected = TRUE;
+      gtk_widget_set_state_flags (GTK_WIDGET (row), GTK_STATE_FLAG_SELECTED, FALSE);
+      if (priv->selection_mode != GTK_SELECTION_MULTIPLE)
+        priv->selected_row = row;
+    }
+
+  return row;
+}
+
+static gboolean
+gtk_list_box_must_keep_row (GtkListBox    *box,
+                            GtkListBoxRow *row)
+{
+  return row == BOX_PRIV (box)->cursor_row ||
+         GTK_WIDGET (row) == gtk_widget_get_focus_child (GTK_WIDGET (box));
+}
+
+static void
+gtk_list_box_release_kept_row (GtkListBox *box)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GtkListBoxRow *row = priv->kept_row;
+
+  g_object_ref (row);
+  gtk_list_box_remove (GTK_CONTAINER (box), GTK_WIDGET (row));
+
+  priv->recycled_rows = g_slist_prepend (priv->recycled_rows, row);
+}
+
+/* Takes the row out of the list without unparenting it, so it keeps
+ * the keyboard focus and stays the cursor row
+ */
+static void
+gtk_list_box_keep_row (GtkListBox    *box,
+                       GtkListBoxRow *row,
+                       guint          position)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GSequenceIter *next;
+
+  if (priv->kept_row)
+    gtk_list_box_release_kept_row (box);
+
+  if (ROW_PRIV (row)->visible)
+    list_box_add_visible_rows (box, -1);
+
+  if (ROW_PRIV (row)->header != NULL)
+    {
+      g_hash_table_remove (priv->header_hash, ROW_PRIV (row)->header);
+      gtk_widget_unparent (ROW_PRIV (row)->header);
+      g_clear_object (&ROW_PRIV (row)->header);
+    }
+
+  if (row == priv->selected_row)
+    priv->selected_row = NULL;
+
+  if (row == priv->drag_highlighted_row)
+    gtk_list_box_drag_unhighlight_row (box);
+
+  next = gtk_list_box_get_next_visible (box, ROW_PRIV (row)->iter);
+  g_sequence_remove (ROW_PRIV (row)->iter);
+  ROW_PRIV (row)->iter = NULL;
+  if (gtk_widget_get_visible (GTK_WIDGET (box)))
+    gtk_list_box_update_header (box, next);
+
+  priv->kept_row = row;
+  priv->kept_item = position;
+}
+
+static void
+gtk_list_box_recycle_row (GtkListBox    *box,
+                          GtkListBoxRow *row,
+                          guint          position)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+
+  /* The selection is kept in selected_items, so this must not be
+   * reported as a change
+   */
+  if (ROW_PRIV (row)->selected)
+    {
+      ROW_PRIV (row)->selected = FALSE;
+      gtk_widget_unset_state_flags (GTK_WIDGET (row), GTK_STATE_FLAG_SELECTED);
+    }
+
+  if (gtk_list_box_must_keep_row (box, row))
+    {
+      gtk_list_box_keep_row (box, row, position);
+      return;
+    }
+
+  g_object_ref (row);
+  gtk_list_box_remove (GTK_CONTAINER (box), GTK_WIDGET (row));
+  ROW_PRIV (row)->iter = NULL;
+
+  priv->recycled_rows = g_slist_prepend (priv->recycled_rows, row);
+}
+
+static void
+gtk_list_box_recycle_rows_from (GtkListBox *box,
+                                guint       index)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  guint n_rows;
+
+  while ((n_rows = g_sequence_get_length (priv->children)) > index)
+    {
+      GSequenceIter *last;
+
+      last = g_sequence_iter_prev (g_sequence_get_end_iter (priv->children));
+      gtk_list_box_recycle_row (box, g_sequence_get (last), priv->first_item + n_rows - 1);
+    }
+}
+
+static void
+gtk_list_box_update_virtual_rows (GtkListBox *box)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  guint n_rows, want_first, want_last;
+  gint width, estimate, delta;
+  gboolean changed = FALSE;
+  GSList *l;
+
+  if (priv->update_rows_id != 0)
+    {
+      g_source_remove (priv->update_rows_id);
+      priv->update_rows_id = 0;
+    }
+
+  if (!priv->bind_widget_func)
+    return;
+
+  /* The cursor and the focus moved on to other rows */
+  if (priv->kept_row && !gtk_list_box_must_keep_row (box, priv->kept_row))
+    gtk_list_box_release_kept_row (box);
+
+  width = gtk_widget_get_allocated_width (GTK_WIDGET (box));
+  if (width <= 0)
+    width = -1;
+
+  n_rows = g_sequence_get_length (priv->children);
+
+  /* We need a row to guess how many rows fit in the page */
+  if (priv->row_height_estimate == 0 && priv->n_items > 0)
+    {
+      GtkListBoxRow *row;
+
+      if (n_rows == 0)
+        {
+          priv->first_item = MIN (priv->first_item, priv->n_items - 1);
+          gtk_list_box_insert_item (box, priv->first_item, -1);
+          n_rows = 1;
+          changed = TRUE;
+        }
+
+      row = g_sequence_get (g_sequence_get_begin_iter (priv->children));
+      priv->row_height_estimate = MAX (gtk_list_box_get_row_extent (row, width), 1);
+    }
+
+  gtk_list_box_layout_virtual_rows (box, width);
+
+  /* Keep a page of rows above and below the visible ones */
+  if (priv->n_items == 0)
+    {
+      want_first = 0;
+      want_last = 0;
+    }
+  else if (priv->adjustment == NULL)
+    {
+      want_first = 0;
+      want_last = priv->n_items;
+    }
+  else
+    {
+      gint value = gtk_adjustment_get_value (priv->adjustment);
+      gint page = gtk_adjustment_get_page_size (priv->adjustment);
+
+      want_first = gtk_list_box_get_item_at_y (box, value - page);
+      want_last = gtk_list_box_get_item_at_y (box, value + 2 * page) + 1;
+    }
+
+  if (n_rows == 0 ||
+      want_last <= priv->first_item ||
+      want_first >= priv->first_item + n_rows)
+    {
+      /* None of the rows are needed anymore */
+      gint y = want_first < want_last ? gtk_list_box_get_item_y (box, want_first) : 0;
+
+      if (n_rows > 0)
+        {
+          gtk_list_box_recycle_rows_from (box, 0);
+          changed = TRUE;
+        }
+
+      priv->first_item = want_first;
+      priv->first_item_y = y;
+      n_rows = 0;
+    }
+  else
+    {
+      while (priv->first_item < want_first)
+        {
+          GtkListBoxRow *row;
+
+          row = g_sequence_get (g_sequence_get_begin_iter (priv->children));
+          priv->first_item_y = ROW_PRIV (row)->y + ROW_PRIV (row)->height;
+          gtk_list_box_recycle_row (box, row, priv->first_item);
+          priv->first_item++;
+          n_rows--;
+          changed = TRUE;
+        }
+
+      if (priv->first_item + n_rows > want_last)
+        {
+          n_rows = want_last - priv->first_item;
+          gtk_list_box_recycle_rows_from (box, n_rows);
+          changed = TRUE;
+        }
+    }
+
+  while (priv->first_item + n_rows < want_last)
+    {
+      gtk_list_box_insert_item (box, priv->first_item + n_rows, -1);
+      n_rows++;
+      changed = TRUE;
+    }
+
+  while (priv->first_item > want_first)
+    {
+      GtkListBoxRow *row;
+
+      priv->first_item--;
+      row = gtk_list_box_insert_item (box, priv->first_item, 0);
+      priv->first_item_y -= gtk_list_box_get_row_extent (row, width);
+      n_rows++;
+      changed = TRUE;
+    }
+
+  /* The estimates were off if the first item does not start at the top,
+   * move the rows and the adjustment to make up for it
+   */
+  if (priv->first_item == 0)
+    delta = -priv->first_item_y;
+  else if (priv->first_item_y < 0)
+    delta = priv->first_item * priv->row_height_estimate - priv->first_item_y;
+  else
+    delta = 0;
+
+  if (delta != 0)
+    {
+      priv->first_item_y += delta;
+      if (priv->adjustment)
+        {
+          gdouble value = gtk_adjustment_get_value (priv->adjustment);
+
+          gtk_adjustment_set_upper (priv->adjustment,
+                                    gtk_adjustment_get_upper (priv->adjustment) + MAX (delta, 0));
+          gtk_adjustment_set_value (priv->adjustment, value + delta);
+        }
+      changed = TRUE;
+    }
+
+  gtk_list_box_layout_virtual_rows (box, width);
+
+  if (n_rows > 0)
+    {
+      estimate = (gtk_list_box_get_rows_end (box) - priv->first_item_y) / n_rows;
+      estimate = MAX (estimate, 1);
+      if (estimate != priv->row_height_estimate)
+        {
+          priv->row_height_estimate = estimate;
+          changed = TRUE;
+        }
+    }
+
+  /* Keep as many rows around as are in use */
+  l = n_rows > 0 ? g_slist_nth (priv->recycled_rows, n_rows - 1) : NULL;
+  if (l)
+    {
+      g_slist_free_full (l->next, g_object_unref);
+      l->next = NULL;
+    }
+  else if (n_rows == 0)
+    {
+      g_slist_free_full (priv->recycled_rows, g_object_unref);
+      priv->recycled_rows = NULL;
+    }
+
+  if (changed)
+    gtk_widget_queue_resize (GTK_WIDGET (box));
+}
+
+static gboolean
+gtk_list_box_update_rows_cb (gpointer data)
+{
+  GtkListBox *box = data;
+
+  BOX_PRIV (box)->update_rows_id = 0;
+  gtk_list_box_update_virtual_rows (box);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_list_box_queue_update_rows (GtkListBox *box)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+
+  if (!priv->bind_widget_func || priv->update_rows_id != 0)
+    return;
+
+  /* Before the resize, so new rows get allocated in the same frame */
+  priv->update_rows_id = gdk_threads_add_idle_full (GTK_PRIORITY_RESIZE - 1,
+                                                    gtk_list_box_update_rows_cb,
+                                                    box, NULL);
+  g_source_set_name_by_id (priv->update_rows_id, "[gtk+] gtk_list_box_update_rows_cb");
+}
+
+static void
+gtk_list_box_scroll_to_item (GtkListBox *box,
+                             guint       position)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  gdouble value, page, y;
+
+  if (!priv->adjustment)
+    return;
+
+  value = gtk_adjustment_get_value (priv->adjustment);
+  page = gtk_adjustment_get_page_size (priv->adjustment);
+  y = gtk_list_box_get_item_y (box, position);
+
+  if (y < value)
+    value = y;
+  else if (y + priv->row_height_estimate > value + page)
+    value = y + priv->row_height_estimate - page;
+  else
+    return;
+
+  gtk_adjustment_set_upper (priv->adjustment,
+                            MAX (gtk_adjustment_get_upper (priv->adjustment),
+                                 value + page));
+  gtk_adjustment_set_value (priv->adjustment, value);
+  gtk_list_box_update_virtual_rows (box);
+}
+
+/* Scrolls back to the kept row before the keyboard moves on from it */
+static void
+gtk_list_box_restore_kept_row (GtkListBox *box)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+
+  if (priv->kept_row == NULL)
+    return;
+
+  gtk_list_box_scroll_to_item (box, priv->kept_item);
+  if (priv->kept_row != NULL)
+    gtk_list_box_update_virtual_rows (box);
+
+  /* Without an adjustment to scroll there is no way back */
+  if (priv->kept_row != NULL)
+    gtk_list_box_release_kept_row (box);
+}
+
+static void
+gtk_list_box_clear_virtual (GtkListBox *box)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+
+  if (priv->update_rows_id != 0)
+    {
+      g_source_remove (priv->update_rows_id);
+      priv->update_rows_id = 0;
+    }
+
+  if (priv->kept_row)
+    gtk_list_box_remove (GTK_CONTAINER (box), GTK_WIDGET (priv->kept_row));
+
+  g_slist_free_full (priv->recycled_rows, g_object_unref);
+  priv->recycled_rows = NULL;
+  g_clear_pointer (&priv->selected_items, g_array_unref);
+
+  priv->bind_widget_func = NULL;
+  priv->n_items = 0;
+  priv->first_item = 0;
+  priv->first_item_y = 0;
+  priv->row_height_estimate = 0;
+}
+
+static void
+gtk_list_box_virtual_model_changed (GtkListBox *box,
+                                    guint       position,
+                                    guint       removed,
+                                    guint       added)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GArray *selected_items = priv->selected_items;
+  gboolean selection_changed = FALSE;
+  guint n_rows, i, j;
+
+  /* Selected items move with the items around them */
+  for (i = 0, j = 0; i < selected_items->len; i++)
+    {
+      guint item = g_array_index (selected_items, guint, i);
+
+      if (item >= position + removed)
+        g_array_index (selected_items, guint, j++) = item - removed + added;
+      else if (item >= position)
+        selection_changed = TRUE;
+      else
+        g_array_index (selected_items, guint, j++) = item;
+    }
+  g_array_set_size (selected_items, j);
+
+  n_rows = g_sequence_get_length (priv->children);
+
+  if (n_rows > 0 && position + removed <= priv->first_item)
+    {
+      priv->first_item = priv->first_item - removed + added;
+      priv->first_item_y += ((gint) added - (gint) removed) * priv->row_height_estimate;
+    }
+  else if (position < priv->first_item + n_rows)
+    {
+      if (position <= priv->first_item)
+        {
+          gint y = gtk_list_box_get_item_y (box, position);
+
+          gtk_list_box_recycle_rows_from (box, 0);
+          priv->first_item = position;
+          priv->first_item_y = y;
+        }
+      else
+        gtk_list_box_recycle_rows_from (box, position - priv->first_item);
+    }
+
+  if (priv->kept_row)
+    {
+      if (priv->kept_item >= position + removed)
+        priv->kept_item = priv->kept_item - removed + added;
+      else if (priv->kept_item >= position)
+        gtk_list_box_release_kept_row (box);
+    }
+
+  priv->n_items = priv->n_items - removed + added;
+  if (g_sequence_is_empty (priv->children))
+    priv->first_item = MIN (priv->first_item, priv->n_items);
+
+  gtk_list_box_update_virtual_rows (box);
+  gtk_widget_queue_resize (GTK_WIDGET (box));
+
+  if (selection_changed)
+    {
+      if (priv->selection_mode != GTK_SELECTION_MULTIPLE)
+        g_signal_emit (box, signals[ROW_SELECTED], 0, NULL);
+      g_signal_emit (box, signals[SELECTED_ROWS_CHANGED], 0);
+    }
+}
+
+static void
+gtk_list_box_bound_model_changed (GListModel *list,
+                                  guint       position,
+                                  guint       removed,
+                                  guint       added,
+                                  gpointer    user_data)
+{
+  GtkListBox *box = user_data;
+  GtkListBoxPrivate *priv = BOX_PRIV (user_data);
+  guint i;
+
+  if (priv->bind_widget_func)
+    {
+      gtk_list_box_virtual_model_changed (box, position, removed, added);
+      return;
+    }
+
+  while (removed--)
+    {
+      GtkListBoxRow *row;
+
+      row = gtk_list_box_get_row_at_index (box, position);
+      gtk_container_remove (GTK_CONTAINER (box), GTK_WIDGET (row));
+    }
+
+  for (i = 0; i < added; i++)
+    {
+      GObject *item;
+      GtkWidget *widget;
+
+      item = g_list_model_get_item (list, position + i);
+      widget = priv->create_widget_func (item, priv->create_widget_func_data);
+
+      /* We allow the create_widget_func to either return a full
+       * reference or a floating reference.  If we got the floating
+       * reference, then turn it into a full reference now.  That means
+       * that gtk_list_box_insert() will take another full reference.
+       * Finally, we'll release this full reference below, leaving only
+       * the one held by the box.
+       */
+      if (g_object_is_floating (widget))
+        g_object_ref_sink (widget);
+
+      gtk_widget_show (widget);
+      gtk_list_box_insert (box, widget, position + i);
+
+      g_object_unref (widget);
+      g_object_unref (item);
+    }
+}
+
+static void
+gtk_list_box_check_model_compat (GtkListBox *box)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+
+  if (priv->bound_model &&
+      (priv->sort_func || priv->filter_func))
+    g_warning ("GtkListBox with a model will ignore sort and filter functions");
+}
+
+static void
+gtk_list_box_bind_model_internal (GtkListBox                 *box,
+                                  GListModel                 *model,
+                                  GtkListBoxCreateWidgetFunc  create_widget_func,
+                                  GtkListBoxBindWidgetFunc    bind_widget_func,
+                                  gpointer                    user_data,
+                                  GDestroyNotify              user_data_free_func)
+{
+  GtkListBoxPrivate *priv = BOX_PRIV (box);
+  GSequenceIter *iter;
+
+  if (priv->bound_model)
+    {
+      if (priv->create_widget_func_data_destroy)
+        priv->create_widget_func_data_destroy (priv->create_widget_func_data);
+
+      g_signal_handlers_disconnect_by_func (priv->bound_model, gtk_list_box_bound_model_changed, box);
+      g_clear_object (&priv->bound_model);
+    }
+
+  iter = g_sequence_get_begin_iter (priv->children);
+  while (!g_sequence_iter_is_end (iter))
+    {
+      GtkWidget *row = g_sequence_get (iter);
+      iter = g_sequence_iter_next (iter);
+      gtk_list_box_remove (GTK_CONTAINER (box), row);
+    }
+
+  gtk_list_box_clear_virtual (box);
+
+  if (model == NULL)
+    return;
+
+  priv->bound_model = g_object_ref (model);
+  priv->create_widget_func = create_widget_func;
+  priv->create_widget_func_data = user_data;
+  priv->create_widget_func_data_destroy = user_data_free_func;
+
+  gtk_list_box_check_model_compat (box);
+
+  g_signal_connect (priv->bound_model, "items-changed", G_CALLBACK (gtk_list_box_bound_model_changed), box);
+
+  if (bind_widget_func)
+    {
+      priv->bind_widget_func = bind_widget_func;
+      priv->n_items = g_list_model_get_n_items (model);
+      priv->selected_items = g_array_new (FALSE, FALSE, sizeof (guint));
+      gtk_list_box_update_virtual_rows (box);
+    }
+  else
+    gtk_list_box_bound_model_changed (model, 0, 0, g_list_model_get_n_items (model), box);
+}
+
+/**
+ * gtk_list_box_bind_model:
+ * @box: a #GtkListBox
+ * @model: (nullable): the #GListModel to be bound to @box
+ * @create_widget_func: (nullable): a function that creates widgets for items
+ *   or %NULL in case you also passed %NULL as @model
+ * @user_data: user data passed to @create_widget_func
+ * @user_data_free_func: function for freeing @user_data
+ *
+ * Binds @model to @box.
+ *
+ * If @box was already bound to a model, that previous binding is
+ * destroyed.
+ *
+ * The contents of @box are cleared and then filled with widgets that
+ * represent items from @model. @box is updated whenever @model changes.
+ * If @model is %NULL, @box is left empty.
+ *
+ * It is undefined to add or remove widgets directly (for example, with
+ * gtk_list_box_insert() or gtk_container_add()) while @box is bound to a
+ * model.
+ *
+ * Note that using a model is incompatible with the filtering and sorting
+ * functionality in GtkListBox. When using a model, filtering and sorting
+ * should be implemented by the model.
+ *
+ * Since: 3.16
+ */
+void
+gtk_list_box_bind_model (GtkListBox                 *box,
+                         GListModel                 *model,
+                         GtkListBoxCreateWidgetFunc  create_widget_func,
+                         gpointer                    user_data,
+                         GDestroyNotify              user_data_free_func)
+{
+  g_return_if_fail (GTK_IS_LIST_BOX (box));
+  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
+  g_return_if_fail (model == NULL || create_widget_func != NULL);
+
+  gtk_list_box_bind_model_internal (box, model,
+                                    create_widget_func, NULL,
+                                    user_data, user_data_free_func);
+}
+
+/**
+ * gtk_list_box_bind_model_virtual:
+ * @box: a #GtkListBox
+ * @model: (nullable): the #GListModel to be bound to @box
+ * @create_widget_func: (nullable): a function that creates widgets for items
+ *   or %NULL in case you also passed %NULL as @model
+ * @bind_widget_func: (nullable): a function that makes a widget created by
+ *   @create_widget_func show another item, or %NULL in case you also
+ *   passed %NULL as @model
+ * @user_data: user data passed to @create_widget_func and @bind_widget_func
+ * @user_data_free_func: function for freeing @user_data
+ *
+ * Binds @model to @box like gtk_list_box_bind_model(), but only creates
+ * rows for the items that are visible in the adjustment set with
+ * gtk_list_box_set_adjustment(), plus a page above and below them.
+ * When scrolling, the rows that are no longer needed are reused for
+ * other items by calling @bind_widget_func on them, so @create_widget_func
+ * is only called as often as necessary to fill the visible area. This
+ * makes @box usable with models containing a large number of items.
+ *
+ * The height of the items without rows is estimated from the average
+ * height of the existing rows, so rows should have similar heights.
+ *
+ * Selection is tracked by position in @model. Functions that return rows,
+ * like gtk_list_box_get_row_at_index(), gtk_list_box_get_selected_rows()
+ * or gtk_list_box_selected_foreach(), as well as the header function, only
+ * see the rows that currently exist. gtk_list_box_row_get_index() returns
+ * the position of the row's item in @model.
+ *
+ * If @box is not in a scrollable container and no adjustment has been
+ * set, rows are created for all items.
+ *
+ * Since: 3.94
+ */
+void
+gtk_list_box_bind_model_virtual (GtkListBox                 *box,
+                                 GListModel                 *model,
+                                 GtkListBoxCreateWidgetFunc  create_widget_func,
+                                 GtkListBoxBindWidgetFunc    bind_widget_func,
+                                 gpointer                    user_data,
+                                 GDestroyNotify              user_data_free_func)
+{
+  g_return_if_fail (GTK_IS_LIST_BOX (box));
+  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
+  g_return_if_fail (model == NULL || create_widget_func != NULL);
+  g_return_if_fail (model == NULL || bind_widget_func != NULL);
+
+  gtk_list_box_bind_model_internal (box, model,
+                                    create_widget_func, bind_widget_func,
+                                    user_data, user_data_free_func);
 }
@@ -125,6 +125,58 @@ gtk_snapshot_state_clear (GtkSnapshotState *state)
   g_clear_pointer (&state->name, g_free);
 }
 
+/* Snapshots are created for every frame and for every fallback drawing,
+ * and their stacks grow to about the same size every time. So instead of
+ * allocating new arrays for each snapshot, we keep the ones of the last
+ * few snapshots around. Snapshots are only used from the main thread.
+ */
+#define MAX_CACHED_STACKS 4
+
+static GArray *cached_state_stacks[MAX_CACHED_STACKS];
+static GPtrArray *cached_nodes[MAX_CACHED_STACKS];
+static guint n_cached_stacks;
+
+static void
+gtk_snapshot_acquire_stacks (GtkSnapshot *snapshot)
+{
+  if (n_cached_stacks > 0)
+    {
+      n_cached_stacks--;
+      snapshot->state_stack = cached_state_stacks[n_cached_stacks];
+      snapshot->nodes = cached_nodes[n_cached_stacks];
+      return;
+    }
+
+  snapshot->state_stack = g_array_new (FALSE, TRUE, sizeof (GtkSnapshotState));
+  g_array_set_clear_func (snapshot->state_stack, (GDestroyNotify)gtk_snapshot_state_clear);
+  snapshot->nodes = g_ptr_array_new_with_free_func ((GDestroyNotify)gsk_render_node_unref);
+}
+
+static void
+gtk_snapshot_release_stacks (GtkSnapshot *snapshot)
+{
+  if (n_cached_stacks < MAX_CACHED_STACKS)
+    {
+      /* This clears the remaining states and unrefs the remaining nodes,
+       * but keeps the memory. New states still get zeroed when pushed.
+       */
+      g_array_set_size (snapshot->state_stack, 0);
+      g_ptr_array_set_size (snapshot->nodes, 0);
+
+      cached_state_stacks[n_cached_stacks] = snapshot->state_stack;
+      cached_nodes[n_cached_stacks] = snapshot->nodes;
+      n_cached_stacks++;
+    }
+  else
+    {
+      g_array_free (snapshot->state_stack, TRUE);
+      g_ptr_array_free (snapshot->nodes, TRUE);
+    }
+
+  snapshot->state_stack = NULL;
+  snapshot->nodes = NULL;
+}
+
 void
 gtk_snapshot_init (GtkSnapshot          *snapshot,
                    GskRenderer          *renderer,
@@ -137,9 +189,8 @@ gtk_snapshot_init (GtkSnapshot          *snapshot,
 
   snapshot->record_names = record_names;
   snapshot->renderer = renderer;
-  snapshot->state_stack = g_array_new (FALSE, TRUE, sizeof (GtkSnapshotState));
-  g_array_set_clear_func (snapshot->state_stack, (GDestroyNotify)gtk_snapshot_state_clear);
-  snapshot->nodes = g_ptr_array_new_with_free_func ((GDestroyNotify)gsk_render_node_unref);
+  snapshot->arena = gsk_render_node_arena_begin ();
+  gtk_snapshot_acquire_stacks (snapshot);
 
   if (name && record_names)
     {
@@ -1029,8 +1080,10 @@ gtk_snapshot_finish (GtkSnapshot *snapshot)
   
   result = gtk_snapshot_pop_internal (snapshot);
 
-  g_array_free (snapshot->state_stack, TRUE);
-  g_ptr_array_free (snapshot->nodes, TRUE);
+  gtk_snapshot_release_stacks (snapshot);
+  gsk_render_node_arena_end (snapshot->arena);
+  snapshot->arena = NULL;
+
   return result;
 }
 
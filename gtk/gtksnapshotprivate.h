@@ -20,6 +20,8 @@
 
 #include "gtksnapshot.h"
 
+#include "gsk/gskrendernodeprivate.h"
+
 G_BEGIN_DECLS
 
 typedef struct _GtkSnapshotState GtkSnapshotState;
@@ -85,6 +87,7 @@ struct _GtkSnapshot {
   GskRenderer           *renderer;
   GArray                *state_stack;
   GPtrArray             *nodes;
+  GskRenderNodeArena    *arena;
 };
 
 void            gtk_snapshot_init               (GtkSnapshot             *state,
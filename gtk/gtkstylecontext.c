@@ -256,6 +256,9 @@ static void
 gtk_style_context_cascade_changed (GtkStyleCascade *cascade,
                                    GtkStyleContext *context)
 {
+  /* Shared styles may have been computed with the old provider */
+  gtk_css_node_style_cache_clear_shared ();
+
   gtk_css_node_invalidate_style_provider (gtk_style_context_get_root (context));
 }
 
@@ -154,6 +154,9 @@ struct _GtkTextBTreeNode {
   } children;
 
   NodeData *node_data;
+
+  GtkTextTrigramFilter *trigrams;       /* Trigrams of the text in a leaf,
+                                         * NULL if not computed yet */
 };
 
 
@@ -301,6 +304,7 @@ static void                  gtk_text_btree_node_destroy             (GtkTextBTr
                                                                       GtkTextBTreeNode *node);
 static void                  gtk_text_btree_node_free_empty          (GtkTextBTree *tree,
                                                                       GtkTextBTreeNode *node);
+static void                  gtk_text_btree_node_invalidate_trigrams (GtkTextBTreeNode *node);
 static NodeData         *    gtk_text_btree_node_ensure_data         (GtkTextBTreeNode *node,
                                                                       gpointer          view_id);
 static void                  gtk_text_btree_node_get_size            (GtkTextBTreeNode *node,
@@ -922,6 +926,7 @@ _gtk_text_btree_delete (GtkTextIter *start,
         {
           /* Segment is gone. Decrement the char count of the node and
              all its parents. */
+          gtk_text_btree_node_invalidate_trigrams (curnode);
           for (node = curnode; node != NULL;
                node = node->parent)
             {
@@ -956,6 +961,7 @@ _gtk_text_btree_delete (GtkTextIter *start,
             }
         }
 
+      gtk_text_btree_node_invalidate_trigrams (start_line->parent);
       for (node = start_line->parent; node != NULL;
            node = node->parent)
         {
@@ -963,6 +969,7 @@ _gtk_text_btree_delete (GtkTextIter *start,
         }
       
       curnode = end_line->parent;
+      gtk_text_btree_node_invalidate_trigrams (curnode);
       for (node = curnode; node != NULL;
            node = node->parent)
         {
@@ -1257,6 +1264,193 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   }
 }
 
+/* Bulk insertion
+ *
+ * Inserting text chunk by chunk with _gtk_text_btree_insert() splits
+ * segments, rebalances the tree, invalidates the views and resolves
+ * the bidi direction for every chunk. The loader only appends segments
+ * and lines while text is added, and does all of that once, for the
+ * whole text, when it is finished.
+ *
+ * The tree is inconsistent while a loader is in use, so it must not
+ * be accessed until _gtk_text_btree_loader_finish() has been called.
+ */
+
+struct _GtkTextBTreeLoader
+{
+  GtkTextBTree *tree;
+  GtkTextLine *start_line;
+  gint start_byte_index;
+
+  GtkTextLine *line;            /* Line that text is appended to */
+  GtkTextLineSegment *cur_seg;  /* New text is added after this segment,
+                                 * NULL means at the beginning of line */
+  gint line_byte_index;         /* Index of the insertion point in line */
+
+  gint line_count_delta;
+  gint char_count_delta;
+};
+
+/**
+ * _gtk_text_btree_loader_new:
+ * @iter: the position to insert text at
+ *
+ * Starts a bulk insertion of text at @iter.
+ *
+ * Returns: a new #GtkTextBTreeLoader, free it with
+ *     _gtk_text_btree_loader_finish()
+ **/
+GtkTextBTreeLoader *
+_gtk_text_btree_loader_new (const GtkTextIter *iter)
+{
+  GtkTextBTreeLoader *loader;
+
+  g_return_val_if_fail (iter != NULL, NULL);
+
+  loader = g_slice_new0 (GtkTextBTreeLoader);
+  loader->tree = _gtk_text_iter_get_btree (iter);
+  loader->start_line = _gtk_text_iter_get_text_line (iter);
+  loader->start_byte_index = gtk_text_iter_get_line_index (iter);
+
+  /* See _gtk_text_btree_insert() */
+  g_assert (!_gtk_text_line_is_last (loader->start_line, loader->tree));
+  loader->cur_seg = gtk_text_line_segment_split (iter);
+  loader->line = loader->start_line;
+  loader->line_byte_index = loader->start_byte_index;
+
+  /* Invalidate all iterators */
+  chars_changed (loader->tree);
+  segments_changed (loader->tree);
+
+  return loader;
+}
+
+/**
+ * _gtk_text_btree_loader_append:
+ * @loader: a #GtkTextBTreeLoader
+ * @text: valid UTF-8 text
+ * @len: length of @text in bytes
+ *
+ * Appends @text to the text inserted by @loader. The text passed
+ * in consecutive calls must not split a "\r\n" paragraph delimiter.
+ **/
+void
+_gtk_text_btree_loader_append (GtkTextBTreeLoader *loader,
+                               const gchar        *text,
+                               gint                len)
+{
+  GtkTextLineSegment *seg;
+  GtkTextLine *newline;
+  gint sol, eol, delim;
+
+  g_return_if_fail (loader != NULL);
+  g_return_if_fail (text != NULL);
+
+  eol = 0;
+  while (eol < len)
+    {
+      sol = eol;
+
+      pango_find_paragraph_boundary (text + sol,
+                                     len - sol,
+                                     &delim,
+                                     &eol);
+
+      /* make these relative to the start of the text */
+      delim += sol;
+      eol += sol;
+
+      seg = _gtk_char_segment_new (&text[sol], eol - sol);
+      loader->char_count_delta += seg->char_count;
+
+      if (loader->cur_seg == NULL)
+        {
+          seg->next = loader->line->segments;
+          loader->line->segments = seg;
+        }
+      else
+        {
+          seg->next = loader->cur_seg->next;
+          loader->cur_seg->next = seg;
+        }
+
+      if (delim == eol)
+        {
+          /* The paragraph continues in the next chunk */
+          loader->cur_seg = seg;
+          loader->line_byte_index += seg->byte_count;
+          break;
+        }
+
+      newline = gtk_text_line_new ();
+      gtk_text_line_set_parent (newline, loader->line->parent);
+      newline->next = loader->line->next;
+      loader->line->next = newline;
+      newline->segments = seg->next;
+      seg->next = NULL;
+
+      /* The line may consist of segments from several chunks, the
+       * start line is cleaned up when finishing. This may free seg.
+       */
+      if (loader->line != loader->start_line && loader->cur_seg != NULL)
+        cleanup_line (loader->line);
+
+      loader->line = newline;
+      loader->cur_seg = NULL;
+      loader->line_byte_index = 0;
+      loader->line_count_delta++;
+    }
+}
+
+/**
+ * _gtk_text_btree_loader_finish:
+ * @loader: (transfer full): a #GtkTextBTreeLoader
+ * @iter: (out) (allow-none): return location for the end of the
+ *     inserted text
+ *
+ * Finishes the bulk insertion, rebalancing the tree and invalidating
+ * the inserted text, and frees @loader.
+ **/
+void
+_gtk_text_btree_loader_finish (GtkTextBTreeLoader *loader,
+                               GtkTextIter        *iter)
+{
+  GtkTextBTree *tree;
+  GtkTextIter start;
+  GtkTextIter end;
+
+  g_return_if_fail (loader != NULL);
+
+  tree = loader->tree;
+
+  cleanup_line (loader->start_line);
+  if (loader->line != loader->start_line)
+    cleanup_line (loader->line);
+
+  post_insert_fixup (tree, loader->line,
+                     loader->line_count_delta, loader->char_count_delta);
+
+  _gtk_text_btree_get_iter_at_line (tree, &start,
+                                    loader->start_line, loader->start_byte_index);
+  _gtk_text_btree_get_iter_at_line (tree, &end,
+                                    loader->line, loader->line_byte_index);
+
+  DV (g_print ("invalidating due to bulk insertion (%s)\n", G_STRLOC));
+  _gtk_text_btree_invalidate_region (tree, &start, &end, FALSE);
+
+  gtk_text_btree_resolve_bidi (&start, &end);
+
+  if (iter)
+    *iter = end;
+
+  g_slice_free (GtkTextBTreeLoader, loader);
+
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (TEXT))
+    _gtk_text_btree_check (tree);
+#endif
+}
+
 static void
 insert_pixbuf_or_widget_segment (GtkTextIter        *iter,
                                  GtkTextLineSegment *seg)
@@ -4888,6 +5082,7 @@ gtk_text_btree_node_new (void)
   node = g_slice_new (GtkTextBTreeNode);
 
   node->node_data = NULL;
+  node->trigrams = NULL;
 
   return node;
 }
@@ -5454,6 +5649,79 @@ _gtk_text_btree_validate_line (GtkTextBTree     *tree,
     }
 }
 
+/**
+ * _gtk_text_btree_line_validated:
+ * @tree: a #GtkTextBTree
+ * @line: a line whose #GtkTextLineData has been made valid
+ * @view_id: view ID for the view
+ *
+ * Propagate the size of a line that has been validated outside of
+ * the btree up through the entire tree.
+ **/
+void
+_gtk_text_btree_line_validated (GtkTextBTree     *tree,
+                                GtkTextLine      *line,
+                                gpointer          view_id)
+{
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (line != NULL);
+
+  gtk_text_btree_node_check_valid_upward (line->parent, view_id);
+}
+
+/**
+ * _gtk_text_btree_get_first_invalid_line:
+ * @tree: a #GtkTextBTree
+ * @view_id: view ID for the view
+ *
+ * Find the first line of the btree that is not valid for the
+ * given view.
+ *
+ * Returns: the first invalid line, or %NULL if the entire
+ * #GtkTextBTree is valid
+ **/
+GtkTextLine *
+_gtk_text_btree_get_first_invalid_line (GtkTextBTree *tree,
+                                        gpointer      view_id)
+{
+  GtkTextBTreeNode *node;
+  GtkTextLine *line;
+  NodeData *nd;
+
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  node = tree->root_node;
+  nd = node_data_find (node->node_data, view_id);
+  if (nd && nd->valid)
+    return NULL;
+
+  while (node->level > 0)
+    {
+      node = node->children.node;
+      while (node != NULL)
+        {
+          nd = node_data_find (node->node_data, view_id);
+          if (!nd || !nd->valid)
+            break;
+
+          node = node->next;
+        }
+
+      if (node == NULL)
+        return NULL;
+    }
+
+  for (line = node->children.line; line != NULL; line = line->next)
+    {
+      GtkTextLineData *ld = _gtk_text_line_get_data (line, view_id);
+
+      if (!ld || !ld->valid)
+        return line;
+    }
+
+  return NULL;
+}
+
 static void
 gtk_text_btree_node_remove_view (BTreeView *view, GtkTextBTreeNode *node, gpointer view_id)
 {
@@ -5538,9 +5806,189 @@ gtk_text_btree_node_free_empty (GtkTextBTree *tree,
 
   summary_list_destroy (node->summary);
   node_data_list_destroy (node->node_data);
+  gtk_text_btree_node_invalidate_trigrams (node);
   g_slice_free (GtkTextBTreeNode, node);
 }
 
+/*
+ * Trigram filters
+ */
+
+/* The trigram filter of a leaf is a bitmap with one bit set for the
+ * hash of every sequence of three bytes in the text of its lines,
+ * ASCII letters being folded to lower case. A search can skip the
+ * leaf if not all bits of the trigrams in the search string are set.
+ *
+ * Filters are computed when searching, and dropped whenever the text
+ * of the leaf changes.
+ */
+
+static inline void
+trigram_filter_add_byte (GtkTextTrigramFilter *filter,
+                         guint32              *window,
+                         guint                *n_bytes,
+                         guchar                byte)
+{
+  guint32 hash;
+
+  if (byte >= 0x80)
+    filter->has_non_ascii = TRUE;
+
+  *window = ((*window << 8) | g_ascii_tolower (byte)) & 0xffffff;
+  if (++(*n_bytes) < 3)
+    return;
+
+  hash = (*window * 0x9E3779B1u) >> (32 - 10);
+  filter->bits[hash / 64] |= G_GUINT64_CONSTANT (1) << (hash % 64);
+}
+
+/**
+ * _gtk_text_trigram_filter_init:
+ * @filter: a #GtkTextTrigramFilter
+ * @text: UTF-8 text
+ * @len: length of @text in bytes
+ *
+ * Initializes @filter with the trigrams of @text, to be passed
+ * to _gtk_text_btree_find_candidate_line().
+ **/
+void
+_gtk_text_trigram_filter_init (GtkTextTrigramFilter *filter,
+                               const gchar          *text,
+                               gsize                 len)
+{
+  guint32 window = 0;
+  guint n_bytes = 0;
+  gsize i;
+
+  memset (filter, 0, sizeof (GtkTextTrigramFilter));
+
+  for (i = 0; i < len; i++)
+    trigram_filter_add_byte (filter, &window, &n_bytes, text[i]);
+}
+
+static const GtkTextTrigramFilter *
+gtk_text_btree_node_ensure_trigrams (GtkTextBTreeNode *node)
+{
+  GtkTextTrigramFilter *filter;
+  GtkTextLine *line;
+  guint32 window = 0;
+  guint n_bytes = 0;
+
+  g_assert (node->level == 0);
+
+  if (node->trigrams)
+    return node->trigrams;
+
+  filter = g_slice_new0 (GtkTextTrigramFilter);
+
+  for (line = node->children.line; line != NULL; line = line->next)
+    {
+      GtkTextLineSegment *seg;
+
+      for (seg = line->segments; seg != NULL; seg = seg->next)
+        {
+          if (seg->type == &gtk_text_char_type)
+            {
+              gint i;
+
+              for (i = 0; i < seg->byte_count; i++)
+                trigram_filter_add_byte (filter, &window, &n_bytes, seg->body.chars[i]);
+            }
+          else if (seg->char_count > 0)
+            {
+              /* Pixbufs and child widgets */
+              filter->has_non_text = TRUE;
+            }
+        }
+    }
+
+  node->trigrams = filter;
+
+  return filter;
+}
+
+static void
+gtk_text_btree_node_invalidate_trigrams (GtkTextBTreeNode *node)
+{
+  if (node->trigrams)
+    {
+      g_slice_free (GtkTextTrigramFilter, node->trigrams);
+      node->trigrams = NULL;
+    }
+}
+
+static gboolean
+gtk_text_btree_node_may_contain (GtkTextBTreeNode           *node,
+                                 const GtkTextTrigramFilter *needle,
+                                 gboolean                    case_insensitive)
+{
+  const GtkTextTrigramFilter *filter;
+  guint i;
+
+  filter = gtk_text_btree_node_ensure_trigrams (node);
+
+  /* Case insensitive matches of non-ASCII text can't be found by
+   * folding bytes, and searches may match text around pixbufs and
+   * child widgets, depending on the flags.
+   */
+  if (filter->has_non_text ||
+      (case_insensitive && filter->has_non_ascii))
+    return TRUE;
+
+  for (i = 0; i < GTK_TEXT_TRIGRAM_FILTER_WORDS; i++)
+    {
+      if ((filter->bits[i] & needle->bits[i]) != needle->bits[i])
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * _gtk_text_btree_find_candidate_line:
+ * @line: a line
+ * @needle: the trigrams of a search string that does not span lines
+ * @case_insensitive: whether the search ignores case
+ *
+ * Skips the lines starting at @line that can't contain the search
+ * string, by looking at the trigram filters of the leaves.
+ *
+ * Returns: the first line at or after @line that may contain a match,
+ *     or %NULL if there is none
+ **/
+GtkTextLine *
+_gtk_text_btree_find_candidate_line (GtkTextLine                *line,
+                                     const GtkTextTrigramFilter *needle,
+                                     gboolean                    case_insensitive)
+{
+  GtkTextBTreeNode *node;
+
+  g_return_val_if_fail (line != NULL, NULL);
+  g_return_val_if_fail (needle != NULL, NULL);
+
+  node = line->parent;
+  if (gtk_text_btree_node_may_contain (node, needle, case_insensitive))
+    return line;
+
+  while (TRUE)
+    {
+      /* Go to the next leaf */
+      while (node->next == NULL)
+        {
+          node = node->parent;
+          if (node == NULL)
+            return NULL;
+        }
+
+      node = node->next;
+      while (node->level > 0)
+        node = node->children.node;
+
+      if (gtk_text_btree_node_may_contain (node, needle, case_insensitive))
+        return node->children.line;
+    }
+}
+
 static NodeData*
 gtk_text_btree_node_ensure_data (GtkTextBTreeNode *node, gpointer view_id)
 {
@@ -5991,6 +6439,7 @@ post_insert_fixup (GtkTextBTree *tree,
     }
   node = line->parent;
   node->num_children += line_count_delta;
+  gtk_text_btree_node_invalidate_trigrams (node);
 
   if (node->num_children > MAX_CHILDREN)
     {
@@ -6210,6 +6659,9 @@ recompute_node_counts (GtkTextBTree *tree, GtkTextBTreeNode *node)
   node->num_lines = 0;
   node->num_chars = 0;
 
+  if (node->level == 0)
+    gtk_text_btree_node_invalidate_trigrams (node);
+
   /*
    * Scan through the children, adding the childrens’ tag counts into
    * the GtkTextBTreeNode’s tag counts and adding new Summary structures if
@@ -71,6 +71,33 @@ void _gtk_text_btree_insert        (GtkTextIter *iter,
 void _gtk_text_btree_insert_pixbuf (GtkTextIter *iter,
                                     GdkPixbuf   *pixbuf);
 
+#define GTK_TEXT_TRIGRAM_FILTER_WORDS 16
+
+typedef struct _GtkTextTrigramFilter GtkTextTrigramFilter;
+
+struct _GtkTextTrigramFilter
+{
+  guint64 bits[GTK_TEXT_TRIGRAM_FILTER_WORDS];
+  guint has_non_ascii : 1;
+  guint has_non_text : 1;
+};
+
+void         _gtk_text_trigram_filter_init        (GtkTextTrigramFilter       *filter,
+                                                   const gchar                *text,
+                                                   gsize                       len);
+GtkTextLine *_gtk_text_btree_find_candidate_line  (GtkTextLine                *line,
+                                                   const GtkTextTrigramFilter *needle,
+                                                   gboolean                    case_insensitive);
+
+typedef struct _GtkTextBTreeLoader GtkTextBTreeLoader;
+
+GtkTextBTreeLoader *_gtk_text_btree_loader_new    (const GtkTextIter  *iter);
+void                _gtk_text_btree_loader_append (GtkTextBTreeLoader *loader,
+                                                   const gchar        *text,
+                                                   gint                len);
+void                _gtk_text_btree_loader_finish (GtkTextBTreeLoader *loader,
+                                                   GtkTextIter        *iter);
+
 void _gtk_text_btree_insert_child_anchor (GtkTextIter        *iter,
                                           GtkTextChildAnchor *anchor);
 
@@ -107,6 +134,11 @@ gboolean     _gtk_text_btree_validate          (GtkTextBTree      *tree,
 void         _gtk_text_btree_validate_line     (GtkTextBTree      *tree,
                                                 GtkTextLine       *line,
                                                 gpointer           view_id);
+void         _gtk_text_btree_line_validated    (GtkTextBTree      *tree,
+                                                GtkTextLine       *line,
+                                                gpointer           view_id);
+GtkTextLine *_gtk_text_btree_get_first_invalid_line (GtkTextBTree *tree,
+                                                     gpointer      view_id);
 
 /* Tag */
 
@@ -143,6 +143,9 @@ static void gtk_text_buffer_real_changed               (GtkTextBuffer     *buffe
 static void gtk_text_buffer_real_mark_set              (GtkTextBuffer     *buffer,
                                                         const GtkTextIter *iter,
                                                         GtkTextMark       *mark);
+static void gtk_text_buffer_mark_set                   (GtkTextBuffer     *buffer,
+                                                        const GtkTextIter *location,
+                                                        GtkTextMark       *mark);
 
 static GtkTextBTree* get_btree (GtkTextBuffer *buffer);
 static void          free_log_attr_cache (GtkTextLogAttrCache *cache);
@@ -986,6 +989,115 @@ gtk_text_buffer_insert_at_cursor (GtkTextBuffer *buffer,
   gtk_text_buffer_insert (buffer, &iter, text, len);
 }
 
+/* Working memory of gtk_text_buffer_insert_stream() */
+#define INSERT_STREAM_CHUNK_SIZE 65536
+
+/**
+ * gtk_text_buffer_insert_stream:
+ * @buffer: a #GtkTextBuffer
+ * @iter: a position in the buffer
+ * @stream: a #GInputStream with UTF-8 text
+ * @cancellable: (allow-none): a #GCancellable
+ * @error: return location for an error
+ *
+ * Inserts the contents of @stream at position @iter, reading it in
+ * chunks of fixed size. This is a lot faster than inserting big texts
+ * with gtk_text_buffer_insert(), and the text is never in memory as
+ * a whole, except in @buffer.
+ *
+ * The “insert-text” signal is not emitted for the inserted text;
+ * instead, the “changed” signal is emitted once when the stream has
+ * been read completely, or when reading fails. In the latter case,
+ * the text read so far stays in @buffer.
+ *
+ * Like gtk_text_buffer_insert(), @iter is revalidated to point to
+ * the end of the inserted text.
+ *
+ * Returns: %TRUE on success, %FALSE if reading @stream failed
+ *     or it didn't contain valid UTF-8 text
+ *
+ * Since: 3.94
+ **/
+gboolean
+gtk_text_buffer_insert_stream (GtkTextBuffer *buffer,
+                               GtkTextIter   *iter,
+                               GInputStream  *stream,
+                               GCancellable  *cancellable,
+                               GError       **error)
+{
+  GtkTextBTreeLoader *loader;
+  GtkTextIter insert;
+  gchar *chunk;
+  gsize carried = 0;
+  gboolean success = TRUE;
+
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (gtk_text_iter_get_buffer (iter) == buffer, FALSE);
+  g_return_val_if_fail (G_IS_INPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  chunk = g_malloc (INSERT_STREAM_CHUNK_SIZE);
+  loader = _gtk_text_btree_loader_new (iter);
+
+  while (TRUE)
+    {
+      const gchar *valid_end;
+      gssize n_read;
+      gsize len, valid_len;
+
+      n_read = g_input_stream_read (stream,
+                                    chunk + carried,
+                                    INSERT_STREAM_CHUNK_SIZE - carried,
+                                    cancellable, error);
+      if (n_read < 0)
+        {
+          success = FALSE;
+          break;
+        }
+
+      len = carried + n_read;
+
+      if (!g_utf8_validate (chunk, len, &valid_end))
+        {
+          /* A character may continue in the next chunk */
+          if (n_read == 0 || len - (valid_end - chunk) >= 4)
+            {
+              g_set_error_literal (error, G_CONVERT_ERROR,
+                                   G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+                                   _("The text is not valid UTF-8"));
+              success = FALSE;
+            }
+        }
+      valid_len = valid_end - chunk;
+
+      /* Don't split a "\r\n" paragraph delimiter */
+      if (n_read > 0 && valid_len > 0 && chunk[valid_len - 1] == '\r')
+        valid_len--;
+
+      _gtk_text_btree_loader_append (loader, chunk, valid_len);
+
+      if (!success || n_read == 0)
+        break;
+
+      carried = len - valid_len;
+      memmove (chunk, chunk + valid_len, carried);
+    }
+
+  g_free (chunk);
+  _gtk_text_btree_loader_finish (loader, iter);
+
+  g_signal_emit (buffer, signals[CHANGED], 0);
+  g_object_notify_by_pspec (G_OBJECT (buffer), text_buffer_props[PROP_CURSOR_POSITION]);
+
+  /* The insert mark may have moved along */
+  gtk_text_buffer_get_iter_at_mark (buffer, &insert,
+                                    gtk_text_buffer_get_insert (buffer));
+  gtk_text_buffer_mark_set (buffer, &insert, gtk_text_buffer_get_insert (buffer));
+
+  return success;
+}
+
 /**
  * gtk_text_buffer_insert_interactive:
  * @buffer: a #GtkTextBuffer
@@ -195,6 +195,12 @@ GDK_AVAILABLE_IN_ALL
 void gtk_text_buffer_insert_at_cursor  (GtkTextBuffer *buffer,
                                         const gchar   *text,
                                         gint           len);
+GDK_AVAILABLE_IN_3_94
+gboolean gtk_text_buffer_insert_stream (GtkTextBuffer *buffer,
+                                        GtkTextIter   *iter,
+                                        GInputStream  *stream,
+                                        GCancellable  *cancellable,
+                                        GError       **error);
 
 GDK_AVAILABLE_IN_ALL
 gboolean gtk_text_buffer_insert_interactive           (GtkTextBuffer *buffer,
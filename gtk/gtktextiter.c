@@ -4865,6 +4865,312 @@ strbreakup (const char *string,
   return str_array;
 }
 
+/* Fast path for forward searches
+ *
+ * Search strings that don't span lines are looked for in the segments
+ * of the lines directly, without copying their text. Candidates are
+ * found by scanning for the first byte of the search string with
+ * memchr(), and leaves of the btree whose trigrams don't include those
+ * of the search string are skipped.
+ *
+ * Lines with pixbufs or child widgets, and lines with non-ASCII text
+ * in case insensitive searches are searched with lines_match().
+ */
+
+typedef struct _TextSearch TextSearch;
+
+struct _TextSearch
+{
+  gchar **lines;                /* as returned by strbreakup () */
+  const gchar *needle;
+  gsize needle_len;
+  gboolean slice;
+  gboolean case_insensitive;
+  gboolean use_trigrams;
+  GtkTextTrigramFilter trigrams;
+};
+
+static gboolean
+text_search_is_possible (const gchar        *str,
+                         GtkTextSearchFlags  flags)
+{
+  if (flags & GTK_TEXT_SEARCH_VISIBLE_ONLY)
+    return FALSE;
+
+  if (strchr (str, '\n') != NULL)
+    return FALSE;
+
+  /* Only ASCII is folded quickly */
+  if ((flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) && !g_str_is_ascii (str))
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+text_search_init (TextSearch         *search,
+                  const gchar        *str,
+                  GtkTextSearchFlags  flags)
+{
+  search->slice = (flags & GTK_TEXT_SEARCH_TEXT_ONLY) == 0;
+  search->case_insensitive = (flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) != 0;
+  search->lines = strbreakup (str, "\n", -1, NULL, search->case_insensitive);
+  search->needle = search->lines[0];
+  search->needle_len = strlen (search->needle);
+  search->use_trigrams = search->needle_len >= 3;
+
+  if (search->use_trigrams)
+    _gtk_text_trigram_filter_init (&search->trigrams, search->needle, search->needle_len);
+}
+
+static void
+text_search_clear (TextSearch *search)
+{
+  g_strfreev (search->lines);
+}
+
+static gboolean
+text_search_line_is_plain (const TextSearch *search,
+                           GtkTextLine      *line)
+{
+  GtkTextLineSegment *seg;
+
+  for (seg = line->segments; seg != NULL; seg = seg->next)
+    {
+      if (seg->type == &gtk_text_char_type)
+        {
+          gint i;
+
+          if (!search->case_insensitive)
+            continue;
+
+          for (i = 0; i < seg->byte_count; i++)
+            {
+              if ((guchar) seg->body.chars[i] >= 0x80)
+                return FALSE;
+            }
+        }
+      else if (seg->char_count > 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+text_search_matches_at (const TextSearch         *search,
+                        const GtkTextLineSegment *seg,
+                        gint                      index)
+{
+  const gchar *needle = search->needle;
+  gsize len = search->needle_len;
+
+  /* The match may continue in the following segments */
+  while (len > 0)
+    {
+      if (seg == NULL)
+        return FALSE;
+
+      if (seg->type == &gtk_text_char_type)
+        {
+          const gchar *chars = seg->body.chars + index;
+          gsize n = MIN (len, (gsize) (seg->byte_count - index));
+          gsize i;
+
+          if (search->case_insensitive)
+            {
+              for (i = 0; i < n; i++)
+                {
+                  if (g_ascii_tolower (chars[i]) != needle[i])
+                    return FALSE;
+                }
+            }
+          else if (memcmp (chars, needle, n) != 0)
+            return FALSE;
+
+          needle += n;
+          len -= n;
+        }
+
+      seg = seg->next;
+      index = 0;
+    }
+
+  return TRUE;
+}
+
+static const gchar *
+text_search_scan (const gchar *p,
+                  const gchar *end,
+                  gchar        c)
+{
+  const gchar *found;
+
+  found = memchr (p, c, end - p);
+
+  return found ? found : end;
+}
+
+/* Returns the byte index of the first match in a plain line,
+ * or -1
+ */
+static gint
+text_search_line (const TextSearch *search,
+                  GtkTextLine      *line,
+                  gint              start_index)
+{
+  GtkTextLineSegment *seg;
+  gchar first, other;
+  gint seg_index;
+
+  /* The needle is folded to lower case already */
+  first = search->needle[0];
+  other = search->case_insensitive ? g_ascii_toupper (first) : first;
+
+  for (seg = line->segments, seg_index = 0;
+       seg != NULL;
+       seg_index += seg->byte_count, seg = seg->next)
+    {
+      const gchar *chars, *end, *p;
+      const gchar *next_first = NULL;
+      const gchar *next_other = NULL;
+
+      if (seg->type != &gtk_text_char_type ||
+          seg_index + seg->byte_count <= start_index)
+        continue;
+
+      chars = seg->body.chars;
+      end = chars + seg->byte_count;
+      p = chars + MAX (0, start_index - seg_index);
+
+      while (p < end)
+        {
+          const gchar *candidate;
+
+          if (next_first == NULL || next_first < p)
+            next_first = text_search_scan (p, end, first);
+          candidate = next_first;
+
+          if (other != first)
+            {
+              if (next_other == NULL || next_other < p)
+                next_other = text_search_scan (p, end, other);
+              candidate = MIN (candidate, next_other);
+            }
+
+          if (candidate == end)
+            break;
+
+          if (text_search_matches_at (search, seg, candidate - chars))
+            return seg_index + (candidate - chars);
+
+          p = candidate + 1;
+        }
+    }
+
+  return -1;
+}
+
+static gboolean
+text_search_forward (const TextSearch  *search,
+                     const GtkTextIter *iter,
+                     GtkTextIter       *match_start,
+                     GtkTextIter       *match_end,
+                     const GtkTextIter *limit)
+{
+  GtkTextBTree *tree;
+  GtkTextLine *line;
+  GtkTextLine *limit_line = NULL;
+  gint limit_index = 0;
+  gint start_index;
+  GtkTextIter start, end;
+
+  tree = _gtk_text_iter_get_btree (iter);
+  line = _gtk_text_iter_get_text_line (iter);
+  start_index = gtk_text_iter_get_line_index (iter);
+
+  if (limit)
+    {
+      limit_line = _gtk_text_iter_get_text_line (limit);
+      limit_index = gtk_text_iter_get_line_index (limit);
+    }
+
+  while (TRUE)
+    {
+      if (search->use_trigrams)
+        {
+          GtkTextLine *candidate;
+
+          candidate = _gtk_text_btree_find_candidate_line (line, &search->trigrams,
+                                                           search->case_insensitive);
+          if (candidate == NULL)
+            return FALSE;
+
+          if (candidate != line)
+            {
+              if (limit_line != NULL &&
+                  _gtk_text_line_get_number (candidate) > _gtk_text_line_get_number (limit_line))
+                return FALSE;
+
+              line = candidate;
+              start_index = 0;
+            }
+        }
+
+      if (_gtk_text_line_is_last (line, tree))
+        return FALSE;
+
+      if (line == limit_line && start_index >= limit_index)
+        return FALSE;
+
+      if (text_search_line_is_plain (search, line))
+        {
+          gint index, end_index;
+
+          index = text_search_line (search, line, start_index);
+          if (index >= 0)
+            {
+              _gtk_text_btree_get_iter_at_line (tree, &start, line, index);
+
+              end_index = index + search->needle_len;
+              if (end_index < _gtk_text_line_byte_count (line))
+                _gtk_text_btree_get_iter_at_line (tree, &end, line, end_index);
+              else
+                _gtk_text_btree_get_iter_at_line (tree, &end, _gtk_text_line_next (line), 0);
+
+              break;
+            }
+        }
+      else
+        {
+          GtkTextIter line_start;
+
+          _gtk_text_btree_get_iter_at_line (tree, &line_start, line, start_index);
+
+          if (lines_match (&line_start, (const gchar **) search->lines,
+                           FALSE, search->slice, search->case_insensitive,
+                           &start, &end))
+            break;
+        }
+
+      if (line == limit_line)
+        return FALSE;
+
+      line = _gtk_text_line_next (line);
+      start_index = 0;
+    }
+
+  if (limit && gtk_text_iter_compare (&end, limit) > 0)
+    return FALSE;
+
+  if (match_start)
+    *match_start = start;
+  if (match_end)
+    *match_end = end;
+
+  return TRUE;
+}
+
 /**
  * gtk_text_iter_forward_search:
  * @iter: start of search
@@ -4930,6 +5236,17 @@ gtk_text_iter_forward_search (const GtkTextIter *iter,
         return FALSE;
     }
 
+  if (text_search_is_possible (str, flags))
+    {
+      TextSearch text_search;
+
+      text_search_init (&text_search, str, flags);
+      retval = text_search_forward (&text_search, iter, match_start, match_end, limit);
+      text_search_clear (&text_search);
+
+      return retval;
+    }
+
   visible_only = (flags & GTK_TEXT_SEARCH_VISIBLE_ONLY) != 0;
   slice = (flags & GTK_TEXT_SEARCH_TEXT_ONLY) == 0;
   case_insensitive = (flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) != 0;
@@ -4978,6 +5295,87 @@ gtk_text_iter_forward_search (const GtkTextIter *iter,
   return retval;
 }
 
+/**
+ * gtk_text_iter_forward_search_all:
+ * @iter: start of search
+ * @str: a search string
+ * @flags: flags affecting how the search is done
+ * @limit: (allow-none): location of last possible match end, or %NULL for the end of the buffer
+ *
+ * Finds all matches of @str after @iter, as if calling
+ * gtk_text_iter_forward_search() repeatedly, starting every search
+ * at the end of the previous match. This is a lot faster than doing
+ * so, which makes it suitable for highlighting all matches in big
+ * buffers. Searching again without modifying the buffer in between
+ * is faster still.
+ *
+ * Since applying tags to the matches invalidates all iterators,
+ * the matches are returned as character offsets, which can be passed
+ * to gtk_text_buffer_get_iter_at_offset().
+ *
+ * Returns: (transfer full) (element-type gint): the offsets of the
+ *     start and end of each match, one after the other
+ *
+ * Since: 3.94
+ **/
+GArray *
+gtk_text_iter_forward_search_all (const GtkTextIter *iter,
+                                  const gchar       *str,
+                                  GtkTextSearchFlags flags,
+                                  const GtkTextIter *limit)
+{
+  GArray *matches;
+  TextSearch text_search;
+  GtkTextIter search, match_start, match_end;
+  gboolean fast;
+
+  g_return_val_if_fail (iter != NULL, NULL);
+  g_return_val_if_fail (str != NULL, NULL);
+
+  matches = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  if (*str == '\0')
+    return matches;
+
+  fast = text_search_is_possible (str, flags);
+  if (fast)
+    text_search_init (&text_search, str, flags);
+
+  search = *iter;
+
+  while (limit == NULL || gtk_text_iter_compare (&search, limit) < 0)
+    {
+      gint offsets[2];
+
+      if (fast)
+        {
+          if (!text_search_forward (&text_search, &search, &match_start, &match_end, limit))
+            break;
+        }
+      else
+        {
+          if (!gtk_text_iter_forward_search (&search, str, flags, &match_start, &match_end, limit))
+            break;
+        }
+
+      offsets[0] = gtk_text_iter_get_offset (&match_start);
+      offsets[1] = gtk_text_iter_get_offset (&match_end);
+      g_array_append_vals (matches, offsets, 2);
+
+      search = match_end;
+
+      /* Don't get stuck at an empty match */
+      if (gtk_text_iter_equal (&match_start, &match_end) &&
+          !gtk_text_iter_forward_char (&search))
+        break;
+    }
+
+  if (fast)
+    text_search_clear (&text_search);
+
+  return matches;
+}
+
 static gboolean
 vectors_equal_ignoring_trailing (gchar    **vec1,
                                  gchar    **vec2,
@@ -376,6 +376,12 @@ gboolean gtk_text_iter_forward_search  (const GtkTextIter *iter,
                                         GtkTextIter       *match_end,
                                         const GtkTextIter *limit);
 
+GDK_AVAILABLE_IN_3_94
+GArray * gtk_text_iter_forward_search_all (const GtkTextIter *iter,
+                                           const gchar       *str,
+                                           GtkTextSearchFlags flags,
+                                           const GtkTextIter *limit);
+
 GDK_AVAILABLE_IN_ALL
 gboolean gtk_text_iter_backward_search (const GtkTextIter *iter,
                                         const gchar       *str,
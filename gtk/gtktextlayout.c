@@ -84,6 +84,7 @@
 #include "gtktextutil.h"
 #include "gtkintl.h"
 
+#include <pango/pangocairo.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -97,8 +98,25 @@ struct _GtkTextLayoutPrivate
      direction only influences the direction of the cursor line.
   */
   GtkTextLine *cursor_line;
+
+  /* Recently used line displays, the most recently used one at the
+   * head. Getting the same lines over and over while drawing,
+   * scrolling or moving the cursor is the most common case.
+   */
+  GQueue display_lru;
+  GHashTable *display_cache;    /* GtkTextLine => GtkTextLineDisplay */
+  guint display_cache_stamp;    /* segments changed stamp of the btree */
+
+  /* Lines being measured in a thread. A line is removed when it gets
+   * invalidated or freed, so its size is only committed if it is still
+   * in the set when the measurement is done.
+   */
+  GHashTable *validating_lines;
 };
 
+/* Should be larger than the number of lines that fit on a screen */
+#define DISPLAY_CACHE_SIZE 250
+
 static GtkTextLineData *gtk_text_layout_real_wrap (GtkTextLayout *layout,
                                                    GtkTextLine *line,
                                                    /* may be NULL */
@@ -126,6 +144,7 @@ static void gtk_text_layout_emit_changed           (GtkTextLayout     *layout,
 						    gint               new_height);
 
 static void gtk_text_layout_invalidate_all (GtkTextLayout *layout);
+static void gtk_text_layout_clear_display_cache (GtkTextLayout *layout);
 
 static PangoAttribute *gtk_text_attr_appearance_new (const GtkTextAppearance *appearance);
 
@@ -193,12 +212,7 @@ gtk_text_layout_dispose (GObject *object)
   g_clear_object (&layout->ltr_context);
   g_clear_object (&layout->rtl_context);
 
-  if (layout->one_display_cache)
-    {
-      GtkTextLineDisplay *tmp_display = layout->one_display_cache;
-      layout->one_display_cache = NULL;
-      gtk_text_layout_free_line_display (layout, tmp_display);
-    }
+  gtk_text_layout_clear_display_cache (layout);
 
   if (layout->preedit_attrs != NULL)
     {
@@ -213,10 +227,14 @@ static void
 gtk_text_layout_finalize (GObject *object)
 {
   GtkTextLayout *layout;
+  GtkTextLayoutPrivate *priv;
 
   layout = GTK_TEXT_LAYOUT (object);
+  priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
 
   g_free (layout->preedit_string);
+  g_hash_table_unref (priv->display_cache);
+  g_hash_table_unref (priv->validating_lines);
 
   G_OBJECT_CLASS (gtk_text_layout_parent_class)->finalize (object);
 }
@@ -276,7 +294,13 @@ gtk_text_layout_class_init (GtkTextLayoutClass *klass)
 static void
 gtk_text_layout_init (GtkTextLayout *text_layout)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (text_layout);
+
   text_layout->cursor_visible = TRUE;
+
+  g_queue_init (&priv->display_lru);
+  priv->display_cache = g_hash_table_new (NULL, NULL);
+  priv->validating_lines = g_hash_table_new (NULL, NULL);
 }
 
 GtkTextLayout*
@@ -295,6 +319,116 @@ free_style_cache (GtkTextLayout *text_layout)
     }
 }
 
+static void
+gtk_text_layout_remove_cached_display (GtkTextLayout      *layout,
+                                       GtkTextLineDisplay *display)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  g_hash_table_remove (priv->display_cache, display->line);
+  g_queue_unlink (&priv->display_lru, &display->cache_link);
+  display->cache_link.data = NULL;
+
+  gtk_text_layout_free_line_display (layout, display);
+}
+
+static void
+gtk_text_layout_clear_display_cache (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  while (priv->display_lru.tail)
+    gtk_text_layout_remove_cached_display (layout, priv->display_lru.tail->data);
+}
+
+/* Lines are only guaranteed to tell the layout when they go away if
+ * they have line data for it, and they can only go away if the
+ * segments of the btree change. So when that happens, drop the
+ * displays of lines we can't be sure about before looking at them.
+ */
+static void
+gtk_text_layout_check_display_cache (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  guint stamp;
+  GList *l, *next;
+
+  if (layout->buffer == NULL)
+    return;
+
+  stamp = _gtk_text_btree_get_segments_changed_stamp (_gtk_text_buffer_get_btree (layout->buffer));
+  if (stamp == priv->display_cache_stamp)
+    return;
+
+  priv->display_cache_stamp = stamp;
+
+  for (l = priv->display_lru.head; l != NULL; l = next)
+    {
+      GtkTextLineDisplay *display = l->data;
+
+      next = l->next;
+
+      if (!display->has_line_data)
+        gtk_text_layout_remove_cached_display (layout, display);
+    }
+}
+
+static GtkTextLineDisplay *
+gtk_text_layout_lookup_cached_display (GtkTextLayout *layout,
+                                       GtkTextLine   *line,
+                                       gboolean       size_only)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextLineDisplay *display;
+
+  gtk_text_layout_check_display_cache (layout);
+
+  display = g_hash_table_lookup (priv->display_cache, line);
+  if (display == NULL)
+    return NULL;
+
+  if (!size_only && display->size_only)
+    {
+      gtk_text_layout_remove_cached_display (layout, display);
+      return NULL;
+    }
+
+  display->has_line_data = _gtk_text_line_get_data (line, layout) != NULL;
+
+  if (!size_only)
+    {
+      g_queue_unlink (&priv->display_lru, &display->cache_link);
+      g_queue_push_head_link (&priv->display_lru, &display->cache_link);
+    }
+
+  return display;
+}
+
+/* Size-only displays are added at the least recently used end, so
+ * wrapping many lines doesn't push the displays used for drawing out
+ * of the cache.
+ */
+static void
+gtk_text_layout_add_cached_display (GtkTextLayout      *layout,
+                                    GtkTextLineDisplay *display)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  g_assert (g_hash_table_lookup (priv->display_cache, display->line) == NULL);
+
+  if (priv->display_lru.length >= DISPLAY_CACHE_SIZE)
+    gtk_text_layout_remove_cached_display (layout, priv->display_lru.tail->data);
+
+  display->has_line_data = _gtk_text_line_get_data (display->line, layout) != NULL;
+  display->cache_link.data = display;
+  g_hash_table_insert (priv->display_cache, display->line, display);
+
+  if (display->size_only)
+    g_queue_push_tail_link (&priv->display_lru, &display->cache_link);
+  else
+    g_queue_push_head_link (&priv->display_lru, &display->cache_link);
+}
+
 /**
  * gtk_text_layout_set_buffer:
  * @buffer: (allow-none):
@@ -303,6 +437,8 @@ void
 gtk_text_layout_set_buffer (GtkTextLayout *layout,
                             GtkTextBuffer *buffer)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
   g_return_if_fail (buffer == NULL || GTK_IS_TEXT_BUFFER (buffer));
 
@@ -310,6 +446,8 @@ gtk_text_layout_set_buffer (GtkTextLayout *layout,
     return;
 
   free_style_cache (layout);
+  gtk_text_layout_clear_display_cache (layout);
+  g_hash_table_remove_all (priv->validating_lines);
 
   if (layout->buffer)
     {
@@ -635,18 +773,37 @@ text_layout_changed (GtkTextLayout *layout,
                      gint           new_height,
                      gboolean       cursors_only)
 {
-  /* Check if the range intersects our cached line display,
-   * and invalidate the cached line if so.
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GList *l, *next;
+
+  /* Check if the range intersects our cached line displays,
+   * and invalidate the cached lines if so.
    */
-  if (layout->one_display_cache)
+  gtk_text_layout_check_display_cache (layout);
+
+  if (y <= 0 && y + old_height >= layout->height)
+    {
+      if (cursors_only)
+        {
+          for (l = priv->display_lru.head; l != NULL; l = l->next)
+            gtk_text_layout_invalidate_cache (layout, ((GtkTextLineDisplay *) l->data)->line, TRUE);
+        }
+      else
+        gtk_text_layout_clear_display_cache (layout);
+    }
+  else
     {
-      GtkTextLine *line = layout->one_display_cache->line;
-      gint cache_y = _gtk_text_btree_find_line_top (_gtk_text_buffer_get_btree (layout->buffer),
-						    line, layout);
-      gint cache_height = layout->one_display_cache->height;
+      for (l = priv->display_lru.head; l != NULL; l = next)
+        {
+          GtkTextLineDisplay *display = l->data;
+          gint cache_y = _gtk_text_btree_find_line_top (_gtk_text_buffer_get_btree (layout->buffer),
+                                                        display->line, layout);
+
+          next = l->next;
 
-      if (cache_y + cache_height > y && cache_y < y + old_height)
-	gtk_text_layout_invalidate_cache (layout, line, cursors_only);
+          if (cache_y + display->height > y && cache_y < y + old_height)
+            gtk_text_layout_invalidate_cache (layout, display->line, cursors_only);
+        }
     }
 
   gtk_text_layout_emit_changed (layout, y, old_height, new_height);
@@ -818,24 +975,23 @@ gtk_text_layout_invalidate_cache (GtkTextLayout *layout,
                                   GtkTextLine   *line,
 				  gboolean       cursors_only)
 {
-  if (layout->one_display_cache && line == layout->one_display_cache->line)
-    {
-      GtkTextLineDisplay *display = layout->one_display_cache;
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextLineDisplay *display;
 
-      if (cursors_only)
-	{
-          if (display->cursors)
-            g_array_free (display->cursors, TRUE);
-	  display->cursors = NULL;
-	  display->cursors_invalid = TRUE;
-	  display->has_block_cursor = FALSE;
-	}
-      else
-	{
-	  layout->one_display_cache = NULL;
-	  gtk_text_layout_free_line_display (layout, display);
-	}
+  display = g_hash_table_lookup (priv->display_cache, line);
+  if (display == NULL)
+    return;
+
+  if (cursors_only)
+    {
+      if (display->cursors)
+        g_array_free (display->cursors, TRUE);
+      display->cursors = NULL;
+      display->cursors_invalid = TRUE;
+      display->has_block_cursor = FALSE;
     }
+  else
+    gtk_text_layout_remove_cached_display (layout, display);
 }
 
 /* Now invalidate the paragraph containing the cursor
@@ -859,6 +1015,7 @@ gtk_text_layout_invalidate_cursor_line (GtkTextLayout *layout,
 	{
 	  gtk_text_layout_invalidate_cache (layout, priv->cursor_line, FALSE);
 	  _gtk_text_line_invalidate_wrap (priv->cursor_line, line_data);
+	  g_hash_table_remove (priv->validating_lines, priv->cursor_line);
 	}
 
       gtk_text_layout_invalidated (layout);
@@ -882,6 +1039,7 @@ gtk_text_layout_real_invalidate (GtkTextLayout *layout,
                                  const GtkTextIter *start,
                                  const GtkTextIter *end)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
   GtkTextLine *line;
   GtkTextLine *last_line;
 
@@ -908,6 +1066,7 @@ gtk_text_layout_real_invalidate (GtkTextLayout *layout,
       GtkTextLineData *line_data = _gtk_text_line_get_data (line, layout);
 
       gtk_text_layout_invalidate_cache (layout, line, FALSE);
+      g_hash_table_remove (priv->validating_lines, line);
       
       if (line_data)
         _gtk_text_line_invalidate_wrap (line, line_data);
@@ -926,32 +1085,35 @@ gtk_text_layout_real_invalidate_cursors (GtkTextLayout     *layout,
 					 const GtkTextIter *start,
 					 const GtkTextIter *end)
 {
-  /* Check if the range intersects our cached line display,
-   * and invalidate the cached line if so.
-   */
-  if (layout->one_display_cache)
-    {
-      GtkTextIter line_start, line_end;
-      GtkTextLine *line = layout->one_display_cache->line;
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  gint start_line, end_line;
+  GList *l;
 
-      gtk_text_layout_get_iter_at_line (layout, &line_start, line, 0);
+  /* Check if the range intersects our cached line displays,
+   * and invalidate the cached lines if so.
+   */
+  gtk_text_layout_check_display_cache (layout);
 
-      line_end = line_start;
-      if (!gtk_text_iter_ends_line (&line_end))
-	gtk_text_iter_forward_to_line_end (&line_end);
+  if (priv->display_lru.length > 0)
+    {
+      start_line = gtk_text_iter_get_line (start);
+      end_line = gtk_text_iter_get_line (end);
 
-      if (gtk_text_iter_compare (start, end) > 0)
+      if (start_line > end_line)
 	{
-	  const GtkTextIter *tmp = start;
-	  start = end;
-	  end = tmp;
+	  gint tmp = start_line;
+	  start_line = end_line;
+	  end_line = tmp;
 	}
 
-      if (gtk_text_iter_compare (&line_start, end) <= 0 &&
-	  gtk_text_iter_compare (start, &line_end) <= 0)
-	{
-	  gtk_text_layout_invalidate_cache (layout, line, TRUE);
-	}
+      for (l = priv->display_lru.head; l != NULL; l = l->next)
+        {
+          GtkTextLineDisplay *display = l->data;
+          gint line = _gtk_text_line_get_number (display->line);
+
+          if (line >= start_line && line <= end_line)
+            gtk_text_layout_invalidate_cache (layout, display->line, TRUE);
+        }
     }
 
   gtk_text_layout_invalidated (layout);
@@ -962,7 +1124,10 @@ gtk_text_layout_real_free_line_data (GtkTextLayout     *layout,
                                      GtkTextLine       *line,
                                      GtkTextLineData   *line_data)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
   gtk_text_layout_invalidate_cache (layout, line, FALSE);
+  g_hash_table_remove (priv->validating_lines, line);
 
   g_slice_free (GtkTextLineData, line_data);
 }
@@ -2240,58 +2405,37 @@ tags_array_toggle_tag (GPtrArray  *array,
   return array;
 }
 
-GtkTextLineDisplay *
-gtk_text_layout_get_line_display (GtkTextLayout *layout,
-                                  GtkTextLine   *line,
-                                  gboolean       size_only)
+/* Sets up the text, attributes and paragraph values of the
+ * PangoLayout of @display, without measuring it.
+ *
+ * Returns FALSE if the line is totally invisible, in which case
+ * the layout is left empty.
+ */
+static gboolean
+gtk_text_layout_fill_line_display (GtkTextLayout      *layout,
+                                   GtkTextLineDisplay *display,
+                                   gboolean           *saw_widget,
+                                   gboolean           *saw_pixbuf)
 {
   GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
-  GtkTextLineDisplay *display;
+  GtkTextLine *line = display->line;
+  gboolean size_only = display->size_only;
   GtkTextLineSegment *seg;
   GtkTextIter iter;
   GtkTextAttributes *style;
   gchar *text;
-  gint text_pixel_width;
   PangoAttrList *attrs;
   gint text_allocated, layout_byte_offset, buffer_byte_offset;
-  PangoRectangle extents;
   gboolean para_values_set = FALSE;
   GSList *cursor_byte_offsets = NULL;
   GSList *cursor_segs = NULL;
   GSList *tmp_list1, *tmp_list2;
-  gboolean saw_widget = FALSE;
   PangoDirection base_dir;
   GPtrArray *tags;
   gboolean initial_toggle_segments;
-  gint h_margin;
-  gint h_padding;
-  
-  g_return_val_if_fail (line != NULL, NULL);
 
-  if (layout->one_display_cache)
-    {
-      if (line == layout->one_display_cache->line &&
-          (size_only || !layout->one_display_cache->size_only))
-	{
-	  if (!size_only)
-            update_text_display_cursors (layout, line, layout->one_display_cache);
-	  return layout->one_display_cache;
-	}
-      else
-        {
-          GtkTextLineDisplay *tmp_display = layout->one_display_cache;
-          layout->one_display_cache = NULL;
-          gtk_text_layout_free_line_display (layout, tmp_display);
-        }
-    }
-
-  DV (g_print ("creating one line display cache (%s)\n", G_STRLOC));
-
-  display = g_slice_new0 (GtkTextLineDisplay);
-
-  display->size_only = size_only;
-  display->line = line;
-  display->insert_index = -1;
+  *saw_widget = FALSE;
+  *saw_pixbuf = FALSE;
 
   /* Special-case optimization for completely
    * invisible lines; makes it faster to deal
@@ -2304,7 +2448,7 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
       else
 	display->layout = pango_layout_new (layout->ltr_context);
       
-      return display;
+      return FALSE;
     }
 
   /* Find the bidi base direction */
@@ -2419,6 +2563,8 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
                 }
               else if (seg->type == &gtk_text_pixbuf_type)
                 {
+                  *saw_pixbuf = TRUE;
+
                   add_generic_attrs (layout,
                                      &style->appearance,
                                      seg->byte_count,
@@ -2433,7 +2579,7 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
                 }
               else if (seg->type == &gtk_text_child_type)
                 {
-                  saw_widget = TRUE;
+                  *saw_widget = TRUE;
                   
                   add_generic_attrs (layout, &style->appearance,
                                      seg->byte_count,
@@ -2570,6 +2716,27 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
   g_slist_free (cursor_byte_offsets);
   g_slist_free (cursor_segs);
 
+  /* Free this if we aren't in a loop */
+  if (layout->wrap_loop_count == 0)
+    invalidate_cached_style (layout);
+
+  g_free (text);
+  pango_attr_list_unref (attrs);
+  if (tags != NULL)
+    g_ptr_array_free (tags, TRUE);
+
+  return TRUE;
+}
+
+static void
+gtk_text_layout_update_display_size (GtkTextLayout      *layout,
+                                     GtkTextLineDisplay *display)
+{
+  PangoRectangle extents;
+  gint text_pixel_width;
+  gint h_margin;
+  gint h_padding;
+
   pango_layout_get_extents (display->layout, NULL, &extents);
 
   text_pixel_width = PIXEL_BOUND (extents.width);
@@ -2601,17 +2768,40 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
 	  break;
 	}
     }
-  
-  /* Free this if we aren't in a loop */
-  if (layout->wrap_loop_count == 0)
-    invalidate_cached_style (layout);
+}
 
-  g_free (text);
-  pango_attr_list_unref (attrs);
-  if (tags != NULL)
-    g_ptr_array_free (tags, TRUE);
+GtkTextLineDisplay *
+gtk_text_layout_get_line_display (GtkTextLayout *layout,
+                                  GtkTextLine   *line,
+                                  gboolean       size_only)
+{
+  GtkTextLineDisplay *display;
+  gboolean saw_widget, saw_pixbuf;
+
+  g_return_val_if_fail (line != NULL, NULL);
+
+  display = gtk_text_layout_lookup_cached_display (layout, line, size_only);
+  if (display)
+    {
+      if (!size_only)
+        update_text_display_cursors (layout, line, display);
+      return display;
+    }
+
+  DV (g_print ("creating line display (%s)\n", G_STRLOC));
+
+  display = g_slice_new0 (GtkTextLineDisplay);
+
+  display->size_only = size_only;
+  display->line = line;
+  display->insert_index = -1;
 
-  layout->one_display_cache = display;
+  if (!gtk_text_layout_fill_line_display (layout, display, &saw_widget, &saw_pixbuf))
+    return display;
+
+  gtk_text_layout_update_display_size (layout, display);
+
+  gtk_text_layout_add_cached_display (layout, display);
 
   if (saw_widget)
     allocate_child_widgets (layout, display);
@@ -2623,7 +2813,7 @@ void
 gtk_text_layout_free_line_display (GtkTextLayout      *layout,
                                    GtkTextLineDisplay *display)
 {
-  if (display != layout->one_display_cache)
+  if (display->cache_link.data == NULL)
     {
       if (display->layout)
         g_object_unref (display->layout);
@@ -2638,6 +2828,504 @@ gtk_text_layout_free_line_display (GtkTextLayout      *layout,
     }
 }
 
+/*
+ * Validating lines in a thread
+ */
+
+/* Measuring lines with Pango is what takes the time when validating
+ * the lines that are not on screen. The main thread takes snapshots
+ * of the text, attributes and paragraph values of a batch of invalid
+ * lines, and the lines are measured in a thread, with contexts of the
+ * font map of that thread. The result for a line is committed back
+ * to the btree unless that line was invalidated or freed meanwhile,
+ * so text appended at the end of the buffer doesn't keep the lines
+ * before it from getting their sizes.
+ *
+ * Lines with pixbufs or child widgets are validated right away while
+ * taking the snapshots, as are totally invisible lines.
+ */
+
+typedef struct _GtkTextContextSnapshot GtkTextContextSnapshot;
+typedef struct _GtkTextValidateJob GtkTextValidateJob;
+typedef struct _GtkTextValidateBatch GtkTextValidateBatch;
+
+struct _GtkTextContextSnapshot
+{
+  PangoFontDescription *font_desc;
+  PangoLanguage *language;
+  PangoDirection base_dir;
+  PangoGravity base_gravity;
+  PangoGravityHint gravity_hint;
+  PangoMatrix matrix;
+  guint has_matrix : 1;
+  cairo_font_options_t *font_options;
+  double resolution;
+};
+
+struct _GtkTextValidateJob
+{
+  GtkTextLine *line;            /* only used on the main thread */
+
+  char *text;
+  PangoAttrList *attrs;
+  PangoTabArray *tabs;
+  PangoAlignment alignment;
+  PangoWrapMode wrap;
+  gint width;
+  gint indent;
+  gint spacing;
+  guint justify : 1;
+  guint rtl : 1;
+  gint extra_width;             /* margins and padding */
+  gint extra_height;            /* pixels above and below */
+
+  /* Filled in by the thread */
+  gint line_width;
+  gint line_height;
+  gint top_ink;
+  gint bottom_ink;
+};
+
+struct _GtkTextValidateBatch
+{
+  GWeakRef layout;
+
+  GtkTextContextSnapshot contexts[2];   /* LTR and RTL */
+  GArray *jobs;
+};
+
+static void
+gtk_text_context_snapshot_init (GtkTextContextSnapshot *snapshot,
+                                PangoContext           *context)
+{
+  const PangoMatrix *matrix;
+  const cairo_font_options_t *font_options;
+
+  snapshot->font_desc = pango_font_description_copy (pango_context_get_font_description (context));
+  snapshot->language = pango_context_get_language (context);
+  snapshot->base_dir = pango_context_get_base_dir (context);
+  snapshot->base_gravity = pango_context_get_base_gravity (context);
+  snapshot->gravity_hint = pango_context_get_gravity_hint (context);
+
+  matrix = pango_context_get_matrix (context);
+  snapshot->has_matrix = matrix != NULL;
+  if (matrix)
+    snapshot->matrix = *matrix;
+
+  font_options = pango_cairo_context_get_font_options (context);
+  snapshot->font_options = font_options ? cairo_font_options_copy (font_options) : NULL;
+  snapshot->resolution = pango_cairo_context_get_resolution (context);
+}
+
+static void
+gtk_text_context_snapshot_clear (GtkTextContextSnapshot *snapshot)
+{
+  if (snapshot->font_desc)
+    pango_font_description_free (snapshot->font_desc);
+  if (snapshot->font_options)
+    cairo_font_options_destroy (snapshot->font_options);
+}
+
+static PangoContext *
+gtk_text_context_snapshot_create_context (GtkTextContextSnapshot *snapshot,
+                                          PangoFontMap           *font_map)
+{
+  PangoContext *context;
+
+  context = pango_font_map_create_context (font_map);
+  pango_context_set_font_description (context, snapshot->font_desc);
+  pango_context_set_language (context, snapshot->language);
+  pango_context_set_base_dir (context, snapshot->base_dir);
+  pango_context_set_base_gravity (context, snapshot->base_gravity);
+  pango_context_set_gravity_hint (context, snapshot->gravity_hint);
+  pango_context_set_matrix (context, snapshot->has_matrix ? &snapshot->matrix : NULL);
+  pango_cairo_context_set_font_options (context, snapshot->font_options);
+  pango_cairo_context_set_resolution (context, snapshot->resolution);
+
+  return context;
+}
+
+static void
+gtk_text_validate_job_clear (gpointer data)
+{
+  GtkTextValidateJob *job = data;
+
+  g_free (job->text);
+  if (job->attrs)
+    pango_attr_list_unref (job->attrs);
+  if (job->tabs)
+    pango_tab_array_free (job->tabs);
+}
+
+static void
+gtk_text_validate_batch_free (gpointer data)
+{
+  GtkTextValidateBatch *batch = data;
+
+  g_weak_ref_clear (&batch->layout);
+  gtk_text_context_snapshot_clear (&batch->contexts[0]);
+  gtk_text_context_snapshot_clear (&batch->contexts[1]);
+  g_array_unref (batch->jobs);
+
+  g_slice_free (GtkTextValidateBatch, batch);
+}
+
+/* Takes the snapshot of @line, returns FALSE if the line
+ * has to be validated on the main thread.
+ */
+static gboolean
+gtk_text_validate_job_init (GtkTextValidateJob *job,
+                            GtkTextLayout      *layout,
+                            GtkTextLine        *line)
+{
+  GtkTextLineDisplay *display;
+  gboolean visible, saw_widget, saw_pixbuf;
+
+  display = g_slice_new0 (GtkTextLineDisplay);
+  display->size_only = TRUE;
+  display->line = line;
+  display->insert_index = -1;
+
+  visible = gtk_text_layout_fill_line_display (layout, display, &saw_widget, &saw_pixbuf);
+  if (!visible || saw_widget || saw_pixbuf)
+    {
+      gtk_text_layout_free_line_display (layout, display);
+      return FALSE;
+    }
+
+  job->line = line;
+  job->text = g_strdup (pango_layout_get_text (display->layout));
+  job->attrs = pango_layout_get_attributes (display->layout);
+  if (job->attrs)
+    job->attrs = pango_attr_list_copy (job->attrs);
+  job->tabs = pango_layout_get_tabs (display->layout);
+  job->alignment = pango_layout_get_alignment (display->layout);
+  job->wrap = pango_layout_get_wrap (display->layout);
+  job->width = pango_layout_get_width (display->layout);
+  job->indent = pango_layout_get_indent (display->layout);
+  job->spacing = pango_layout_get_spacing (display->layout);
+  job->justify = pango_layout_get_justify (display->layout);
+  job->rtl = pango_layout_get_context (display->layout) == layout->rtl_context;
+  job->extra_width = display->left_margin + display->right_margin +
+                     layout->left_padding + layout->right_padding;
+  job->extra_height = display->height;
+
+  gtk_text_layout_free_line_display (layout, display);
+
+  return TRUE;
+}
+
+static void
+gtk_text_validate_job_measure (GtkTextValidateJob *job,
+                               PangoContext       *context)
+{
+  PangoLayout *pango_layout;
+  PangoRectangle ink_rect, logical_rect;
+
+  pango_layout = pango_layout_new (context);
+  pango_layout_set_text (pango_layout, job->text, -1);
+  pango_layout_set_attributes (pango_layout, job->attrs);
+  pango_layout_set_tabs (pango_layout, job->tabs);
+  pango_layout_set_alignment (pango_layout, job->alignment);
+  pango_layout_set_justify (pango_layout, job->justify);
+  pango_layout_set_spacing (pango_layout, job->spacing);
+  pango_layout_set_indent (pango_layout, job->indent);
+  pango_layout_set_width (pango_layout, job->width);
+  pango_layout_set_wrap (pango_layout, job->wrap);
+
+  /* This is what gtk_text_layout_real_wrap() would compute */
+  pango_layout_get_extents (pango_layout, &ink_rect, &logical_rect);
+
+  job->line_width = PIXEL_BOUND (logical_rect.width) + job->extra_width;
+  job->line_height = job->extra_height + PANGO_PIXELS (logical_rect.height);
+
+  pango_extents_to_pixels (&ink_rect, NULL);
+  pango_extents_to_pixels (&logical_rect, NULL);
+  job->top_ink = MAX (0, logical_rect.x - ink_rect.x);
+  job->bottom_ink = MAX (0, logical_rect.x + logical_rect.width - ink_rect.x - ink_rect.width);
+
+  g_object_unref (pango_layout);
+}
+
+static void
+gtk_text_layout_validate_thread (GTask        *task,
+                                 gpointer      source_object,
+                                 gpointer      task_data,
+                                 GCancellable *cancellable)
+{
+  GtkTextValidateBatch *batch = task_data;
+  PangoFontMap *font_map;
+  PangoContext *contexts[2];
+  guint i;
+
+  /* The default font map is per thread */
+  font_map = pango_cairo_font_map_get_default ();
+  contexts[0] = gtk_text_context_snapshot_create_context (&batch->contexts[0], font_map);
+  contexts[1] = gtk_text_context_snapshot_create_context (&batch->contexts[1], font_map);
+
+  for (i = 0; i < batch->jobs->len; i++)
+    {
+      GtkTextValidateJob *job = &g_array_index (batch->jobs, GtkTextValidateJob, i);
+
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      gtk_text_validate_job_measure (job, contexts[job->rtl]);
+    }
+
+  g_object_unref (contexts[0]);
+  g_object_unref (contexts[1]);
+
+  if (!g_task_return_error_if_cancelled (task))
+    g_task_return_boolean (task, TRUE);
+}
+
+/*< private >
+ * gtk_text_layout_can_validate_async:
+ * @layout: a #GtkTextLayout
+ *
+ * Checks if lines of @layout can be measured in a thread with
+ * gtk_text_layout_validate_async(). This is not the case if lines
+ * are wrapped by a subclass or the contexts use a custom font map.
+ *
+ * Returns: %TRUE if gtk_text_layout_validate_async() can be used
+ */
+gboolean
+gtk_text_layout_can_validate_async (GtkTextLayout *layout)
+{
+  static int enabled = -1;
+  PangoFontMap *font_map;
+
+  g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), FALSE);
+
+  if (enabled < 0)
+    enabled = g_strcmp0 (g_getenv ("GTK_TEXT_THREADED_VALIDATION"), "0") != 0;
+
+  if (!enabled)
+    return FALSE;
+
+  if (layout->buffer == NULL ||
+      layout->ltr_context == NULL ||
+      layout->rtl_context == NULL ||
+      layout->wrap_loop_count > 0)
+    return FALSE;
+
+  if (GTK_TEXT_LAYOUT_GET_CLASS (layout)->wrap != gtk_text_layout_real_wrap)
+    return FALSE;
+
+  font_map = pango_cairo_font_map_get_default ();
+
+  return pango_context_get_font_map (layout->ltr_context) == font_map &&
+         pango_context_get_font_map (layout->rtl_context) == font_map;
+}
+
+/*< private >
+ * gtk_text_layout_validate_async:
+ * @layout: a #GtkTextLayout
+ * @max_lines: the maximum number of lines to look at
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called when the lines have been measured
+ * @user_data: data for @callback
+ *
+ * Validates the first invalid lines of @layout, measuring them in
+ * a thread. Call gtk_text_layout_validate_finish() from @callback
+ * to commit the results. The ::changed signal will then be emitted
+ * for each region validated.
+ *
+ * Lines that can't be measured in a thread are validated right away.
+ */
+void
+gtk_text_layout_validate_async (GtkTextLayout       *layout,
+                                gint                 max_lines,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextValidateBatch *batch;
+  GtkTextBTree *tree;
+  GtkTextLine *line;
+  GTask *task;
+
+  g_return_if_fail (gtk_text_layout_can_validate_async (layout));
+  g_return_if_fail (max_lines > 0);
+
+  tree = _gtk_text_buffer_get_btree (layout->buffer);
+
+  batch = g_slice_new0 (GtkTextValidateBatch);
+  g_weak_ref_init (&batch->layout, layout);
+  batch->jobs = g_array_new (FALSE, FALSE, sizeof (GtkTextValidateJob));
+  g_array_set_clear_func (batch->jobs, gtk_text_validate_job_clear);
+
+  for (line = _gtk_text_btree_get_first_invalid_line (tree, layout);
+       line != NULL && max_lines > 0;
+       line = _gtk_text_line_next (line), max_lines--)
+    {
+      GtkTextLineData *line_data;
+      GtkTextValidateJob job = { NULL, };
+      gint y, old_height;
+
+      line_data = _gtk_text_line_get_data (line, layout);
+      if (line_data && line_data->valid)
+        continue;
+
+      if (gtk_text_validate_job_init (&job, layout, line))
+        {
+          /* Make sure the layout is told when the line goes away */
+          if (line_data == NULL)
+            {
+              line_data = _gtk_text_line_data_new (layout, line);
+              _gtk_text_line_add_data (line, line_data);
+            }
+
+          g_hash_table_add (priv->validating_lines, line);
+          g_array_append_val (batch->jobs, job);
+          continue;
+        }
+
+      old_height = line_data ? line_data->height : 0;
+      _gtk_text_btree_validate_line (tree, line, layout);
+      line_data = _gtk_text_line_get_data (line, layout);
+
+      y = _gtk_text_btree_find_line_top (tree, line, layout);
+      update_layout_size (layout);
+      gtk_text_layout_emit_changed (layout, y, old_height, line_data->height);
+    }
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gtk_text_layout_validate_async);
+  g_task_set_task_data (task, batch, gtk_text_validate_batch_free);
+
+  if (batch->jobs->len == 0)
+    {
+      g_task_return_boolean (task, TRUE);
+    }
+  else
+    {
+      gtk_text_context_snapshot_init (&batch->contexts[0], layout->ltr_context);
+      gtk_text_context_snapshot_init (&batch->contexts[1], layout->rtl_context);
+
+      g_task_run_in_thread (task, gtk_text_layout_validate_thread);
+    }
+
+  g_object_unref (task);
+}
+
+/*< private >
+ * gtk_text_layout_validate_finish:
+ * @layout: a #GtkTextLayout
+ * @result: the #GAsyncResult passed to the callback
+ * @error: return location for an error
+ *
+ * Commits the sizes of the lines that have been measured by
+ * gtk_text_layout_validate_async(). Each line is committed on its
+ * own, the size of a line is only dropped if that line has been
+ * invalidated or removed while it was being measured.
+ *
+ * Returns: %FALSE if the validation was cancelled
+ */
+gboolean
+gtk_text_layout_validate_finish (GtkTextLayout  *layout,
+                                 GAsyncResult   *result,
+                                 GError        **error)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextValidateBatch *batch;
+  GtkTextLayout *batch_layout;
+  GtkTextBTree *tree;
+  GtkTextLine *run_line = NULL;
+  GtkTextLine *last_line = NULL;
+  gint run_y = 0, run_old_height = 0, run_new_height = 0;
+  guint i;
+
+  g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gtk_text_layout_validate_async, FALSE);
+
+  batch = g_task_get_task_data (G_TASK (result));
+  batch_layout = g_weak_ref_get (&batch->layout);
+  if (batch_layout)
+    g_object_unref (batch_layout);
+
+  if (!g_task_propagate_boolean (G_TASK (result), error))
+    {
+      if (batch_layout == layout)
+        {
+          for (i = 0; i < batch->jobs->len; i++)
+            g_hash_table_remove (priv->validating_lines,
+                                 g_array_index (batch->jobs, GtkTextValidateJob, i).line);
+        }
+
+      return FALSE;
+    }
+
+  if (batch_layout != layout || layout->buffer == NULL)
+    return TRUE;
+
+  tree = _gtk_text_buffer_get_btree (layout->buffer);
+
+  for (i = 0; i <= batch->jobs->len; i++)
+    {
+      GtkTextValidateJob *job = NULL;
+      GtkTextLineData *line_data = NULL;
+
+      if (i < batch->jobs->len)
+        {
+          job = &g_array_index (batch->jobs, GtkTextValidateJob, i);
+
+          /* The line changed or went away since it was measured */
+          if (!g_hash_table_remove (priv->validating_lines, job->line))
+            job = NULL;
+          else
+            {
+              line_data = _gtk_text_line_get_data (job->line, layout);
+              if (line_data && line_data->valid)
+                job = NULL;
+            }
+        }
+
+      /* Emit ::changed once per run of consecutive lines */
+      if (run_line != NULL &&
+          (job == NULL || _gtk_text_line_next (last_line) != job->line))
+        {
+          update_layout_size (layout);
+          gtk_text_layout_emit_changed (layout, run_y, run_old_height, run_new_height);
+          run_line = NULL;
+        }
+
+      if (job == NULL)
+        continue;
+
+      if (line_data == NULL)
+        {
+          line_data = _gtk_text_line_data_new (layout, job->line);
+          _gtk_text_line_add_data (job->line, line_data);
+        }
+
+      if (run_line == NULL)
+        {
+          run_line = job->line;
+          run_y = _gtk_text_btree_find_line_top (tree, job->line, layout);
+          run_old_height = 0;
+          run_new_height = 0;
+        }
+
+      run_old_height += line_data->height;
+      run_new_height += job->line_height;
+      last_line = job->line;
+
+      line_data->width = job->line_width;
+      line_data->height = job->line_height;
+      line_data->top_ink = job->top_ink;
+      line_data->bottom_ink = job->bottom_ink;
+      line_data->valid = TRUE;
+
+      _gtk_text_btree_line_validated (tree, job->line, layout);
+    }
+
+  return TRUE;
+}
+
 /* Functions to convert iter <=> index for the line of a GtkTextLineDisplay
  * taking into account the preedit string and invisible text if necessary.
  */
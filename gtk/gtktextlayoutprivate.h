@@ -138,11 +138,6 @@ struct _GtkTextLayout
    * over long runs with the same style. */
   GtkTextAttributes *one_style_cache;
 
-  /* A cache of one line display. Getting the same line
-   * many times in a row is the most common case.
-   */
-  GtkTextLineDisplay *one_display_cache;
-
   /* Whether we are allowed to wrap right now */
   gint wrap_loop_count;
   
@@ -245,6 +240,9 @@ struct _GtkTextLineDisplay
   guint has_block_cursor : 1;
   guint cursor_at_line_end : 1;
   guint size_only : 1;
+  guint has_line_data : 1;      /* line had line data when last looked up in the cache */
+
+  GList cache_link;             /* link in the layout's display cache, data is NULL if not cached */
 
   GdkRGBA *pg_bg_rgba;
 };
@@ -367,6 +365,18 @@ void     gtk_text_layout_validate_yrange (GtkTextLayout *layout,
 GDK_AVAILABLE_IN_ALL
 void     gtk_text_layout_validate        (GtkTextLayout *layout,
                                           gint           max_pixels);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_layout_can_validate_async (GtkTextLayout       *layout);
+GDK_AVAILABLE_IN_ALL
+void     gtk_text_layout_validate_async  (GtkTextLayout       *layout,
+                                          gint                 max_lines,
+                                          GCancellable        *cancellable,
+                                          GAsyncReadyCallback  callback,
+                                          gpointer             user_data);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_layout_validate_finish (GtkTextLayout       *layout,
+                                          GAsyncResult        *result,
+                                          GError             **error);
 
 /* This function should return the passed-in line data,
  * OR remove the existing line data from the line, and
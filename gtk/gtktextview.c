@@ -227,6 +227,7 @@ struct _GtkTextViewPrivate
 
   guint first_validate_idle;        /* Idle to revalidate onscreen portion, runs before resize */
   guint incremental_validate_idle;  /* Idle to revalidate offscreen portions, runs after redraw */
+  GCancellable *validate_cancellable; /* Set while offscreen portions are validated in a thread */
 
   GtkTextMark *dnd_mark;
 
@@ -3567,6 +3568,12 @@ gtk_text_view_remove_validate_idles (GtkTextView *text_view)
       g_source_remove (priv->incremental_validate_idle);
       priv->incremental_validate_idle = 0;
     }
+
+  if (priv->validate_cancellable != NULL)
+    {
+      g_cancellable_cancel (priv->validate_cancellable);
+      g_clear_object (&priv->validate_cancellable);
+    }
 }
 
 static void
@@ -4341,13 +4348,64 @@ first_validate_callback (gpointer data)
   return FALSE;
 }
 
+static gboolean incremental_validate_callback (gpointer data);
+
+static void
+incremental_validate_done (GObject      *source,
+                           GAsyncResult *result,
+                           gpointer      data)
+{
+  GtkTextView *text_view = data;
+  GtkTextViewPrivate *priv = text_view->priv;
+
+  DV(g_print(G_STRLOC"\n"));
+
+  /* When cancelled, the layout may be gone already */
+  if (priv->layout != NULL &&
+      gtk_text_layout_validate_finish (priv->layout, result, NULL))
+    {
+      g_clear_object (&priv->validate_cancellable);
+
+      gtk_text_view_update_adjustments (text_view);
+
+      if (!gtk_text_layout_is_valid (priv->layout) &&
+          !priv->incremental_validate_idle)
+        {
+          priv->incremental_validate_idle = gdk_threads_add_idle_full (GTK_TEXT_VIEW_PRIORITY_VALIDATE, incremental_validate_callback, text_view, NULL);
+          g_source_set_name_by_id (priv->incremental_validate_idle, "[gtk+] incremental_validate_callback");
+        }
+    }
+
+  g_object_unref (text_view);
+}
+
 static gboolean
 incremental_validate_callback (gpointer data)
 {
   GtkTextView *text_view = data;
+  GtkTextViewPrivate *priv = text_view->priv;
   gboolean result = TRUE;
 
   DV(g_print(G_STRLOC"\n"));
+
+  /* Offscreen lines are measured in a thread if possible, the
+   * idle is added again when the thread is done.
+   */
+  if (gtk_text_layout_can_validate_async (priv->layout))
+    {
+      priv->incremental_validate_idle = 0;
+
+      if (priv->validate_cancellable == NULL)
+        {
+          priv->validate_cancellable = g_cancellable_new ();
+          gtk_text_layout_validate_async (priv->layout, 500,
+                                          priv->validate_cancellable,
+                                          incremental_validate_done,
+                                          g_object_ref (text_view));
+        }
+
+      return FALSE;
+    }
   
   gtk_text_layout_validate (text_view->priv->layout, 2000);
 
@@ -15099,6 +15099,18 @@ gtk_widget_render (GtkWidget            *widget,
       gsk_render_node_unref (root);
     }
 
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (SNAPSHOT))
+    {
+      gsize bytes_held, bytes_used;
+      guint n_pinned;
+
+      gsk_render_node_get_arena_stats (&bytes_held, &bytes_used, &n_pinned);
+      g_message ("Render<%s>: node arenas hold %" G_GSIZE_FORMAT " bytes, %" G_GSIZE_FORMAT
+                 " bytes in use, %u pinned",
+                 G_OBJECT_TYPE_NAME (widget), bytes_held, bytes_used, n_pinned);
+    }
+#endif
 
   gsk_renderer_end_draw_frame (renderer, context);
 }
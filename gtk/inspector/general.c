@@ -30,6 +30,9 @@
 #include "gtkimage.h"
 #include "gtkadjustment.h"
 #include "gtkbox.h"
+#include "gtkcssnodestylecacheprivate.h"
+#include "gtkcssprofilerprivate.h"
+#include "gtkcssvalueprivate.h"
 
 
 #ifdef GDK_WINDOWING_X11
@@ -66,6 +69,7 @@ struct _GtkInspectorGeneralPrivate
   GtkWidget *gl_box;
   GtkWidget *vulkan_box;
   GtkWidget *device_box;
+  GtkWidget *css_box;
   GtkWidget *gtk_version;
   GtkWidget *gdk_backend;
   GtkWidget *gsk_renderer;
@@ -86,6 +90,7 @@ struct _GtkInspectorGeneralPrivate
   GtkWidget *display_composited;
   GtkSizeGroup *labels;
   GtkAdjustment *focus_adjustment;
+  guint css_update_source_id;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GtkInspectorGeneral, gtk_inspector_general, GTK_TYPE_SCROLLED_WINDOW)
@@ -783,6 +788,105 @@ init_device (GtkInspectorGeneral *gen)
   populate_seats (gen);
 }
 
+static gboolean
+populate_css (gpointer data)
+{
+  GtkInspectorGeneral *gen = data;
+  GtkCssProfilerFrame frame;
+  guint64 hits, misses;
+  guint n_entries;
+  GList *list, *l;
+  char *text;
+
+  list = gtk_container_get_children (GTK_CONTAINER (gen->priv->css_box));
+  for (l = list; l; l = l->next)
+    gtk_widget_destroy (GTK_WIDGET (l->data));
+  g_list_free (list);
+
+  gtk_css_node_style_cache_get_shared_stats (&hits, &misses, &n_entries);
+
+  text = g_strdup_printf ("%" G_GUINT64_FORMAT, hits);
+  add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Shared Style Cache Hits"), text, 0);
+  g_free (text);
+
+  text = g_strdup_printf ("%" G_GUINT64_FORMAT, misses);
+  add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Shared Style Cache Misses"), text, 0);
+  g_free (text);
+
+  text = g_strdup_printf ("%u", n_entries);
+  add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Shared Styles"), text, 0);
+  g_free (text);
+
+  text = g_strdup_printf ("%u", _gtk_css_value_get_n_interned ());
+  add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Interned CSS Values"), text, 0);
+  g_free (text);
+
+  if (gtk_css_profiler_get_last_frame (&frame))
+    {
+      text = g_strdup_printf ("%u", frame.n_invalidated);
+      add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Invalidated Nodes (Last Frame)"), text, 0);
+      g_free (text);
+
+      text = gtk_css_change_to_string (frame.invalidated_changes);
+      add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Invalidation Reasons"), text, 0);
+      g_free (text);
+
+      text = g_strdup_printf ("%u", frame.n_restyled);
+      add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Restyled Nodes"), text, 0);
+      g_free (text);
+
+      text = g_strdup_printf ("%u / %u / %u / %u",
+                              frame.results[GTK_CSS_PROFILER_KEPT],
+                              frame.results[GTK_CSS_PROFILER_PARENT_CACHE],
+                              frame.results[GTK_CSS_PROFILER_SHARED_CACHE],
+                              frame.results[GTK_CSS_PROFILER_COMPUTED]);
+      add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Kept / Parent Cache / Shared Cache / Computed"), text, 0);
+      g_free (text);
+
+      text = g_strdup_printf ("%.2f ms", frame.validate_time / 1000.);
+      add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Validation Time"), text, 0);
+      g_free (text);
+
+      text = g_strdup_printf ("%.2f ms", frame.phase_time[GTK_CSS_PROFILER_MATCH] / 1000.);
+      add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Selector Matching Time"), text, 0);
+      g_free (text);
+
+      text = g_strdup_printf ("%.2f ms", frame.phase_time[GTK_CSS_PROFILER_COMPUTE] / 1000.);
+      add_label_row (gen, GTK_LIST_BOX (gen->priv->css_box), _("Value Computation Time"), text, 0);
+      g_free (text);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gtk_inspector_general_map (GtkWidget *widget)
+{
+  GtkInspectorGeneral *gen = GTK_INSPECTOR_GENERAL (widget);
+
+  GTK_WIDGET_CLASS (gtk_inspector_general_parent_class)->map (widget);
+
+  gtk_css_profiler_start ();
+  populate_css (gen);
+  gen->priv->css_update_source_id = g_timeout_add_seconds (1, populate_css, gen);
+}
+
+static void
+gtk_inspector_general_unmap (GtkWidget *widget)
+{
+  GtkInspectorGeneral *gen = GTK_INSPECTOR_GENERAL (widget);
+
+  if (gen->priv->css_update_source_id)
+    {
+      g_source_remove (gen->priv->css_update_source_id);
+      gen->priv->css_update_source_id = 0;
+    }
+
+  gtk_css_profiler_stop ();
+
+  GTK_WIDGET_CLASS (gtk_inspector_general_parent_class)->unmap (widget);
+}
+
 static void
 gtk_inspector_general_init (GtkInspectorGeneral *gen)
 {
@@ -812,6 +916,10 @@ keynav_failed (GtkWidget *widget, GtkDirectionType direction, GtkInspectorGenera
     next = gen->priv->vulkan_box;
   else if (direction == GTK_DIR_DOWN && widget == gen->priv->vulkan_box)
     next = gen->priv->device_box;
+  else if (direction == GTK_DIR_DOWN && widget == gen->priv->device_box)
+    next = gen->priv->css_box;
+  else if (direction == GTK_DIR_UP && widget == gen->priv->css_box)
+    next = gen->priv->device_box;
   else if (direction == GTK_DIR_UP && widget == gen->priv->device_box)
     next = gen->priv->vulkan_box;
   else if (direction == GTK_DIR_UP && widget == gen->priv->vulkan_box)
@@ -867,6 +975,7 @@ gtk_inspector_general_constructed (GObject *object)
    g_signal_connect (gen->priv->gl_box, "keynav-failed", G_CALLBACK (keynav_failed), gen);
    g_signal_connect (gen->priv->vulkan_box, "keynav-failed", G_CALLBACK (keynav_failed), gen);
    g_signal_connect (gen->priv->device_box, "keynav-failed", G_CALLBACK (keynav_failed), gen);
+   g_signal_connect (gen->priv->css_box, "keynav-failed", G_CALLBACK (keynav_failed), gen);
 }
 
 static void
@@ -877,6 +986,9 @@ gtk_inspector_general_class_init (GtkInspectorGeneralClass *klass)
 
   object_class->constructed = gtk_inspector_general_constructed;
 
+  widget_class->map = gtk_inspector_general_map;
+  widget_class->unmap = gtk_inspector_general_unmap;
+
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gtk/libgtk/inspector/general.ui");
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorGeneral, version_box);
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorGeneral, env_box);
@@ -903,6 +1015,7 @@ gtk_inspector_general_class_init (GtkInspectorGeneralClass *klass)
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorGeneral, display_composited);
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorGeneral, display_rgba);
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorGeneral, device_box);
+  gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorGeneral, css_box);
 }
 
 // vim: set et sw=2 ts=2:
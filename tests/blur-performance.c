@@ -2,6 +2,120 @@
 
 #include <gsk/gskcairoblurprivate.h>
 
+#include <math.h>
+#include <string.h>
+
+/* A copy of the original implementation, which transposes the buffer
+ * to blur columns, to compare the results and the timings against.
+ */
+static void
+reference_blur_xspan (guchar *row,
+                      guchar *tmp_buffer,
+                      int     row_width,
+                      int     d,
+                      int     shift)
+{
+  int offset;
+  int sum = 0;
+  int i;
+
+  if (d % 2 == 1)
+    offset = d / 2;
+  else
+    offset = (d - shift) / 2;
+
+  for (i = -d + offset; i < row_width + offset; i++)
+    {
+      if (i >= 0 && i < row_width)
+        sum += row[i];
+
+      if (i >= offset)
+        {
+          if (i >= d)
+            sum -= row[i - d];
+
+          tmp_buffer[i - offset] = (sum + d / 2) / d;
+        }
+    }
+
+  memcpy (row, tmp_buffer, row_width);
+}
+
+static void
+reference_blur_rows (guchar *dst_buffer,
+                     guchar *tmp_buffer,
+                     int     buffer_width,
+                     int     buffer_height,
+                     int     d)
+{
+  int i;
+
+  for (i = 0; i < buffer_height; i++)
+    {
+      guchar *row = dst_buffer + i * buffer_width;
+
+      if (d % 2 == 1)
+        {
+          reference_blur_xspan (row, tmp_buffer, buffer_width, d, 0);
+          reference_blur_xspan (row, tmp_buffer, buffer_width, d, 0);
+          reference_blur_xspan (row, tmp_buffer, buffer_width, d, 0);
+        }
+      else
+        {
+          reference_blur_xspan (row, tmp_buffer, buffer_width, d, 1);
+          reference_blur_xspan (row, tmp_buffer, buffer_width, d, -1);
+          reference_blur_xspan (row, tmp_buffer, buffer_width, d + 1, 0);
+        }
+    }
+}
+
+static void
+reference_flip_buffer (guchar *dst_buffer,
+                       guchar *src_buffer,
+                       int     width,
+                       int     height)
+{
+  int i0, j0;
+
+  for (i0 = 0; i0 < width; i0 += 16)
+    for (j0 = 0; j0 < height; j0 += 16)
+      {
+        int max_j = MIN (j0 + 16, height);
+        int max_i = MIN (i0 + 16, width);
+        int i, j;
+
+        for (i = i0; i < max_i; i++)
+          for (j = j0; j < max_j; j++)
+            dst_buffer[i * height + j] = src_buffer[j * width + i];
+      }
+}
+
+static void
+reference_blur_surface (cairo_surface_t *surface,
+                        int              radius)
+{
+  guchar *buffer, *flipped_buffer;
+  int width, height, d;
+
+  cairo_surface_flush (surface);
+
+  buffer = cairo_image_surface_get_data (surface);
+  width = cairo_image_surface_get_stride (surface);
+  height = cairo_image_surface_get_height (surface);
+  d = (int) ((3.0 * sqrt (2 * G_PI) / 4) * radius);
+
+  flipped_buffer = g_malloc (width * height);
+
+  reference_flip_buffer (flipped_buffer, buffer, width, height);
+  reference_blur_rows (flipped_buffer, buffer, height, width, d);
+  reference_flip_buffer (buffer, flipped_buffer, height, width);
+  reference_blur_rows (buffer, flipped_buffer, width, height, d);
+
+  g_free (flipped_buffer);
+
+  cairo_surface_mark_dirty (surface);
+}
+
 static void
 init_surface (cairo_t *cr)
 {
@@ -16,39 +130,81 @@ init_surface (cairo_t *cr)
   cairo_fill (cr);
 }
 
-int
-main (int argc, char **argv)
+static int
+count_differences (cairo_surface_t *a,
+                   cairo_surface_t *b)
 {
-  cairo_surface_t *surface;
-  cairo_t *cr;
+  guchar *data_a = cairo_image_surface_get_data (a);
+  guchar *data_b = cairo_image_surface_get_data (b);
+  int size = cairo_image_surface_get_stride (a) * cairo_image_surface_get_height (a);
+  int i, n = 0;
+
+  for (i = 0; i < size; i++)
+    if (data_a[i] != data_b[i])
+      n++;
+
+  return n;
+}
+
+static void
+run_benchmark (int size)
+{
+  cairo_surface_t *surface, *reference;
+  cairo_t *cr, *reference_cr;
   GTimer *timer;
-  double msec;
+  double msec, reference_msec;
   int i, j;
-  int size;
 
   timer = g_timer_new ();
 
-  size = 2000;
-
   surface = cairo_image_surface_create (CAIRO_FORMAT_A8, size, size);
+  reference = cairo_image_surface_create (CAIRO_FORMAT_A8, size, size);
 
   cr = cairo_create (surface);
+  reference_cr = cairo_create (reference);
+
+  g_print ("Size %dx%d:\n", size, size);
 
   /* We do everything three times, first two as warmup */
   for (j = 0; j < 2; j++)
     {
       for (i = 1; i < 16; i++)
 	{
+	  init_surface (reference_cr);
+	  g_timer_start (timer);
+	  if (i > 1)
+	    reference_blur_surface (reference, i);
+	  reference_msec = g_timer_elapsed (timer, NULL) * 1000;
+
 	  init_surface (cr);
 	  g_timer_start (timer);
 	  gsk_cairo_blur_surface (surface, i, GSK_BLUR_X | GSK_BLUR_Y);
 	  msec = g_timer_elapsed (timer, NULL) * 1000;
+
 	  if (j == 1)
-	    g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec:\n", i, msec, size*size/(msec*1000));
+	    g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec (old: %.2f msec, %.2fx), %d differing pixels\n",
+                     i, msec, size*size/(msec*1000),
+                     reference_msec, reference_msec / msec,
+                     count_differences (surface, reference));
 	}
     }
 
+  cairo_destroy (cr);
+  cairo_destroy (reference_cr);
+  cairo_surface_destroy (surface);
+  cairo_surface_destroy (reference);
+
   g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+  /* A large surface, which is blurred in parallel, and a shadow-sized
+   * one, which exercises the scratch buffer reuse.
+   */
+  run_benchmark (2000);
+  run_benchmark (200);
 
   return 0;
 }
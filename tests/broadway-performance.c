@@ -0,0 +1,351 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Encodes a sequence of frames like broadwayd does, once from scratch,
+ * once using the damage from the previous frame and once also passing
+ * the painted area like apps do, and compares the timings and the output.
+ * The frames are either PNG files given on the command line or a synthetic
+ * scrolling/typing workload.
+ */
+
+#include "gdk/broadway/broadway-buffer.h"
+
+#include <cairo.h>
+#include <string.h>
+
+/* A port of decodeBuffer() from broadway.js, working on unpremultiplied
+ * ARGB pixels, to check that both encodings give the same frames.
+ */
+static void
+decode_buffer (guint32       *pixels,
+               const guint32 *old_pixels,
+               int            width,
+               int            height,
+               const guint32 *data,
+               gsize          n_data)
+{
+  gsize src = 0;
+  int dest = 0;
+  guint32 len, i;
+
+  if (old_pixels)
+    memcpy (pixels, old_pixels, width * height * 4);
+
+  while (src < n_data)
+    {
+      guint32 symbol = data[src++];
+
+      if (symbol & 0xff000000)
+        {
+          pixels[dest++] = symbol;
+          continue;
+        }
+
+      len = symbol & 0xfffff;
+
+      switch (symbol & 0x00f00000)
+        {
+        case 0x00000000:
+          pixels[dest++] = 0;
+          break;
+
+        case 0x00100000:
+          dest += len;
+          break;
+
+        case 0x00200000:
+          {
+            int block_stride = (width + 31) / 32;
+            int src_x = (len % block_stride) * 32;
+            int src_y = (len / block_stride) * 32;
+            int dest_x = data[src] >> 16;
+            int dest_y = data[src] & 0xffff;
+            int x, y;
+
+            src++;
+            for (y = 0; y < 32 && src_y + y < height && dest_y + y < height; y++)
+              for (x = 0; x < 32 && src_x + x < width && dest_x + x < width; x++)
+                pixels[(dest_y + y) * width + dest_x + x] = old_pixels[(src_y + y) * width + src_x + x];
+          }
+          break;
+
+        case 0x00300000:
+          for (i = 0; i < len; i++)
+            pixels[dest++] = data[src];
+          src++;
+          break;
+
+        case 0x00400000:
+          for (i = 0; i < len; i++, dest++)
+            {
+              guint32 p = pixels[dest], d = data[src];
+
+              pixels[dest] = (((p & 0xff000000) + (d & 0xff000000)) & 0xff000000) |
+                             (((p & 0x00ff0000) + (d & 0x00ff0000)) & 0x00ff0000) |
+                             (((p & 0x0000ff00) + (d & 0x0000ff00)) & 0x0000ff00) |
+                             (((p & 0x000000ff) + (d & 0x000000ff)) & 0x000000ff);
+            }
+          src++;
+          break;
+
+        default:
+          g_assert_not_reached ();
+        }
+    }
+}
+
+/* Fakes a terminal: scrolls the text up by a line every few frames
+ * and types a character into the last line in between.
+ */
+static cairo_surface_t *
+create_synthetic_frame (int width,
+                        int height,
+                        int frame)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  int line, scroll, typed, y;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cr = cairo_create (surface);
+
+  cairo_set_source_rgb (cr, 1, 1, 1);
+  cairo_paint (cr);
+
+  scroll = frame / 8;
+  typed = frame % 8;
+
+  for (line = 0, y = 10; y < height - 20; line++, y += 20)
+    {
+      int n = (line + scroll) * 7919 % 60 + 10;
+
+      if (y + 40 >= height - 20)
+        n = typed * 2;
+
+      cairo_set_source_rgb (cr, 0.1 * ((line + scroll) % 4), 0.2, 0.3);
+      cairo_rectangle (cr, 10, y, n * 9, 14);
+      cairo_fill (cr);
+    }
+
+  /* a translucent overlay that does not move */
+  cairo_set_source_rgba (cr, 0.2, 0.4, 0.8, 0.5);
+  cairo_rectangle (cr, width - 150, 20, 120, 60);
+  cairo_fill (cr);
+
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+/* Finds the rows that differ between two frames of the same size,
+ * as a stand-in for the area an app painted */
+static int
+get_painted_rect (cairo_surface_t *prev,
+                  cairo_surface_t *surface,
+                  BroadwayRect    *rect)
+{
+  int width = cairo_image_surface_get_width (surface);
+  int height = cairo_image_surface_get_height (surface);
+  int stride = cairo_image_surface_get_stride (surface);
+  guint8 *a = cairo_image_surface_get_data (prev);
+  guint8 *b = cairo_image_surface_get_data (surface);
+  int y0, y1;
+
+  if (cairo_image_surface_get_width (prev) != width ||
+      cairo_image_surface_get_height (prev) != height)
+    return 0;
+
+  for (y0 = 0; y0 < height; y0++)
+    if (memcmp (a + y0 * stride, b + y0 * stride, width * 4) != 0)
+      break;
+
+  for (y1 = height; y1 > y0; y1--)
+    if (memcmp (a + (y1 - 1) * stride, b + (y1 - 1) * stride, width * 4) != 0)
+      break;
+
+  rect->x = 0;
+  rect->y = y0;
+  rect->width = width;
+  rect->height = y1 - y0;
+
+  return 1;
+}
+
+typedef enum {
+  ENCODE_FULL,
+  ENCODE_DAMAGE,
+  ENCODE_PAINTED
+} EncodeMode;
+
+typedef struct {
+  double create_msec;
+  double encode_msec;
+  gsize bytes;
+} Totals;
+
+static void
+encode_frames (cairo_surface_t **frames,
+               int               n_frames,
+               EncodeMode        mode,
+               Totals           *totals,
+               guint32        ***decoded)
+{
+  BroadwayBuffer *buffer, *prev = NULL;
+  GTimer *timer;
+  int i;
+
+  timer = g_timer_new ();
+  memset (totals, 0, sizeof (Totals));
+  *decoded = g_new0 (guint32 *, n_frames);
+
+  for (i = 0; i < n_frames; i++)
+    {
+      int width = cairo_image_surface_get_width (frames[i]);
+      int height = cairo_image_surface_get_height (frames[i]);
+      BroadwayBuffer *encode_prev;
+      BroadwayRect rect;
+      GString *dest;
+      int n_rects = 0;
+
+      if (mode == ENCODE_PAINTED && i > 0)
+        n_rects = get_painted_rect (frames[i - 1], frames[i], &rect);
+
+      g_timer_start (timer);
+      buffer = broadway_buffer_create (width, height,
+                                       cairo_image_surface_get_data (frames[i]),
+                                       cairo_image_surface_get_stride (frames[i]),
+                                       mode != ENCODE_FULL ? prev : NULL,
+                                       &rect, n_rects);
+      totals->create_msec += g_timer_elapsed (timer, NULL) * 1000;
+
+      /* Like broadwayd, only refer to a previous frame of the same size */
+      if (prev && broadway_buffer_get_width (prev) == width &&
+          broadway_buffer_get_height (prev) == height)
+        encode_prev = prev;
+      else
+        encode_prev = NULL;
+
+      dest = g_string_new ("");
+      g_timer_start (timer);
+      broadway_buffer_encode (buffer, encode_prev, dest);
+      totals->encode_msec += g_timer_elapsed (timer, NULL) * 1000;
+      totals->bytes += dest->len;
+
+      (*decoded)[i] = g_new (guint32, width * height);
+      decode_buffer ((*decoded)[i],
+                     encode_prev ? (*decoded)[i - 1] : NULL,
+                     width, height,
+                     (const guint32 *) dest->str, dest->len / 4);
+
+      g_string_free (dest, TRUE);
+
+      if (prev)
+        broadway_buffer_unref (prev);
+      prev = buffer;
+    }
+
+  broadway_buffer_unref (prev);
+  g_timer_destroy (timer);
+}
+
+static void
+free_decoded (guint32 **decoded,
+              int       n_frames)
+{
+  int i;
+
+  for (i = 0; i < n_frames; i++)
+    g_free (decoded[i]);
+  g_free (decoded);
+}
+
+int
+main (int argc, char **argv)
+{
+  cairo_surface_t **frames;
+  guint32 **full_decoded, **damage_decoded, **painted_decoded;
+  Totals full, damage, painted;
+  int n_frames, differing_frames;
+  int i, run;
+
+  if (argc > 1)
+    {
+      n_frames = argc - 1;
+      frames = g_new (cairo_surface_t *, n_frames);
+      for (i = 0; i < n_frames; i++)
+        {
+          cairo_surface_t *png = cairo_image_surface_create_from_png (argv[i + 1]);
+          cairo_t *cr;
+
+          if (cairo_surface_status (png) != CAIRO_STATUS_SUCCESS)
+            {
+              g_printerr ("Could not load %s: %s\n", argv[i + 1],
+                          cairo_status_to_string (cairo_surface_status (png)));
+              return 1;
+            }
+
+          /* Make sure we have premultiplied ARGB32, like windows do */
+          frames[i] = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                  cairo_image_surface_get_width (png),
+                                                  cairo_image_surface_get_height (png));
+          cr = cairo_create (frames[i]);
+          cairo_set_source_surface (cr, png, 0, 0);
+          cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+          cairo_paint (cr);
+          cairo_destroy (cr);
+          cairo_surface_destroy (png);
+        }
+    }
+  else
+    {
+      n_frames = 200;
+      frames = g_new (cairo_surface_t *, n_frames);
+      for (i = 0; i < n_frames; i++)
+        frames[i] = create_synthetic_frame (1280, 800, i);
+    }
+
+  for (i = 0; i < n_frames; i++)
+    cairo_surface_flush (frames[i]);
+
+  /* We do everything twice, the first time as warmup */
+  for (run = 0; run < 2; run++)
+    {
+      encode_frames (frames, n_frames, ENCODE_FULL, &full, &full_decoded);
+      encode_frames (frames, n_frames, ENCODE_DAMAGE, &damage, &damage_decoded);
+      encode_frames (frames, n_frames, ENCODE_PAINTED, &painted, &painted_decoded);
+
+      differing_frames = 0;
+      for (i = 0; i < n_frames; i++)
+        {
+          int size = cairo_image_surface_get_width (frames[i]) *
+                     cairo_image_surface_get_height (frames[i]) * 4;
+
+          if (memcmp (full_decoded[i], damage_decoded[i], size) != 0 ||
+              memcmp (full_decoded[i], painted_decoded[i], size) != 0)
+            differing_frames++;
+        }
+
+      free_decoded (full_decoded, n_frames);
+      free_decoded (damage_decoded, n_frames);
+      free_decoded (painted_decoded, n_frames);
+    }
+
+  g_print ("%d frames\n", n_frames);
+  g_print ("full:   create %.2f msec, encode %.2f msec, %.2f msec/frame, %" G_GSIZE_FORMAT " bytes\n",
+           full.create_msec, full.encode_msec,
+           (full.create_msec + full.encode_msec) / n_frames, full.bytes);
+  g_print ("damage: create %.2f msec, encode %.2f msec, %.2f msec/frame, %" G_GSIZE_FORMAT " bytes (%.2fx faster)\n",
+           damage.create_msec, damage.encode_msec,
+           (damage.create_msec + damage.encode_msec) / n_frames, damage.bytes,
+           (full.create_msec + full.encode_msec) / (damage.create_msec + damage.encode_msec));
+  g_print ("painted: create %.2f msec, encode %.2f msec, %.2f msec/frame, %" G_GSIZE_FORMAT " bytes (%.2fx faster)\n",
+           painted.create_msec, painted.encode_msec,
+           (painted.create_msec + painted.encode_msec) / n_frames, painted.bytes,
+           (full.create_msec + full.encode_msec) / (painted.create_msec + painted.encode_msec));
+  g_print ("%d differing frames\n", differing_frames);
+
+  for (i = 0; i < n_frames; i++)
+    cairo_surface_destroy (frames[i]);
+  g_free (frames);
+
+  return differing_frames == 0 ? 0 : 1;
+}
@@ -0,0 +1,366 @@
+/* Renders a serialized render node repeatedly and reports timings.
+ *
+ * By default this uses the Cairo renderer without a window, so it works
+ * without a display server or a GPU. It links the GSK and GDK internals
+ * directly, to realize the renderer without a window and to read the
+ * per node type timings from the renderer's profiler.
+ *
+ * Nodes are timed with g_get_monotonic_time(), which only counts whole
+ * microseconds, so most single nodes take 0 or 1 microseconds. The
+ * rounding errors cancel out over many nodes and frames, so only the
+ * totals over all runs are reported per node type.
+ *
+ * See snapshot-benchmark for the time it takes to create the nodes.
+ */
+
+#include "config.h"
+
+#include <gdk/gdk.h>
+#include <gsk/gsk.h>
+
+#include "gsk/gskcairorendererprivate.h"
+#include "gsk/gskrendererprivate.h"
+#include "gsk/gskenumtypes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+static int runs = 100;
+static int warmup = 5;
+static gboolean use_window = FALSE;
+static gboolean json = FALSE;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Render the node N times", "N" },
+  { "warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "Render N times before measuring", "N" },
+  { "window", '\0', 0, G_OPTION_ARG_NONE, &use_window, "Use the renderer GDK picks for a window instead of Cairo", NULL },
+  { "json", 'j', 0, G_OPTION_ARG_NONE, &json, "Print the results as JSON", NULL },
+  { NULL }
+};
+
+typedef struct {
+  const char *name;
+  GQuark timer;
+  GQuark counter;
+  gint64 total_time;
+  gint64 n_nodes;
+} NodeTypeStats;
+
+/* The peak resident set size of the process, in kB */
+static gint64
+get_max_rss (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+
+  return -1;
+}
+
+/* The CPU time used by all threads of the process, in nsec */
+static gint64
+get_cpu_time (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return ((gint64) usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_GINT64_CONSTANT (1000000000) +
+           ((gint64) usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+#endif
+
+  return -1;
+}
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 t1 = *(const gint64 *) a;
+  gint64 t2 = *(const gint64 *) b;
+
+  return t1 < t2 ? -1 : t1 > t2;
+}
+
+/* Sorts @times and returns the given percentile, using the nearest rank */
+static gint64
+percentile (gint64 *times,
+            int     n,
+            int     p)
+{
+  int rank;
+
+  qsort (times, n, sizeof (gint64), compare_times);
+
+  rank = (p * n + 99) / 100;
+
+  return times[CLAMP (rank - 1, 0, n - 1)];
+}
+
+static gint64
+mean (const gint64 *times,
+      int           n)
+{
+  gint64 sum = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    sum += times[i];
+
+  return sum / n;
+}
+
+static void
+print_times (const char *name,
+             gint64     *times)
+{
+  gint64 avg = mean (times, runs);
+
+  if (json)
+    g_print ("\"%s\": { \"mean\": %" G_GINT64_FORMAT ", \"min\": %" G_GINT64_FORMAT
+             ", \"p50\": %" G_GINT64_FORMAT ", \"p90\": %" G_GINT64_FORMAT
+             ", \"p99\": %" G_GINT64_FORMAT ", \"max\": %" G_GINT64_FORMAT " }",
+             name, avg,
+             percentile (times, runs, 0),
+             percentile (times, runs, 50),
+             percentile (times, runs, 90),
+             percentile (times, runs, 99),
+             percentile (times, runs, 100));
+  else
+    g_print ("%-30s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+             name,
+             avg / 1000000.,
+             percentile (times, runs, 0) / 1000000.,
+             percentile (times, runs, 50) / 1000000.,
+             percentile (times, runs, 90) / 1000000.,
+             percentile (times, runs, 99) / 1000000.,
+             percentile (times, runs, 100) / 1000000.);
+}
+
+static GskRenderer *
+create_renderer (GdkWindow **window)
+{
+  GskRenderer *renderer;
+  GError *error = NULL;
+
+  if (use_window)
+    {
+      GdkDisplay *display = gdk_display_open (NULL);
+
+      if (display == NULL)
+        {
+          g_printerr ("Could not open a display.\n");
+          return NULL;
+        }
+
+      *window = gdk_window_new_toplevel (display, 10, 10);
+      renderer = gsk_renderer_new_for_window (*window);
+      if (renderer == NULL)
+        {
+          g_printerr ("Could not create a renderer.\n");
+          return NULL;
+        }
+    }
+  else
+    {
+      *window = NULL;
+      renderer = g_object_new (GSK_TYPE_CAIRO_RENDERER, NULL);
+      if (!gsk_renderer_realize_headless (renderer, &error))
+        {
+          g_printerr ("Could not realize the Cairo renderer: %s\n", error->message);
+          g_error_free (error);
+          g_object_unref (renderer);
+          return NULL;
+        }
+    }
+
+  return renderer;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GskRenderNode *node;
+  GskRenderer *renderer;
+  GskProfiler *profiler;
+  GdkWindow *window;
+  NodeTypeStats node_types[GSK_N_RENDER_NODE_TYPES] = { { NULL, }, };
+  GEnumClass *enum_class;
+  gint64 *wall_times, *cpu_times;
+  gint64 load_time, rss_start, rss_loaded, rss_end;
+  gboolean profile_nodes, first;
+  graphene_rect_t bounds;
+  int run, i;
+
+  context = g_option_context_new ("NODE-FILE");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (argc != 2)
+    {
+      g_printerr ("Usage: %s [OPTIONS] NODE-FILE\n", argv[0]);
+      return 1;
+    }
+  if (runs < 1 || warmup < 0)
+    {
+      g_printerr ("Number of runs must be at least 1 and number of warmup runs must not be negative.\n");
+      return 1;
+    }
+
+  rss_start = get_max_rss ();
+
+  load_time = g_get_monotonic_time ();
+  node = gsk_render_node_load_from_file (argv[1], &error);
+  load_time = g_get_monotonic_time () - load_time;
+  if (node == NULL)
+    {
+      g_printerr ("Could not load node file: %s\n", error->message);
+      return 1;
+    }
+
+  rss_loaded = get_max_rss ();
+
+  renderer = create_renderer (&window);
+  if (renderer == NULL)
+    return 1;
+
+  profiler = gsk_renderer_get_profiler (renderer);
+  profile_nodes = GSK_IS_CAIRO_RENDERER (renderer);
+  if (profile_nodes)
+    gsk_cairo_renderer_enable_node_profiling (GSK_CAIRO_RENDERER (renderer));
+
+  enum_class = g_type_class_ref (GSK_TYPE_RENDER_NODE_TYPE);
+  for (i = 1; i < GSK_N_RENDER_NODE_TYPES && profile_nodes; i++)
+    {
+      char *name;
+
+      node_types[i].name = g_enum_get_value (enum_class, i)->value_nick;
+      name = g_strconcat (node_types[i].name, "-time", NULL);
+      node_types[i].timer = g_quark_from_string (name);
+      g_free (name);
+      name = g_strconcat (node_types[i].name, "-count", NULL);
+      node_types[i].counter = g_quark_from_string (name);
+      g_free (name);
+    }
+
+  wall_times = g_new (gint64, runs);
+  cpu_times = g_new (gint64, runs);
+
+  gsk_render_node_get_bounds (node, &bounds);
+
+  for (run = -warmup; run < runs; run++)
+    {
+      GdkTexture *texture;
+      gint64 wall_time, cpu_time;
+
+      wall_time = g_get_monotonic_time ();
+      cpu_time = get_cpu_time ();
+
+      texture = gsk_renderer_render_texture (renderer, node, &bounds);
+
+      cpu_time = get_cpu_time () - cpu_time;
+      wall_time = g_get_monotonic_time () - wall_time;
+
+      g_object_unref (texture);
+
+      if (run < 0)
+        continue;
+
+      wall_times[run] = wall_time * 1000;
+      cpu_times[run] = cpu_time;
+
+      for (i = 1; i < GSK_N_RENDER_NODE_TYPES && profile_nodes; i++)
+        {
+          node_types[i].total_time += gsk_profiler_timer_get (profiler, node_types[i].timer);
+          node_types[i].n_nodes += gsk_profiler_counter_get (profiler, node_types[i].counter);
+        }
+    }
+
+  rss_end = get_max_rss ();
+
+  if (json)
+    {
+      char *escaped = g_strescape (argv[1], NULL);
+
+      g_print ("{\n");
+      g_print ("  \"file\": \"%s\",\n", escaped);
+      g_free (escaped);
+      g_print ("  \"renderer\": \"%s\",\n", G_OBJECT_TYPE_NAME (renderer));
+      g_print ("  \"width\": %g,\n  \"height\": %g,\n", bounds.size.width, bounds.size.height);
+      g_print ("  \"runs\": %d,\n", runs);
+      g_print ("  \"load-time\": %" G_GINT64_FORMAT ",\n", load_time * 1000);
+      g_print ("  \"max-rss\": { \"start\": %" G_GINT64_FORMAT ", \"loaded\": %" G_GINT64_FORMAT
+               ", \"end\": %" G_GINT64_FORMAT " },\n",
+               rss_start, rss_loaded, rss_end);
+      g_print ("  ");
+      print_times ("wall-time", wall_times);
+      g_print (",\n  ");
+      print_times ("cpu-time", cpu_times);
+      g_print (",\n  \"nodes\": {");
+      first = TRUE;
+      for (i = 1; i < GSK_N_RENDER_NODE_TYPES && profile_nodes; i++)
+        {
+          if (node_types[i].n_nodes == 0)
+            continue;
+
+          g_print ("%s\n    ", first ? "" : ",");
+          first = FALSE;
+          g_print ("\"%s\": { \"count\": %" G_GINT64_FORMAT ", \"self-time\": %" G_GINT64_FORMAT
+                   ", \"self-time-per-node\": %" G_GINT64_FORMAT " }",
+                   node_types[i].name, node_types[i].n_nodes / runs,
+                   node_types[i].total_time / runs,
+                   node_types[i].total_time / node_types[i].n_nodes);
+        }
+      g_print ("\n  }\n}\n");
+    }
+  else
+    {
+      g_print ("Rendered %s (%gx%g) %d times using %s\n",
+               argv[1], bounds.size.width, bounds.size.height, runs, G_OBJECT_TYPE_NAME (renderer));
+      g_print ("Loaded in %.3f ms\n", load_time / 1000.);
+      g_print ("Peak RSS: %" G_GINT64_FORMAT " kB at start, %" G_GINT64_FORMAT " kB after loading, %"
+               G_GINT64_FORMAT " kB at the end\n\n",
+               rss_start, rss_loaded, rss_end);
+      g_print ("%-30s %10s %10s %10s %10s %10s %10s\n", "Time (ms)", "mean", "min", "p50", "p90", "p99", "max");
+      print_times ("wall time", wall_times);
+      print_times ("cpu time", cpu_times);
+      if (profile_nodes)
+        g_print ("\n%-30s %10s %10s %10s\n", "Self time, averaged", "nodes", "ms/frame", "ns/node");
+      for (i = 1; i < GSK_N_RENDER_NODE_TYPES && profile_nodes; i++)
+        {
+          if (node_types[i].n_nodes == 0)
+            continue;
+
+          g_print ("%-30s %10" G_GINT64_FORMAT " %10.3f %10" G_GINT64_FORMAT "\n",
+                   node_types[i].name,
+                   node_types[i].n_nodes / runs,
+                   node_types[i].total_time / runs / 1000000.,
+                   node_types[i].total_time / node_types[i].n_nodes);
+        }
+    }
+
+  g_type_class_unref (enum_class);
+  g_free (wall_times);
+  g_free (cpu_times);
+
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  g_clear_object (&window);
+  gsk_render_node_unref (node);
+
+  return 0;
+}
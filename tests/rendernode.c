@@ -3,12 +3,16 @@
 static gboolean benchmark = FALSE;
 static gboolean dump_variant = FALSE;
 static gboolean fallback = FALSE;
+static gboolean use_mmap = FALSE;
+static char *write_binary = NULL;
 static int runs = 1;
 
 static GOptionEntry options[] = {
   { "benchmark", 'b', 0, G_OPTION_ARG_NONE, &benchmark, "Time operations", NULL },
   { "dump-variant", 'd', 0, G_OPTION_ARG_NONE, &dump_variant, "Dump GVariant structure", NULL },
   { "fallback", '\0', 0, G_OPTION_ARG_NONE, &fallback, "Draw node without a renderer", NULL },
+  { "mmap", 'm', 0, G_OPTION_ARG_NONE, &use_mmap, "Map the node file instead of reading it", NULL },
+  { "write-binary", '\0', 0, G_OPTION_ARG_FILENAME, &write_binary, "Save the node in the binary format", "FILE" },
   { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Render the test N times", "N" },
   { NULL }
 };
@@ -41,40 +45,51 @@ main(int argc, char **argv)
       g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
       return 1;
     }
-  if (!(argc == 3 || (argc == 2 && (dump_variant || benchmark))))
+  if (!(argc == 3 || (argc == 2 && (dump_variant || benchmark || write_binary))))
     {
       g_printerr ("Usage: %s [OPTIONS] NODE-FILE PNG-FILE\n", argv[0]);
       return 1;
     }
 
-  if (!g_file_get_contents (argv[1], &contents, &len, &error))
+  if (use_mmap)
     {
-      g_printerr ("Could not open node file: %s\n", error->message);
-      return 1;
+      start = g_get_monotonic_time ();
+      node = gsk_render_node_load_from_file (argv[1], &error);
+      end = g_get_monotonic_time ();
+      if (benchmark)
+        g_print ("Mapped in %.4gs\n", (double) (end - start) / G_USEC_PER_SEC);
     }
-
-  bytes = g_bytes_new_take (contents, len);
-  if (dump_variant)
+  else
     {
-      GVariant *variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("(suuv)"), bytes, FALSE);
-      char *s;
+      if (!g_file_get_contents (argv[1], &contents, &len, &error))
+        {
+          g_printerr ("Could not open node file: %s\n", error->message);
+          return 1;
+        }
 
-      s = g_variant_print (variant, FALSE);
-      g_print ("%s\n", s);
-      g_free (s);
-      g_variant_unref (variant);
-    }
+      bytes = g_bytes_new_take (contents, len);
+      if (dump_variant)
+        {
+          GVariant *variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("(suuv)"), bytes, FALSE);
+          char *s;
 
-  start = g_get_monotonic_time ();
-  node = gsk_render_node_deserialize (bytes, &error);
-  end = g_get_monotonic_time ();
-  if (benchmark)
-    {
-      char *bytes_string = g_format_size (g_bytes_get_size (bytes));
-      g_print ("Loaded %s in %.4gs\n", bytes_string, (double) (end - start) / G_USEC_PER_SEC);
-      g_free (bytes_string);
+          s = g_variant_print (variant, FALSE);
+          g_print ("%s\n", s);
+          g_free (s);
+          g_variant_unref (variant);
+        }
+
+      start = g_get_monotonic_time ();
+      node = gsk_render_node_deserialize (bytes, &error);
+      end = g_get_monotonic_time ();
+      if (benchmark)
+        {
+          char *bytes_string = g_format_size (g_bytes_get_size (bytes));
+          g_print ("Loaded %s in %.4gs\n", bytes_string, (double) (end - start) / G_USEC_PER_SEC);
+          g_free (bytes_string);
+        }
+      g_bytes_unref (bytes);
     }
-  g_bytes_unref (bytes);
 
   if (node == NULL)
     {
@@ -83,6 +98,25 @@ main(int argc, char **argv)
       return 1;
     }
 
+  if (write_binary)
+    {
+      start = g_get_monotonic_time ();
+      bytes = gsk_render_node_serialize_with_format (node, GSK_SERIALIZATION_FORMAT_BINARY);
+      end = g_get_monotonic_time ();
+      if (benchmark)
+        g_print ("Serialized in %.4gs\n", (double) (end - start) / G_USEC_PER_SEC);
+
+      if (!g_file_set_contents (write_binary,
+                                g_bytes_get_data (bytes, NULL),
+                                g_bytes_get_size (bytes),
+                                &error))
+        {
+          g_printerr ("Could not save binary node file: %s\n", error->message);
+          return 1;
+        }
+      g_bytes_unref (bytes);
+    }
+
   if (fallback)
     {
       graphene_rect_t bounds;
@@ -0,0 +1,514 @@
+/* Builds a render node tree with GtkSnapshot repeatedly and reports
+ * timings and memory use.
+ *
+ * The tree is loaded from a node file once, and a widget replays it
+ * into its snapshot in every frame, the way widgets build a frame, so
+ * the time is spent allocating and filling nodes. Nodes that GtkSnapshot
+ * has no call for are recreated with their constructors.
+ *
+ * The memory held by the node arenas is read from the messages that
+ * GTK_DEBUG=snapshot prints after every frame, so it is only reported
+ * when GTK is built with debugging enabled.
+ *
+ * With --keep N, one in N of the recreated nodes is kept alive until
+ * the end of the next frame, like the nodes kept by caches, to see how
+ * much memory they keep alive in the node arenas.
+ */
+
+#include <gtk/gtk.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int runs = 100;
+static int warmup = 5;
+static int keep = 0;
+static gboolean json = FALSE;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Build the node N times", "N" },
+  { "warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "Build N times before measuring", "N" },
+  { "keep", 'k', 0, G_OPTION_ARG_INT, &keep, "Keep one node in N alive until the next frame", "N" },
+  { "json", 'j', 0, G_OPTION_ARG_NONE, &json, "Print the results as JSON", NULL },
+  { NULL }
+};
+
+static GskRenderNode *node;
+static graphene_rect_t node_bounds;
+static gint64 *build_times;
+static int run;
+
+/* Recreated nodes kept alive for --keep */
+static GPtrArray *kept;
+static guint n_copies;
+
+/* Read from the GTK_DEBUG=snapshot messages */
+static gboolean have_arena_stats;
+static gsize max_bytes_held, kept_bytes_held, kept_bytes_used;
+static guint max_pinned;
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 t1 = *(const gint64 *) a;
+  gint64 t2 = *(const gint64 *) b;
+
+  return t1 < t2 ? -1 : t1 > t2;
+}
+
+/* Sorts @times and returns the given percentile, using the nearest rank */
+static gint64
+percentile (gint64 *times,
+            int     n,
+            int     p)
+{
+  int rank;
+
+  qsort (times, n, sizeof (gint64), compare_times);
+
+  rank = (p * n + 99) / 100;
+
+  return times[CLAMP (rank - 1, 0, n - 1)];
+}
+
+static gint64
+mean (const gint64 *times,
+      int           n)
+{
+  gint64 sum = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    sum += times[i];
+
+  return sum / n;
+}
+
+static void
+print_times (const char *name,
+             gint64     *times)
+{
+  gint64 avg = mean (times, runs);
+
+  if (json)
+    g_print ("\"%s\": { \"mean\": %" G_GINT64_FORMAT ", \"min\": %" G_GINT64_FORMAT
+             ", \"p50\": %" G_GINT64_FORMAT ", \"p90\": %" G_GINT64_FORMAT
+             ", \"p99\": %" G_GINT64_FORMAT ", \"max\": %" G_GINT64_FORMAT " }",
+             name, avg,
+             percentile (times, runs, 0),
+             percentile (times, runs, 50),
+             percentile (times, runs, 90),
+             percentile (times, runs, 99),
+             percentile (times, runs, 100));
+  else
+    g_print ("%-30s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+             name,
+             avg / 1000000.,
+             percentile (times, runs, 0) / 1000000.,
+             percentile (times, runs, 50) / 1000000.,
+             percentile (times, runs, 90) / 1000000.,
+             percentile (times, runs, 99) / 1000000.,
+             percentile (times, runs, 100) / 1000000.);
+}
+
+static GskRenderNode *
+copy_leaf (GskRenderNode *node)
+{
+  graphene_rect_t bounds;
+
+  gsk_render_node_get_bounds (node, &bounds);
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_LINEAR_GRADIENT_NODE:
+      return gsk_linear_gradient_node_new (&bounds,
+                                           gsk_linear_gradient_node_peek_start (node),
+                                           gsk_linear_gradient_node_peek_end (node),
+                                           gsk_linear_gradient_node_peek_color_stops (node),
+                                           gsk_linear_gradient_node_get_n_color_stops (node));
+
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      return gsk_repeating_linear_gradient_node_new (&bounds,
+                                                     gsk_linear_gradient_node_peek_start (node),
+                                                     gsk_linear_gradient_node_peek_end (node),
+                                                     gsk_linear_gradient_node_peek_color_stops (node),
+                                                     gsk_linear_gradient_node_get_n_color_stops (node));
+
+    case GSK_BORDER_NODE:
+      return gsk_border_node_new (gsk_border_node_peek_outline (node),
+                                  gsk_border_node_peek_widths (node),
+                                  gsk_border_node_peek_colors (node));
+
+    case GSK_INSET_SHADOW_NODE:
+      return gsk_inset_shadow_node_new (gsk_inset_shadow_node_peek_outline (node),
+                                        gsk_inset_shadow_node_peek_color (node),
+                                        gsk_inset_shadow_node_get_dx (node),
+                                        gsk_inset_shadow_node_get_dy (node),
+                                        gsk_inset_shadow_node_get_spread (node),
+                                        gsk_inset_shadow_node_get_blur_radius (node));
+
+    case GSK_OUTSET_SHADOW_NODE:
+      return gsk_outset_shadow_node_new (gsk_outset_shadow_node_peek_outline (node),
+                                         gsk_outset_shadow_node_peek_color (node),
+                                         gsk_outset_shadow_node_get_dx (node),
+                                         gsk_outset_shadow_node_get_dy (node),
+                                         gsk_outset_shadow_node_get_spread (node),
+                                         gsk_outset_shadow_node_get_blur_radius (node));
+
+    case GSK_TEXT_NODE:
+      {
+        PangoGlyphString *glyphs;
+        GskRenderNode *copy;
+        guint n_glyphs;
+
+        n_glyphs = gsk_text_node_get_num_glyphs (node);
+        glyphs = pango_glyph_string_new ();
+        pango_glyph_string_set_size (glyphs, n_glyphs);
+        memcpy (glyphs->glyphs, gsk_text_node_peek_glyphs (node), n_glyphs * sizeof (PangoGlyphInfo));
+
+        copy = gsk_text_node_new ((PangoFont *) gsk_text_node_peek_font (node),
+                                  glyphs,
+                                  gsk_text_node_peek_color (node),
+                                  gsk_text_node_get_x (node),
+                                  gsk_text_node_get_y (node));
+
+        pango_glyph_string_free (glyphs);
+
+        return copy;
+      }
+
+    case GSK_CAIRO_NODE:
+    default:
+      /* Recording the drawing again is not what this measures */
+      return gsk_render_node_ref (node);
+    }
+}
+
+/* Appends the contents of @node to @snapshot with the calls
+ * a widget would use to build it.
+ */
+static void
+replay_node (GskRenderNode *node,
+             GtkSnapshot   *snapshot)
+{
+  graphene_rect_t bounds;
+  guint i;
+
+  gsk_render_node_get_bounds (node, &bounds);
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        replay_node (gsk_container_node_get_child (node, i), snapshot);
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      gtk_snapshot_push_transform (snapshot, gsk_transform_node_peek_transform (node), "Transform");
+      replay_node (gsk_transform_node_get_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_OPACITY_NODE:
+      gtk_snapshot_push_opacity (snapshot, gsk_opacity_node_get_opacity (node), "Opacity");
+      replay_node (gsk_opacity_node_get_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      gtk_snapshot_push_color_matrix (snapshot,
+                                      gsk_color_matrix_node_peek_color_matrix (node),
+                                      gsk_color_matrix_node_peek_color_offset (node),
+                                      "ColorMatrix");
+      replay_node (gsk_color_matrix_node_get_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_REPEAT_NODE:
+      gtk_snapshot_push_repeat (snapshot, &bounds, gsk_repeat_node_peek_child_bounds (node), "Repeat");
+      replay_node (gsk_repeat_node_get_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_CLIP_NODE:
+      gtk_snapshot_push_clip (snapshot, gsk_clip_node_peek_clip (node), "Clip");
+      replay_node (gsk_clip_node_get_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      gtk_snapshot_push_rounded_clip (snapshot, gsk_rounded_clip_node_peek_clip (node), "RoundedClip");
+      replay_node (gsk_rounded_clip_node_get_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        gsize n_shadows = gsk_shadow_node_get_n_shadows (node);
+        GskShadow *shadows = g_newa (GskShadow, n_shadows);
+
+        for (i = 0; i < n_shadows; i++)
+          shadows[i] = *gsk_shadow_node_peek_shadow (node, i);
+
+        gtk_snapshot_push_shadow (snapshot, shadows, n_shadows, "Shadow");
+        replay_node (gsk_shadow_node_get_child (node), snapshot);
+        gtk_snapshot_pop (snapshot);
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      gtk_snapshot_push_blend (snapshot, gsk_blend_node_get_blend_mode (node), "Blend");
+      replay_node (gsk_blend_node_get_bottom_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      replay_node (gsk_blend_node_get_top_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      gtk_snapshot_push_cross_fade (snapshot, gsk_cross_fade_node_get_progress (node), "CrossFade");
+      replay_node (gsk_cross_fade_node_get_start_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      replay_node (gsk_cross_fade_node_get_end_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_BLUR_NODE:
+      gtk_snapshot_push_blur (snapshot, gsk_blur_node_get_radius (node), "Blur");
+      replay_node (gsk_blur_node_get_child (node), snapshot);
+      gtk_snapshot_pop (snapshot);
+      break;
+
+    case GSK_COLOR_NODE:
+      gtk_snapshot_append_color (snapshot, gsk_color_node_peek_color (node), &bounds, "Color");
+      break;
+
+    case GSK_TEXTURE_NODE:
+      gtk_snapshot_append_texture (snapshot, gsk_texture_node_get_texture (node), &bounds, "Texture");
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+      g_assert_not_reached ();
+      break;
+
+    default:
+      {
+        GskRenderNode *copy = copy_leaf (node);
+
+        gtk_snapshot_append_node (snapshot, copy);
+
+        if (keep > 0 && n_copies++ % keep == 0)
+          g_ptr_array_add (kept, copy);
+        else
+          gsk_render_node_unref (copy);
+      }
+      break;
+    }
+}
+
+typedef GtkWidget BenchmarkWidget;
+typedef GtkWidgetClass BenchmarkWidgetClass;
+
+G_DEFINE_TYPE (BenchmarkWidget, benchmark_widget, GTK_TYPE_WIDGET)
+
+static void
+benchmark_widget_measure (GtkWidget      *widget,
+                          GtkOrientation  orientation,
+                          int             for_size,
+                          int            *minimum,
+                          int            *natural,
+                          int            *minimum_baseline,
+                          int            *natural_baseline)
+{
+  if (orientation == GTK_ORIENTATION_HORIZONTAL)
+    *minimum = *natural = ceil (node_bounds.origin.x + node_bounds.size.width);
+  else
+    *minimum = *natural = ceil (node_bounds.origin.y + node_bounds.size.height);
+}
+
+static void
+benchmark_widget_snapshot (GtkWidget   *widget,
+                           GtkSnapshot *snapshot)
+{
+  GPtrArray *previous_kept;
+  gint64 build_time;
+
+  if (run >= runs)
+    return;
+
+  /* The nodes kept by the last frame go away with this one */
+  previous_kept = kept;
+  kept = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+  n_copies = 0;
+
+  build_time = g_get_monotonic_time ();
+  replay_node (node, snapshot);
+  build_time = g_get_monotonic_time () - build_time;
+
+  g_ptr_array_unref (previous_kept);
+
+  if (run >= 0)
+    build_times[run] = build_time * 1000;
+
+  run++;
+}
+
+static void
+benchmark_widget_class_init (BenchmarkWidgetClass *klass)
+{
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  widget_class->measure = benchmark_widget_measure;
+  widget_class->snapshot = benchmark_widget_snapshot;
+}
+
+static void
+benchmark_widget_init (BenchmarkWidget *widget)
+{
+  gtk_widget_set_has_window (widget, FALSE);
+}
+
+static gboolean
+tick_callback (GtkWidget     *widget,
+               GdkFrameClock *frame_clock,
+               gpointer       user_data)
+{
+  if (run >= runs)
+    {
+      gtk_main_quit ();
+      return G_SOURCE_REMOVE;
+    }
+
+  gtk_widget_queue_draw (widget);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+arena_stats_handler (const gchar    *log_domain,
+                     GLogLevelFlags  log_level,
+                     const gchar    *message,
+                     gpointer        user_data)
+{
+  const char *stats = strstr (message, ": node arenas hold ");
+  gsize bytes_held, bytes_used;
+  guint n_pinned;
+
+  if (stats == NULL ||
+      sscanf (stats, ": node arenas hold %" G_GSIZE_FORMAT " bytes, %" G_GSIZE_FORMAT " bytes in use, %u pinned",
+              &bytes_held, &bytes_used, &n_pinned) != 3)
+    {
+      g_log_default_handler (log_domain, log_level, message, user_data);
+      return;
+    }
+
+  if (run <= 0)
+    return;
+
+  have_arena_stats = TRUE;
+  max_bytes_held = MAX (max_bytes_held, bytes_held);
+  max_pinned = MAX (max_pinned, n_pinned);
+
+  /* What the kept nodes of the last frame hold on to */
+  kept_bytes_held = bytes_held;
+  kept_bytes_used = bytes_used;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkWidget *window, *widget;
+
+  context = g_option_context_new ("NODE-FILE");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (argc != 2)
+    {
+      g_printerr ("Usage: %s [OPTIONS] NODE-FILE\n", argv[0]);
+      return 1;
+    }
+  if (runs < 1 || warmup < 0 || keep < 0)
+    {
+      g_printerr ("Number of runs must be at least 1 and other numbers must not be negative.\n");
+      return 1;
+    }
+
+  gtk_init ();
+
+  node = gsk_render_node_load_from_file (argv[1], &error);
+  if (node == NULL)
+    {
+      g_printerr ("Could not load node file: %s\n", error->message);
+      return 1;
+    }
+  gsk_render_node_get_bounds (node, &node_bounds);
+
+  build_times = g_new (gint64, runs);
+  kept = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+  run = -warmup;
+
+  gtk_set_debug_flags (gtk_get_debug_flags () | GTK_DEBUG_SNAPSHOT);
+  g_log_set_handler ("Gtk", G_LOG_LEVEL_MESSAGE, arena_stats_handler, NULL);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  widget = g_object_new (benchmark_widget_get_type (), NULL);
+  gtk_container_add (GTK_CONTAINER (window), widget);
+  gtk_widget_add_tick_callback (widget, tick_callback, NULL, NULL);
+  gtk_widget_show (window);
+
+  gtk_main ();
+
+  gtk_widget_destroy (window);
+  g_ptr_array_unref (kept);
+
+  if (json)
+    {
+      char *escaped = g_strescape (argv[1], NULL);
+
+      g_print ("{\n");
+      g_print ("  \"file\": \"%s\",\n", escaped);
+      g_free (escaped);
+      g_print ("  \"runs\": %d,\n", runs);
+      g_print ("  \"keep\": %d,\n", keep);
+      if (have_arena_stats)
+        g_print ("  \"arena-bytes\": { \"max\": %" G_GSIZE_FORMAT ", \"kept-held\": %" G_GSIZE_FORMAT
+                 ", \"kept-used\": %" G_GSIZE_FORMAT ", \"max-pinned\": %u },\n",
+                 max_bytes_held, kept_bytes_held, kept_bytes_used, max_pinned);
+      g_print ("  ");
+      print_times ("build-time", build_times);
+      g_print ("\n}\n");
+    }
+  else
+    {
+      g_print ("Built %s %d times with GtkSnapshot\n", argv[1], runs);
+      if (have_arena_stats)
+        {
+          g_print ("Arenas: %" G_GSIZE_FORMAT " bytes and %u pinned arenas at most after a frame\n",
+                   max_bytes_held, max_pinned);
+          if (keep > 0)
+            g_print ("Keeping 1 node in %d holds %" G_GSIZE_FORMAT " bytes for %" G_GSIZE_FORMAT
+                     " bytes of nodes (%.1f%% fragmentation)\n",
+                     keep, kept_bytes_held, kept_bytes_used,
+                     kept_bytes_held ? 100. * (kept_bytes_held - kept_bytes_used) / kept_bytes_held : 0.);
+        }
+      else
+        g_print ("Arenas: not reported, GTK is built without debugging\n");
+      g_print ("\n%-30s %10s %10s %10s %10s %10s %10s\n", "Time (ms)", "mean", "min", "p50", "p90", "p99", "max");
+      print_times ("build time", build_times);
+    }
+
+  g_free (build_times);
+  gsk_render_node_unref (node);
+
+  return 0;
+}
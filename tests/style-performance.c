@@ -0,0 +1,156 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Restyles a large tree of nested boxes on every frame, by toggling a
+ * style class on the outermost box. The theme gets a lot of descendant
+ * selectors, most of which do not match anything.
+ *
+ * Run with GTK_CSS_ANCESTOR_FILTER=0 to compare against matching
+ * without the ancestor filter, or with GTK_CSS_PARALLEL_STYLES=0 to
+ * look up all styles on the main thread.
+ */
+
+#include <gtk/gtk.h>
+
+#include "frame-stats.h"
+
+static int depth = 8;
+static int breadth = 3;
+static int n_rules = 500;
+
+static GOptionEntry options[] = {
+  { "depth", 'd', 0, G_OPTION_ARG_INT, &depth, "Nesting depth of the widget tree", "COUNT" },
+  { "breadth", 'b', 0, G_OPTION_ARG_INT, &breadth, "Number of children per box", "COUNT" },
+  { "rules", 'r', 0, G_OPTION_ARG_INT, &n_rules, "Number of generated CSS rules", "COUNT" },
+  { NULL }
+};
+
+static GtkWidget *
+create_tree (int level,
+             int index)
+{
+  GtkWidget *box, *label;
+  char *class;
+  int i;
+
+  if (level == depth)
+    {
+      label = gtk_label_new ("Hello World");
+      class = g_strdup_printf ("leaf-%d", index);
+      gtk_style_context_add_class (gtk_widget_get_style_context (label), class);
+      g_free (class);
+
+      return label;
+    }
+
+  box = gtk_box_new (level % 2 ? GTK_ORIENTATION_VERTICAL : GTK_ORIENTATION_HORIZONTAL, 0);
+  class = g_strdup_printf ("level-%d", level);
+  gtk_style_context_add_class (gtk_widget_get_style_context (box), class);
+  g_free (class);
+
+  for (i = 0; i < breadth; i++)
+    gtk_box_pack_start (GTK_BOX (box), create_tree (level + 1, i));
+
+  return box;
+}
+
+static GtkCssProvider *
+create_provider (void)
+{
+  GtkCssProvider *provider;
+  GString *css;
+  int i;
+
+  css = g_string_new ("");
+
+  /* Rules that match, so the styles actually change */
+  g_string_append (css, ".toggled .level-1 label { color: red; }\n");
+  g_string_append (css, "box.level-0 label.leaf-0 { padding: 1px; }\n");
+
+  /* Rules with ancestors that never exist */
+  for (i = 0; i < n_rules; i++)
+    {
+      switch (i % 4)
+        {
+        case 0:
+          g_string_append_printf (css, ".unused-%d label { margin: 1px; }\n", i);
+          break;
+        case 1:
+          g_string_append_printf (css, "#unused-%d .leaf-%d { margin: 2px; }\n", i, i % breadth);
+          break;
+        case 2:
+          g_string_append_printf (css, "unused%d box > label { margin: 3px; }\n", i);
+          break;
+        default:
+          g_string_append_printf (css, ".unused-%d .level-%d * { margin: 4px; }\n", i, i % depth);
+          break;
+        }
+    }
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css->str, css->len);
+  g_string_free (css, TRUE);
+
+  return provider;
+}
+
+static gboolean
+toggle_class (GtkWidget     *widget,
+              GdkFrameClock *frame_clock,
+              gpointer       data)
+{
+  GtkStyleContext *context = gtk_widget_get_style_context (widget);
+
+  if (gtk_style_context_has_class (context, "toggled"))
+    gtk_style_context_remove_class (context, "toggled");
+  else
+    gtk_style_context_add_class (context, "toggled");
+
+  return G_SOURCE_CONTINUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *window, *scrolled, *tree;
+  GtkCssProvider *provider;
+  GOptionContext *context;
+  GError *error = NULL;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  frame_stats_add_options (g_option_context_get_main_group (context));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  gtk_init ();
+
+  provider = create_provider ();
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+  g_signal_connect (window, "destroy", gtk_main_quit, NULL);
+  frame_stats_ensure (GTK_WINDOW (window));
+
+  scrolled = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (window), scrolled);
+
+  tree = create_tree (0, 0);
+  gtk_container_add (GTK_CONTAINER (scrolled), tree);
+  gtk_widget_add_tick_callback (tree, toggle_class, NULL, NULL);
+
+  gtk_widget_show (window);
+
+  gtk_main ();
+
+  g_object_unref (provider);
+
+  return 0;
+}
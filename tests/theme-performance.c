@@ -0,0 +1,160 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Measures how long it takes to load a theme, once without the theme
+ * cache and once with a cache written by a previous run. Every load
+ * happens in a new process, like it does when starting an application,
+ * using an empty cache directory.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+
+static int runs = 10;
+static gboolean verbose = FALSE;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Number of loads to average", "COUNT" },
+  { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "Print the time of every load", NULL },
+  { NULL }
+};
+
+static int
+load_theme (const char *name,
+            const char *variant)
+{
+  gint64 start;
+
+  gtk_init ();
+
+  start = g_get_monotonic_time ();
+  gtk_css_provider_get_named (name, variant);
+  g_print ("%f\n", (g_get_monotonic_time () - start) / 1000.0);
+
+  return 0;
+}
+
+static double
+run_child (char       **argv,
+           const char  *cache_dir,
+           gboolean     use_cache)
+{
+  char **envp;
+  char *output;
+  GError *error = NULL;
+  int status;
+  double msec;
+
+  envp = g_get_environ ();
+  envp = g_environ_setenv (envp, "XDG_CACHE_HOME", cache_dir, TRUE);
+  envp = g_environ_setenv (envp, "GTK_CSS_THEME_CACHE", use_cache ? "1" : "0", TRUE);
+
+  if (!g_spawn_sync (NULL, argv, envp, G_SPAWN_SEARCH_PATH, NULL, NULL,
+                     &output, NULL, &status, &error) ||
+      !g_spawn_check_exit_status (status, &error))
+    {
+      g_printerr ("Could not load theme: %s\n", error->message);
+      exit (1);
+    }
+
+  msec = g_ascii_strtod (output, NULL);
+
+  g_free (output);
+  g_strfreev (envp);
+
+  return msec;
+}
+
+static double
+run_children (char       **argv,
+              const char  *cache_dir,
+              gboolean     use_cache)
+{
+  double msec, total = 0;
+  int i;
+
+  for (i = 0; i < runs; i++)
+    {
+      msec = run_child (argv, cache_dir, use_cache);
+      if (verbose)
+        g_print ("%s load %d: %.2f msec\n", use_cache ? "warm" : "cold", i, msec);
+      total += msec;
+    }
+
+  return total / runs;
+}
+
+static void
+remove_recursively (const char *path)
+{
+  GDir *dir;
+  const char *name;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir)
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          char *child = g_build_filename (path, name, NULL);
+          remove_recursively (child);
+          g_free (child);
+        }
+      g_dir_close (dir);
+    }
+
+  g_remove (path);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  char *child_argv[5];
+  const char *name, *variant;
+  char *cache_dir;
+  double cold, warm;
+
+  if (argc > 2 && g_str_equal (argv[1], "--load"))
+    return load_theme (argv[2], argc > 3 ? argv[3] : NULL);
+
+  context = g_option_context_new ("[THEME [VARIANT]]");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  name = argc > 1 ? argv[1] : "Adwaita";
+  variant = argc > 2 ? argv[2] : NULL;
+
+  cache_dir = g_dir_make_tmp ("gtk-theme-performance-XXXXXX", &error);
+  if (cache_dir == NULL)
+    {
+      g_printerr ("Could not create cache directory: %s\n", error->message);
+      return 1;
+    }
+
+  child_argv[0] = argv[0];
+  child_argv[1] = (char *) "--load";
+  child_argv[2] = (char *) name;
+  child_argv[3] = (char *) variant;
+  child_argv[4] = NULL;
+
+  cold = run_children (child_argv, cache_dir, FALSE);
+
+  /* Write the cache */
+  run_child (child_argv, cache_dir, TRUE);
+
+  warm = run_children (child_argv, cache_dir, TRUE);
+
+  g_print ("cold load: %.2f msec\n", cold);
+  g_print ("warm load: %.2f msec (%.2fx faster)\n", warm, cold / warm);
+
+  remove_recursively (cache_dir);
+  g_free (cache_dir);
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+#include <gtk/gtk.h>
+#include "gsk/gskcairocacheprivate.h"
+#include "reftest-compare.h"
+
+#define WIDTH 300
+#define HEIGHT 150
+
+/* The cacheable nodes don't overlap and are drawn onto a transparent
+ * surface, so compositing a cached surface gives the exact same pixels
+ * as drawing the node directly.
+ */
+static GskRenderNode *
+create_tree (double blur_radius)
+{
+  GdkRGBA red = { 1, 0, 0, 1 };
+  GdkRGBA green = { 0, 1, 0, 1 };
+  GdkRGBA blue = { 0, 0, 1, 1 };
+  GskRenderNode *nodes[3];
+  GskRenderNode *child, *container;
+  GskRoundedRect outline;
+  guint i;
+
+  /* Expensive, cached */
+  child = gsk_color_node_new (&red, &GRAPHENE_RECT_INIT (20, 20, 100, 100));
+  nodes[0] = gsk_blur_node_new (child, blur_radius);
+  gsk_render_node_unref (child);
+
+  /* Expensive, cached */
+  gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (170, 30, 80, 80), 10);
+  nodes[1] = gsk_outset_shadow_node_new (&outline, &green, 0, 0, 0, 8);
+
+  /* Cheap, never cached */
+  nodes[2] = gsk_color_node_new (&blue, &GRAPHENE_RECT_INIT (270, 20, 20, 100));
+
+  container = gsk_container_node_new (nodes, G_N_ELEMENTS (nodes));
+
+  for (i = 0; i < G_N_ELEMENTS (nodes); i++)
+    gsk_render_node_unref (nodes[i]);
+
+  return container;
+}
+
+static cairo_surface_t *
+draw_node (GskRenderNode *node,
+           GskCairoCache *cache)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+  cr = cairo_create (surface);
+
+  if (cache)
+    gsk_cairo_cache_attach (cache, cr);
+
+  gsk_render_node_draw (node, cr);
+
+  if (cache)
+    {
+      gsk_cairo_cache_attach (NULL, cr);
+      gsk_cairo_cache_end_frame (cache);
+    }
+
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+static void
+assert_same_pixels (cairo_surface_t *surface,
+                    cairo_surface_t *reference)
+{
+  cairo_surface_t *diff;
+
+  diff = reftest_compare_surfaces (surface, reference);
+  g_assert_null (diff);
+}
+
+/* A node is only remembered the first time it is drawn, rasterized the
+ * second time and drawn from the cache from then on. The output must
+ * not change along the way.
+ */
+static void
+test_reuse (void)
+{
+  GskCairoCache *cache;
+  GskRenderNode *node;
+  cairo_surface_t *reference, *surface;
+  guint hits, misses;
+  gsize size;
+
+  node = create_tree (10);
+  reference = draw_node (node, NULL);
+  cache = gsk_cairo_cache_new (16 * 1024 * 1024);
+
+  surface = draw_node (node, cache);
+  gsk_cairo_cache_get_stats (cache, &hits, &misses, &size);
+  g_assert_cmpuint (hits, ==, 0);
+  g_assert_cmpuint (misses, ==, 2);
+  g_assert_cmpuint (size, ==, 0);
+  assert_same_pixels (surface, reference);
+  cairo_surface_destroy (surface);
+
+  surface = draw_node (node, cache);
+  gsk_cairo_cache_get_stats (cache, &hits, &misses, &size);
+  g_assert_cmpuint (hits, ==, 0);
+  g_assert_cmpuint (misses, ==, 2);
+  g_assert_cmpuint (size, >, 0);
+  assert_same_pixels (surface, reference);
+  cairo_surface_destroy (surface);
+
+  surface = draw_node (node, cache);
+  gsk_cairo_cache_get_stats (cache, &hits, &misses, NULL);
+  g_assert_cmpuint (hits, ==, 2);
+  g_assert_cmpuint (misses, ==, 0);
+  assert_same_pixels (surface, reference);
+  cairo_surface_destroy (surface);
+
+  g_object_unref (cache);
+  cairo_surface_destroy (reference);
+  gsk_render_node_unref (node);
+}
+
+/* Equal nodes are found even when they are not the same instance,
+ * and a changed node must not be drawn from the old surface.
+ */
+static void
+test_changed (void)
+{
+  GskCairoCache *cache;
+  GskRenderNode *node, *copy, *changed;
+  cairo_surface_t *reference, *surface;
+  guint hits, misses;
+
+  node = create_tree (10);
+  copy = create_tree (10);
+  changed = create_tree (4);
+  cache = gsk_cairo_cache_new (16 * 1024 * 1024);
+
+  cairo_surface_destroy (draw_node (node, cache));
+  cairo_surface_destroy (draw_node (node, cache));
+  gsk_cairo_cache_get_stats (cache, NULL, NULL, NULL);
+
+  reference = draw_node (node, NULL);
+  surface = draw_node (copy, cache);
+  gsk_cairo_cache_get_stats (cache, &hits, &misses, NULL);
+  g_assert_cmpuint (hits, ==, 2);
+  g_assert_cmpuint (misses, ==, 0);
+  assert_same_pixels (surface, reference);
+  cairo_surface_destroy (surface);
+  cairo_surface_destroy (reference);
+
+  reference = draw_node (changed, NULL);
+  surface = draw_node (changed, cache);
+  gsk_cairo_cache_get_stats (cache, &hits, &misses, NULL);
+  g_assert_cmpuint (hits, ==, 1);
+  g_assert_cmpuint (misses, ==, 1);
+  assert_same_pixels (surface, reference);
+  cairo_surface_destroy (surface);
+  cairo_surface_destroy (reference);
+
+  g_object_unref (cache);
+  gsk_render_node_unref (changed);
+  gsk_render_node_unref (copy);
+  gsk_render_node_unref (node);
+}
+
+/* Nodes that would take more than a quarter of the budget are
+ * always drawn directly.
+ */
+static void
+test_too_large (void)
+{
+  GskCairoCache *cache;
+  GskRenderNode *node;
+  cairo_surface_t *reference, *surface;
+  guint hits, misses;
+  gsize size;
+  int i;
+
+  node = create_tree (10);
+  reference = draw_node (node, NULL);
+  cache = gsk_cairo_cache_new (64 * 1024);
+
+  for (i = 0; i < 3; i++)
+    {
+      surface = draw_node (node, cache);
+      gsk_cairo_cache_get_stats (cache, &hits, &misses, &size);
+      g_assert_cmpuint (hits, ==, 0);
+      g_assert_cmpuint (misses, ==, 2);
+      g_assert_cmpuint (size, ==, 0);
+      assert_same_pixels (surface, reference);
+      cairo_surface_destroy (surface);
+    }
+
+  g_object_unref (cache);
+  cairo_surface_destroy (reference);
+  gsk_render_node_unref (node);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/cairo-cache/reuse", test_reuse);
+  g_test_add_func ("/cairo-cache/changed", test_changed);
+  g_test_add_func ("/cairo-cache/too-large", test_too_large);
+
+  return g_test_run ();
+}
@@ -0,0 +1,258 @@
+#include <gtk/gtk.h>
+
+#include "gsk/gskrendernodeprivate.h"
+
+static GskRenderNode *
+color_node (const char *color,
+            float       x,
+            float       y,
+            float       width,
+            float       height)
+{
+  GdkRGBA rgba;
+
+  gdk_rgba_parse (&rgba, color);
+
+  return gsk_color_node_new (&rgba, &GRAPHENE_RECT_INIT (x, y, width, height));
+}
+
+/* Takes ownership of the children */
+static GskRenderNode *
+container_node (GskRenderNode *first,
+                ...)
+{
+  GskRenderNode *children[16];
+  GskRenderNode *node, *child;
+  guint i, n_children;
+  va_list args;
+
+  n_children = 0;
+  va_start (args, first);
+  for (child = first; child; child = va_arg (args, GskRenderNode *))
+    {
+      g_assert_cmpuint (n_children, <, G_N_ELEMENTS (children));
+      children[n_children++] = child;
+    }
+  va_end (args);
+
+  node = gsk_container_node_new (children, n_children);
+
+  for (i = 0; i < n_children; i++)
+    gsk_render_node_unref (children[i]);
+
+  return node;
+}
+
+/* Takes ownership of @child */
+static GskRenderNode *
+translate_node (GskRenderNode *child,
+                float          dx,
+                float          dy)
+{
+  graphene_matrix_t transform;
+  GskRenderNode *node;
+
+  graphene_matrix_init_translate (&transform, &GRAPHENE_POINT3D_INIT (dx, dy, 0));
+  node = gsk_transform_node_new (child, &transform);
+  gsk_render_node_unref (child);
+
+  return node;
+}
+
+/* Takes ownership of @child */
+static GskRenderNode *
+clip_node (GskRenderNode *child,
+           float          x,
+           float          y,
+           float          width,
+           float          height)
+{
+  GskRenderNode *node;
+
+  node = gsk_clip_node_new (child, &GRAPHENE_RECT_INIT (x, y, width, height));
+  gsk_render_node_unref (child);
+
+  return node;
+}
+
+/* Diffs the trees both ways and checks that the damage is the union
+ * of the @n_rects rectangles in @rects
+ */
+static void
+assert_diff (GskRenderNode               *node1,
+             GskRenderNode               *node2,
+             const cairo_rectangle_int_t *rects,
+             int                          n_rects)
+{
+  cairo_region_t *expected, *region;
+
+  expected = cairo_region_create_rectangles (rects, n_rects);
+
+  region = cairo_region_create ();
+  gsk_render_node_diff (node1, node2, region);
+  g_assert_true (cairo_region_equal (region, expected));
+  cairo_region_destroy (region);
+
+  region = cairo_region_create ();
+  gsk_render_node_diff (node2, node1, region);
+  g_assert_true (cairo_region_equal (region, expected));
+  cairo_region_destroy (region);
+
+  cairo_region_destroy (expected);
+}
+
+static GskRenderNode *
+create_tree (const char *middle_color)
+{
+  return container_node (color_node ("red", 0, 0, 10, 10),
+                         color_node (middle_color, 20, 0, 10, 10),
+                         color_node ("blue", 40, 0, 10, 10),
+                         NULL);
+}
+
+static void
+test_identical (void)
+{
+  GskRenderNode *node1, *node2;
+
+  node1 = create_tree ("green");
+  node2 = create_tree ("green");
+
+  assert_diff (node1, node1, NULL, 0);
+  assert_diff (node1, node2, NULL, 0);
+
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+static void
+test_changed_leaf (void)
+{
+  const cairo_rectangle_int_t damage[] = { { 20, 0, 10, 10 } };
+  GskRenderNode *node1, *node2;
+
+  node1 = create_tree ("green");
+  node2 = create_tree ("yellow");
+
+  assert_diff (node1, node2, damage, G_N_ELEMENTS (damage));
+
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+static void
+test_moved_leaf (void)
+{
+  const cairo_rectangle_int_t damage[] = { { 20, 0, 10, 10 }, { 25, 20, 10, 10 } };
+  GskRenderNode *node1, *node2;
+
+  node1 = create_tree ("green");
+  node2 = container_node (color_node ("red", 0, 0, 10, 10),
+                          color_node ("green", 25, 20, 10, 10),
+                          color_node ("blue", 40, 0, 10, 10),
+                          NULL);
+
+  assert_diff (node1, node2, damage, G_N_ELEMENTS (damage));
+
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+static void
+test_inserted_child (void)
+{
+  const cairo_rectangle_int_t damage[] = { { 20, 0, 10, 10 } };
+  GskRenderNode *node1, *node2;
+
+  node1 = container_node (color_node ("red", 0, 0, 10, 10),
+                          color_node ("blue", 40, 0, 10, 10),
+                          NULL);
+  node2 = create_tree ("green");
+
+  assert_diff (node1, node2, damage, G_N_ELEMENTS (damage));
+
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+static void
+test_reordered_children (void)
+{
+  const cairo_rectangle_int_t damage[] = { { 0, 0, 10, 10 }, { 5, 5, 10, 10 } };
+  GskRenderNode *node1, *node2;
+
+  /* Overlapping children that are drawn in another order */
+  node1 = container_node (color_node ("red", 0, 0, 10, 10),
+                          color_node ("green", 5, 5, 10, 10),
+                          color_node ("blue", 40, 0, 10, 10),
+                          NULL);
+  node2 = container_node (color_node ("green", 5, 5, 10, 10),
+                          color_node ("red", 0, 0, 10, 10),
+                          color_node ("blue", 40, 0, 10, 10),
+                          NULL);
+
+  assert_diff (node1, node2, damage, G_N_ELEMENTS (damage));
+
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+static void
+test_clip (void)
+{
+  const cairo_rectangle_int_t child_damage[] = { { 20, 0, 5, 10 } };
+  const cairo_rectangle_int_t clip_damage[] = { { 0, 0, 25, 10 }, { 0, 0, 35, 10 } };
+  GskRenderNode *node1, *node2, *node3;
+
+  node1 = clip_node (create_tree ("green"), 0, 0, 25, 10);
+  node2 = clip_node (create_tree ("yellow"), 0, 0, 25, 10);
+  node3 = clip_node (create_tree ("green"), 0, 0, 35, 10);
+
+  /* A changed child is only damaged inside the clip */
+  assert_diff (node1, node2, child_damage, G_N_ELEMENTS (child_damage));
+
+  /* A changed clip damages everything it draws, before and after */
+  assert_diff (node1, node3, clip_damage, G_N_ELEMENTS (clip_damage));
+
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+  gsk_render_node_unref (node3);
+}
+
+static void
+test_transform (void)
+{
+  const cairo_rectangle_int_t child_damage[] = { { 120, 50, 10, 10 } };
+  const cairo_rectangle_int_t transform_damage[] = { { 100, 50, 50, 10 }, { 0, 0, 50, 10 } };
+  GskRenderNode *node1, *node2, *node3;
+
+  node1 = translate_node (create_tree ("green"), 100, 50);
+  node2 = translate_node (create_tree ("yellow"), 100, 50);
+  node3 = translate_node (create_tree ("green"), 0, 0);
+
+  /* A changed child is damaged where it ends up */
+  assert_diff (node1, node2, child_damage, G_N_ELEMENTS (child_damage));
+
+  /* A changed transform damages everything, before and after */
+  assert_diff (node1, node3, transform_damage, G_N_ELEMENTS (transform_damage));
+
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+  gsk_render_node_unref (node3);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/diff/identical", test_identical);
+  g_test_add_func ("/diff/changed-leaf", test_changed_leaf);
+  g_test_add_func ("/diff/moved-leaf", test_moved_leaf);
+  g_test_add_func ("/diff/inserted-child", test_inserted_child);
+  g_test_add_func ("/diff/reordered-children", test_reordered_children);
+  g_test_add_func ("/diff/clip", test_clip);
+  g_test_add_func ("/diff/transform", test_transform);
+
+  return g_test_run ();
+}
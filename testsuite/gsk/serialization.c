@@ -0,0 +1,192 @@
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+/* Writes the node in @file in the binary format, maps it back in with
+ * gsk_render_node_load_from_file() and checks that the loaded tree is
+ * the same by comparing its serialization to the original one.
+ */
+static void
+test_binary_roundtrip (gconstpointer data)
+{
+  const char *filename = data;
+  GskRenderNode *node, *loaded;
+  GBytes *binary, *expected, *result;
+  GError *error = NULL;
+  char *path, *tmp;
+  int fd;
+
+  path = g_test_build_filename (G_TEST_DIST, filename, NULL);
+  node = gsk_render_node_load_from_file (path, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (node);
+
+  binary = gsk_render_node_serialize_with_format (node, GSK_SERIALIZATION_FORMAT_BINARY);
+  g_assert_nonnull (binary);
+
+  fd = g_file_open_tmp ("gsk-serialization-XXXXXX.node", &tmp, &error);
+  g_assert_no_error (error);
+  g_close (fd, NULL);
+  g_file_set_contents (tmp, g_bytes_get_data (binary, NULL), g_bytes_get_size (binary), &error);
+  g_assert_no_error (error);
+
+  loaded = gsk_render_node_load_from_file (tmp, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (loaded);
+  g_assert_cmpint (gsk_render_node_get_node_type (loaded), ==, gsk_render_node_get_node_type (node));
+
+  expected = gsk_render_node_serialize (node);
+  result = gsk_render_node_serialize (loaded);
+  g_assert_true (g_bytes_equal (expected, result));
+
+  /* Pixel data is used from the mapping, which outlives the file */
+  g_unlink (tmp);
+  g_bytes_unref (result);
+  result = gsk_render_node_serialize (loaded);
+  g_assert_true (g_bytes_equal (expected, result));
+
+  g_bytes_unref (result);
+  g_bytes_unref (expected);
+  g_bytes_unref (binary);
+  gsk_render_node_unref (loaded);
+  gsk_render_node_unref (node);
+  g_free (tmp);
+  g_free (path);
+}
+
+static void
+test_binary_invalid (void)
+{
+  GskRenderNode *node;
+  GBytes *binary, *truncated;
+  GError *error = NULL;
+  char *path;
+
+  path = g_test_build_filename (G_TEST_DIST, "colors.node", NULL);
+  node = gsk_render_node_load_from_file (path, &error);
+  g_assert_no_error (error);
+
+  binary = gsk_render_node_serialize_with_format (node, GSK_SERIALIZATION_FORMAT_BINARY);
+  truncated = g_bytes_new_from_bytes (binary, 0, g_bytes_get_size (binary) / 2);
+
+  g_assert_null (gsk_render_node_deserialize (truncated, &error));
+  g_assert_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA);
+  g_clear_error (&error);
+
+  g_bytes_unref (truncated);
+  g_bytes_unref (binary);
+  gsk_render_node_unref (node);
+  g_free (path);
+}
+
+/* Trees that are nested too deeply are rejected while loading instead
+ * of overflowing the stack later.
+ */
+static void
+test_binary_too_deep (void)
+{
+  GskRenderNode *node, *child;
+  GBytes *binary;
+  GError *error = NULL;
+  int i;
+
+  node = gsk_color_node_new (&(GdkRGBA) { 1, 0, 0, 1 }, &GRAPHENE_RECT_INIT (0, 0, 10, 10));
+  for (i = 0; i < 1000; i++)
+    {
+      child = node;
+      node = gsk_opacity_node_new (child, 0.5);
+      gsk_render_node_unref (child);
+    }
+
+  binary = gsk_render_node_serialize_with_format (node, GSK_SERIALIZATION_FORMAT_BINARY);
+
+  g_assert_null (gsk_render_node_deserialize (binary, &error));
+  g_assert_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA);
+  g_clear_error (&error);
+
+  g_bytes_unref (binary);
+  gsk_render_node_unref (node);
+}
+
+static guint32
+get_pixel (const cairo_surface_t *surface)
+{
+  return *(guint32 *) cairo_image_surface_get_data ((cairo_surface_t *) surface);
+}
+
+/* Both cairo nodes share the same pixel blob in the binary format,
+ * drawing to one of them must not change the other one.
+ */
+static void
+test_binary_cairo_draw (void)
+{
+  GskRenderNode *nodes[2], *node, *loaded;
+  GBytes *binary;
+  GError *error = NULL;
+  cairo_t *cr;
+  guint32 pixel;
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      nodes[i] = gsk_cairo_node_new (&GRAPHENE_RECT_INIT (i * 10, 0, 10, 10));
+      cr = gsk_cairo_node_get_draw_context (nodes[i], NULL);
+      cairo_set_source_rgb (cr, 1, 0, 0);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+    }
+
+  node = gsk_container_node_new (nodes, 2);
+  binary = gsk_render_node_serialize_with_format (node, GSK_SERIALIZATION_FORMAT_BINARY);
+
+  loaded = gsk_render_node_deserialize (binary, &error);
+  g_assert_no_error (error);
+  pixel = get_pixel (gsk_cairo_node_peek_surface (gsk_container_node_get_child (loaded, 1)));
+
+  cr = gsk_cairo_node_get_draw_context (gsk_container_node_get_child (loaded, 0), NULL);
+  cairo_set_source_rgb (cr, 0, 0, 1);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  g_assert_cmphex (get_pixel (gsk_cairo_node_peek_surface (gsk_container_node_get_child (loaded, 1))), ==, pixel);
+  g_assert_cmphex (get_pixel (gsk_cairo_node_peek_surface (gsk_container_node_get_child (loaded, 0))), !=, pixel);
+
+  gsk_render_node_unref (loaded);
+  g_bytes_unref (binary);
+  gsk_render_node_unref (node);
+  for (i = 0; i < 2; i++)
+    gsk_render_node_unref (nodes[i]);
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *files[] = {
+    "blendmode.node",
+    "blendmodes.node",
+    "cairo.node",
+    "colors.node",
+    "cross-fade.node",
+    "cross-fades.node",
+    "opacity.node",
+    "repeat.node",
+    "transform.node",
+  };
+  guint i;
+
+  gtk_test_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (files); i++)
+    {
+      char *name = g_strconcat ("/serialization/binary/", files[i], NULL);
+
+      g_test_add_data_func (name, files[i], test_binary_roundtrip);
+      g_free (name);
+    }
+
+  g_test_add_func ("/serialization/binary/invalid", test_binary_invalid);
+  g_test_add_func ("/serialization/binary/too-deep", test_binary_too_deep);
+  g_test_add_func ("/serialization/binary/cairo-draw", test_binary_cairo_draw);
+
+  return g_test_run ();
+}
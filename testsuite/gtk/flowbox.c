@@ -0,0 +1,187 @@
+#include <gtk/gtk.h>
+#include <stdlib.h>
+
+#define N_ITEMS 10000
+#define N_COLUMNS 5
+
+static GtkWidget *
+create_label (gpointer item,
+              gpointer user_data)
+{
+  gint *n_created = user_data;
+  GtkWidget *label;
+  gchar *s;
+
+  (*n_created)++;
+
+  s = g_strdup_printf ("%d", GPOINTER_TO_INT (g_object_get_data (item, "data")));
+  label = gtk_label_new (s);
+  g_free (s);
+
+  return label;
+}
+
+static void
+bind_label (gpointer   item,
+            GtkWidget *widget,
+            gpointer   user_data)
+{
+  gchar *s;
+
+  s = g_strdup_printf ("%d", GPOINTER_TO_INT (g_object_get_data (item, "data")));
+  gtk_label_set_label (GTK_LABEL (widget), s);
+  g_free (s);
+}
+
+static gint
+get_label (GtkFlowBoxChild *child)
+{
+  return atoi (gtk_label_get_label (GTK_LABEL (gtk_bin_get_child (GTK_BIN (child)))));
+}
+
+static guint
+check_virtual_children (GtkFlowBox *box)
+{
+  GList *children, *l;
+  GtkFlowBoxChild *child;
+  guint n_children;
+  gint index;
+
+  children = gtk_container_get_children (GTK_CONTAINER (box));
+  for (l = children; l; l = l->next)
+    {
+      child = l->data;
+      index = gtk_flow_box_child_get_index (child);
+      g_assert (gtk_flow_box_get_child_at_index (box, index) == child);
+      g_assert_cmpint (get_label (child), ==, index + 1000);
+    }
+
+  /* Children only exist for whole lines */
+  child = children ? children->data : NULL;
+  g_assert (child == NULL || gtk_flow_box_child_get_index (child) % N_COLUMNS == 0);
+
+  n_children = g_list_length (children);
+  g_list_free (children);
+
+  return n_children;
+}
+
+/* Lets the box update its children and get allocated until
+ * @index has a child, or not
+ */
+static void
+wait_for_child (GtkFlowBox *box,
+                gint        index,
+                gboolean    exists)
+{
+  gint64 deadline;
+
+  deadline = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  while (g_get_monotonic_time () < deadline)
+    {
+      while (g_main_context_iteration (NULL, FALSE));
+
+      if ((gtk_flow_box_get_child_at_index (box, index) != NULL) == exists)
+        break;
+
+      g_usleep (1000);
+    }
+
+  g_assert ((gtk_flow_box_get_child_at_index (box, index) != NULL) == exists);
+}
+
+static void
+test_virtual_model (void)
+{
+  GtkWidget *window, *sw;
+  GtkFlowBox *box;
+  GtkAdjustment *adjustment;
+  GListStore *store;
+  GtkFlowBoxChild *child;
+  GObject *item;
+  gint n_created;
+  guint n_children;
+  gint i;
+
+  store = g_list_store_new (G_TYPE_OBJECT);
+  for (i = 0; i < N_ITEMS; i++)
+    {
+      item = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_data (item, "data", GINT_TO_POINTER (i + 1000));
+      g_list_store_append (store, item);
+      g_object_unref (item);
+    }
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (window), 300, 200);
+  sw = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (window), sw);
+
+  box = GTK_FLOW_BOX (gtk_flow_box_new ());
+  gtk_flow_box_set_homogeneous (box, TRUE);
+  gtk_flow_box_set_min_children_per_line (box, N_COLUMNS);
+  gtk_flow_box_set_max_children_per_line (box, N_COLUMNS);
+  gtk_container_add (GTK_CONTAINER (sw), GTK_WIDGET (box));
+
+  adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (sw));
+  gtk_flow_box_set_vadjustment (box, adjustment);
+
+  n_created = 0;
+  gtk_flow_box_bind_model_virtual (box, G_LIST_MODEL (store),
+                                   create_label, bind_label,
+                                   &n_created, NULL);
+
+  gtk_widget_show (window);
+  wait_for_child (box, N_COLUMNS, TRUE);
+
+  /* Only the lines around the page exist */
+  n_children = check_virtual_children (box);
+  g_assert_cmpint (n_children, >, 0);
+  g_assert_cmpint (n_children, <, 1000);
+  g_assert_cmpint (n_created, ==, n_children);
+
+  /* The box is as large as if all items had children */
+  g_assert_cmpfloat (gtk_adjustment_get_upper (adjustment), >,
+                     10 * gtk_adjustment_get_page_size (adjustment));
+
+  child = gtk_flow_box_get_child_at_index (box, 0);
+  g_assert (child != NULL);
+  gtk_flow_box_select_child (box, child);
+
+  /* Scrolling away reuses the children */
+  gtk_adjustment_set_value (adjustment, gtk_adjustment_get_upper (adjustment) / 2);
+  wait_for_child (box, 0, FALSE);
+  g_assert (gtk_flow_box_get_selected_children (box) == NULL);
+  g_assert_cmpint (n_created, <, 1000);
+  check_virtual_children (box);
+
+  /* The selection is kept */
+  gtk_adjustment_set_value (adjustment, 0);
+  wait_for_child (box, 0, TRUE);
+  child = gtk_flow_box_get_child_at_index (box, 0);
+  g_assert (gtk_flow_box_child_is_selected (child));
+  check_virtual_children (box);
+
+  /* Changes to the model update the children */
+  g_list_store_remove (store, 0);
+  child = gtk_flow_box_get_child_at_index (box, 0);
+  g_assert (child != NULL);
+  g_assert (!gtk_flow_box_child_is_selected (child));
+  g_assert_cmpint (get_label (child), ==, 1001);
+
+  gtk_flow_box_bind_model (box, NULL, NULL, NULL, NULL);
+  g_assert (gtk_flow_box_get_child_at_index (box, 0) == NULL);
+
+  gtk_widget_destroy (window);
+  g_object_unref (store);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/flowbox/virtual-model", test_virtual_model);
+
+  return g_test_run ();
+}
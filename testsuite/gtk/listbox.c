@@ -1,4 +1,5 @@
 #include <gtk/gtk.h>
+#include <stdlib.h>
 
 static gint
 sort_list (GtkListBoxRow *row1,
@@ -434,6 +435,200 @@ test_header (void)
   g_object_unref (list);
 }
 
+static GtkWidget *
+create_label (gpointer item,
+              gpointer user_data)
+{
+  gint *n_created = user_data;
+  GtkWidget *label;
+  gchar *s;
+
+  (*n_created)++;
+
+  s = g_strdup_printf ("%d", GPOINTER_TO_INT (g_object_get_data (item, "data")));
+  label = gtk_label_new (s);
+  g_free (s);
+
+  return label;
+}
+
+static void
+bind_label (gpointer   item,
+            GtkWidget *widget,
+            gpointer   user_data)
+{
+  gchar *s;
+
+  s = g_strdup_printf ("%d", GPOINTER_TO_INT (g_object_get_data (item, "data")));
+  gtk_label_set_label (GTK_LABEL (widget), s);
+  g_free (s);
+}
+
+static void
+check_virtual_rows (GtkListBox *list)
+{
+  GList *children, *l;
+  GtkListBoxRow *row;
+  GtkWidget *label;
+  gint index;
+
+  children = gtk_container_get_children (GTK_CONTAINER (list));
+  for (l = children; l; l = l->next)
+    {
+      row = l->data;
+      label = gtk_bin_get_child (GTK_BIN (row));
+      index = gtk_list_box_row_get_index (row);
+      g_assert (gtk_list_box_get_row_at_index (list, index) == row);
+      g_assert_cmpint (atoi (gtk_label_get_label (GTK_LABEL (label))), ==, index + 1000);
+    }
+  g_list_free (children);
+}
+
+static void
+run_idles (void)
+{
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+}
+
+static void
+test_virtual_model (void)
+{
+  GtkListBox *list;
+  GtkAdjustment *adjustment;
+  GListStore *store;
+  GtkListBoxRow *row;
+  GList *children;
+  GObject *item;
+  gint n_created;
+  gint i;
+
+  store = g_list_store_new (G_TYPE_OBJECT);
+  for (i = 0; i < 10000; i++)
+    {
+      item = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_data (item, "data", GINT_TO_POINTER (i + 1000));
+      g_list_store_append (store, item);
+      g_object_unref (item);
+    }
+
+  list = GTK_LIST_BOX (gtk_list_box_new ());
+  g_object_ref_sink (list);
+  gtk_widget_show (GTK_WIDGET (list));
+
+  adjustment = gtk_adjustment_new (0, 0, 1000000, 1, 100, 100);
+  gtk_list_box_set_adjustment (list, adjustment);
+
+  n_created = 0;
+  gtk_list_box_bind_model_virtual (list, G_LIST_MODEL (store),
+                                   create_label, bind_label,
+                                   &n_created, NULL);
+
+  /* Only the rows around the page exist */
+  children = gtk_container_get_children (GTK_CONTAINER (list));
+  g_assert_cmpint (g_list_length (children), >, 0);
+  g_assert_cmpint (g_list_length (children), <, 1000);
+  g_assert_cmpint (n_created, ==, g_list_length (children));
+  g_list_free (children);
+  check_virtual_rows (list);
+
+  row = gtk_list_box_get_row_at_index (list, 0);
+  g_assert (row != NULL);
+  gtk_list_box_select_row (list, row);
+
+  /* Scrolling away reuses the rows */
+  gtk_adjustment_set_value (adjustment, 50000);
+  run_idles ();
+  g_assert (gtk_list_box_get_row_at_index (list, 0) == NULL);
+  g_assert (gtk_list_box_get_selected_row (list) == NULL);
+  g_assert_cmpint (n_created, <, 1000);
+  check_virtual_rows (list);
+
+  /* The selection is kept */
+  gtk_adjustment_set_value (adjustment, 0);
+  run_idles ();
+  row = gtk_list_box_get_row_at_index (list, 0);
+  g_assert (row != NULL);
+  g_assert (gtk_list_box_row_is_selected (row));
+  g_assert (gtk_list_box_get_selected_row (list) == row);
+  check_virtual_rows (list);
+
+  /* Changes to the model update the rows */
+  g_list_store_remove (G_LIST_STORE (store), 0);
+  g_assert (gtk_list_box_get_selected_row (list) == NULL);
+  row = gtk_list_box_get_row_at_index (list, 0);
+  g_assert (!gtk_list_box_row_is_selected (row));
+  g_assert_cmpint (atoi (gtk_label_get_label (GTK_LABEL (gtk_bin_get_child (GTK_BIN (row))))), ==, 1001);
+
+  gtk_list_box_bind_model (list, NULL, NULL, NULL, NULL);
+  g_assert (gtk_list_box_get_row_at_index (list, 0) == NULL);
+
+  g_object_unref (list);
+  g_object_unref (store);
+}
+
+/* The focus row is not recycled when it scrolls away */
+static void
+test_virtual_focus (void)
+{
+  GtkWidget *window;
+  GtkListBox *list;
+  GtkAdjustment *adjustment;
+  GListStore *store;
+  GtkListBoxRow *row;
+  GObject *item;
+  gint n_created;
+  gint i;
+
+  store = g_list_store_new (G_TYPE_OBJECT);
+  for (i = 0; i < 10000; i++)
+    {
+      item = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_data (item, "data", GINT_TO_POINTER (i + 1000));
+      g_list_store_append (store, item);
+      g_object_unref (item);
+    }
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  list = GTK_LIST_BOX (gtk_list_box_new ());
+  gtk_container_add (GTK_CONTAINER (window), GTK_WIDGET (list));
+
+  adjustment = gtk_adjustment_new (0, 0, 1000000, 1, 100, 100);
+  gtk_list_box_set_adjustment (list, adjustment);
+
+  n_created = 0;
+  gtk_list_box_bind_model_virtual (list, G_LIST_MODEL (store),
+                                   create_label, bind_label,
+                                   &n_created, NULL);
+
+  row = gtk_list_box_get_row_at_index (list, 0);
+  gtk_widget_grab_focus (GTK_WIDGET (row));
+  g_assert (gtk_widget_has_focus (GTK_WIDGET (row)));
+
+  gtk_adjustment_set_value (adjustment, 50000);
+  run_idles ();
+  g_assert (gtk_list_box_get_row_at_index (list, 0) == NULL);
+  g_assert (gtk_widget_get_parent (GTK_WIDGET (row)) == GTK_WIDGET (list));
+  g_assert (gtk_widget_has_focus (GTK_WIDGET (row)));
+
+  /* Moving the focus on brings the row back first */
+  gtk_widget_child_focus (GTK_WIDGET (list), GTK_DIR_DOWN);
+  g_assert (gtk_list_box_get_row_at_index (list, 0) == row);
+  g_assert (gtk_widget_has_focus (GTK_WIDGET (gtk_list_box_get_row_at_index (list, 1))));
+  check_virtual_rows (list);
+
+  /* The row of a removed item goes away */
+  row = gtk_list_box_get_row_at_index (list, 1);
+  gtk_adjustment_set_value (adjustment, 50000);
+  run_idles ();
+  g_list_store_remove (store, 1);
+  g_assert (!gtk_widget_has_focus (GTK_WIDGET (row)));
+  check_virtual_rows (list);
+
+  gtk_widget_destroy (window);
+  g_object_unref (store);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -444,6 +639,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/listbox/multi-selection", test_multi_selection);
   g_test_add_func ("/listbox/filter", test_filter);
   g_test_add_func ("/listbox/header", test_header);
+  g_test_add_func ("/listbox/virtual-model", test_virtual_model);
+  g_test_add_func ("/listbox/virtual-focus", test_virtual_focus);
 
   return g_test_run ();
 }
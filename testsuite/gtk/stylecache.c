@@ -0,0 +1,147 @@
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+/* The shared style cache is checked with the CSS trace, which records
+ * where the style of every restyled node came from.
+ */
+
+static gchar *trace_filename;
+
+static guint
+count_shared_labels (void)
+{
+  gchar *contents;
+  gchar **lines;
+  guint i, count;
+
+  if (!g_file_get_contents (trace_filename, &contents, NULL, NULL))
+    return 0;
+
+  count = 0;
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i]; i++)
+    {
+      if (g_str_has_prefix (lines[i], "{\"name\":\"label") &&
+          strstr (lines[i], "\"result\":\"shared-cache\"") != NULL)
+        count++;
+    }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return count;
+}
+
+static GtkWidget *
+create_labels (void)
+{
+  GtkWidget *box, *label;
+  gint i;
+
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  for (i = 0; i < 5; i++)
+    {
+      label = gtk_label_new ("Hello");
+      gtk_style_context_add_class (gtk_widget_get_style_context (label), "shared");
+      gtk_container_add (GTK_CONTAINER (box), label);
+    }
+
+  return box;
+}
+
+static void
+ensure_styles (GtkWidget *widget,
+               gpointer   data)
+{
+  GdkRGBA color;
+
+  gtk_style_context_get_color (gtk_widget_get_style_context (widget), &color);
+
+  if (GTK_IS_CONTAINER (widget))
+    gtk_container_forall (GTK_CONTAINER (widget), ensure_styles, NULL);
+}
+
+static GtkWidget *
+create_window (void)
+{
+  GtkWidget *window, *container;
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  container = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  gtk_container_add (GTK_CONTAINER (window), container);
+
+  return window;
+}
+
+static void
+test_shared_cache (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *window1, *window2, *container1, *container2;
+  GtkWidget *labels1, *labels2;
+  guint count;
+
+  /* A style that depends on the ancestors of the labels */
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, "window box label.shared { color: red; }", -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  window1 = create_window ();
+  container1 = gtk_bin_get_child (GTK_BIN (window1));
+  labels1 = create_labels ();
+  gtk_container_add (GTK_CONTAINER (container1), labels1);
+  ensure_styles (window1, NULL);
+
+  /* Labels in the same place in another window */
+  count = count_shared_labels ();
+  window2 = create_window ();
+  container2 = gtk_bin_get_child (GTK_BIN (window2));
+  labels2 = create_labels ();
+  gtk_container_add (GTK_CONTAINER (container2), labels2);
+  ensure_styles (window2, NULL);
+  g_assert_cmpuint (count_shared_labels (), >, count);
+
+  /* Reparenting does not throw away the cache */
+  gtk_container_remove (GTK_CONTAINER (container2), labels2);
+  ensure_styles (window2, NULL);
+
+  count = count_shared_labels ();
+  g_object_ref (labels1);
+  gtk_container_remove (GTK_CONTAINER (container1), labels1);
+  gtk_container_add (GTK_CONTAINER (container2), labels1);
+  g_object_unref (labels1);
+  ensure_styles (window2, NULL);
+  g_assert_cmpuint (count_shared_labels (), >, count);
+
+  gtk_widget_destroy (window1);
+  gtk_widget_destroy (window2);
+
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gint fd, result;
+
+  fd = g_file_open_tmp ("gtk-css-trace-XXXXXX", &trace_filename, NULL);
+  g_assert (fd >= 0);
+  g_close (fd, NULL);
+  g_setenv ("GTK_CSS_TRACE", trace_filename, TRUE);
+
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/style/shared-cache", test_shared_cache);
+
+  result = g_test_run ();
+
+  g_unlink (trace_filename);
+  g_free (trace_filename);
+
+  return result;
+}
@@ -1556,6 +1556,219 @@ test_get_iter (void)
   g_object_unref (buffer);
 }
 
+static void
+test_insert_stream (void)
+{
+  GtkTextBuffer *buffer;
+  GInputStream *stream;
+  GtkTextIter iter, start, end;
+  GString *text;
+  gchar *expected, *result;
+  GError *error = NULL;
+  gboolean success;
+
+  /* Put a "\r\n" and a two-byte character where the stream is
+   * read in two chunks.
+   */
+  text = g_string_new (NULL);
+  while (text->len < 65535)
+    g_string_append_c (text, 'x');
+  g_string_append (text, "\r\n");
+  while (text->len < 131069)
+    g_string_append_c (text, 'y');
+  g_string_append (text, "\303\251\nend");
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "ab", -1);
+  gtk_text_buffer_get_iter_at_offset (buffer, &iter, 1);
+
+  stream = g_memory_input_stream_new_from_data (text->str, text->len, NULL);
+  success = gtk_text_buffer_insert_stream (buffer, &iter, stream, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (success);
+  g_object_unref (stream);
+
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 1 + g_utf8_strlen (text->str, text->len));
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 3);
+
+  expected = g_strconcat ("a", text->str, "b", NULL);
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  result = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+  g_assert_cmpstr (result, ==, expected);
+  g_free (result);
+  g_free (expected);
+
+  /* Invalid text is reported, but what has been read is kept */
+  gtk_text_buffer_set_text (buffer, "", -1);
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  stream = g_memory_input_stream_new_from_data ("abc\nd\377\377\377\377", -1, NULL);
+  success = gtk_text_buffer_insert_stream (buffer, &iter, stream, NULL, &error);
+  g_assert_error (error, G_CONVERT_ERROR, G_CONVERT_ERROR_ILLEGAL_SEQUENCE);
+  g_assert (!success);
+  g_clear_error (&error);
+  g_object_unref (stream);
+
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  result = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+  g_assert_cmpstr (result, ==, "abc\nd");
+  g_free (result);
+
+  g_string_free (text, TRUE);
+  g_object_unref (buffer);
+}
+
+static void
+test_insert_stream_paragraphs (void)
+{
+  GtkTextBuffer *buffer;
+  GInputStream *stream;
+  GtkTextIter iter, start, end;
+  GString *text;
+  gchar *expected, *result;
+  GError *error = NULL;
+  gboolean success;
+  gint i, j;
+
+  /* Lines that are longer than half a chunk, so most lines after the
+   * first one start in one chunk and end in the next. The tree is
+   * checked after loading, as btree debugging is turned on.
+   */
+  text = g_string_new (NULL);
+  for (i = 0; i < 10; i++)
+    {
+      for (j = 0; j < 40000; j++)
+        g_string_append_c (text, 'a' + i);
+      g_string_append_c (text, '\n');
+    }
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "ab", -1);
+  gtk_text_buffer_get_iter_at_offset (buffer, &iter, 1);
+
+  stream = g_memory_input_stream_new_from_data (text->str, text->len, NULL);
+  success = gtk_text_buffer_insert_stream (buffer, &iter, stream, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (success);
+  g_object_unref (stream);
+
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 11);
+
+  for (i = 1; i < 10; i++)
+    {
+      gtk_text_buffer_get_iter_at_line (buffer, &iter, i);
+      g_assert_cmpint (gtk_text_iter_get_chars_in_line (&iter), ==, 40001);
+      g_assert_cmpint (gtk_text_iter_get_char (&iter), ==, 'a' + i);
+    }
+
+  expected = g_strconcat ("a", text->str, "b", NULL);
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  result = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+  g_assert_cmpstr (result, ==, expected);
+  g_free (result);
+  g_free (expected);
+
+  g_string_free (text, TRUE);
+  g_object_unref (buffer);
+}
+
+static void
+test_insert_stream_lines (void)
+{
+  GtkTextBuffer *buffer;
+  GInputStream *stream;
+  GtkTextIter iter, start, end;
+  GtkTextTag *tag;
+  GString *text;
+  gchar *result, *expected;
+  GError *error = NULL;
+  gboolean success;
+  gint i;
+
+  /* Enough lines to fill many leaves of the btree */
+  text = g_string_new (NULL);
+  for (i = 0; i < 5000; i++)
+    g_string_append_printf (text, i % 100 == 0 ? "\327\251\327\234 %d\n" : "line %d\n", i);
+
+  buffer = gtk_text_buffer_new (NULL);
+  tag = gtk_text_buffer_create_tag (buffer, NULL, NULL);
+  gtk_text_buffer_set_text (buffer, "ab", -1);
+  gtk_text_buffer_get_iter_at_offset (buffer, &iter, 1);
+
+  stream = g_memory_input_stream_new_from_data (text->str, text->len, NULL);
+  success = gtk_text_buffer_insert_stream (buffer, &iter, stream, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (success);
+  g_object_unref (stream);
+
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 5001);
+
+  expected = g_strconcat ("a", text->str, "b", NULL);
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  result = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+  g_assert_cmpstr (result, ==, expected);
+  g_free (result);
+
+  /* Lines in the middle of the load can be reached */
+  gtk_text_buffer_get_iter_at_line (buffer, &start, 2501);
+  end = start;
+  gtk_text_iter_forward_to_line_end (&end);
+  result = gtk_text_iter_get_text (&start, &end);
+  g_assert_cmpstr (result, ==, "line 2501");
+  g_free (result);
+
+  gtk_text_buffer_get_iter_at_line (buffer, &start, 1001);
+  gtk_text_buffer_get_iter_at_line (buffer, &end, 4001);
+  gtk_text_buffer_apply_tag (buffer, tag, &start, &end);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 3000);
+  g_assert (gtk_text_iter_has_tag (&iter, tag));
+
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  result = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+  g_assert_cmpstr (result, ==, expected);
+  g_free (result);
+  result = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+  g_assert_cmpstr (result, ==, expected);
+  g_free (result);
+
+  gtk_text_buffer_get_iter_at_line (buffer, &start, 10);
+  gtk_text_buffer_get_iter_at_line (buffer, &end, 4990);
+  gtk_text_buffer_delete (buffer, &start, &end);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 21);
+
+  /* A short stream in a large buffer ends in the leaf it starts in */
+  gtk_text_buffer_set_text (buffer, text->str, -1);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 2500);
+
+  stream = g_memory_input_stream_new_from_data ("short\nstream\n", -1, NULL);
+  success = gtk_text_buffer_insert_stream (buffer, &iter, stream, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (success);
+  g_object_unref (stream);
+
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 2502);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 5003);
+  g_assert_cmpint (gtk_text_buffer_get_char_count (buffer), ==,
+                   g_utf8_strlen (text->str, text->len) + 13);
+
+  gtk_text_buffer_get_iter_at_line (buffer, &start, 2501);
+  end = start;
+  gtk_text_iter_forward_to_line_end (&end);
+  result = gtk_text_iter_get_text (&start, &end);
+  g_assert_cmpstr (result, ==, "stream");
+  g_free (result);
+
+  gtk_text_buffer_get_end_iter (buffer, &end);
+  start = end;
+  gtk_text_iter_backward_line (&start);
+  result = gtk_text_iter_get_text (&start, &end);
+  g_assert_cmpstr (result, ==, "line 4999\n");
+  g_free (result);
+
+  g_free (expected);
+  g_string_free (text, TRUE);
+  g_object_unref (buffer);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -1575,6 +1788,9 @@ main (int argc, char** argv)
   g_test_add_func ("/TextBuffer/Tag", test_tag);
   g_test_add_func ("/TextBuffer/Clipboard", test_clipboard);
   g_test_add_func ("/TextBuffer/Get iter", test_get_iter);
+  g_test_add_func ("/TextBuffer/Insert stream", test_insert_stream);
+  g_test_add_func ("/TextBuffer/Insert stream lines", test_insert_stream_lines);
+  g_test_add_func ("/TextBuffer/Insert stream paragraphs", test_insert_stream_paragraphs);
 
   return g_test_run();
 }
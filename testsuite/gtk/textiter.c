@@ -279,6 +279,78 @@ test_search_caseless (void)
   check_found_backward ("aa \303\200", "aa", flags, 0, 2, "aa");
 }
 
+static void
+check_search_all (GtkTextBuffer      *buffer,
+                  const gchar        *str,
+                  GtkTextSearchFlags  flags,
+                  guint               n_matches,
+                  const gchar        *expected)
+{
+  GtkTextIter start, end;
+  GArray *matches;
+  gchar *text;
+  guint i;
+
+  gtk_text_buffer_get_start_iter (buffer, &start);
+  matches = gtk_text_iter_forward_search_all (&start, str, flags, NULL);
+  g_assert_cmpuint (matches->len, ==, 2 * n_matches);
+
+  for (i = 0; expected && i < matches->len; i += 2)
+    {
+      gtk_text_buffer_get_iter_at_offset (buffer, &start, g_array_index (matches, gint, i));
+      gtk_text_buffer_get_iter_at_offset (buffer, &end, g_array_index (matches, gint, i + 1));
+      text = gtk_text_iter_get_text (&start, &end);
+      g_assert_cmpstr (text, ==, expected);
+      g_free (text);
+    }
+
+  g_array_unref (matches);
+}
+
+static void
+test_search_all (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextTag *tag;
+  GtkTextIter start, end;
+  gint i;
+
+  buffer = gtk_text_buffer_new (NULL);
+  tag = gtk_text_buffer_create_tag (buffer, NULL, NULL);
+
+  gtk_text_buffer_get_start_iter (buffer, &start);
+  for (i = 0; i < 1000; i++)
+    {
+      if (i == 100 || i == 900)
+        gtk_text_buffer_insert (buffer, &start, "some needle here\n", -1);
+      else
+        gtk_text_buffer_insert (buffer, &start, "some text here\n", -1);
+    }
+
+  /* Split the segments of a match */
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &start, 900, 7);
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &end, 900, 9);
+  gtk_text_buffer_apply_tag (buffer, tag, &start, &end);
+
+  check_search_all (buffer, "needle", 0, 2, "needle");
+  check_search_all (buffer, "NEEDLE", GTK_TEXT_SEARCH_CASE_INSENSITIVE, 2, "needle");
+  check_search_all (buffer, "e", 0, 4004, "e");
+  check_search_all (buffer, "hay", 0, 0, NULL);
+
+  /* Edits are picked up */
+  gtk_text_buffer_get_iter_at_line (buffer, &start, 500);
+  gtk_text_buffer_insert (buffer, &start, "Needle", -1);
+  check_search_all (buffer, "needle", GTK_TEXT_SEARCH_CASE_INSENSITIVE, 3, NULL);
+  check_search_all (buffer, "Needle", 0, 1, "Needle");
+
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &start, 100, 5);
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &end, 100, 6);
+  gtk_text_buffer_delete (buffer, &start, &end);
+  check_search_all (buffer, "needle", 0, 1, "needle");
+
+  g_object_unref (buffer);
+}
+
 static void
 test_forward_to_tag_toggle (void)
 {
@@ -789,6 +861,7 @@ main (int argc, char** argv)
   g_test_add_func ("/TextIter/Search Full Buffer", test_search_full_buffer);
   g_test_add_func ("/TextIter/Search", test_search);
   g_test_add_func ("/TextIter/Search Caseless", test_search_caseless);
+  g_test_add_func ("/TextIter/Search All", test_search_all);
   g_test_add_func ("/TextIter/Forward To Tag Toggle", test_forward_to_tag_toggle);
   g_test_add_func ("/TextIter/Forward To Line End", test_forward_to_line_end);
   g_test_add_func ("/TextIter/Word Boundaries", test_word_boundaries);
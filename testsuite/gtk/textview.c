@@ -0,0 +1,68 @@
+#include <gtk/gtk.h>
+
+#define N_LINES 3000
+
+/* Lines that are not on screen are measured in a thread. Appending
+ * to the buffer while that happens, like a log view does, must not
+ * keep the lines before the end from getting their sizes.
+ */
+static void
+test_validate_while_appending (void)
+{
+  GtkWidget *window, *sw, *view;
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GString *text;
+  gint64 deadline;
+  gint y, height;
+  int i;
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (window), 300, 200);
+  sw = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (window), sw);
+  view = gtk_text_view_new ();
+  gtk_container_add (GTK_CONTAINER (sw), view);
+
+  text = g_string_new (NULL);
+  for (i = 0; i < N_LINES; i++)
+    g_string_append_printf (text, "line %d\n", i);
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (view));
+  gtk_text_buffer_set_text (buffer, text->str, text->len);
+  g_string_free (text, TRUE);
+
+  gtk_widget_show (window);
+
+  height = 0;
+  deadline = g_get_monotonic_time () + 30 * G_TIME_SPAN_SECOND;
+  while (g_get_monotonic_time () < deadline)
+    {
+      gtk_text_buffer_get_end_iter (buffer, &iter);
+      gtk_text_buffer_insert (buffer, &iter, "more\n", -1);
+
+      while (g_main_context_iteration (NULL, FALSE));
+
+      gtk_text_buffer_get_iter_at_line (buffer, &iter, N_LINES - 500);
+      gtk_text_view_get_line_yrange (GTK_TEXT_VIEW (view), &iter, &y, &height);
+      if (height > 0)
+        break;
+
+      g_usleep (1000);
+    }
+
+  g_assert_cmpint (height, >, 0);
+  g_assert_cmpint (y, >, 0);
+
+  gtk_widget_destroy (window);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/textview/validate-while-appending", test_validate_while_appending);
+
+  return g_test_run ();
+}